@@ -25,81 +25,83 @@
 #include "ras-mce-handler.h"
 #include "bitfield.h"
 
-unsigned bitfield_msg(char *buf, size_t len, const char **bitarray,
+/*
+ * Appends the names of the bits set at status, separated by commas.
+ * bitarray[i] names bit (i + bit_offset) of status, and ignore_bits is
+ * a mask of the bitarray indexes to skip.
+ * Returns the number of characters added.
+ */
+unsigned bitfield_msg(struct strbuf *sb, const char **bitarray,
 		      unsigned array_len,
 		      unsigned bit_offset, unsigned ignore_bits,
 		      uint64_t status)
 {
-	int i, n;
-	char *p = buf;
+	unsigned start = sb->len;
+	uint64_t bits = status >> bit_offset;
 
-	len--;
+	if (array_len < 64)
+		bits &= (1ULL << array_len) - 1;
+	bits &= ~(uint64_t)ignore_bits;
 
-	for (i = 0; i < array_len; i++) {
-		if (status & ignore_bits)
-			continue;
-		if (status & (1 <<  (i + bit_offset))) {
-			if (p != buf) {
-				n = snprintf(p, len, ", ");
-				if (n < 0)
-					break;
-				len -= n;
-				p += n;
-			}
-			if (!bitarray[i])
-				n = snprintf(p, len, "BIT%d", i + bit_offset);
-			else
-				n = snprintf(p, len, "%s", bitarray[i]);
-			if (n < 0)
-				break;
-			len -= n;
-			p += n;
-		}
+	while (bits) {
+		int i = __builtin_ctzll(bits);
+
+		bits &= bits - 1;
+		if (sb->len != start)
+			strbuf_add(sb, ", ", 2);
+		if (!bitarray[i])
+			strbuf_printf(sb, "BIT%d", i + bit_offset);
+		else
+			strbuf_puts(sb, bitarray[i]);
 	}
 
-	*p = 0;
-	return p - buf;
+	return sb->len - start;
 }
 
-static uint64_t bitmask(uint64_t i)
-{
-	uint64_t mask = 1;
-	while (mask < i)
-		mask = (mask << 1) | 1;
-	return mask;
-}
-
-void decode_bitfield(struct mce_event *e, uint64_t status,
+#ifdef HAVE_MCE
+void decode_bitfield(struct mce_text *t, uint64_t status,
 		     struct field *fields)
 {
+	struct strbuf sb;
 	struct field *f;
 
+	mce_text_begin(t, &sb);
+
 	for (f = fields; f->str; f++) {
-		uint64_t v = (status >> f->start_bit) & bitmask(f->stringlen - 1);
+		uint64_t v = (status >> f->start_bit) & f->mask;
 		char *s = NULL;
 		if (v < f->stringlen)
 			s = f->str[v];
 		if (!s) {
 			if (v == 0)
 				continue;
-			mce_snprintf(e->error_msg, "<%u:%llx>",
-				     f->start_bit, (long long)v);
-		} else
-			mce_snprintf(e->error_msg, "%s", s);
+			strbuf_catf(&sb, "<%u:%llx>",
+				    f->start_bit, (long long)v);
+		} else {
+			if (sb.len)
+				strbuf_add(&sb, " ", 1);
+			strbuf_puts(&sb, s);
+		}
 	}
+	mce_text_end(t, &sb);
 }
 
-void decode_numfield(struct mce_event *e, uint64_t status,
+void decode_numfield(struct mce_text *t, uint64_t status,
 		     struct numfield *fields)
 {
+	struct strbuf sb;
 	struct numfield *f;
+
+	mce_text_begin(t, &sb);
 	for (f = fields; f->name; f++) {
-		uint64_t mask = (1ULL << (f->end - f->start + 1)) - 1;
-		uint64_t v = (status >> f->start) & mask;
+		uint64_t v = (status >> f->start) & f->mask;
 		if (v > 0 || f->force) {
-			char fmt[32] = {0};
-			snprintf(fmt, 32, "%%s: %s\n", f->fmt ? f->fmt : "%Lu");
-			mce_snprintf(e->error_msg, fmt, f->name, v);
+			strbuf_catf(&sb, "%s: ", f->name);
+			strbuf_printf(&sb, f->fmt ? f->fmt : "%Lu",
+				      (unsigned long long)v);
+			strbuf_add(&sb, "\n", 1);
 		}
 	}
+	mce_text_end(t, &sb);
 }
+#endif
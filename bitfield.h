@@ -19,12 +19,19 @@
 
 #include <stdint.h>
 
+#include "strbuf.h"
+
 /* Generic bitfield decoder */
 
+/*
+ * The masks are evaluated at build time by the macros below, so the
+ * decoders just need a shift and an AND per field.
+ */
 struct field {
 	unsigned start_bit;
 	char **str;
 	unsigned stringlen;
+	uint64_t mask;		/* Smallest all-ones mask covering stringlen - 1 */
 };
 
 struct numfield {
@@ -32,24 +39,29 @@ struct numfield {
 	char *name;
 	char *fmt;
 	int force;
+	uint64_t mask;
 };
 
-#define FIELD(start_bit, name) { start_bit, name, ARRAY_SIZE(name) }
-#define SBITFIELD(start_bit, string) { start_bit, ((char * [2]) { NULL, string }), 2 }
+#define MASK(x) ((1ULL << (1 + (x))) - 1)
+#define STRINGS_MASK(n) ((2ULL << (63 - __builtin_clzll(((n) - 1) | 1))) - 1)
 
-#define NUMBER(start, end, name) { start, end, name, "%Lu", 0 }
-#define NUMBERFORCE(start, end, name) { start, end, name, "%Lu", 1 }
-#define HEXNUMBER(start, end, name) { start, end, name, "%Lx", 0 }
-#define HEXNUMBERFORCE(start, end, name) { start, end, name, "%Lx", 1 }
+#define FIELD(start_bit, name) { start_bit, name, ARRAY_SIZE(name), STRINGS_MASK(ARRAY_SIZE(name)) }
+/* Reserved fields, without names */
+#define FIELD_NULL(start_bit) { start_bit, NULL, 0, 0 }
+#define SBITFIELD(start_bit, string) { start_bit, ((char * [2]) { NULL, string }), 2, 1 }
 
-struct mce_event;
+#define NUMBER(start, end, name) { start, end, name, "%Lu", 0, MASK((end) - (start)) }
+#define NUMBERFORCE(start, end, name) { start, end, name, "%Lu", 1, MASK((end) - (start)) }
+#define HEXNUMBER(start, end, name) { start, end, name, "%Lx", 0, MASK((end) - (start)) }
+#define HEXNUMBERFORCE(start, end, name) { start, end, name, "%Lx", 1, MASK((end) - (start)) }
 
-void decode_bitfield(struct mce_event *e, uint64_t status,
+struct mce_text;
+
+void decode_bitfield(struct mce_text *t, uint64_t status,
 		     struct field *fields);
-void decode_numfield(struct mce_event *e, uint64_t status,
+void decode_numfield(struct mce_text *t, uint64_t status,
 		     struct numfield *fields);
 
-#define MASK(x) ((1ULL << (1 + (x))) - 1)
 #define EXTRACT(v, a, b) (((v) >> (a)) & MASK((b)-(a)))
 
 static inline int test_prefix(int nr, uint32_t value)
@@ -59,7 +71,7 @@ static inline int test_prefix(int nr, uint32_t value)
 
 /* Ancillary routines */
 
-unsigned bitfield_msg(char *buf, size_t len, const char **bitarray,
+unsigned bitfield_msg(struct strbuf *sb, const char **bitarray,
 		      unsigned array_len,
 		      unsigned bit_offset, unsigned ignore_bits,
 		      uint64_t status);
@@ -0,0 +1,205 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "librasdecode.h"
+#include "ras-mce-handler.h"
+#include "ras-aer-handler.h"
+#include "ras-cper.h"
+#include "ras-logger.h"
+
+struct rasdec_ctx {
+	struct mce_priv		mce;
+	/* The decoders just look at the mce_priv */
+	struct ras_events	ras;
+};
+
+static rasdec_log_fn log_fn;
+static void *log_priv;
+
+void rasdec_set_log(rasdec_log_fn fn, void *priv)
+{
+	log_priv = priv;
+	log_fn = fn;
+}
+
+void librasdecode_log(int level, const char *fmt, ...)
+{
+	char msg[512];
+	va_list ap;
+	size_t len;
+
+	if (!log_fn)
+		return;
+
+	va_start(ap, fmt);
+	vsnprintf(msg, sizeof(msg), fmt, ap);
+	va_end(ap);
+
+	len = strlen(msg);
+	if (len && msg[len - 1] == '\n')
+		msg[len - 1] = '\0';
+	log_fn(log_priv, level, msg);
+}
+
+struct rasdec_ctx *rasdec_new(const struct rasdec_cpu *cpu)
+{
+	struct rasdec_ctx *ctx;
+
+	if (!cpu || !cpu->vendor ||
+	    strlen(cpu->vendor) >= sizeof(ctx->mce.vendor)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	ctx = calloc(1, sizeof(*ctx));
+	if (!ctx) {
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	strcpy(ctx->mce.vendor, cpu->vendor);
+	ctx->mce.family = cpu->family;
+	ctx->mce.model = cpu->model;
+	if (mce_select_cpu(&ctx->mce, NULL)) {
+		free(ctx);
+		errno = EINVAL;
+		return NULL;
+	}
+	ctx->ras.mce_priv = &ctx->mce;
+
+	return ctx;
+}
+
+void rasdec_free(struct rasdec_ctx *ctx)
+{
+	free(ctx);
+}
+
+const char *rasdec_cpu_name(const struct rasdec_ctx *ctx)
+{
+	return ctx->mce.cpu_name;
+}
+
+#define ADD_MCE_TEXT(b, e, field) \
+	(b)->add((b)->priv, #field, MCE_TEXT(e, field), (e)->field.len)
+
+int rasdec_mce(struct rasdec_ctx *ctx, const struct rasdec_mce *mce,
+	       const struct rasdec_builder *b)
+{
+	struct mce_event e;
+	int rc;
+
+	memset(&e, 0, sizeof(e));
+	if (mce_event_init(&e) < 0)
+		return -ENOMEM;
+
+	e.mcgcap = mce->mcgcap;
+	e.mcgstatus = mce->mcgstatus;
+	e.status = mce->status;
+	e.addr = mce->addr;
+	e.misc = mce->misc;
+	e.ip = mce->ip;
+	e.tsc = mce->tsc;
+	e.walltime = mce->walltime;
+	e.cpu = mce->cpu;
+	e.cpuid = mce->cpuid;
+	e.apicid = mce->apicid;
+	e.socketid = mce->socketid;
+	e.cs = mce->cs;
+	e.bank = mce->bank;
+
+	rc = mce_decode_event(&ctx->ras, &e);
+	if (rc) {
+		mce_event_release(&e);
+		return rc < 0 ? rc : -rc;
+	}
+
+	ADD_MCE_TEXT(b, &e, bank_name);
+	ADD_MCE_TEXT(b, &e, error_msg);
+	ADD_MCE_TEXT(b, &e, mcgstatus_msg);
+	ADD_MCE_TEXT(b, &e, mcistatus_msg);
+	ADD_MCE_TEXT(b, &e, mcastatus_msg);
+	ADD_MCE_TEXT(b, &e, user_action);
+	ADD_MCE_TEXT(b, &e, mc_location);
+	mce_event_release(&e);
+
+	return 0;
+}
+
+static void add_str(const struct rasdec_builder *b, const char *name,
+		    const char *str)
+{
+	b->add(b->priv, name, str, strlen(str));
+}
+
+int rasdec_aer(const struct rasdec_aer *aer, const struct rasdec_builder *b)
+{
+	char buf[1024];
+	struct strbuf msg;
+
+	STRBUF_INIT(&msg, buf);
+	ras_aer_msg(&msg, aer->status);
+
+	add_str(b, "error_type", ras_aer_severity(aer->severity));
+	b->add(b->priv, "msg", msg.buf, msg.len);
+
+	return 0;
+}
+
+int rasdec_extlog(const struct rasdec_extlog *ev,
+		  const struct rasdec_builder *b)
+{
+	struct ras_extlog_event e;
+	char buf[1024];
+	struct strbuf msg;
+
+	if (ev->cper_data_len > 0xffff)
+		return -EINVAL;
+
+	memset(&e, 0, sizeof(e));
+	e.error_seq = ev->err_seq;
+	e.etype = ev->etype;
+	e.severity = ev->severity;
+	e.address = ev->address;
+	e.pa_mask_lsb = ev->pa_mask_lsb;
+	e.fru_text = ev->fru_text;
+	e.fru_id = (const char *)ev->fru_id;
+	e.cper_data = ev->cper_data;
+	e.cper_data_length = ev->cper_data_len;
+
+	STRBUF_INIT(&msg, buf);
+	ras_cper_mem_msg(&msg, &e);
+
+	add_str(b, "severity", err_severity(e.severity));
+	add_str(b, "error_type", err_type(e.etype));
+	b->add(b->priv, "msg", msg.buf, msg.len);
+
+	return 0;
+}
+
+void rasdec_thread_exit(void)
+{
+	mce_cache_free();
+	mce_text_free();
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __LIBRASDECODE_H
+#define __LIBRASDECODE_H
+
+/*
+ * librasdecode: the rasdaemon error decoders, for other programs.
+ *
+ * Only the rasdec_* symbols are exported. The library soname changes
+ * whenever the structs below change.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RASDEC_API_VERSION	2
+
+/* The CPU an MCE came from, as at /proc/cpuinfo */
+struct rasdec_cpu {
+	const char	*vendor;	/* "GenuineIntel" or "AuthenticAMD" */
+	unsigned	family;
+	unsigned	model;
+};
+
+/*
+ * Receives the decoded data, as name/value pairs. value isn't NUL
+ * terminated, and is only valid during the call.
+ */
+struct rasdec_builder {
+	void	(*add)(void *priv, const char *name, const char *value,
+		       size_t len);
+	void	*priv;
+};
+
+/* Raw MCE registers, as at the mce:mce_record trace event */
+struct rasdec_mce {
+	uint64_t	mcgcap;
+	uint64_t	mcgstatus;
+	uint64_t	status;
+	uint64_t	addr;
+	uint64_t	misc;
+	uint64_t	ip;
+	uint64_t	tsc;
+	uint64_t	walltime;
+	uint32_t	cpu;
+	uint32_t	cpuid;
+	uint32_t	apicid;
+	uint32_t	socketid;
+	uint8_t		cs;
+	uint8_t		bank;
+};
+
+/* PCIe AER event, as at the ras:aer_event trace event */
+struct rasdec_aer {
+	uint32_t	status;
+	unsigned	severity;	/* 0: corrected, 1: uncorrected, 2: fatal */
+};
+
+/* UEFI CPER memory error, as at the ras:extlog_mem_event trace event */
+struct rasdec_extlog {
+	int32_t		err_seq;
+	int8_t		etype;
+	int8_t		severity;
+	uint64_t	address;
+	int8_t		pa_mask_lsb;
+	const char	*fru_text;	/* May be NULL */
+	const uint8_t	*fru_id;	/* 16 bytes, or NULL */
+	const void	*cper_data;	/* CPER memory error section, or NULL */
+	size_t		cper_data_len;
+};
+
+/*
+ * Receives the library messages, like the decoders rasdec_new() chose for
+ * a CPU, with a syslog(3) level. msg has no trailing newline. Without it,
+ * the library doesn't print or log anything.
+ */
+typedef void (*rasdec_log_fn)(void *priv, int level, const char *msg);
+
+/* Sets the log callback, for all contexts, or NULL to drop the messages */
+void rasdec_set_log(rasdec_log_fn fn, void *priv);
+
+struct rasdec_ctx;
+
+/*
+ * Sets up the decoders for a CPU. Returns NULL, with errno set to EINVAL
+ * if the CPU isn't supported, or to ENOMEM. A context may be used by
+ * several threads at once.
+ */
+struct rasdec_ctx *rasdec_new(const struct rasdec_cpu *cpu);
+void rasdec_free(struct rasdec_ctx *ctx);
+
+/* Name of the CPU decoders, like "Intel Xeon v3 (Haswell) EP/EX" */
+const char *rasdec_cpu_name(const struct rasdec_ctx *ctx);
+
+/*
+ * Decoders. They return 0, or a negative errno, in which case nothing
+ * was added to the builder.
+ *
+ * MCE fields: bank_name, error_msg, mcgstatus_msg, mcistatus_msg,
+ * mcastatus_msg, user_action and mc_location. Repeated MCEs are served
+ * from a per-thread cache of decoded messages.
+ */
+int rasdec_mce(struct rasdec_ctx *ctx, const struct rasdec_mce *mce,
+	       const struct rasdec_builder *b);
+
+/* AER fields: error_type and msg */
+int rasdec_aer(const struct rasdec_aer *aer, const struct rasdec_builder *b);
+
+/* Extlog fields: severity, error_type and msg */
+int rasdec_extlog(const struct rasdec_extlog *ev,
+		  const struct rasdec_builder *b);
+
+/* Frees the calling thread's decoding buffers, before it exits */
+void rasdec_thread_exit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
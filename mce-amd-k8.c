@@ -121,19 +121,24 @@ static const char *highbits[32] = {
 	[0] = "err cpu0",
 };
 
-#define IGNORE_HIGHBITS		((1 << 31) || (1 << 28) || (1 << 26))
+/*
+ * Bits already reported elsewhere, plus the multi-bit ECC syndrome and
+ * HT link number fields, which aren't flags
+ */
+#define IGNORE_HIGHBITS		((1U << 31) | (1U << 28) | (1U << 26) | \
+				 (0xffU << 15) | (0xfU << 4))
 
 static void decode_k8_generic_errcode(struct mce_event *e)
 {
 	char tmp_buf[4096];
+	struct strbuf highbits_msg;
 	unsigned short errcode = e->status & 0xffff;
-	int n;
 
 	/* Translate the highest bits */
-	n = bitfield_msg(tmp_buf, sizeof(tmp_buf), highbits, 32,
-			 IGNORE_HIGHBITS, 32, e->status);
-	if (n)
-		mce_snprintf(e->error_msg, "(%s) ", tmp_buf);
+	STRBUF_INIT(&highbits_msg, tmp_buf);
+	if (bitfield_msg(&highbits_msg, highbits, 32,
+			 32, IGNORE_HIGHBITS, e->status))
+		mce_snprintf(e->error_msg, "(%s) ", highbits_msg.buf);
 
 	if ((errcode & 0xfff0) == 0x0010)
 		mce_snprintf(e->error_msg,
@@ -290,7 +295,8 @@ int parse_amd_k8_event(struct ras_events *ras, struct mce_event *e)
 		decode_k8_threashold(e);
 		break;
 	default:
-		strcpy(e->error_msg, "Don't know how to decode this bank");
+		mce_text_reset(&e->error_msg);
+		mce_text_puts(&e->error_msg, "Don't know how to decode this bank");
 	}
 
 	/* IP doesn't matter on memory errors */
@@ -0,0 +1,187 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ras-mce-handler.h"
+#include "ras-config.h"
+
+/*
+ * Decoded MCE messages cache. A CMCI storm reports the same error over
+ * and over, so the strings decoded for a set of MCE registers are kept
+ * and just copied for the next events with the very same registers.
+ *
+ * Each thread has its own direct-mapped table, so lookups need no
+ * locking. Only the hit/miss counters are shared.
+ */
+
+#define MCE_CACHE_SIZE	64
+
+#define MCE_STR(field)	offsetof(struct mce_event, field)
+
+static const size_t mce_strings[] = {
+	MCE_STR(bank_name),
+	MCE_STR(error_msg),
+	MCE_STR(mcgstatus_msg),
+	MCE_STR(mcistatus_msg),
+	MCE_STR(mcastatus_msg),
+	MCE_STR(user_action),
+	MCE_STR(mc_location),
+};
+
+#define NUM_MCE_STRINGS	ARRAY_SIZE(mce_strings)
+
+static inline struct mce_text *mce_string(struct mce_event *e, int i)
+{
+	return (struct mce_text *)((char *)e + mce_strings[i]);
+}
+
+struct mce_cache_entry {
+	uint64_t	status, misc, mcgstatus, mcgcap;
+	uint8_t		bank;
+	enum cputype	cputype;
+	unsigned	len[NUM_MCE_STRINGS];
+	char		*strings;	/* At mce_strings order */
+};
+
+static __thread struct mce_cache_entry *mce_cache;
+static __thread unsigned mce_cache_size;
+
+static unsigned cache_size(void)
+{
+	static unsigned size;
+
+	if (!size)
+		size = ras_env_ulong("RAS_MCE_CACHE_SIZE", MCE_CACHE_SIZE);
+
+	return size;
+}
+
+static uint64_t mix(uint64_t h, uint64_t v)
+{
+	h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+	return h;
+}
+
+static struct mce_cache_entry *cache_slot(struct mce_event *e,
+					  uint64_t status)
+{
+	uint64_t h;
+
+	if (!mce_cache) {
+		mce_cache_size = cache_size();
+		if (!mce_cache_size)
+			return NULL;
+		mce_cache = calloc(mce_cache_size, sizeof(*mce_cache));
+		if (!mce_cache)
+			return NULL;
+	}
+
+	h = mix(status, e->misc);
+	h = mix(h, e->mcgstatus);
+	h = mix(h, e->mcgcap);
+	h = mix(h, e->bank);
+
+	return &mce_cache[h % mce_cache_size];
+}
+
+/*
+ * Fills the decoded strings, if the registers were already seen.
+ * status is the MCi_STATUS value, masking out any bits that don't
+ * change the decoded messages.
+ */
+int mce_cache_lookup(struct mce_priv *mce, struct mce_event *e,
+		     uint64_t status)
+{
+	struct mce_cache_entry *c = cache_slot(e, status);
+	const char *p;
+	int i;
+
+	if (!c || !c->strings || c->status != status || c->misc != e->misc ||
+	    c->mcgstatus != e->mcgstatus || c->mcgcap != e->mcgcap ||
+	    c->bank != e->bank || c->cputype != mce->cputype) {
+		__atomic_add_fetch(&mce->cache_misses, 1, __ATOMIC_RELAXED);
+		return 0;
+	}
+
+	p = c->strings;
+	for (i = 0; i < NUM_MCE_STRINGS; i++) {
+		struct mce_text *t = mce_string(e, i);
+
+		mce_text_reset(t);
+		mce_text_add(t, p, c->len[i]);
+		p += c->len[i];
+	}
+
+	__atomic_add_fetch(&mce->cache_hits, 1, __ATOMIC_RELAXED);
+	return 1;
+}
+
+void mce_cache_store(struct mce_priv *mce, struct mce_event *e,
+		     uint64_t status)
+{
+	struct mce_cache_entry *c = cache_slot(e, status);
+	size_t len = 0;
+	char *p;
+	int i;
+
+	if (!c)
+		return;
+
+	for (i = 0; i < NUM_MCE_STRINGS; i++)
+		len += mce_string(e, i)->len;
+
+	p = realloc(c->strings, len ? len : 1);
+	if (!p) {
+		free(c->strings);
+		c->strings = NULL;
+		return;
+	}
+	c->strings = p;
+
+	for (i = 0; i < NUM_MCE_STRINGS; i++) {
+		struct mce_text *t = mce_string(e, i);
+
+		memcpy(p, e->text + t->off, t->len);
+		c->len[i] = t->len;
+		p += t->len;
+	}
+
+	c->status = status;
+	c->misc = e->misc;
+	c->mcgstatus = e->mcgstatus;
+	c->mcgcap = e->mcgcap;
+	c->bank = e->bank;
+	c->cputype = mce->cputype;
+}
+
+/* Frees the calling thread's cache */
+void mce_cache_free(void)
+{
+	unsigned i;
+
+	if (!mce_cache)
+		return;
+
+	for (i = 0; i < mce_cache_size; i++)
+		free(mce_cache[i].strings);
+	free(mce_cache);
+	mce_cache = NULL;
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright (C) 2013 Mauro Carvalho Chehab <mchehab@redhat.com>
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include "ras-mce-handler.h"
+#include "ras-logger.h"
+
+/*
+ * The code below were adapted from Andi Kleen/Intel/SuSe mcelog code,
+ * released under GNU Public General License, v.2
+ */
+/*
+ * Known CPU models. The first entry matching the CPU vendor, family and
+ * model is used. Models without a specific decoder only get the
+ * architectural errors decoded.
+ */
+
+#define ANY_MODEL	NULL
+#define MODELS(m...)	((const int []) { m, -1 })
+
+struct mce_cpu_model {
+	const char	*vendor;
+	unsigned	family;
+	const int	*models;
+	enum cputype	cputype;
+	const char	*name;
+	mce_decode_func	bus_decode;
+	mce_decode_func	model_decode;
+	int		(*setup)(unsigned ncpus);
+};
+
+#define INTEL	"GenuineIntel"
+#define AMD	"AuthenticAMD"
+
+static const struct mce_cpu_model mce_cpu_models[] = {
+	{ INTEL, 15, MODELS(6), CPU_TULSA, "Intel Xeon 7100 series",
+	  p4_decode_model, tulsa_decode_model },
+	{ INTEL, 15, ANY_MODEL, CPU_P4, "Intel P4",
+	  p4_decode_model },
+	{ INTEL, 6, MODELS(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 0xa, 0xb, 0xc, 0xd, 0xe),
+	  CPU_P6OLD, "Intel PPro/P2/P3/old Xeon",
+	  p6old_decode_model },
+	{ INTEL, 6, MODELS(0xf, 0x17), CPU_CORE2, "Intel Core", /* Merom/Penryn */
+	  core2_decode_model },
+	{ INTEL, 6, MODELS(0x1d), CPU_DUNNINGTON, "Intel Xeon 7400 series",
+	  core2_decode_model, dunnington_decode_model },
+	{ INTEL, 6, MODELS(0x1a, 0x2c, 0x1e, 0x25), CPU_NEHALEM,
+	  "Intel Xeon 5500 series / Core i3/5/7 (\"Nehalem/Westmere\")",
+	  core2_decode_model, nehalem_decode_model },
+	{ INTEL, 6, MODELS(0x2e, 0x2f), CPU_XEON75XX, "Intel Xeon 7500 series",
+	  core2_decode_model, xeon75xx_decode_model },
+	{ INTEL, 6, MODELS(0x2a), CPU_SANDY_BRIDGE, "Sandy Bridge",
+	  NULL, snb_decode_model },
+	{ INTEL, 6, MODELS(0x2d), CPU_SANDY_BRIDGE_EP, "Sandy Bridge EP",
+	  NULL, snb_decode_model, set_intel_imc_log },
+	{ INTEL, 6, MODELS(0x3a), CPU_IVY_BRIDGE, "Ivy Bridge" },
+	{ INTEL, 6, MODELS(0x3e), CPU_IVY_BRIDGE_EPEX, "Ivy Bridge EP/EX",
+	  NULL, ivb_decode_model, set_intel_imc_log },
+	{ INTEL, 6, MODELS(0x3c, 0x45, 0x46), CPU_HASWELL, "Haswell" },
+	{ INTEL, 6, MODELS(0x3f), CPU_HASWELL_EPEX, "Intel Xeon v3 (Haswell) EP/EX",
+	  NULL, hsw_decode_model, set_intel_imc_log },
+	{ INTEL, 6, MODELS(0x3d), CPU_BROADWELL, "Broadwell" },
+	{ INTEL, 6, MODELS(0x56), CPU_BROADWELL_DE, "Broadwell DE",
+	  NULL, broadwell_de_decode_model },
+	{ INTEL, 6, MODELS(0x4f), CPU_BROADWELL_EPEX, "Broadwell EP/EX",
+	  NULL, broadwell_epex_decode_model },
+	{ INTEL, 6, MODELS(0x57), CPU_KNIGHTS_LANDING, "Knights Landing",
+	  NULL, knl_decode_model, set_intel_imc_log },
+	{ INTEL, 6, MODELS(0x85), CPU_KNIGHTS_MILL, "Knights Mill",
+	  NULL, knl_decode_model, set_intel_imc_log },
+	{ INTEL, 6, MODELS(0x55), CPU_SKYLAKE_XEON, "Skylake server" },
+	{ INTEL, 6, MODELS(0x6a, 0x6c), CPU_ICELAKE_XEON, "Icelake server" },
+	{ INTEL, 6, MODELS(0x8f), CPU_SAPPHIRERAPIDS, "Sapphire Rapids server" },
+
+	{ AMD, 15, ANY_MODEL, CPU_K8, "AMD K8 and derivates" },
+};
+
+static const struct mce_cpu_model intel_arch_model = {
+	INTEL, 0, ANY_MODEL, CPU_INTEL, "Intel generic architectural MCA"
+};
+
+static const struct mce_cpu_model generic_model = {
+	NULL, 0, ANY_MODEL, CPU_GENERIC, "generic CPU"
+};
+
+static const struct mce_cpu_model *find_cpu_model(struct mce_priv *mce)
+{
+	const struct mce_cpu_model *m;
+	const int *model;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mce_cpu_models); i++) {
+		m = &mce_cpu_models[i];
+		if (strcmp(m->vendor, mce->vendor) || m->family != mce->family)
+			continue;
+		if (m->models == ANY_MODEL)
+			return m;
+		for (model = m->models; *model >= 0; model++)
+			if (*model == mce->model)
+				return m;
+	}
+
+	return NULL;
+}
+
+static const struct mce_cpu_model *find_cputype(enum cputype cputype)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(mce_cpu_models); i++)
+		if (mce_cpu_models[i].cputype == cputype)
+			return &mce_cpu_models[i];
+
+	return &generic_model;
+}
+
+static const struct mce_cpu_model *select_intel_cputype(struct mce_priv *mce)
+{
+	const struct mce_cpu_model *m;
+
+	if (mce->family == 6 && mce->model >= 0x1a && mce->model != 28)
+		mce->mc_error_support = 1;
+
+	m = find_cpu_model(mce);
+	if (m) {
+		if (!m->model_decode && mce->model > 0x1a)
+			log(ALL, LOG_INFO,
+			    "Family %u Model %x CPU: only decoding architectural errors\n",
+			    mce->family, mce->model);
+		return m;
+	}
+
+	if ((mce->family == 6 && mce->model > 0x1a) || mce->family > 6) {
+		log(ALL, LOG_INFO,
+		    "Family %u Model %x CPU: only decoding architectural errors\n",
+		    mce->family, mce->model);
+		return &intel_arch_model;
+	}
+	log(ALL, LOG_INFO,
+	    "Unknown Intel CPU type Family %x Model %x\n",
+	    mce->family, mce->model);
+	return mce->family == 6 ? find_cputype(CPU_P6OLD) : &generic_model;
+}
+
+/*
+ * Selects the decoders for the CPU at mce->vendor, mce->family and
+ * mce->model. setup, if not NULL, gets the routine that enables the
+ * extra error logs for this CPU, if any.
+ */
+int mce_select_cpu(struct mce_priv *mce, int (**setup)(unsigned ncpus))
+{
+	const struct mce_cpu_model *m;
+	int ret = 0;
+
+	/* Handle only Intel and AMD CPUs */
+	m = &generic_model;
+
+	if (!strcmp(mce->vendor, AMD)) {
+		if (mce->family == 15) {
+			m = find_cpu_model(mce);
+			mce->parse_event = parse_amd_k8_event;
+		}
+		if (mce->family > 15) {
+			log(ALL, LOG_INFO,
+			    "Can't parse MCE for this AMD CPU yet\n");
+			ret = EINVAL;
+		}
+	} else if (!strcmp(mce->vendor, INTEL)) {
+		m = select_intel_cputype(mce);
+		mce->parse_event = parse_intel_event;
+	} else {
+		ret = EINVAL;
+	}
+
+	mce->cputype = m->cputype;
+	mce->cpu_name = m->name;
+	mce->bus_decode = m->bus_decode;
+	mce->model_decode = m->model_decode;
+	if (setup)
+		*setup = m->setup;
+
+	return ret;
+}
+
+/* Decodes an MCE, filling its parsed data strings */
+int mce_decode_event(struct ras_events *ras, struct mce_event *e)
+{
+	struct mce_priv *mce = ras->mce_priv;
+	int rc = 0;
+
+	if (mce->parse_event)
+		rc = mce->parse_event(ras, e);
+	if (rc)
+		return rc;
+
+	if (!e->error_msg.len && e->mcastatus_msg.len)
+		mce_text_add(&e->error_msg, MCE_TEXT(e, mcastatus_msg),
+			     e->mcastatus_msg.len);
+
+	return 0;
+}
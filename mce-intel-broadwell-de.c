@@ -97,11 +97,11 @@ void broadwell_de_decode_model(struct ras_events *ras, struct mce_event *e)
 			mce_snprintf(e->mcastatus_msg, "PCU internal error ");
 		if (EXTRACT(status, 20, 23) & 4)
 			mce_snprintf(e->mcastatus_msg, "Ubox error ");
-		decode_bitfield(e, status, pcu_mc4);
+		decode_bitfield(&e->error_msg, status, pcu_mc4);
 		break;
 	case 9: case 10:
 		mce_snprintf(e->mcastatus_msg, "MemCtrl: ");
-		decode_bitfield(e, status, memctrl_mc9);
+		decode_bitfield(&e->error_msg, status, memctrl_mc9);
 		break;
 	}
 
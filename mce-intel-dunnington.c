@@ -27,14 +27,14 @@
 
 static struct field dunnington_bus_status[] = {
 	SBITFIELD(16, "Parity error detected during FSB request phase"),
-	FIELD(17, NULL),
+	FIELD_NULL(17),
 	SBITFIELD(20, "Hard Failure response received for a local transaction"),
 	SBITFIELD(21, "Parity error on FSB response field detected"),
 	SBITFIELD(22, "Parity data error on inbound data detected"),
-	FIELD(23, NULL),
-	FIELD(25, NULL),
-	FIELD(28, NULL),
-	FIELD(31, NULL),
+	FIELD_NULL(23),
+	FIELD_NULL(25),
+	FIELD_NULL(28),
+	FIELD_NULL(31),
 	{}
 };
 
@@ -85,23 +85,23 @@ struct field dnt_uecc[] = {
 
 static void dunnington_decode_bus(struct mce_event *e, uint64_t status)
 {
-	decode_bitfield(e, status, dunnington_bus_status);
+	decode_bitfield(&e->error_msg, status, dunnington_bus_status);
 }
 
 static void dunnington_decode_internal(struct mce_event *e, uint64_t status)
 {
 	uint32_t mca = (status >> 16) & 0xffff;
 	if ((mca & 0xfff0) == 0)
-		decode_bitfield(e, mca, dnt_front_status);
+		decode_bitfield(&e->error_msg, mca, dnt_front_status);
 	else if ((mca & 0xf0ff) == 0)
-		decode_bitfield(e, mca, dnt_int_status);
+		decode_bitfield(&e->error_msg, mca, dnt_int_status);
 	else if ((mca & 0xfff0) == 0xc000)
-		decode_bitfield(e, mca, dnt_cecc);
+		decode_bitfield(&e->error_msg, mca, dnt_cecc);
 	else if ((mca & 0xfff0) == 0xe000)
-		decode_bitfield(e, mca, dnt_uecc);
+		decode_bitfield(&e->error_msg, mca, dnt_uecc);
 }
 
-void dunnington_decode_model(struct mce_event *e)
+void dunnington_decode_model(struct ras_events *ras, struct mce_event *e)
 {
 	uint64_t status = e->status;
 	if ((status & 0xffff) == 0xe0f)
@@ -137,16 +137,16 @@ void hsw_decode_model(struct ras_events *ras, struct mce_event *e)
                 }
                 if (EXTRACT(status, 16, 17) && !EXTRACT(status, 18, 19))
                         mce_snprintf(e->error_msg, "PCU Internal error");
-                decode_bitfield(e, status, pcu_mc4);
+                decode_bitfield(&e->error_msg, status, pcu_mc4);
                 break;
         case 5:
         case 20:
         case 21:
-                decode_bitfield(e, status, qpi_mc);
+                decode_bitfield(&e->error_msg, status, qpi_mc);
                 break;
         case 9: case 10: case 11: case 12:
         case 13: case 14: case 15: case 16:
-                decode_bitfield(e, status, memctrl_mc9);
+                decode_bitfield(&e->error_msg, status, memctrl_mc9);
                 break;
         }
 
@@ -95,7 +95,7 @@ void ivb_decode_model(struct ras_events *ras, struct mce_event *e)
 	switch (e->bank) {
 	case 4:
 //		Wprintf("PCU: ");
-		decode_bitfield(e, e->status, pcu_mc4);
+		decode_bitfield(&e->error_msg, e->status, pcu_mc4);
 //		Wprintf("\n");
 		break;
 	case 5:
@@ -107,7 +107,7 @@ void ivb_decode_model(struct ras_events *ras, struct mce_event *e)
 	case 9: case 10: case 11: case 12:
 	case 13: case 14: case 15: case 16:
 //		Wprintf("MemCtrl: ");
-		decode_bitfield(e, e->status, memctrl_mc9);
+		decode_bitfield(&e->error_msg, e->status, memctrl_mc9);
 		break;
 	}
 
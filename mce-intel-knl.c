@@ -91,7 +91,7 @@ void knl_decode_model(struct ras_events *ras, struct mce_event *e)
 				break;
 			}
 		}
-		decode_bitfield(e, status, memctrl_mc7);
+		decode_bitfield(&e->error_msg, status, memctrl_mc7);
 		break;
 	default:
 		break;
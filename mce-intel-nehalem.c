@@ -107,7 +107,7 @@ static struct numfield internal_error_numbers[] = {
 
 /* Generic architectural memory controller encoding */
 
-void nehalem_decode_model(struct mce_event *e)
+void nehalem_decode_model(struct ras_events *ras, struct mce_event *e)
 {
 	uint64_t status = e->status;
 	uint32_t mca = status & 0xffff;
@@ -115,19 +115,19 @@ void nehalem_decode_model(struct mce_event *e)
 	unsigned channel, dimm;
 
 	if ((mca >> 11) == 1) { 	/* bus and interconnect QPI */
-		decode_bitfield(e, status, qpi_status);
+		decode_bitfield(&e->error_msg, status, qpi_status);
 		if (status & MCI_STATUS_MISCV) {
-			decode_numfield(e, misc, qpi_numbers);
-			decode_bitfield(e, misc, qpi_misc);
+			decode_numfield(&e->error_msg, misc, qpi_numbers);
+			decode_bitfield(&e->error_msg, misc, qpi_misc);
 		}
 	} else if (mca == 0x0001) { /* internal unspecified */
-		decode_bitfield(e, status, internal_error_status);
-		decode_numfield(e, status, internal_error_numbers);
+		decode_bitfield(&e->error_msg, status, internal_error_status);
+		decode_numfield(&e->error_msg, status, internal_error_numbers);
 	} else if ((mca >> 7) == 1) { /* memory controller */
-		decode_bitfield(e, status, nhm_memory_status);
-		decode_numfield(e, status, nhm_memory_status_numbers);
+		decode_bitfield(&e->error_msg, status, nhm_memory_status);
+		decode_numfield(&e->error_msg, status, nhm_memory_status_numbers);
 		if (status & MCI_STATUS_MISCV)
-			decode_numfield(e, misc, nhm_memory_misc_numbers);
+			decode_numfield(&e->error_msg, misc, nhm_memory_misc_numbers);
 	}
 
 	if ((((status & 0xffff) >> 7) == 1) && (status & MCI_STATUS_MISCV)) {
@@ -139,12 +139,12 @@ void nehalem_decode_model(struct mce_event *e)
 }
 
 /* Only core errors supported. Same as Nehalem */
-void xeon75xx_decode_model(struct mce_event *e)
+void xeon75xx_decode_model(struct ras_events *ras, struct mce_event *e)
 {
 	uint64_t status = e->status;
 	uint32_t mca = status & 0xffff;
 	if (mca == 0x0001) { /* internal unspecified */
-		decode_bitfield(e, status, internal_error_status);
-		decode_numfield(e, status, internal_error_numbers);
+		decode_bitfield(&e->error_msg, status, internal_error_status);
+		decode_numfield(&e->error_msg, status, internal_error_numbers);
 	}
 }
@@ -86,7 +86,7 @@ void snb_decode_model(struct ras_events *ras, struct mce_event *e)
 
 	switch (e->bank) {
 	case 4:
-		decode_bitfield(e, e->status, pcu_mc4);
+		decode_bitfield(&e->error_msg, e->status, pcu_mc4);
 		break;
 	case 6:
 	case 7:
@@ -99,7 +99,7 @@ void snb_decode_model(struct ras_events *ras, struct mce_event *e)
 	case 10:
 	case 11:
 //		Wprintf("MemCtrl: ");
-		decode_bitfield(e, e->status, memctrl_mc8);
+		decode_bitfield(&e->error_msg, e->status, memctrl_mc8);
 		break;
 	}
 
@@ -39,7 +39,7 @@ static struct field tls_bus_status[] = {
 	SBITFIELD(16, "Parity error detected during FSB request phase"),
 	SBITFIELD(17, "Partity error detected on Core 0 request's address field"),
 	SBITFIELD(18, "Partity error detected on Core 1 request's address field"),
-	FIELD(19, NULL),
+	FIELD_NULL(19),
 	SBITFIELD(20, "Parity error on FSB response field detected"),
 	SBITFIELD(21, "FSB data parity error on inbound date detected"),
 	SBITFIELD(22, "Data parity error on data received from Core 0 detected"),
@@ -48,8 +48,8 @@ static struct field tls_bus_status[] = {
 	SBITFIELD(25, "Data ECC event to error on inbound data correctable or uncorrectable"),
 	SBITFIELD(26, "Pad logic detected a data strobe glitch or sequencing error"),
 	SBITFIELD(27, "Pad logic detected a request strobe glitch or sequencing error"),
-	FIELD(28, NULL),
-	FIELD(31, NULL),
+	FIELD_NULL(28),
+	FIELD_NULL(31),
 	{}
 };
 
@@ -99,27 +99,27 @@ struct field tls_uecc[] = {
 
 static void tulsa_decode_bus(struct mce_event *e, uint64_t status)
 {
-	decode_bitfield(e, status, tls_bus_status);
+	decode_bitfield(&e->error_msg, status, tls_bus_status);
 }
 
 static void tulsa_decode_internal(struct mce_event *e, uint64_t status)
 {
 	uint32_t mca = (status >> 16) & 0xffff;
 	if ((mca & 0xfff0) == 0)
-		decode_bitfield(e, mca, tls_front_status);
+		decode_bitfield(&e->error_msg, mca, tls_front_status);
 	else if ((mca & 0xf0ff) == 0)
-		decode_bitfield(e, mca, tls_int_status);
+		decode_bitfield(&e->error_msg, mca, tls_int_status);
 	else if ((mca & 0xfff0) == 0xc000)
-		decode_bitfield(e, mca, tls_cecc);
+		decode_bitfield(&e->error_msg, mca, tls_cecc);
 	else if ((mca & 0xfff0) == 0xe000)
-		decode_bitfield(e, mca, tls_uecc);
+		decode_bitfield(&e->error_msg, mca, tls_uecc);
 }
 
-void tulsa_decode_model(struct mce_event *e)
+void tulsa_decode_model(struct ras_events *ras, struct mce_event *e)
 {
-	decode_numfield(e, e->status, corr_numbers);
+	decode_numfield(&e->error_msg, e->status, corr_numbers);
 	if (e->status & (1ULL << 52))
-		decode_numfield(e, e->status, ecc_numbers);
+		decode_numfield(&e->error_msg, e->status, ecc_numbers);
 	/* MISC register not documented in the SDM. Let's just dump hex for now. */
 	if (e->status &  MCI_STATUS_MISCV)
 		mce_snprintf(e->mcistatus_msg, "MISC format %llx value %llx\n",
@@ -57,8 +57,6 @@
 #define BUS_PP_MASK      0x600 /*bit 9, bit 10*/
 #define BUS_PP_SHIFT     0x9
 
-#define MCG_TES_P       (1ULL<<11)   /* Yellow bit cache threshold supported */
-
 
 static char *TT[] = {
 	"Instruction",
@@ -191,14 +189,16 @@ static void decode_mcg(struct mce_event *e)
 
 static void bank_name(struct mce_event *e)
 {
-	char *buf = e->bank_name;
+	struct mce_text *t = &e->bank_name;
 
 	switch (e->bank) {
 	case MCE_THERMAL_BANK:
-		strcpy(buf, "THERMAL EVENT");
+		mce_text_reset(t);
+		mce_text_puts(t, "THERMAL EVENT");
 		break;
 	case MCE_TIMEOUT_BANK:
-		strcpy(buf, "Timeout waiting for exception on other CPUs");
+		mce_text_reset(t);
+		mce_text_puts(t, "Timeout waiting for exception on other CPUs");
 		break;
 	default:
 		break;
@@ -259,11 +259,6 @@ static void decode_mca(struct mce_event *e, uint64_t track, int *ismemerr)
 			     "%s CACHE %s %s Error", type, level,
 			     get_RRRR_str((mca & CACHE_RRRR_MASK) >>
 					      CACHE_RRRR_SHIFT));
-#if 0
-		/* FIXME: We shouldn't mix parsing with actions */
-		if (track == 2)
-			run_yellow_trigger(e->cpu, typenum, levelnum, type, level, e->socket);
-#endif
 	} else if (test_prefix(10, mca)) {
 		if (mca == 0x400)
 			mce_snprintf(e->mcastatus_msg,
@@ -334,83 +329,64 @@ static void decode_mci(struct mce_event *e, int *ismemerr)
 	decode_mca(e, track, ismemerr);
 }
 
+/* Adds the corrected error count, for memory controller errors */
+static void decode_error_count(struct mce_event *e)
+{
+	char location[256];
+	unsigned len = e->mc_location.len;
+
+	if (((e->status & 0xffff) >> 7) != 1)
+		return;
+
+	if (len > sizeof(location))
+		len = sizeof(location);
+	memcpy(location, MCE_TEXT(e, mc_location), len);
+	mce_text_reset(&e->mc_location);
+	mce_snprintf(e->mc_location, "n_errors=%d",
+		     (int)EXTRACT(e->status, 38, 52));
+	if (len) {
+		mce_text_add(&e->mc_location, " ", 1);
+		mce_text_add(&e->mc_location, location, len);
+	}
+}
+
 int parse_intel_event(struct ras_events *ras, struct mce_event *e)
 {
 	struct mce_priv *mce = ras->mce_priv;
+	uint64_t status = e->status;
 	int ismemerr;
 
-	bank_name(e);
-
 	if (e->bank == MCE_THERMAL_BANK) {
+		bank_name(e);
 		decode_termal_bank(e);
 		return 0;
 	}
+
+	/*
+	 * The corrected error count changes at each event of a storm.
+	 * Only the bus decoders of older CPUs use those bits for
+	 * something else.
+	 */
+	if (!mce->bus_decode)
+		status &= ~MCI_STATUS_CEC_MASK;
+
+	if (mce_cache_lookup(mce, e, status)) {
+		decode_error_count(e);
+		return 0;
+	}
+
+	bank_name(e);
 	decode_mcg(e);
 	decode_mci(e, &ismemerr);
 
-	/* Check if the error is at the memory controller */
-	if (((e->status & 0xffff) >> 7) == 1) {
-		unsigned corr_err_cnt;
+	if (mce->bus_decode && test_prefix(11, (e->status & 0xffffL)))
+		mce->bus_decode(ras, e);
 
-		corr_err_cnt = EXTRACT(e->status, 38, 52);
-		mce_snprintf(e->mc_location, "n_errors=%d", corr_err_cnt);
-	}
+	if (mce->model_decode)
+		mce->model_decode(ras, e);
 
-	if (test_prefix(11, (e->status & 0xffffL))) {
-		switch(mce->cputype) {
-		case CPU_P6OLD:
-			p6old_decode_model(e);
-			break;
-		case CPU_DUNNINGTON:
-		case CPU_CORE2:
-		case CPU_NEHALEM:
-		case CPU_XEON75XX:
-			core2_decode_model(e);
-			break;
-		case CPU_TULSA:
-		case CPU_P4:
-			p4_decode_model(e);
-			break;
-		default:
-			break;
-		}
-	}
-	switch(mce->cputype) {
-	case CPU_NEHALEM:
-		nehalem_decode_model(e);
-		break;
-	case CPU_XEON75XX:
-		xeon75xx_decode_model(e);
-		break;
-	case CPU_DUNNINGTON:
-		dunnington_decode_model(e);
-		break;
-	case CPU_TULSA:
-		tulsa_decode_model(e);
-		break;
-	case CPU_SANDY_BRIDGE:
-	case CPU_SANDY_BRIDGE_EP:
-		snb_decode_model(ras, e);
-		break;
-	case CPU_IVY_BRIDGE_EPEX:
-		ivb_decode_model(ras, e);
-		break;
-	case CPU_HASWELL_EPEX:
-		hsw_decode_model(ras, e);
-		break;
-	case CPU_KNIGHTS_LANDING:
-	case CPU_KNIGHTS_MILL:
-		knl_decode_model(ras, e);
-		break;
-	case CPU_BROADWELL_DE:
-		broadwell_de_decode_model(ras, e);
-		break;
-	case CPU_BROADWELL_EPEX:
-		broadwell_epex_decode_model(ras, e);
-		break;
-	default:
-		break;
-	}
+	mce_cache_store(mce, e, status);
+	decode_error_count(e);
 
 	return 0;
 }
@@ -463,22 +439,11 @@ static int domsr(int cpu, int msr, int bit)
 	return 0;
 }
 
-int set_intel_imc_log(enum cputype cputype, unsigned ncpus)
+int set_intel_imc_log(unsigned ncpus)
 {
-	int cpu, msr, bit, rc;
-
-	switch (cputype) {
-	case CPU_SANDY_BRIDGE_EP:
-	case CPU_IVY_BRIDGE_EPEX:
-	case CPU_HASWELL_EPEX:
-	case CPU_KNIGHTS_LANDING:
-	case CPU_KNIGHTS_MILL:
-		msr = 0x17f;	/* MSR_ERROR_CONTROL */
-		bit = 0x2;	/* MemError Log Enable */
-		break;
-	default:
-		return 0;
-	}
+	int cpu, rc;
+	int msr = 0x17f;	/* MSR_ERROR_CONTROL */
+	int bit = 0x2;		/* MemError Log Enable */
 
 	for (cpu = 0; cpu < ncpus; cpu++) {
 		rc = domsr(cpu, msr, bit);
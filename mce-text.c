@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ras-mce-handler.h"
+
+/*
+ * Decoded MCE strings. Each event has its own arena, where they're written,
+ * and just keeps their offset and length, so struct mce_event stays small
+ * and cheap to clear and to copy. Released arenas are kept for the next
+ * event of the thread, so there's no allocation per event.
+ */
+
+struct mce_text_arena {
+	char	timestamp[64];
+	char	bank_name[64];
+	char	error_msg[4096];
+	char	mcgstatus_msg[256];
+	char	mcistatus_msg[1024];
+	char	mcastatus_msg[1024];
+	char	user_action[4096];
+	char	mc_location[256];
+};
+
+/* The arena of the event being decoded, and a released one */
+static __thread struct mce_text_arena *mce_arena;
+static __thread struct mce_text_arena *mce_spare;
+
+#define TEXT_INIT(e, field) do {					\
+	(e)->field.off = offsetof(struct mce_text_arena, field);	\
+	(e)->field.size = sizeof(mce_arena->field);			\
+	mce_text_reset(&(e)->field);					\
+} while (0)
+
+int mce_event_init(struct mce_event *e)
+{
+	struct mce_text_arena *arena = mce_spare;
+
+	if (arena)
+		mce_spare = NULL;
+	else
+		arena = malloc(sizeof(*arena));
+	if (!arena)
+		return -ENOMEM;
+
+	mce_arena = arena;
+	e->text = (const char *)arena;
+	TEXT_INIT(e, timestamp);
+	TEXT_INIT(e, bank_name);
+	TEXT_INIT(e, error_msg);
+	TEXT_INIT(e, mcgstatus_msg);
+	TEXT_INIT(e, mcistatus_msg);
+	TEXT_INIT(e, mcastatus_msg);
+	TEXT_INIT(e, user_action);
+	TEXT_INIT(e, mc_location);
+
+	return 0;
+}
+
+void mce_event_release(struct mce_event *e)
+{
+	struct mce_text_arena *arena = (struct mce_text_arena *)e->text;
+
+	if (!arena)
+		return;
+	if (mce_arena == arena)
+		mce_arena = NULL;
+	if (!mce_spare)
+		mce_spare = arena;
+	else
+		free(arena);
+	e->text = NULL;
+}
+
+/* Frees the arena kept by the calling thread */
+void mce_text_free(void)
+{
+	free(mce_spare);
+	mce_spare = NULL;
+}
+
+/* Gets a builder for a string, to be given back with mce_text_end() */
+void mce_text_begin(struct mce_text *t, struct strbuf *sb)
+{
+	sb->buf = (char *)mce_arena + t->off;
+	sb->len = t->len;
+	sb->size = t->size;
+}
+
+void mce_text_end(struct mce_text *t, struct strbuf *sb)
+{
+	t->len = sb->len;
+}
+
+void mce_text_reset(struct mce_text *t)
+{
+	t->len = 0;
+	*((char *)mce_arena + t->off) = '\0';
+}
+
+void mce_text_add(struct mce_text *t, const char *str, unsigned len)
+{
+	struct strbuf sb;
+
+	mce_text_begin(t, &sb);
+	strbuf_add(&sb, str, len);
+	mce_text_end(t, &sb);
+}
+
+void mce_text_puts(struct mce_text *t, const char *str)
+{
+	mce_text_add(t, str, strlen(str));
+}
+
+/* Appends, adding a space first if the string isn't empty */
+void mce_text_catf(struct mce_text *t, const char *fmt, ...)
+{
+	struct strbuf sb;
+	va_list ap;
+
+	mce_text_begin(t, &sb);
+	if (sb.len)
+		strbuf_add(&sb, " ", 1);
+	va_start(ap, fmt);
+	strbuf_vprintf(&sb, fmt, ap);
+	va_end(ap);
+	mce_text_end(t, &sb);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2013 Mauro Carvalho Chehab <mchehab@redhat.com>
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+#include "ras-aer-handler.h"
+#include "bitfield.h"
+
+static const char *aer_errors[32] = {
+	/* Correctable errors */
+	[0]  = "Receiver Error",
+	[6]  = "Bad TLP",
+	[7]  = "Bad DLLP",
+	[8]  = "RELAY_NUM Rollover",
+	[12] = "Replay Timer Timeout",
+	[13] = "Advisory Non-Fatal",
+
+	/* Uncorrectable errors */
+	[4]  = "Data Link Protocol",
+	[12] = "Poisoned TLP",
+	[13] = "Flow Control Protocol",
+	[14] = "Completion Timeout",
+	[15] = "Completer Abort",
+	[16] = "Unexpected Completion",
+	[17] = "Receiver Overflow",
+	[18] = "Malformed TLP",
+	[19] = "ECRC",
+	[20] = "Unsupported Request",
+};
+
+void ras_aer_msg(struct strbuf *sb, uint64_t status)
+{
+	bitfield_msg(sb, aer_errors, 32, 0, 0, status);
+}
+
+const char *ras_aer_severity(unsigned severity)
+{
+	switch (severity) {
+	case HW_EVENT_ERR_CORRECTED:
+		return "Corrected";
+	case HW_EVENT_ERR_UNCORRECTED:
+		return "Uncorrected";
+	case HW_EVENT_ERR_FATAL:
+		return "Fatal";
+	default:
+	case HW_EVENT_ERR_INFO:
+		return "Info";
+	}
+}
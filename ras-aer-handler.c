@@ -23,30 +23,8 @@
 #include "ras-aer-handler.h"
 #include "ras-record.h"
 #include "ras-logger.h"
-#include "bitfield.h"
 #include "ras-report.h"
-
-static const char *aer_errors[32] = {
-	/* Correctable errors */
-	[0]  = "Receiver Error",
-	[6]  = "Bad TLP",
-	[7]  = "Bad DLLP",
-	[8]  = "RELAY_NUM Rollover",
-	[12] = "Replay Timer Timeout",
-	[13] = "Advisory Non-Fatal",
-
-	/* Uncorrectable errors */
-	[4]  = "Data Link Protocol",
-	[12] = "Poisoned TLP",
-	[13] = "Flow Control Protocol",
-	[14] = "Completion Timeout",
-	[15] = "Completer Abort",
-	[16] = "Unexpected Completion",
-	[17] = "Receiver Overflow",
-	[18] = "Malformed TLP",
-	[19] = "ECRC",
-	[20] = "Unsupported Request",
-};
+#include "ras-rules.h"
 
 int ras_aer_event_handler(struct trace_seq *s,
 			 struct pevent_record *record,
@@ -56,9 +34,10 @@ int ras_aer_event_handler(struct trace_seq *s,
 	unsigned long long val;
 	struct ras_events *ras = context;
 	time_t now;
-	struct tm *tm;
+	struct tm tm_buf, *tm;
 	struct ras_aer_event ev;
 	char buf[1024];
+	struct strbuf msg;
 
 	/*
 	 * Newer kernels (3.10-rc1 or upper) provide an uptime clock.
@@ -74,7 +53,7 @@ int ras_aer_event_handler(struct trace_seq *s,
 	else
 		now = time(NULL);
 
-	tm = localtime(&now);
+	tm = localtime_r(&now, &tm_buf);
 	if (tm)
 		strftime(ev.timestamp, sizeof(ev.timestamp),
 			 "%Y-%m-%d %H:%M:%S %z", tm);
@@ -89,28 +68,18 @@ int ras_aer_event_handler(struct trace_seq *s,
 		return -1;
 
 	/* Fills the error buffer */
-	bitfield_msg(buf, sizeof(buf), aer_errors, 32, 0, 0, val);
-	ev.msg = buf;
+	STRBUF_INIT(&msg, buf);
+	ras_aer_msg(&msg, val);
+	ev.msg = msg.buf;
 	trace_seq_printf(s, "%s ", ev.msg);
 
 	if (pevent_get_field_val(s, event, "severity", record, &val, 1) < 0)
 		return -1;
-	switch (val) {
-	case HW_EVENT_ERR_CORRECTED:
-		ev.error_type = "Corrected";
-		break;
-	case HW_EVENT_ERR_UNCORRECTED:
-		ev.error_type = "Uncorrected";
-		break;
-	case HW_EVENT_ERR_FATAL:
-		ev.error_type = "Fatal";
-		break;
-	default:
-	case HW_EVENT_ERR_INFO:
-		ev.error_type = "Info";
-	}
+	ev.error_type = ras_aer_severity(val);
 	trace_seq_puts(s, ev.error_type);
 
+	ras_notify_event(ras, RAS_RULE_AER, &ev);
+
 	/* Insert data into the SGBD */
 #ifdef HAVE_SQLITE3
 	ras_store_aer_event(ras, &ev);
@@ -19,11 +19,18 @@
 #ifndef __RAS_AER_HANDLER_H
 #define __RAS_AER_HANDLER_H
 
+#include <stdint.h>
+
 #include "ras-events.h"
+#include "strbuf.h"
 #include "libtrace/event-parse.h"
 
 int ras_aer_event_handler(struct trace_seq *s,
 			 struct pevent_record *record,
 			 struct event_format *event, void *context);
 
+/* Names of the error bits at the AER status */
+void ras_aer_msg(struct strbuf *sb, uint64_t status);
+const char *ras_aer_severity(unsigned severity);
+
 #endif
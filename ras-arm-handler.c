@@ -20,6 +20,7 @@
 #include "ras-record.h"
 #include "ras-logger.h"
 #include "ras-report.h"
+#include "ras-rules.h"
 
 int ras_arm_event_handler(struct trace_seq *s,
 			 struct pevent_record *record,
@@ -28,7 +29,7 @@ int ras_arm_event_handler(struct trace_seq *s,
 	unsigned long long val;
 	struct ras_events *ras = context;
 	time_t now;
-	struct tm *tm;
+	struct tm tm_buf, *tm;
 	struct ras_arm_event ev;
 
 	/*
@@ -45,7 +46,7 @@ int ras_arm_event_handler(struct trace_seq *s,
 	else
 		now = time(NULL);
 
-	tm = localtime(&now);
+	tm = localtime_r(&now, &tm_buf);
 	if (tm)
 		strftime(ev.timestamp, sizeof(ev.timestamp),
 			 "%Y-%m-%d %H:%M:%S %z", tm);
@@ -76,6 +77,8 @@ int ras_arm_event_handler(struct trace_seq *s,
 	ev.psci_state = val;
 	trace_seq_printf(s, "\n psci_state: %d", ev.psci_state);
 
+	ras_notify_event(ras, RAS_RULE_ARM, &ev);
+
 	/* Insert data into the SGBD */
 #ifdef HAVE_SQLITE3
 	ras_store_arm_record(ras, &ev);
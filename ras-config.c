@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include "ras-config.h"
+#include "ras-logger.h"
+
+unsigned long ras_env_ulong(const char *name, unsigned long def)
+{
+	const char *val = getenv(name);
+	unsigned long num;
+	char *end;
+
+	if (!val || !*val)
+		return def;
+
+	num = strtoul(val, &end, 0);
+	if (*end) {
+		log(ALL, LOG_WARNING, "Invalid value '%s' for %s. Using %lu\n",
+		    val, name, def);
+		return def;
+	}
+
+	return num;
+}
+
+int ras_env_bool(const char *name, int def)
+{
+	const char *val = getenv(name);
+
+	if (!val || !*val)
+		return def;
+
+	if (!strcmp(val, "1") || !strcasecmp(val, "yes") ||
+	    !strcasecmp(val, "on") || !strcasecmp(val, "true"))
+		return 1;
+	if (!strcmp(val, "0") || !strcasecmp(val, "no") ||
+	    !strcasecmp(val, "off") || !strcasecmp(val, "false"))
+		return 0;
+
+	log(ALL, LOG_WARNING, "Invalid value '%s' for %s. Ignoring it\n",
+	    val, name);
+	return def;
+}
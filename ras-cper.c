@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2014 Tony Luck <tony.luck@intel.com>
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "ras-cper.h"
+#include "ras-hex.h"
+
+/*
+ * Decoding of the UEFI CPER memory error sections, as reported by the
+ * extlog driver.
+ */
+
+const char *err_type(int etype)
+{
+	switch (etype) {
+	case 0: return "unknown";
+	case 1: return "no error";
+	case 2: return "single-bit ECC";
+	case 3: return "multi-bit ECC";
+	case 4: return "single-symbol chipkill ECC";
+	case 5: return "multi-symbol chipkill ECC";
+	case 6: return "master abort";
+	case 7: return "target abort";
+	case 8: return "parity error";
+	case 9: return "watchdog timeout";
+	case 10: return "invalid address";
+	case 11: return "mirror Broken";
+	case 12: return "memory sparing";
+	case 13: return "scrub corrected error";
+	case 14: return "scrub uncorrected error";
+	case 15: return "physical memory map-out event";
+	}
+	return "unknown-type";
+}
+
+const char *err_severity(int severity)
+{
+	switch (severity) {
+	case 0: return "recoverable";
+	case 1: return "fatal";
+	case 2: return "corrected";
+	case 3: return "informational";
+	}
+	return "unknown-severity";
+}
+
+unsigned long long err_mask(int lsb)
+{
+	if (lsb == 0xff)
+		return ~0ull;
+	return ~((1ull << lsb) - 1);
+}
+
+#define CPER_MEM_VALID_NODE			0x0008
+#define CPER_MEM_VALID_CARD			0x0010
+#define CPER_MEM_VALID_MODULE			0x0020
+#define CPER_MEM_VALID_BANK			0x0040
+#define CPER_MEM_VALID_DEVICE			0x0080
+#define CPER_MEM_VALID_ROW			0x0100
+#define CPER_MEM_VALID_COLUMN			0x0200
+#define CPER_MEM_VALID_BIT_POSITION		0x0400
+#define CPER_MEM_VALID_REQUESTOR_ID		0x0800
+#define CPER_MEM_VALID_RESPONDER_ID		0x1000
+#define CPER_MEM_VALID_TARGET_ID		0x2000
+#define CPER_MEM_VALID_RANK_NUMBER		0x8000
+#define CPER_MEM_VALID_CARD_HANDLE		0x10000
+#define CPER_MEM_VALID_MODULE_HANDLE		0x20000
+
+struct cper_mem_err_compact {
+	unsigned long long	validation_bits;
+	unsigned short		node;
+	unsigned short		card;
+	unsigned short		module;
+	unsigned short		bank;
+	unsigned short		device;
+	unsigned short		row;
+	unsigned short		column;
+	unsigned short		bit_pos;
+	unsigned long long	requestor_id;
+	unsigned long long	responder_id;
+	unsigned long long	target_id;
+	unsigned short		rank;
+	unsigned short		mem_array_handle;
+	unsigned short		mem_dev_handle;
+};
+
+static const char *err_cper_data(struct strbuf *sb, const char *c)
+{
+	const struct cper_mem_err_compact *cpd = (struct cper_mem_err_compact *)c;
+
+	if (cpd->validation_bits == 0)
+		return "";
+	strbuf_add(sb, " (", 2);
+	if (cpd->validation_bits & CPER_MEM_VALID_NODE)
+		strbuf_printf(sb, "node: %d ", cpd->node);
+	if (cpd->validation_bits & CPER_MEM_VALID_CARD)
+		strbuf_printf(sb, "card: %d ", cpd->card);
+	if (cpd->validation_bits & CPER_MEM_VALID_MODULE)
+		strbuf_printf(sb, "module: %d ", cpd->module);
+	if (cpd->validation_bits & CPER_MEM_VALID_BANK)
+		strbuf_printf(sb, "bank: %d ", cpd->bank);
+	if (cpd->validation_bits & CPER_MEM_VALID_DEVICE)
+		strbuf_printf(sb, "device: %d ", cpd->device);
+	if (cpd->validation_bits & CPER_MEM_VALID_ROW)
+		strbuf_printf(sb, "row: %d ", cpd->row);
+	if (cpd->validation_bits & CPER_MEM_VALID_COLUMN)
+		strbuf_printf(sb, "column: %d ", cpd->column);
+	if (cpd->validation_bits & CPER_MEM_VALID_BIT_POSITION)
+		strbuf_printf(sb, "bit_pos: %d ", cpd->bit_pos);
+	if (cpd->validation_bits & CPER_MEM_VALID_REQUESTOR_ID)
+		strbuf_printf(sb, "req_id: 0x%llx ", cpd->requestor_id);
+	if (cpd->validation_bits & CPER_MEM_VALID_RESPONDER_ID)
+		strbuf_printf(sb, "resp_id: 0x%llx ", cpd->responder_id);
+	if (cpd->validation_bits & CPER_MEM_VALID_TARGET_ID)
+		strbuf_printf(sb, "tgt_id: 0x%llx ", cpd->target_id);
+	if (cpd->validation_bits & CPER_MEM_VALID_RANK_NUMBER)
+		strbuf_printf(sb, "rank: %d ", cpd->rank);
+	if (cpd->validation_bits & CPER_MEM_VALID_CARD_HANDLE)
+		strbuf_printf(sb, "card_handle: %d ", cpd->mem_array_handle);
+	if (cpd->validation_bits & CPER_MEM_VALID_MODULE_HANDLE)
+		strbuf_printf(sb, "module_handle: %d ", cpd->mem_dev_handle);
+	sb->buf[sb->len - 1] = ')';
+
+	return sb->buf;
+}
+
+/* The CPER memory error fields, as listed by ras-mc-ctl --errors */
+void ras_cper_mem_fields(struct strbuf *sb, const void *data, size_t len)
+{
+	struct cper_mem_err_compact cpd;
+	unsigned start = sb->len;
+
+	/* Older records may be shorter. The missing fields are 0 */
+	memset(&cpd, 0, sizeof(cpd));
+	memcpy(&cpd, data, len < sizeof(cpd) ? len : sizeof(cpd));
+
+#define CPER_FIELD(bit, fmt, val)				\
+	if (cpd.validation_bits & (bit))			\
+		strbuf_printf(sb, "%s" fmt, sb->len > start ? ", " : "", val)
+
+	CPER_FIELD(CPER_MEM_VALID_NODE, "node=%d", cpd.node);
+	CPER_FIELD(CPER_MEM_VALID_CARD, "card=%d", cpd.card);
+	CPER_FIELD(CPER_MEM_VALID_MODULE, "module=%d", cpd.module);
+	CPER_FIELD(CPER_MEM_VALID_BANK, "bank=%d", cpd.bank);
+	CPER_FIELD(CPER_MEM_VALID_DEVICE, "device=%d", cpd.device);
+	CPER_FIELD(CPER_MEM_VALID_ROW, "row=%d", cpd.row);
+	CPER_FIELD(CPER_MEM_VALID_COLUMN, "column=%d", cpd.column);
+	CPER_FIELD(CPER_MEM_VALID_BIT_POSITION, "bit_position=%d", cpd.bit_pos);
+	CPER_FIELD(CPER_MEM_VALID_REQUESTOR_ID, "0x%08llx", cpd.requestor_id);
+	CPER_FIELD(CPER_MEM_VALID_RESPONDER_ID, "0x%08llx", cpd.responder_id);
+	CPER_FIELD(CPER_MEM_VALID_TARGET_ID, "0x%08llx", cpd.target_id);
+	CPER_FIELD(CPER_MEM_VALID_RANK_NUMBER, "rank=%d", cpd.rank);
+	CPER_FIELD(CPER_MEM_VALID_CARD_HANDLE, "mem_array_handle=%d",
+		   cpd.mem_array_handle);
+	CPER_FIELD(CPER_MEM_VALID_MODULE_HANDLE, "mem_dev_handle=%d",
+		   cpd.mem_dev_handle);
+
+#undef CPER_FIELD
+}
+
+/* SMBIOS handle of the memory device with the error, or -1 */
+int ras_cper_mem_handle(const struct ras_extlog_event *ev)
+{
+	const struct cper_mem_err_compact *cpd =
+		(const struct cper_mem_err_compact *)ev->cper_data;
+
+	if (!cpd || ev->cper_data_length < sizeof(*cpd) ||
+	    !(cpd->validation_bits & CPER_MEM_VALID_MODULE_HANDLE))
+		return -1;
+
+	return cpd->mem_dev_handle;
+}
+
+void ras_cper_mem_location(const struct ras_extlog_event *ev,
+			   int *node, int *card, int *module)
+{
+	const struct cper_mem_err_compact *cpd =
+		(const struct cper_mem_err_compact *)ev->cper_data;
+	unsigned long long valid = 0;
+
+	if (cpd && ev->cper_data_length >= sizeof(*cpd))
+		valid = cpd->validation_bits;
+
+	*node = valid & CPER_MEM_VALID_NODE ? cpd->node : -1;
+	*card = valid & CPER_MEM_VALID_CARD ? cpd->card : -1;
+	*module = valid & CPER_MEM_VALID_MODULE ? cpd->module : -1;
+}
+
+/* Formats a memory error, as printed by rasdaemon for extlog events */
+void ras_cper_mem_msg(struct strbuf *sb, const struct ras_extlog_event *ev)
+{
+	char buf[256], uuid[UUID_STR_SIZE];
+	struct strbuf cper_data;
+
+	STRBUF_INIT(&cper_data, buf);
+	strbuf_printf(sb, "%d %s error: %s physical addr: 0x%llx mask: 0x%llx%s %s %s",
+		      ev->error_seq, err_severity(ev->severity),
+		      err_type(ev->etype), ev->address,
+		      err_mask(ev->pa_mask_lsb),
+		      ev->cper_data &&
+		      ev->cper_data_length >= sizeof(struct cper_mem_err_compact) ?
+				err_cper_data(&cper_data, ev->cper_data) : "",
+		      ev->fru_text ? ev->fru_text : "",
+		      ev->fru_id ? uuid_le_str(uuid, ev->fru_id) : "");
+}
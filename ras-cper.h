@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2014 Tony Luck <tony.luck@intel.com>
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_CPER_H
+#define __RAS_CPER_H
+
+#include "ras-record.h"
+#include "strbuf.h"
+
+/* Severity of the CPER records */
+enum cper_severity {
+	CPER_SEV_RECOVERABLE,
+	CPER_SEV_FATAL,
+	CPER_SEV_CORRECTED,
+	CPER_SEV_INFORMATIONAL,
+};
+
+const char *err_type(int etype);
+const char *err_severity(int severity);
+unsigned long long err_mask(int lsb);
+
+void ras_cper_mem_msg(struct strbuf *sb, const struct ras_extlog_event *ev);
+int ras_cper_mem_handle(const struct ras_extlog_event *ev);
+
+/* The node, card and module of a memory error, or -1 if not known */
+void ras_cper_mem_location(const struct ras_extlog_event *ev,
+			   int *node, int *card, int *module);
+void ras_cper_mem_fields(struct strbuf *sb, const void *data, size_t len);
+
+#endif
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ras-cpu-isolation.h"
+#include "ras-mce-handler.h"
+#include "ras-rules.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+
+#define CPU_ONLINE_FILE		"/sys/devices/system/cpu/cpu%u/online"
+
+#define CPU_CE_THRESHOLD	18
+#define CPU_CE_WINDOW		(24 * 60 * 60)
+
+/*
+ * Banks 0 to 3 belong to the core, on Intel and AMD K8 (IFU, DCU, DTLB
+ * and MLC, or DC, IC, BU and LS). The others report the uncore, memory
+ * controllers or northbridge, shared by all the CPUs in the socket, and
+ * aren't tracked, nor are the software defined ones.
+ */
+#define CPU_CORE_BANKS		4
+
+enum cpu_action {
+	CPU_ACTION_OFF,
+	CPU_ACTION_ACCOUNT,
+	CPU_ACTION_NOTIFY,
+	CPU_ACTION_OFFLINE,
+	NUM_CPU_ACTIONS
+};
+
+static const char *cpu_actions[] = {
+	[CPU_ACTION_OFF]	= "off",
+	[CPU_ACTION_ACCOUNT]	= "account",
+	[CPU_ACTION_NOTIFY]	= "notify",
+	[CPU_ACTION_OFFLINE]	= "offline",
+};
+
+/*
+ * Sliding window counter. The window is split in CE_SLOTS intervals, and
+ * each slot holds the interval number it counts, in the upper bits, and
+ * its error count. Slots for intervals that left the window are reused.
+ */
+#define CE_SLOTS	8
+#define CE_COUNT_BITS	24
+#define CE_COUNT_MASK	((1ULL << CE_COUNT_BITS) - 1)
+
+struct ce_counter {
+	uint64_t	slot[CE_SLOTS];
+};
+
+struct cpu_entry {
+	struct ce_counter	total;
+	struct ce_counter	bank[CPU_CORE_BANKS];
+	uint8_t			yellow[CPU_CORE_BANKS];
+	int			offline;	/* Offlining was tried */
+};
+
+/*
+ * One entry per CPU number, so each error is accounted with a couple of
+ * atomic operations. The actions run at the thread crossing the
+ * threshold.
+ */
+struct ras_cpu_tracker {
+	enum cpu_action		action;
+	unsigned		threshold;
+	unsigned		bank_threshold;
+	unsigned long		window;
+	unsigned long		interval;
+	const char		*trigger;
+
+	struct cpu_entry	*cpus;
+	unsigned		ncpus;
+};
+
+static uint64_t now_interval(struct ras_cpu_tracker *ct)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec / ct->interval;
+}
+
+/*
+ * Adds an error, returning the count in the window as seen by this
+ * update. Concurrent updates see different counts, so only one of them
+ * sees the threshold being reached.
+ */
+static unsigned counter_inc(struct ce_counter *c, uint64_t now)
+{
+	uint64_t *slot = &c->slot[now % CE_SLOTS];
+	uint64_t old, new, v;
+	unsigned i, sum;
+
+	old = __atomic_load_n(slot, __ATOMIC_RELAXED);
+	do {
+		if (old >> CE_COUNT_BITS != now)
+			new = now << CE_COUNT_BITS | 1;
+		else if ((old & CE_COUNT_MASK) == CE_COUNT_MASK)
+			new = old;
+		else
+			new = old + 1;
+	} while (!__atomic_compare_exchange_n(slot, &old, new, 1,
+					      __ATOMIC_RELAXED,
+					      __ATOMIC_RELAXED));
+
+	sum = new & CE_COUNT_MASK;
+	for (i = 0; i < CE_SLOTS; i++) {
+		if (&c->slot[i] == slot)
+			continue;
+		v = __atomic_load_n(&c->slot[i], __ATOMIC_RELAXED);
+		if (now - (v >> CE_COUNT_BITS) < CE_SLOTS)
+			sum += v & CE_COUNT_MASK;
+	}
+
+	return sum;
+}
+
+static int cpu_offline(unsigned cpu)
+{
+	char file[64];
+	int fd, rc = 0;
+
+	/* Don't leave the machine without CPUs */
+	if (sysconf(_SC_NPROCESSORS_ONLN) <= 1)
+		return -EBUSY;
+
+	snprintf(file, sizeof(file), CPU_ONLINE_FILE, cpu);
+	fd = open(file, O_WRONLY);
+	if (fd < 0)
+		return -errno;
+	if (write(fd, "0", 1) < 0)
+		rc = -errno;
+	close(fd);
+
+	return rc;
+}
+
+/*
+ * Runs the trigger as "trigger cpu bank count reason", by the rule
+ * workers, so the event threads don't wait for it.
+ */
+static void cpu_notify(struct ras_events *ras, struct ras_cpu_tracker *ct,
+		       unsigned cpu, int bank, unsigned count,
+		       const char *reason)
+{
+	char cpu_s[16], bank_s[16], count_s[16];
+	char *argv[] = { (char *)ct->trigger, cpu_s, bank_s, count_s,
+			 (char *)reason, NULL };
+
+	if (!ct->trigger)
+		return;
+
+	snprintf(cpu_s, sizeof(cpu_s), "%u", cpu);
+	if (bank < 0)
+		strcpy(bank_s, "all");
+	else
+		snprintf(bank_s, sizeof(bank_s), "%d", bank);
+	snprintf(count_s, sizeof(count_s), "%u", count);
+
+	ras_rules_spawn(ras, "CPU fault isolation", argv);
+}
+
+static void cpu_act(struct ras_events *ras, unsigned cpu, int bank,
+		    unsigned count, const char *reason)
+{
+	struct ras_cpu_tracker *ct = ras->cpus;
+	struct cpu_entry *c = &ct->cpus[cpu];
+	int rc;
+
+	if (!strcmp(reason, "yellow"))
+		log(SYSLOG, LOG_WARNING,
+		    "CPU %u bank %d: cache reported a large number of corrected errors\n",
+		    cpu, bank);
+	else if (bank < 0)
+		log(SYSLOG, LOG_WARNING,
+		    "CPU %u exceeded %u corrected errors in %lu seconds\n",
+		    cpu, count, ct->window);
+	else
+		log(SYSLOG, LOG_WARNING,
+		    "CPU %u bank %d exceeded %u corrected errors in %lu seconds\n",
+		    cpu, bank, count, ct->window);
+
+	switch (ct->action) {
+	case CPU_ACTION_NOTIFY:
+		cpu_notify(ras, ct, cpu, bank, count, reason);
+		break;
+	case CPU_ACTION_OFFLINE:
+		if (__atomic_exchange_n(&c->offline, 1, __ATOMIC_RELAXED))
+			break;
+		rc = cpu_offline(cpu);
+		if (rc) {
+			log(SYSLOG, LOG_ERR, "Can't take CPU %u offline: %s\n",
+			    cpu, strerror(-rc));
+			break;
+		}
+		log(SYSLOG, LOG_WARNING, "CPU %u taken offline\n", cpu);
+		break;
+	default:
+		break;
+	}
+}
+
+struct ras_cpu_tracker *ras_cpu_init(void)
+{
+	struct ras_cpu_tracker *ct;
+	const char *action = getenv("RAS_CPU_CE_ACTION");
+	const char *trigger = getenv("RAS_CPU_CE_TRIGGER");
+	long ncpus;
+	unsigned i;
+
+	ct = calloc(1, sizeof(*ct));
+	if (!ct)
+		return NULL;
+
+	ct->action = CPU_ACTION_ACCOUNT;
+	if (action && *action) {
+		for (i = 0; i < NUM_CPU_ACTIONS; i++)
+			if (!strcmp(action, cpu_actions[i]))
+				break;
+		if (i < NUM_CPU_ACTIONS)
+			ct->action = i;
+		else
+			log(ALL, LOG_WARNING,
+			    "Invalid value '%s' for RAS_CPU_CE_ACTION. Using %s\n",
+			    action, cpu_actions[ct->action]);
+	}
+	if (trigger && *trigger)
+		ct->trigger = trigger;
+	if (ct->action == CPU_ACTION_NOTIFY && !ct->trigger)
+		log(ALL, LOG_WARNING,
+		    "RAS_CPU_CE_ACTION is notify, but RAS_CPU_CE_TRIGGER isn't set\n");
+
+	ct->threshold = ras_env_ulong("RAS_CPU_CE_THRESHOLD", CPU_CE_THRESHOLD);
+	ct->bank_threshold = ras_env_ulong("RAS_CPU_BANK_CE_THRESHOLD", 0);
+	ct->window = ras_env_ulong("RAS_CPU_CE_WINDOW", CPU_CE_WINDOW);
+	ncpus = sysconf(_SC_NPROCESSORS_CONF);
+	if (ct->action == CPU_ACTION_OFF || !ct->window || ncpus <= 0) {
+		free(ct);
+		return NULL;
+	}
+	ct->interval = ct->window / CE_SLOTS ? ct->window / CE_SLOTS : 1;
+
+	ct->ncpus = ncpus;
+	ct->cpus = calloc(ct->ncpus, sizeof(*ct->cpus));
+	if (!ct->cpus) {
+		log(ALL, LOG_ERR, "Can't allocate the CPU error tracker\n");
+		free(ct);
+		return NULL;
+	}
+
+	log(ALL, LOG_INFO,
+	    "CPU fault isolation: %s at %u corrected errors per CPU, %u per bank, in %lu seconds\n",
+	    cpu_actions[ct->action], ct->threshold, ct->bank_threshold,
+	    ct->window);
+
+	return ct;
+}
+
+void ras_cpu_free(struct ras_cpu_tracker *ct)
+{
+	if (!ct)
+		return;
+
+	free(ct->cpus);
+	free(ct);
+}
+
+/*
+ * Whether the MCA error code is a core one: cache hierarchy (0000 0001
+ * RRRR TTLL), TLB (0000 0000 0001 TTLL), internal unclassified (0000 01xx
+ * xxxx xxxx) or internal parity. Memory controller (0000 0000 1MMM CCCC)
+ * and bus errors aren't. Bit 12 is the corrected error filtering flag.
+ */
+static int cpu_core_error(uint64_t status)
+{
+	unsigned mcacod = status & 0xefff;
+
+	return (mcacod & 0xff00) == 0x0100 || (mcacod & 0xfff0) == 0x0010 ||
+	       (mcacod & 0xfc00) == 0x0400 || mcacod == 0x0005;
+}
+
+void ras_record_cpu_error(struct ras_events *ras, struct mce_event *e)
+{
+	struct ras_cpu_tracker *ct = ras->cpus;
+	struct cpu_entry *c;
+	unsigned count;
+	uint64_t now;
+
+	if (!ct || e->cpu >= ct->ncpus || e->bank >= CPU_CORE_BANKS)
+		return;
+	if ((e->status & (MCI_STATUS_VAL | MCI_STATUS_UC)) != MCI_STATUS_VAL)
+		return;
+	if (!cpu_core_error(e->status))
+		return;
+
+	c = &ct->cpus[e->cpu];
+
+	/* Threshold based error status, at bits 53-54, is "yellow" */
+	if ((e->mcgcap & MCG_TES_P) && ((e->status >> 53) & 3) == 2 &&
+	    !__atomic_exchange_n(&c->yellow[e->bank], 1, __ATOMIC_RELAXED))
+		cpu_act(ras, e->cpu, e->bank, 0, "yellow");
+
+	now = now_interval(ct);
+	count = counter_inc(&c->bank[e->bank], now);
+	if (count == ct->bank_threshold)
+		cpu_act(ras, e->cpu, e->bank, count, "threshold");
+
+	count = counter_inc(&c->total, now);
+	if (count == ct->threshold)
+		cpu_act(ras, e->cpu, -1, count, "threshold");
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_CPU_ISOLATION_H
+#define __RAS_CPU_ISOLATION_H
+
+#include "ras-events.h"
+
+/*
+ * CPU fault isolation: corrected core and cache MCEs, from the core banks,
+ * are counted per CPU and per bank, and a CPU getting too many of them, or
+ * whose cache reports the "yellow" threshold state, is logged, notified
+ * or taken offline.
+ */
+
+struct ras_cpu_tracker;
+struct mce_event;
+
+#ifdef HAVE_CPU_FAULT_ISOLATION
+
+struct ras_cpu_tracker *ras_cpu_init(void);
+void ras_cpu_free(struct ras_cpu_tracker *ct);
+
+/* Accounts a decoded MCE. Doesn't take any lock. */
+void ras_record_cpu_error(struct ras_events *ras, struct mce_event *e);
+
+#else
+
+static inline struct ras_cpu_tracker *ras_cpu_init(void) { return NULL; }
+static inline void ras_cpu_free(struct ras_cpu_tracker *ct) { }
+static inline void ras_record_cpu_error(struct ras_events *ras,
+					struct mce_event *e) { }
+
+#endif
+
+#endif
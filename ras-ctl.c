@@ -0,0 +1,274 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "ras-events.h"
+#include "ras-ctl.h"
+#include "ras-hitters.h"
+#include "ras-subscribe.h"
+#include "ras-query.h"
+#include "ras-metrics.h"
+#include "ras-logger.h"
+
+#define RAS_CTL_SOCKET	RASSTATEDIR "/rasdaemon.sock"
+
+/* How long a client may take to send its command, or to read a reply */
+#define CTL_TIMEOUT	5
+
+#define CTL_MAX_LINE	1024
+#define CTL_MAX_ARGS	16
+
+struct ras_ctl {
+	struct ras_events	*ras;
+	int			fd;
+	pthread_t		thread;
+	char			path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+};
+
+struct ctl_cmd {
+	const char	*name;
+	const char	*args;
+	const char	*help;
+	ras_ctl_fn	fn;
+	ras_ctl_stream_fn stream;
+};
+
+static int cmd_help(struct ras_events *ras, int argc, char *argv[],
+		    FILE *out);
+
+static const struct ctl_cmd ctl_cmds[] = {
+	{ "help", "", "lists the commands", cmd_help },
+	{ "top", "[address|row|dimm] [N]",
+	  "the memory locations with most errors", ras_hitters_cmd },
+	{ "summary", "", "the summary of the recorded errors",
+	  ras_query_summary },
+	{ "errors", "[mc|aer|extlog|mce [after ID] [limit N]]",
+	  "the recorded errors, by id", ras_query_errors },
+	{ "metrics", "[openmetrics|prometheus]",
+	  "the error counters", ras_metrics_cmd },
+	{ "subscribe",
+	  "[queue N] [overflow drop|disconnect] [GROUP:EVENT...] "
+	  "[severity LEVEL] [cpu LIST] [dimm PATTERN] [if COND [and COND]...]",
+	  "streams the events, as JSON lines", .stream = ras_subs_cmd },
+};
+
+#define NUM_CTL_CMDS	(sizeof(ctl_cmds) / sizeof(*ctl_cmds))
+
+static int cmd_help(struct ras_events *ras, int argc, char *argv[],
+		    FILE *out)
+{
+	int i;
+
+	for (i = 0; i < NUM_CTL_CMDS; i++)
+		fprintf(out, "%s%s%s\n\t%s\n", ctl_cmds[i].name,
+			*ctl_cmds[i].args ? " " : "", ctl_cmds[i].args,
+			ctl_cmds[i].help);
+
+	return 0;
+}
+
+/* Replies go straight to the socket, without raising SIGPIPE */
+static ssize_t ctl_write(void *cookie, const char *buf, size_t size)
+{
+	int fd = *(int *)cookie;
+	ssize_t rc;
+
+	do {
+		rc = send(fd, buf, size, MSG_NOSIGNAL);
+	} while (rc < 0 && errno == EINTR);
+
+	return rc;
+}
+
+static const cookie_io_functions_t ctl_io = {
+	.write = ctl_write,
+};
+
+/* Reads the command line. Returns its length, or -1 */
+static int ctl_read_line(int fd, char *buf, size_t size)
+{
+	size_t len = 0;
+	ssize_t rc;
+	char *eol;
+
+	while (len < size - 1) {
+		rc = recv(fd, buf + len, size - 1 - len, 0);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			break;
+		len += rc;
+		buf[len] = '\0';
+
+		eol = strchr(buf, '\n');
+		if (eol) {
+			*eol = '\0';
+			return eol - buf;
+		}
+	}
+	buf[len] = '\0';
+
+	/* A command closed by shutting down the write side */
+	return rc == 0 && len ? len : -1;
+}
+
+/* Returns 1 if a streaming command took the connection */
+static int ctl_serve(struct ras_ctl *ctl, int fd)
+{
+	char line[CTL_MAX_LINE], *argv[CTL_MAX_ARGS], *p, *save;
+	const struct ctl_cmd *cmd = NULL;
+	int argc = 0, i, rc = 0;
+	FILE *out;
+
+	if (ctl_read_line(fd, line, sizeof(line)) < 0)
+		return 0;
+
+	for (p = strtok_r(line, " \t\r", &save); p && argc < CTL_MAX_ARGS;
+	     p = strtok_r(NULL, " \t\r", &save))
+		argv[argc++] = p;
+	if (!argc)
+		return 0;
+
+	out = fopencookie(&fd, "w", ctl_io);
+	if (!out)
+		return 0;
+
+	for (i = 0; i < NUM_CTL_CMDS; i++) {
+		if (!strcmp(argv[0], ctl_cmds[i].name)) {
+			cmd = &ctl_cmds[i];
+			break;
+		}
+	}
+	if (!cmd) {
+		fprintf(out, "error: unknown command %s. Try help\n", argv[0]);
+	} else {
+		if (cmd->stream)
+			rc = cmd->stream(ctl->ras, argc, argv, fd, out);
+		else
+			rc = cmd->fn(ctl->ras, argc, argv, out);
+		if (rc < 0)
+			fprintf(out, "error: %s\n", strerror(-rc));
+	}
+	fclose(out);
+
+	return rc > 0;
+}
+
+static void *ctl_thread(void *priv)
+{
+	struct ras_ctl *ctl = priv;
+	struct timeval tv = { .tv_sec = CTL_TIMEOUT };
+	int fd;
+
+	for (;;) {
+		fd = accept(ctl->fd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			/* The socket was shut down by ras_ctl_stop() */
+			break;
+		}
+
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+		if (!ctl_serve(ctl, fd))
+			close(fd);
+	}
+
+	return NULL;
+}
+
+struct ras_ctl *ras_ctl_start(struct ras_events *ras)
+{
+	const char *path = getenv("RAS_CTL_SOCKET");
+	struct sockaddr_un addr;
+	struct ras_ctl *ctl;
+
+	if (!path)
+		path = RAS_CTL_SOCKET;
+	if (!*path)
+		return NULL;
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		log(ALL, LOG_ERR, "Control socket path %s is too long\n", path);
+		return NULL;
+	}
+
+	ctl = calloc(1, sizeof(*ctl));
+	if (!ctl)
+		return NULL;
+	ctl->ras = ras;
+	strcpy(ctl->path, path);
+
+	ctl->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (ctl->fd < 0)
+		goto err;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	/* A socket left by a previous run */
+	unlink(path);
+	if (bind(ctl->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+		goto err_close;
+	if (chmod(path, 0600) < 0 || listen(ctl->fd, 8) < 0)
+		goto err_unlink;
+
+	if (pthread_create(&ctl->thread, NULL, ctl_thread, ctl)) {
+		errno = EAGAIN;
+		goto err_unlink;
+	}
+
+	log(SYSLOG, LOG_INFO, "Listening to commands at %s\n", path);
+
+	return ctl;
+
+err_unlink:
+	unlink(path);
+err_close:
+	close(ctl->fd);
+err:
+	log(ALL, LOG_ERR, "Can't open the control socket %s: %s\n",
+	    path, strerror(errno));
+	free(ctl);
+	return NULL;
+}
+
+void ras_ctl_stop(struct ras_ctl *ctl)
+{
+	if (!ctl)
+		return;
+
+	/* Makes accept() fail, stopping the thread */
+	shutdown(ctl->fd, SHUT_RDWR);
+	pthread_join(ctl->thread, NULL);
+
+	close(ctl->fd);
+	unlink(ctl->path);
+	free(ctl);
+}
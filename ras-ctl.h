@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_CTL_H
+#define __RAS_CTL_H
+
+#include <stdio.h>
+
+struct ras_events;
+
+/*
+ * Control socket. Clients connect to the Unix socket at RAS_CTL_SOCKET,
+ * send a command line, like "top address 10", and read the text reply
+ * up to the end of the connection. Failed commands reply with a line
+ * starting with "error: ". Streaming commands, like "subscribe", keep
+ * the connection open.
+ */
+struct ras_ctl;
+
+struct ras_ctl *ras_ctl_start(struct ras_events *ras);
+void ras_ctl_stop(struct ras_ctl *ctl);
+
+/*
+ * A command. It writes its reply to out, returning 0, or a negative
+ * errno, replied as an error.
+ */
+typedef int (*ras_ctl_fn)(struct ras_events *ras, int argc, char *argv[],
+			  FILE *out);
+
+/*
+ * A command that may keep the connection, to stream its reply. It
+ * returns 1 once it owns fd, and then it must not write to out, 0 if
+ * it replied to out, or a negative errno, replied as an error.
+ */
+typedef int (*ras_ctl_stream_fn)(struct ras_events *ras, int argc,
+				 char *argv[], int fd, FILE *out);
+
+#endif
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libtrace/event-parse.h"
+#include "ras-decode.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+
+#define DECODE_QUEUE_SIZE	4096
+
+struct ras_decode_job {
+	struct pthread_data	*pdata;
+	unsigned long long	seq;
+	int			ordered;
+	struct pevent_record	record;
+	char			data[];
+};
+
+struct ras_decode_pool {
+	pthread_t		*threads;
+	unsigned		nthreads;
+
+	/* Queue of raw events */
+	pthread_mutex_t		qlock;
+	pthread_cond_t		not_empty, not_full;
+	struct ras_decode_job	**queue;
+	unsigned		head, count;
+	int			stopping;
+
+	/*
+	 * Output order: per stream, or of all the events when they're
+	 * merged by time
+	 */
+	pthread_mutex_t		tlock;
+	pthread_cond_t		turn;
+	int			global;
+	unsigned long long	seq, done;
+};
+
+static unsigned long long *done_seq(struct ras_decode_pool *pool,
+				    struct ras_decode_job *job)
+{
+	return pool->global ? &pool->done : &job->pdata->dec_done;
+}
+
+static __thread struct ras_decode_job *cur_job;
+
+void ras_decode_ordered(void)
+{
+	struct ras_decode_job *job = cur_job;
+	struct ras_decode_pool *pool;
+
+	if (!job || job->ordered)
+		return;
+
+	pool = job->pdata->ras->decode;
+	pthread_mutex_lock(&pool->tlock);
+	while (*done_seq(pool, job) != job->seq)
+		pthread_cond_wait(&pool->turn, &pool->tlock);
+	pthread_mutex_unlock(&pool->tlock);
+
+	job->ordered = 1;
+}
+
+static void job_done(struct ras_decode_pool *pool, struct ras_decode_job *job)
+{
+	pthread_mutex_lock(&pool->tlock);
+	(*done_seq(pool, job))++;
+	pthread_cond_broadcast(&pool->turn);
+	pthread_mutex_unlock(&pool->tlock);
+}
+
+static struct ras_decode_job *dequeue(struct ras_decode_pool *pool)
+{
+	struct ras_decode_job *job = NULL;
+
+	pthread_mutex_lock(&pool->qlock);
+	while (!pool->count && !pool->stopping)
+		pthread_cond_wait(&pool->not_empty, &pool->qlock);
+
+	if (pool->count) {
+		job = pool->queue[pool->head];
+		pool->head = (pool->head + 1) % DECODE_QUEUE_SIZE;
+		pool->count--;
+		pthread_cond_signal(&pool->not_full);
+	}
+	pthread_mutex_unlock(&pool->qlock);
+
+	return job;
+}
+
+static void *decode_worker(void *priv)
+{
+	struct ras_decode_pool *pool = priv;
+	struct ras_decode_job *job;
+
+	while ((job = dequeue(pool))) {
+		cur_job = job;
+		ras_print_record(job->pdata, &job->record);
+		ras_decode_ordered();
+		cur_job = NULL;
+
+		job_done(pool, job);
+		free(job);
+	}
+
+	return NULL;
+}
+
+/* Copies the event, as the trace ring buffer page will be reused */
+int ras_decode_queue(struct pthread_data *pdata, struct pevent_record *record)
+{
+	struct ras_decode_pool *pool = pdata->ras->decode;
+	struct ras_decode_job *job;
+
+	job = malloc(sizeof(*job) + record->size);
+	if (!job) {
+		log(ALL, LOG_ERR, "Can't queue event: out of memory\n");
+		return -ENOMEM;
+	}
+
+	job->pdata = pdata;
+	job->ordered = 0;
+	memset(&job->record, 0, sizeof(job->record));
+	job->record.ts = record->ts;
+	job->record.offset = record->offset;
+	job->record.missed_events = record->missed_events;
+	job->record.record_size = record->record_size;
+	job->record.size = record->size;
+	job->record.cpu = record->cpu;
+	job->record.data = job->data;
+	memcpy(job->data, record->data, record->size);
+
+	pthread_mutex_lock(&pool->qlock);
+	while (pool->count == DECODE_QUEUE_SIZE)
+		pthread_cond_wait(&pool->not_full, &pool->qlock);
+
+	/* Only this stream reader changes its dec_seq. pool->seq is locked */
+	job->seq = pool->global ? pool->seq++ : pdata->dec_seq++;
+	pool->queue[(pool->head + pool->count) % DECODE_QUEUE_SIZE] = job;
+	pool->count++;
+	pthread_cond_signal(&pool->not_empty);
+	pthread_mutex_unlock(&pool->qlock);
+
+	return 0;
+}
+
+static void free_pool(struct ras_decode_pool *pool)
+{
+	pthread_mutex_destroy(&pool->qlock);
+	pthread_mutex_destroy(&pool->tlock);
+	pthread_cond_destroy(&pool->not_empty);
+	pthread_cond_destroy(&pool->not_full);
+	pthread_cond_destroy(&pool->turn);
+	free(pool->queue);
+	free(pool->threads);
+	free(pool);
+}
+
+int ras_decode_start(struct ras_events *ras)
+{
+	struct ras_decode_pool *pool;
+	unsigned long nthreads;
+	sigset_t all, old;
+	int rc = 0;
+
+	nthreads = ras_env_ulong("RAS_DECODE_THREADS", 0);
+	if (!nthreads)
+		return 0;
+
+	pool = calloc(1, sizeof(*pool));
+	if (!pool)
+		return -ENOMEM;
+
+	pool->queue = calloc(DECODE_QUEUE_SIZE, sizeof(*pool->queue));
+	pool->threads = calloc(nthreads, sizeof(*pool->threads));
+	if (!pool->queue || !pool->threads) {
+		free(pool->queue);
+		free(pool->threads);
+		free(pool);
+		return -ENOMEM;
+	}
+
+	pthread_mutex_init(&pool->qlock, NULL);
+	pthread_mutex_init(&pool->tlock, NULL);
+	pthread_cond_init(&pool->not_empty, NULL);
+	pthread_cond_init(&pool->not_full, NULL);
+	pthread_cond_init(&pool->turn, NULL);
+	pool->global = ras->merge != NULL;
+
+	/* Signals are handled by the readers */
+	sigfillset(&all);
+	pthread_sigmask(SIG_BLOCK, &all, &old);
+
+	for (; pool->nthreads < nthreads; pool->nthreads++) {
+		rc = pthread_create(&pool->threads[pool->nthreads], NULL,
+				    decode_worker, pool);
+		if (rc)
+			break;
+	}
+
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (!pool->nthreads) {
+		log(ALL, LOG_ERR, "Can't create decode threads: %s\n",
+		    strerror(rc));
+		free_pool(pool);
+		return -rc;
+	}
+
+	log(ALL, LOG_INFO, "Decoding events with %u threads\n",
+	    pool->nthreads);
+	ras->decode = pool;
+
+	return 0;
+}
+
+/* Waits for the queued events to be decoded, and stops the workers */
+void ras_decode_stop(struct ras_events *ras)
+{
+	struct ras_decode_pool *pool = ras->decode;
+	unsigned i;
+
+	if (!pool)
+		return;
+
+	pthread_mutex_lock(&pool->qlock);
+	pool->stopping = 1;
+	pthread_cond_broadcast(&pool->not_empty);
+	pthread_mutex_unlock(&pool->qlock);
+
+	for (i = 0; i < pool->nthreads; i++)
+		pthread_join(pool->threads[i], NULL);
+
+	ras->decode = NULL;
+	free_pool(pool);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_DECODE_H
+#define __RAS_DECODE_H
+
+#include "ras-events.h"
+
+/*
+ * Optional pool of decode workers. The readers just copy the raw events
+ * out of the trace ring buffer and queue them. Events from different
+ * streams are decoded in parallel, but each stream output and storage
+ * happen in the order its events were read. When the events are merged
+ * by time, all of them are output in the order they were queued.
+ */
+
+int ras_decode_start(struct ras_events *ras);
+void ras_decode_stop(struct ras_events *ras);
+int ras_decode_queue(struct pthread_data *pdata,
+		     struct pevent_record *record);
+
+/*
+ * Waits until the events queued before the one being decoded by this
+ * thread, at the same stream or, when merging, at any stream, were
+ * output. Does nothing outside the decode workers.
+ */
+void ras_decode_ordered(void);
+
+#endif
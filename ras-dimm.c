@@ -0,0 +1,825 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include "ras-events.h"
+#include "ras-dimm.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+
+#define EDAC_MC_DIR		"/sys/devices/system/edac/mc"
+#define CPU_DIR			"/sys/devices/system/cpu"
+#define DMI_ID_DIR		"/sys/class/dmi/id"
+#define DMI_ENTRIES_DIR		"/sys/firmware/dmi/entries"
+#define LABEL_DB		SYSCONFDIR "/ras/dimm_labels.db"
+#define LABEL_DIR		SYSCONFDIR "/ras/dimm_labels.d"
+
+#define DIMM_REFRESH		60
+#define DMI_MEMORY_DEVICE	17
+#define DIMM_MAX_SOCKETS	64
+
+/* Socket without a memory controller, or with several of them */
+#define SOCKET_MC_NONE		-1
+#define SOCKET_MC_MANY		-2
+
+/* A DIMM, by EDAC location or by SMBIOS handle */
+struct dimm {
+	uint32_t	key;
+	char		*label;
+};
+
+struct dimm_map {
+	struct dimm	*dimms;
+	size_t		ndimms;
+	struct dimm	*handles;
+	size_t		nhandles;
+	short		socket_mc[DIMM_MAX_SOCKETS];
+};
+
+/*
+ * Lookups take the read lock. The map is rebuilt by the refresh thread,
+ * woken up by a lookup finding it too old, without holding the lock,
+ * then swapped.
+ */
+struct ras_dimm_index {
+	pthread_rwlock_t	lock;
+	struct dimm_map		*map;
+	unsigned long		refresh;
+	time_t			built;
+	int			building;
+
+	pthread_t		thread;
+	pthread_mutex_t		wake_lock;
+	pthread_cond_t		wake;
+	int			rebuild, stop;
+};
+
+/* Mainboard, as at the label database, in lower case */
+struct board {
+	char	vendor[128];
+	char	model[128];
+	char	product_vendor[128];
+	char	product[128];
+};
+
+/* Memory controller and layers, 8 bits each. Unused layers are 0xff. */
+static uint32_t dimm_key(int mc, int top, int mid, int low)
+{
+	return (uint32_t)(mc & 0xff) << 24 | (uint32_t)(top & 0xff) << 16 |
+	       (uint32_t)(mid & 0xff) << 8 | (uint32_t)(low & 0xff);
+}
+
+static int dimm_add(struct dimm **dimms, size_t *n, uint32_t key,
+		    const char *label)
+{
+	struct dimm *p;
+
+	if (!*n || (*n >= 16 && !(*n & (*n - 1)))) {
+		p = realloc(*dimms, (*n < 16 ? 16 : 2 * *n) * sizeof(*p));
+		if (!p)
+			return -ENOMEM;
+		*dimms = p;
+	}
+
+	(*dimms)[*n].key = key;
+	(*dimms)[*n].label = strdup(label);
+	if (!(*dimms)[*n].label)
+		return -ENOMEM;
+	(*n)++;
+
+	return 0;
+}
+
+static void dimms_free(struct dimm *dimms, size_t n)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++)
+		free(dimms[i].label);
+	free(dimms);
+}
+
+static int cmp_dimm(const void *a, const void *b)
+{
+	const struct dimm *da = a, *db = b;
+
+	return (da->key > db->key) - (da->key < db->key);
+}
+
+/* First DIMM with a key not below key */
+static size_t dimm_lower_bound(const struct dimm *dimms, size_t n,
+			       uint32_t key)
+{
+	size_t lo = 0, hi = n, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (dimms[mid].key < key)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static const char *dimm_find(const struct dimm *dimms, size_t n, uint32_t key)
+{
+	size_t i = dimm_lower_bound(dimms, n, key);
+
+	return i < n && dimms[i].key == key ? dimms[i].label : NULL;
+}
+
+static char *trim(char *s)
+{
+	char *end;
+
+	while (isspace((unsigned char)*s))
+		s++;
+	for (end = s + strlen(s); end > s && isspace((unsigned char)end[-1]);
+	     end--)
+		;
+	*end = '\0';
+
+	return s;
+}
+
+static void lower(char *s)
+{
+	for (; *s; s++)
+		*s = tolower((unsigned char)*s);
+}
+
+static int read_file(const char *path, char *buf, size_t size)
+{
+	FILE *fp;
+	char *p;
+
+	*buf = '\0';
+	fp = fopen(path, "r");
+	if (!fp)
+		return -errno;
+	p = fgets(buf, size, fp);
+	fclose(fp);
+	if (!p)
+		return -EIO;
+
+	p = trim(buf);
+	memmove(buf, p, strlen(p) + 1);
+
+	return 0;
+}
+
+static void board_read(struct board *b)
+{
+	read_file(DMI_ID_DIR "/board_vendor", b->vendor, sizeof(b->vendor));
+	read_file(DMI_ID_DIR "/board_name", b->model, sizeof(b->model));
+	read_file(DMI_ID_DIR "/product_name", b->product, sizeof(b->product));
+	/* Product vendors are rare, so the mainboard one is used instead */
+	if (read_file(DMI_ID_DIR "/product_vendor", b->product_vendor,
+		      sizeof(b->product_vendor)))
+		strcpy(b->product_vendor, b->vendor);
+
+	lower(b->vendor);
+	lower(b->model);
+	lower(b->product_vendor);
+	lower(b->product);
+}
+
+/* Value of a "keyword: value" line, or NULL */
+static char *keyword(char *line, const char *key)
+{
+	size_t len = strlen(key);
+	char *p;
+
+	if (strncasecmp(line, key, len))
+		return NULL;
+	for (p = line + len; isspace((unsigned char)*p); p++)
+		;
+
+	return *p == ':' ? trim(p + 1) : NULL;
+}
+
+/* If name is at a list separated by commas or semicolons */
+static int list_has(char *list, const char *name)
+{
+	char *tok, *save = NULL;
+
+	for (tok = strtok_r(list, ",;", &save); tok;
+	     tok = strtok_r(NULL, ",;", &save)) {
+		tok = trim(tok);
+		lower(tok);
+		if (!strcmp(tok, name))
+			return 1;
+	}
+
+	return 0;
+}
+
+/* Parses "mc.top[.mid[.low]]", with dots or colons */
+static int parse_target(const char *s, uint32_t *key)
+{
+	int pos[4] = { -1, -1, -1, -1 }, n = 0;
+	char *end;
+
+	while (n < 4) {
+		pos[n++] = strtol(s, &end, 10);
+		if (end == s || pos[n - 1] < 0 || pos[n - 1] > 254)
+			return -EINVAL;
+		if (!*end)
+			break;
+		if (*end != '.' && *end != ':')
+			return -EINVAL;
+		s = end + 1;
+	}
+	if (n < 2 || *end)
+		return -EINVAL;
+
+	*key = dimm_key(pos[0], pos[1], pos[2], pos[3]);
+	return 0;
+}
+
+static void parse_labels(const char *file, int line, char *str,
+			 struct dimm **dimms, size_t *n)
+{
+	char *entry, *label, *target, *save = NULL, *save2 = NULL;
+	uint32_t key;
+
+	for (entry = strtok_r(str, ";", &save); entry;
+	     entry = strtok_r(NULL, ";", &save)) {
+		target = strchr(entry, ':');
+		if (!target)
+			continue;
+		*target++ = '\0';
+		label = trim(entry);
+
+		for (target = strtok_r(target, ", \t", &save2); target;
+		     target = strtok_r(NULL, ", \t", &save2)) {
+			if (parse_target(target, &key)) {
+				log(ALL, LOG_WARNING,
+				    "%s:%d: invalid DIMM location %s\n",
+				    file, line, target);
+				continue;
+			}
+			if (dimm_add(dimms, n, key, label))
+				return;
+		}
+	}
+}
+
+/*
+ * Label database, as used by ras-mc-ctl:
+ *
+ *	Vendor: <vendor>
+ *	  Model: <model>[, <model>...]	(or Product: <product>...)
+ *	    <label>: <mc>.<top>[.<mid>[.<low>]][, ...][; <label>: ...]
+ *
+ * Labels for the mainboard model take precedence over the product ones.
+ */
+static void labels_load_file(const char *file, struct board *b,
+			     struct dimm **model, size_t *nmodel,
+			     struct dimm **prod, size_t *nprod)
+{
+	char line[1024], vendor[128] = "", *p, *val;
+	enum { NONE, MODEL, PRODUCT } section = NONE;
+	int n = 0;
+	FILE *fp;
+
+	fp = fopen(file, "r");
+	if (!fp)
+		return;
+
+	while (fgets(line, sizeof(line), fp)) {
+		n++;
+		p = trim(line);
+		if (!*p || *p == '#')
+			continue;
+
+		if ((val = keyword(p, "vendor"))) {
+			snprintf(vendor, sizeof(vendor), "%s", val);
+			lower(vendor);
+			section = NONE;
+		} else if ((val = keyword(p, "model")) ||
+			   (val = keyword(p, "board"))) {
+			section = !strcmp(vendor, b->vendor) &&
+				  list_has(val, b->model) ? MODEL : NONE;
+		} else if ((val = keyword(p, "product"))) {
+			section = !strcmp(vendor, b->product_vendor) &&
+				  list_has(val, b->product) ? PRODUCT : NONE;
+		} else if (section == MODEL) {
+			parse_labels(file, n, p, model, nmodel);
+		} else if (section == PRODUCT) {
+			parse_labels(file, n, p, prod, nprod);
+		}
+	}
+	fclose(fp);
+}
+
+static void labels_load(struct dimm **labels, size_t *nlabels)
+{
+	struct dimm *model = NULL, *prod = NULL;
+	size_t nmodel = 0, nprod = 0;
+	char file[PATH_MAX];
+	struct dirent **names;
+	struct board b;
+	int i, n;
+
+	memset(&b, 0, sizeof(b));
+	board_read(&b);
+	if (!*b.vendor && !*b.product_vendor)
+		return;
+
+	labels_load_file(LABEL_DB, &b, &model, &nmodel, &prod, &nprod);
+	n = scandir(LABEL_DIR, &names, NULL, alphasort);
+	for (i = 0; i < n; i++) {
+		if (names[i]->d_name[0] != '.') {
+			snprintf(file, sizeof(file), "%s/%s", LABEL_DIR,
+				 names[i]->d_name);
+			labels_load_file(file, &b, &model, &nmodel,
+					 &prod, &nprod);
+		}
+		free(names[i]);
+	}
+	if (n >= 0)
+		free(names);
+
+	if (nmodel) {
+		dimms_free(prod, nprod);
+		*labels = model;
+		*nlabels = nmodel;
+	} else {
+		dimms_free(model, nmodel);
+		*labels = prod;
+		*nlabels = nprod;
+	}
+	if (*labels)
+		qsort(*labels, *nlabels, sizeof(**labels), cmp_dimm);
+}
+
+/* Layer positions of "channel 0 slot 1" */
+static uint32_t parse_location(int mc, char *loc)
+{
+	int pos[3] = { -1, -1, -1 }, n = 0;
+	char *tok, *save = NULL;
+
+	for (tok = strtok_r(loc, " \t", &save); tok && n < 3;
+	     tok = strtok_r(NULL, " \t", &save))
+		if (isdigit((unsigned char)*tok))
+			pos[n++] = atoi(tok);
+
+	return dimm_key(mc, pos[0], pos[1], pos[2]);
+}
+
+/* Socket of the EDAC drivers naming it, like "Skylake Socket#0 IMC#1" */
+static int mc_name_socket(const char *name)
+{
+	const char *p;
+
+	p = strstr(name, "Socket#");
+	if (p)
+		return atoi(p + strlen("Socket#"));
+	p = strstr(name, "SrcID#");
+	if (p)
+		return atoi(p + strlen("SrcID#"));
+
+	return -1;
+}
+
+/* If all the CPUs are at the same package */
+static int single_package(void)
+{
+	char path[PATH_MAX], id[16], first[16] = "";
+	struct dirent *ent;
+	unsigned cpu;
+	DIR *dir;
+	int rc = 1;
+
+	dir = opendir(CPU_DIR);
+	if (!dir)
+		return 0;
+
+	while (rc && (ent = readdir(dir))) {
+		if (sscanf(ent->d_name, "cpu%u", &cpu) != 1)
+			continue;
+		snprintf(path, sizeof(path),
+			 CPU_DIR "/%s/topology/physical_package_id",
+			 ent->d_name);
+		if (read_file(path, id, sizeof(id)))
+			continue;
+		if (!*first)
+			strcpy(first, id);
+		else if (strcmp(first, id))
+			rc = 0;
+	}
+	closedir(dir);
+
+	return rc && *first;
+}
+
+/*
+ * MCEs only know the socket, so the memory controller of a socket is
+ * only set when the EDAC driver names a single one for it, or when
+ * there's a single socket, with a single memory controller.
+ */
+static void socket_mc_set(struct dimm_map *m, int socket, int mc)
+{
+	if (socket < 0 || socket >= DIMM_MAX_SOCKETS)
+		return;
+	m->socket_mc[socket] = m->socket_mc[socket] == SOCKET_MC_NONE ?
+			       mc : SOCKET_MC_MANY;
+}
+
+static int edac_load(struct dimm_map *m, const struct dimm *labels,
+		     size_t nlabels)
+{
+	char path[PATH_MAX], loc[128], label[128];
+	struct dirent *mc_ent, *ent;
+	DIR *mc_dir, *dir;
+	const char *db;
+	uint32_t key;
+	int i, mc, last_mc = -1, nmc = 0, named = 0, rc = 0;
+
+	for (i = 0; i < DIMM_MAX_SOCKETS; i++)
+		m->socket_mc[i] = SOCKET_MC_NONE;
+
+	mc_dir = opendir(EDAC_MC_DIR);
+	if (!mc_dir)
+		return 0;
+
+	while (!rc && (mc_ent = readdir(mc_dir))) {
+		if (sscanf(mc_ent->d_name, "mc%d", &mc) != 1)
+			continue;
+		nmc++;
+		last_mc = mc;
+		snprintf(path, sizeof(path), EDAC_MC_DIR "/%s/mc_name",
+			 mc_ent->d_name);
+		if (!read_file(path, label, sizeof(label)) &&
+		    mc_name_socket(label) >= 0) {
+			socket_mc_set(m, mc_name_socket(label), mc);
+			named++;
+		}
+
+		snprintf(path, sizeof(path), EDAC_MC_DIR "/%s",
+			 mc_ent->d_name);
+		dir = opendir(path);
+		if (!dir)
+			continue;
+
+		while (!rc && (ent = readdir(dir))) {
+			if (strncmp(ent->d_name, "dimm", 4) &&
+			    strncmp(ent->d_name, "rank", 4))
+				continue;
+			snprintf(path, sizeof(path),
+				 EDAC_MC_DIR "/%s/%s/dimm_location",
+				 mc_ent->d_name, ent->d_name);
+			if (read_file(path, loc, sizeof(loc)))
+				continue;
+			snprintf(path, sizeof(path),
+				 EDAC_MC_DIR "/%s/%s/dimm_label",
+				 mc_ent->d_name, ent->d_name);
+			read_file(path, label, sizeof(label));
+
+			key = parse_location(mc, loc);
+			db = dimm_find(labels, nlabels, key);
+			if (db || *label)
+				rc = dimm_add(&m->dimms, &m->ndimms, key,
+					      db ? db : label);
+		}
+		closedir(dir);
+	}
+	closedir(mc_dir);
+
+	if (nmc == 1 && !named && single_package())
+		m->socket_mc[0] = last_mc;
+	for (i = 0; i < DIMM_MAX_SOCKETS; i++)
+		if (m->socket_mc[i] == SOCKET_MC_MANY)
+			m->socket_mc[i] = SOCKET_MC_NONE;
+
+	return rc;
+}
+
+/* SMBIOS string number n of a structure */
+static const char *dmi_string(const unsigned char *raw, size_t len,
+			      size_t hlen, unsigned n)
+{
+	const char *s = (const char *)raw + hlen, *end = (const char *)raw + len;
+
+	if (!n)
+		return NULL;
+	while (--n && s < end)
+		s += strnlen(s, end - s) + 1;
+
+	return s < end && strnlen(s, end - s) < (size_t)(end - s) ? s : NULL;
+}
+
+/*
+ * Memory devices, labeled "<bank locator> <device locator>", as done by
+ * the ghes_edac driver.
+ */
+static int smbios_load(struct dimm_map *m)
+{
+	unsigned char raw[4096];
+	char path[PATH_MAX], label[256];
+	const char *bank, *dev;
+	struct dirent *ent;
+	ssize_t len;
+	DIR *dir;
+	int fd, rc = 0;
+
+	dir = opendir(DMI_ENTRIES_DIR);
+	if (!dir)
+		return 0;
+
+	while (!rc && (ent = readdir(dir))) {
+		if (strncmp(ent->d_name, "17-", 3))
+			continue;
+		snprintf(path, sizeof(path), DMI_ENTRIES_DIR "/%s/raw",
+			 ent->d_name);
+		fd = open(path, O_RDONLY);
+		if (fd < 0)
+			continue;
+		len = read(fd, raw, sizeof(raw));
+		close(fd);
+
+		/* Skip empty slots, with a zero size */
+		if (len < 0x12 || raw[0] != DMI_MEMORY_DEVICE ||
+		    raw[1] < 0x12 || raw[1] > len ||
+		    !(raw[0x0c] | raw[0x0d]))
+			continue;
+
+		dev = dmi_string(raw, len, raw[1], raw[0x10]);
+		bank = dmi_string(raw, len, raw[1], raw[0x11]);
+		if (!dev)
+			continue;
+		if (bank && *bank)
+			snprintf(label, sizeof(label), "%s %s", bank, dev);
+		else
+			snprintf(label, sizeof(label), "%s", dev);
+
+		rc = dimm_add(&m->handles, &m->nhandles,
+			      raw[2] | raw[3] << 8, label);
+	}
+	closedir(dir);
+
+	return rc;
+}
+
+static void map_free(struct dimm_map *m)
+{
+	if (!m)
+		return;
+
+	dimms_free(m->dimms, m->ndimms);
+	dimms_free(m->handles, m->nhandles);
+	free(m);
+}
+
+static struct dimm_map *map_build(void)
+{
+	struct dimm *labels = NULL;
+	size_t nlabels = 0;
+	struct dimm_map *m;
+
+	m = calloc(1, sizeof(*m));
+	if (!m)
+		return NULL;
+
+	labels_load(&labels, &nlabels);
+	if (edac_load(m, labels, nlabels) || smbios_load(m)) {
+		log(ALL, LOG_ERR, "Can't allocate the DIMM label index\n");
+		dimms_free(labels, nlabels);
+		map_free(m);
+		return NULL;
+	}
+	dimms_free(labels, nlabels);
+
+	if (m->dimms)
+		qsort(m->dimms, m->ndimms, sizeof(*m->dimms), cmp_dimm);
+	if (m->handles)
+		qsort(m->handles, m->nhandles, sizeof(*m->handles), cmp_dimm);
+
+	return m;
+}
+
+static time_t now_secs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+/*
+ * Wakes up the refresh thread if the map is too old, at the first thread
+ * noticing it. The lookup itself uses the current map.
+ */
+static void dimm_refresh(struct ras_dimm_index *di)
+{
+	if (!di->refresh ||
+	    now_secs() - __atomic_load_n(&di->built, __ATOMIC_RELAXED) <
+						(time_t)di->refresh ||
+	    __atomic_exchange_n(&di->building, 1, __ATOMIC_ACQUIRE))
+		return;
+
+	pthread_mutex_lock(&di->wake_lock);
+	di->rebuild = 1;
+	pthread_cond_signal(&di->wake);
+	pthread_mutex_unlock(&di->wake_lock);
+}
+
+static void *dimm_thread(void *priv)
+{
+	struct ras_dimm_index *di = priv;
+	struct dimm_map *m, *old;
+
+	pthread_mutex_lock(&di->wake_lock);
+	for (;;) {
+		while (!di->rebuild && !di->stop)
+			pthread_cond_wait(&di->wake, &di->wake_lock);
+		if (di->stop)
+			break;
+		di->rebuild = 0;
+		pthread_mutex_unlock(&di->wake_lock);
+
+		m = map_build();
+		if (m) {
+			pthread_rwlock_wrlock(&di->lock);
+			old = di->map;
+			di->map = m;
+			pthread_rwlock_unlock(&di->lock);
+			map_free(old);
+		}
+		__atomic_store_n(&di->built, now_secs(), __ATOMIC_RELAXED);
+		__atomic_store_n(&di->building, 0, __ATOMIC_RELEASE);
+
+		pthread_mutex_lock(&di->wake_lock);
+	}
+	pthread_mutex_unlock(&di->wake_lock);
+
+	return NULL;
+}
+
+struct ras_dimm_index *ras_dimm_init(void)
+{
+	struct ras_dimm_index *di;
+
+	di = calloc(1, sizeof(*di));
+	if (!di)
+		return NULL;
+
+	di->map = map_build();
+	if (!di->map) {
+		free(di);
+		return NULL;
+	}
+	di->refresh = ras_env_ulong("RAS_DIMM_REFRESH", DIMM_REFRESH);
+	di->built = now_secs();
+	pthread_rwlock_init(&di->lock, NULL);
+	pthread_mutex_init(&di->wake_lock, NULL);
+	pthread_cond_init(&di->wake, NULL);
+	if (di->refresh && pthread_create(&di->thread, NULL, dimm_thread, di)) {
+		log(ALL, LOG_ERR, "Can't start the DIMM labels refresh thread\n");
+		di->refresh = 0;
+	}
+
+	log(ALL, LOG_INFO, "DIMM labels: %zu EDAC DIMMs, %zu SMBIOS memory devices\n",
+	    di->map->ndimms, di->map->nhandles);
+
+	return di;
+}
+
+void ras_dimm_free(struct ras_dimm_index *di)
+{
+	if (!di)
+		return;
+
+	if (di->refresh) {
+		pthread_mutex_lock(&di->wake_lock);
+		di->stop = 1;
+		pthread_cond_signal(&di->wake);
+		pthread_mutex_unlock(&di->wake_lock);
+		pthread_join(di->thread, NULL);
+	}
+
+	map_free(di->map);
+	pthread_cond_destroy(&di->wake);
+	pthread_mutex_destroy(&di->wake_lock);
+	pthread_rwlock_destroy(&di->lock);
+	free(di);
+}
+
+int ras_dimm_label(struct ras_events *ras, int mc, int top, int mid, int low,
+		   char *buf, size_t size)
+{
+	struct ras_dimm_index *di = ras->dimms;
+	const char *label;
+	int rc = -ENOENT;
+
+	if (!di || mc < 0)
+		return -ENOENT;
+
+	dimm_refresh(di);
+	pthread_rwlock_rdlock(&di->lock);
+	label = dimm_find(di->map->dimms, di->map->ndimms,
+			  dimm_key(mc, top, mid, low));
+	if (label) {
+		snprintf(buf, size, "%s", label);
+		rc = 0;
+	}
+	pthread_rwlock_unlock(&di->lock);
+
+	return rc;
+}
+
+int ras_dimm_channel_label(struct ras_events *ras, int mc, int channel,
+			   char *buf, size_t size)
+{
+	struct ras_dimm_index *di = ras->dimms;
+	const struct dimm *dimms;
+	uint32_t key;
+	size_t i, n;
+	int rc = -ENOENT;
+
+	if (!di || mc < 0 || channel < 0)
+		return -ENOENT;
+
+	dimm_refresh(di);
+	pthread_rwlock_rdlock(&di->lock);
+	dimms = di->map->dimms;
+	n = di->map->ndimms;
+	key = dimm_key(mc, channel, 0, 0);
+	i = dimm_lower_bound(dimms, n, key);
+	if (i < n && dimms[i].key >> 16 == key >> 16 &&
+	    (i + 1 == n || dimms[i + 1].key >> 16 != key >> 16)) {
+		snprintf(buf, size, "%s", dimms[i].label);
+		rc = 0;
+	}
+	pthread_rwlock_unlock(&di->lock);
+
+	return rc;
+}
+
+int ras_dimm_socket_mc(struct ras_events *ras, unsigned socket)
+{
+	struct ras_dimm_index *di = ras->dimms;
+	int mc;
+
+	if (!di || socket >= DIMM_MAX_SOCKETS)
+		return -ENOENT;
+
+	dimm_refresh(di);
+	pthread_rwlock_rdlock(&di->lock);
+	mc = di->map->socket_mc[socket];
+	pthread_rwlock_unlock(&di->lock);
+
+	return mc >= 0 ? mc : -ENOENT;
+}
+
+int ras_dimm_handle_label(struct ras_events *ras, unsigned handle,
+			  char *buf, size_t size)
+{
+	struct ras_dimm_index *di = ras->dimms;
+	const char *label;
+	int rc = -ENOENT;
+
+	if (!di)
+		return -ENOENT;
+
+	dimm_refresh(di);
+	pthread_rwlock_rdlock(&di->lock);
+	label = dimm_find(di->map->handles, di->map->nhandles, handle);
+	if (label) {
+		snprintf(buf, size, "%s", label);
+		rc = 0;
+	}
+	pthread_rwlock_unlock(&di->lock);
+
+	return rc;
+}
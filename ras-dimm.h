@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_DIMM_H
+#define __RAS_DIMM_H
+
+#include <stddef.h>
+
+struct ras_events;
+
+/*
+ * DIMM labels. The EDAC DIMMs, the label database at
+ * SYSCONFDIR/ras/dimm_labels.d, as used by ras-mc-ctl, and the SMBIOS
+ * memory devices are read into a sorted index, rebuilt by its own thread
+ * every RAS_DIMM_REFRESH seconds, when used. Lookups copy the label to buf, returning
+ * 0, or -ENOENT if there's no such DIMM.
+ */
+struct ras_dimm_index;
+
+struct ras_dimm_index *ras_dimm_init(void);
+void ras_dimm_free(struct ras_dimm_index *di);
+
+/* By EDAC memory controller and layers. Unused layers are -1. */
+int ras_dimm_label(struct ras_events *ras, int mc, int top, int mid, int low,
+		   char *buf, size_t size);
+
+/* The only DIMM of an EDAC memory controller channel */
+int ras_dimm_channel_label(struct ras_events *ras, int mc, int channel,
+			   char *buf, size_t size);
+
+/*
+ * The EDAC memory controller of a socket, or -ENOENT if it's unknown, or
+ * if the socket has several of them
+ */
+int ras_dimm_socket_mc(struct ras_events *ras, unsigned socket);
+
+/* By SMBIOS memory device handle, as at UEFI CPER memory errors */
+int ras_dimm_handle_label(struct ras_events *ras, unsigned handle,
+			  char *buf, size_t size);
+
+#endif
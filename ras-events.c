@@ -15,9 +15,12 @@
  * along with this program; if not, write to the Free Software
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
 */
+#define _GNU_SOURCE
+#include <ctype.h>
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,7 +37,20 @@
 #include "ras-mce-handler.h"
 #include "ras-extlog-handler.h"
 #include "ras-record.h"
+#include "ras-page-isolation.h"
+#include "ras-cpu-isolation.h"
+#include "ras-rules.h"
+#include "ras-dimm.h"
+#include "ras-hitters.h"
+#include "ras-ctl.h"
+#include "ras-subscribe.h"
+#include "ras-metrics.h"
 #include "ras-logger.h"
+#include "ras-config.h"
+#include "ras-filter.h"
+#include "ras-decode.h"
+#include "ras-merge.h"
+#include "ras-incident.h"
 
 /*
  * Polling time, if read() doesn't block. Currently, trace_pipe_raw never
@@ -43,6 +59,24 @@
  */
 #define POLLING_TIME 3
 
+/*
+ * Ring buffer sizing: how often the per-CPU stats are checked, the fill
+ * level that triggers a grow and for how long the buffer should be quiet
+ * before shrinking it back. All times in seconds.
+ */
+#define RING_CHECK_TIME		5
+#define RING_HIGH_FILL		75
+#define RING_SHRINK_TIME	300
+
+/* Set when rasdaemon is asked to stop */
+static volatile sig_atomic_t ras_exiting;
+static sigset_t ras_sigmask;
+
+static void ras_stop(int sig)
+{
+	ras_exiting = 1;
+}
+
 /* Test for a little-endian machine */
 #if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
 	#define ENDIAN KBUFFER_ENDIAN_LITTLE
@@ -91,11 +125,16 @@ static int get_debugfs_dir(char *tracing_dir, size_t len)
 	return ENOENT;
 }
 
-static int open_trace(struct ras_events *ras, char *name, int flags)
+static const char *instance_name[] = {
+	[RAS_INST_CRITICAL] = "critical",
+	[RAS_INST_BULK] = "bulk",
+};
+
+static int open_trace(char *tracing, char *name, int flags)
 {
 	char fname[MAX_PATH + 1];
 
-	strcpy(fname, ras->tracing);
+	strcpy(fname, tracing);
 	strcat(fname, "/");
 	strcat(fname, name);
 
@@ -105,7 +144,7 @@ static int open_trace(struct ras_events *ras, char *name, int flags)
 static int get_tracing_dir(struct ras_events *ras)
 {
 	char		fname[MAX_PATH + 1];
-	int		rc, has_instances = 0;
+	int		rc, i, has_instances = 0;
 	DIR		*dir;
 	struct dirent	*entry;
 
@@ -127,23 +166,48 @@ static int get_tracing_dir(struct ras_events *ras)
 
 	strcpy(ras->tracing, ras->debugfs);
 	strcat(ras->tracing, "/tracing");
-	if (has_instances) {
-		strcat(ras->tracing, "/instances/" TOOL_NAME);
-		rc = mkdir(ras->tracing, S_IRWXU);
+	if (!has_instances) {
+		ras->ninstances = 1;
+		ras->inst[0].name = "main";
+		strcpy(ras->inst[0].tracing, ras->tracing);
+		return 0;
+	}
+
+	/* Drop the single instance used by older versions, if not in use */
+	strcpy(fname, ras->tracing);
+	strcat(fname, "/instances/" TOOL_NAME);
+	rmdir(fname);
+
+	ras->use_instance = 1;
+	ras->ninstances = RAS_NUM_INSTANCES;
+	for (i = 0; i < RAS_NUM_INSTANCES; i++) {
+		struct ras_instance *inst = &ras->inst[i];
+
+		inst->name = instance_name[i];
+		strcpy(inst->tracing, ras->tracing);
+		strcat(inst->tracing, "/instances/" TOOL_NAME "-");
+		strcat(inst->tracing, inst->name);
+		rc = mkdir(inst->tracing, S_IRWXU);
 		if (rc < 0 && errno != EEXIST) {
 			log(ALL, LOG_INFO,
 			    "Unable to create " TOOL_NAME " instance at %s\n",
-			    ras->tracing);
+			    inst->tracing);
 			return -1;
 		}
 	}
 	return 0;
 }
 
+static struct ras_instance *get_instance(struct ras_events *ras,
+					 enum ras_instance_id id)
+{
+	return &ras->inst[ras->use_instance ? id : 0];
+}
+
 /*
  * Tracing enable/disable code
  */
-static int __toggle_ras_mc_event(struct ras_events *ras,
+static int __toggle_ras_mc_event(struct ras_instance *inst,
 				 char *group, char *event, int enable)
 {
 	int fd, rc;
@@ -154,7 +218,7 @@ static int __toggle_ras_mc_event(struct ras_events *ras,
 		 group, event);
 
 	/* Enable RAS events */
-	fd = open_trace(ras, "set_event", O_RDWR | O_APPEND);
+	fd = open_trace(inst->tracing, "set_event", O_RDWR | O_APPEND);
 	if (fd < 0) {
 		log(ALL, LOG_WARNING, "Can't open set_event\n");
 		return errno;
@@ -172,9 +236,9 @@ static int __toggle_ras_mc_event(struct ras_events *ras,
 		return EIO;
 	}
 
-	log(ALL, LOG_INFO, "%s:%s event %s\n",
+	log(ALL, LOG_INFO, "%s:%s event %s at %s instance\n",
 	    group, event,
-	    enable ? "enabled" : "disabled");
+	    enable ? "enabled" : "disabled", inst->name);
 
 	return 0;
 }
@@ -196,26 +260,32 @@ int toggle_ras_mc_event(int enable)
 		goto free_ras;
 	}
 
-	rc = __toggle_ras_mc_event(ras, "ras", "mc_event", enable);
+	rc = __toggle_ras_mc_event(get_instance(ras, RAS_INST_BULK),
+				   "ras", "mc_event", enable);
 
 #ifdef HAVE_AER
-	rc |= __toggle_ras_mc_event(ras, "ras", "aer_event", enable);
+	rc |= __toggle_ras_mc_event(get_instance(ras, RAS_INST_CRITICAL),
+				    "ras", "aer_event", enable);
 #endif
 
 #ifdef HAVE_MCE
-	rc |= __toggle_ras_mc_event(ras, "mce", "mce_record", enable);
+	rc |= __toggle_ras_mc_event(get_instance(ras, RAS_INST_BULK),
+				    "mce", "mce_record", enable);
 #endif
 
 #ifdef HAVE_EXTLOG
-	rc |= __toggle_ras_mc_event(ras, "ras", "extlog_mem_event", enable);
+	rc |= __toggle_ras_mc_event(get_instance(ras, RAS_INST_CRITICAL),
+				    "ras", "extlog_mem_event", enable);
 #endif
 
 #ifdef HAVE_NON_STANDARD
-	rc |= __toggle_ras_mc_event(ras, "ras", "non_standard_event", enable);
+	rc |= __toggle_ras_mc_event(get_instance(ras, RAS_INST_CRITICAL),
+				    "ras", "non_standard_event", enable);
 #endif
 
 #ifdef HAVE_ARM
-	rc |= __toggle_ras_mc_event(ras, "ras", "arm_event", enable);
+	rc |= __toggle_ras_mc_event(get_instance(ras, RAS_INST_CRITICAL),
+				    "ras", "arm_event", enable);
 #endif
 
 free_ras:
@@ -233,7 +303,7 @@ static int get_pagesize(struct ras_events *ras, struct pevent *pevent)
 	int fd, len, page_size = 4096;
 	char buf[page_size];
 
-	fd = open_trace(ras, "events/header_page", O_RDONLY);
+	fd = open_trace(ras->tracing, "events/header_page", O_RDONLY);
 	if (fd < 0)
 		return page_size;
 
@@ -251,28 +321,368 @@ error:
 
 }
 
+/*
+ * Trace ring buffer sizing
+ */
+
+static int read_trace_ulong(struct ras_instance *inst, char *name,
+			    unsigned long long *val)
+{
+	char buf[128], *p;
+	int fd, size;
+
+	fd = open_trace(inst->tracing, name, O_RDONLY);
+	if (fd < 0)
+		return -1;
+	size = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (size <= 0)
+		return -1;
+	buf[size] = '\0';
+
+	/* Unused buffers are shown as "7 (expanded: 1408)" */
+	p = strstr(buf, "expanded:");
+	if (p)
+		p += strlen("expanded:");
+	else
+		p = buf;
+
+	return sscanf(p, "%llu", val) == 1 ? 0 : -1;
+}
+
+static int write_trace(struct ras_instance *inst, char *name, char *val)
+{
+	int fd, rc;
+
+	fd = open_trace(inst->tracing, name, O_WRONLY);
+	if (fd < 0)
+		return errno;
+	rc = write(fd, val, strlen(val));
+	close(fd);
+	if (rc < 0)
+		return errno;
+
+	return 0;
+}
+
+/*
+ * Tunables can be set per instance (RAS_TRACE_CRITICAL_BUFFER_KB) or
+ * for all of them (RAS_TRACE_BUFFER_KB).
+ */
+static void ring_env_name(char *name, size_t len, struct ras_instance *inst,
+			  char *var)
+{
+	char *p;
+
+	snprintf(name, len, "RAS_TRACE_%s_%s", inst->name, var);
+	for (p = name; *p; p++)
+		*p = toupper(*p);
+}
+
+static unsigned long ring_env_ulong(struct ras_instance *inst, char *var,
+				    unsigned long def)
+{
+	char name[64];
+
+	snprintf(name, sizeof(name), "RAS_TRACE_%s", var);
+	def = ras_env_ulong(name, def);
+	ring_env_name(name, sizeof(name), inst, var);
+
+	return ras_env_ulong(name, def);
+}
+
+static int ring_env_bool(struct ras_instance *inst, char *var, int def)
+{
+	char name[64];
+
+	snprintf(name, sizeof(name), "RAS_TRACE_%s", var);
+	def = ras_env_bool(name, def);
+	ring_env_name(name, sizeof(name), inst, var);
+
+	return ras_env_bool(name, def);
+}
+
+static int set_buffer_size(struct ras_instance *inst, unsigned kb)
+{
+	char buf[32];
+	int rc;
+
+	snprintf(buf, sizeof(buf), "%u", kb);
+	rc = write_trace(inst, "buffer_size_kb", buf);
+	if (rc) {
+		log(ALL, LOG_WARNING,
+		    "Can't set %s buffer_size_kb to %u: %s\n",
+		    inst->name, kb, strerror(rc));
+		return rc;
+	}
+	inst->buffer_kb = kb;
+
+	return 0;
+}
+
+static void setup_instance_ring(struct ras_events *ras,
+				struct ras_instance *inst)
+{
+	unsigned long long val;
+	unsigned long kb;
+	int overwrite, rc;
+	char buf[32];
+
+	inst->ring_cpu = calloc(ras->ncpus, sizeof(*inst->ring_cpu));
+
+	overwrite = ring_env_bool(inst, "OVERWRITE", -1);
+	if (overwrite >= 0) {
+		rc = write_trace(inst, "options/overwrite", overwrite ? "1" : "0");
+		if (rc)
+			log(ALL, LOG_WARNING, "Can't set %s overwrite mode: %s\n",
+			    inst->name, strerror(rc));
+		else
+			log(ALL, LOG_INFO,
+			    "%s ring buffer %s oldest events when full\n",
+			    inst->name, overwrite ? "overwrites" : "keeps");
+	}
+
+	kb = ring_env_ulong(inst, "BUFFER_PERCENT", ~0ul);
+	if (kb != ~0ul) {
+		snprintf(buf, sizeof(buf), "%lu", kb);
+		rc = write_trace(inst, "buffer_percent", buf);
+		if (rc)
+			log(ALL, LOG_WARNING, "Can't set %s buffer_percent: %s\n",
+			    inst->name, strerror(rc));
+	}
+
+	if (read_trace_ulong(inst, "buffer_size_kb", &val)) {
+		log(ALL, LOG_WARNING, "Can't read %s buffer_size_kb\n",
+		    inst->name);
+		return;
+	}
+	inst->buffer_kb = val;
+
+	kb = ring_env_ulong(inst, "BUFFER_KB", 0);
+	if (kb && kb != inst->buffer_kb)
+		set_buffer_size(inst, kb);
+	inst->buffer_base_kb = inst->buffer_kb;
+
+	inst->buffer_max_kb = ring_env_ulong(inst, "BUFFER_MAX_KB",
+					     4 * inst->buffer_base_kb);
+	if (inst->buffer_max_kb < inst->buffer_base_kb)
+		inst->buffer_max_kb = inst->buffer_base_kb;
+
+	log(ALL, LOG_INFO,
+	    "%s ring buffer size: %u KiB per CPU (max %u KiB)\n",
+	    inst->name, inst->buffer_kb, inst->buffer_max_kb);
+}
+
+static void setup_ring_buffer(struct ras_events *ras, unsigned cpus)
+{
+	int i;
+
+	ras->ncpus = cpus;
+
+	/* Don't touch the ring buffer shared with other tracing users */
+	if (!ras->use_instance)
+		return;
+
+	for (i = 0; i < ras->ninstances; i++)
+		setup_instance_ring(ras, &ras->inst[i]);
+}
+
+static void account_missed_events(struct pthread_data *pdata, int missed)
+{
+	struct ras_instance *inst = pdata->inst;
+
+	/* The kernel may flag a loss without knowing how many were lost */
+	if (missed < 0)
+		missed = 1;
+
+	if (inst->ring_cpu)
+		__atomic_add_fetch(&inst->ring_cpu[pdata->cpu].missed, missed,
+				   __ATOMIC_RELAXED);
+
+	log(ALL, LOG_WARNING,
+	    "cpu %02d: %d events lost at the %s ring buffer\n",
+	    pdata->cpu, missed, inst->name);
+}
+
+/*
+ * Checks the per-CPU ring buffer statistics, growing the buffer when
+ * events got lost or the buffer is getting full, and shrinking it back
+ * when things are quiet again.
+ */
+static void adjust_instance_ring(struct ras_events *ras,
+				 struct ras_instance *inst)
+{
+	unsigned long long overrun, dropped, bytes, missed, lost = 0;
+	unsigned fill, max_fill = 0, kb;
+	char fname[MAX_PATH + 1], *p;
+	time_t now = time(NULL);
+	FILE *fp;
+	int fd, i;
+
+	if (!inst->buffer_kb || !inst->ring_cpu)
+		return;
+	if (now - inst->ring_checked < RING_CHECK_TIME)
+		return;
+	inst->ring_checked = now;
+
+	for (i = 0; i < ras->ncpus; i++) {
+		struct ras_ring_cpu *rc = &inst->ring_cpu[i];
+		char line[128];
+
+		snprintf(fname, sizeof(fname), "per_cpu/cpu%d/stats", i);
+		fd = open_trace(inst->tracing, fname, O_RDONLY);
+		if (fd < 0)
+			continue;
+		fp = fdopen(fd, "r");
+		if (!fp) {
+			close(fd);
+			continue;
+		}
+
+		overrun = dropped = bytes = 0;
+		while (fgets(line, sizeof(line), fp)) {
+			p = strchr(line, ':');
+			if (!p)
+				continue;
+			if (!strncmp(line, "overrun:", 8))
+				overrun = strtoull(p + 1, NULL, 10);
+			else if (!strncmp(line, "dropped events:", 15))
+				dropped = strtoull(p + 1, NULL, 10);
+			else if (!strncmp(line, "bytes:", 6))
+				bytes = strtoull(p + 1, NULL, 10);
+		}
+		fclose(fp);
+
+		missed = __atomic_exchange_n(&rc->missed, 0, __ATOMIC_RELAXED);
+		lost += missed;
+		if (overrun > rc->overrun)
+			lost += overrun - rc->overrun;
+		if (dropped > rc->dropped)
+			lost += dropped - rc->dropped;
+		rc->overrun = overrun;
+		rc->dropped = dropped;
+
+		fill = bytes * 100 / ((unsigned long long)inst->buffer_kb * 1024);
+		if (fill > max_fill)
+			max_fill = fill;
+	}
+
+	if (lost || max_fill >= RING_HIGH_FILL) {
+		inst->ring_busy = now;
+		if (inst->buffer_kb >= inst->buffer_max_kb)
+			return;
+
+		kb = inst->buffer_kb * 2;
+		if (kb > inst->buffer_max_kb)
+			kb = inst->buffer_max_kb;
+
+		log(ALL, LOG_INFO,
+		    "%llu events lost, buffer %u%% full: growing %s ring buffer to %u KiB\n",
+		    lost, max_fill, inst->name, kb);
+		set_buffer_size(inst, kb);
+		return;
+	}
+
+	if (inst->buffer_kb > inst->buffer_base_kb &&
+	    now - inst->ring_busy >= RING_SHRINK_TIME) {
+		kb = inst->buffer_kb / 2;
+		if (kb < inst->buffer_base_kb)
+			kb = inst->buffer_base_kb;
+
+		log(ALL, LOG_INFO, "Shrinking %s ring buffer back to %u KiB\n",
+		    inst->name, kb);
+		set_buffer_size(inst, kb);
+		inst->ring_busy = now;
+	}
+}
+
+static void adjust_ring_buffer(struct ras_events *ras)
+{
+	static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+	int i;
+
+	if (!ras->use_instance)
+		return;
+
+	/* On the pthread way, let just one thread do it */
+	if (pthread_mutex_trylock(&ring_lock))
+		return;
+
+	for (i = 0; i < ras->ninstances; i++)
+		adjust_instance_ring(ras, &ras->inst[i]);
+
+	pthread_mutex_unlock(&ring_lock);
+}
+
 static void parse_ras_data(struct pthread_data *pdata, struct kbuffer *kbuf,
 			   void *data, unsigned long long time_stamp)
 {
 	struct pevent_record record;
-	struct trace_seq s;
 
 	record.ts = time_stamp;
 	record.size = kbuffer_event_size(kbuf);
 	record.data = data;
 	record.offset = kbuffer_curr_offset(kbuf);
 
+	record.cpu = pdata->cpu;
+
 	/* note offset is just offset in subbuffer */
 	record.missed_events = kbuffer_missed_events(kbuf);
 	record.record_size = kbuffer_curr_size(kbuf);
 
+	if (record.missed_events)
+		account_missed_events(pdata, record.missed_events);
+
+	/* Events the Kernel couldn't filter out */
+	if (pdata->ras->filter &&
+	    pevent_filter_match(pdata->ras->filter, &record) == FILTER_MISS)
+		return;
+
+	/* Critical events aren't held back by the bulk ones */
+	if (pdata->ras->merge &&
+	    !(pdata->ras->use_instance &&
+	      pdata->inst == &pdata->ras->inst[RAS_INST_CRITICAL]))
+		ras_merge_push(pdata, &record);
+	else
+		ras_dispatch_record(pdata, &record);
+}
+
+/* Passes an event on to the decode workers, or decodes it */
+void ras_dispatch_record(struct pthread_data *pdata,
+			 struct pevent_record *record)
+{
+	if (pdata->ras->decode)
+		ras_decode_queue(pdata, record);
+	else
+		ras_print_record(pdata, record);
+}
+
+/* Decodes and stores an event, calling its handler */
+void ras_print_record(struct pthread_data *pdata, struct pevent_record *record)
+{
+	struct trace_seq s;
+
 	/* TODO - logging */
 	trace_seq_init(&s);
+	pevent_print_event(pdata->ras->pevent, &s, record);
+
+	ras_decode_ordered();
 	printf("cpu %02d:", pdata->cpu);
-	fflush(stdout);
-	pevent_print_event(pdata->ras->pevent, &s, &record);
 	trace_seq_do_printf(&s);
 	printf("\n");
+	fflush(stdout);
+	trace_seq_destroy(&s);
+}
+
+void ras_notify_event(struct ras_events *ras, enum ras_rule_event type,
+		      const void *ev)
+{
+	/* Decode workers pass on each stream events in order */
+	ras_decode_ordered();
+
+	ras_metrics_count(ras, type, ev);
+	ras_subs_publish(ras, type, ev);
+	ras_rules_eval(ras, type, ev);
 }
 
 static int get_num_cpus(struct ras_events *ras)
@@ -300,25 +710,74 @@ static int get_num_cpus(struct ras_events *ras)
 #endif
 }
 
-static int read_ras_event_all_cpus(struct pthread_data *pdata,
-				   unsigned n_cpus)
+static int read_ras_page(struct pthread_data *pdata, int fd,
+			 struct kbuffer *kbuf, void *page)
 {
-	unsigned size;
 	unsigned long long time_stamp;
 	void *data;
+	int size;
+
+	size = read(fd, page, pdata->ras->page_size);
+	if (size <= 0)
+		return size;
+
+	kbuffer_load_subbuffer(kbuf, page);
+
+	while ((data = kbuffer_read_event(kbuf, &time_stamp))) {
+		parse_ras_data(pdata, kbuf, data, time_stamp);
+
+		/* increment to read next event */
+		kbuffer_next_event(kbuf, NULL);
+	}
+
+	return size;
+}
+
+/*
+ * Reads whatever is pending at the higher priority streams, stored
+ * at the beginning of the pdata/fds arrays.
+ */
+static void drain_priority_streams(struct pthread_data *pdata,
+				   struct pollfd *fds, unsigned n_prio,
+				   struct kbuffer *kbuf, void *page)
+{
+	int i, busy;
+
+	do {
+		busy = 0;
+		if (poll(fds, n_prio, 0) <= 0)
+			return;
+
+		for (i = 0; i < n_prio; i++) {
+			if (!(fds[i].revents & POLLIN))
+				continue;
+			if (read_ras_page(&pdata[i], fds[i].fd, kbuf, page) > 0)
+				busy = 1;
+		}
+	} while (busy);
+}
+
+static int read_ras_event_all_cpus(struct pthread_data *pdata,
+				   unsigned n_streams)
+{
+	int size, rc = 0;
 	int ready, i, count_nready;
+	int timeout, db_timeout, merge_timeout;
+	struct timespec ts;
+	unsigned n_prio;
 	struct kbuffer *kbuf;
 	void *page;
-	struct pollfd fds[n_cpus];
-	int warnonce[n_cpus];
+	struct pollfd fds[n_streams];
+	int warnonce[n_streams];
 	char pipe_raw[PATH_MAX];
+	struct ras_events *ras = pdata[0].ras;
 #if 0
 	int need_sleep = 0;
 #endif
 
 	memset(&warnonce, 0, sizeof(warnonce));
 
-	page = malloc(pdata[0].ras->page_size);
+	page = malloc(ras->page_size);
 	if (!page) {
 		log(TERM, LOG_ERR, "Can't allocate page\n");
 		return -ENOMEM;
@@ -331,37 +790,68 @@ static int read_ras_event_all_cpus(struct pthread_data *pdata,
 		return -ENOMEM;
 	}
 
-	for (i = 0; i < n_cpus; i++) {
+	/* Streams are sorted by instance priority */
+	n_prio = 0;
+	for (i = 0; i < n_streams; i++) {
 		fds[i].events = POLLIN;
 
+		if (pdata[i].inst == pdata[0].inst)
+			n_prio++;
+
 		/* FIXME: use select to open for all CPUs */
 		snprintf(pipe_raw, sizeof(pipe_raw),
-			"per_cpu/cpu%d/trace_pipe_raw", i);
+			"per_cpu/cpu%d/trace_pipe_raw", pdata[i].cpu);
 
-		fds[i].fd = open_trace(pdata[0].ras, pipe_raw, O_RDONLY);
+		fds[i].fd = open_trace(pdata[i].inst->tracing, pipe_raw,
+				       O_RDONLY);
 		if (fds[i].fd < 0) {
 			log(TERM, LOG_ERR, "Can't open trace_pipe_raw\n");
+			while (--i >= 0)
+				close(fds[i].fd);
 			kbuffer_free(kbuf);
 			free(page);
 			return -EINVAL;
 		}
 	}
 
-	log(TERM, LOG_INFO, "Listening to events for cpus 0 to %d\n", n_cpus - 1);
-	if (pdata[0].ras->record_events)
-		ras_mc_event_opendb(pdata[0].cpu, pdata[0].ras);
+	log(TERM, LOG_INFO, "Listening to events for cpus 0 to %d\n",
+	    ras->ncpus - 1);
+	if (ras->record_events)
+		ras_mc_event_opendb(pdata[0].cpu, ras);
 
-	do {
-		ready = poll(fds, n_cpus, -1);
+	while (!ras_exiting) {
+		/*
+		 * Wake up from time to time to resize the ring buffer, to
+		 * pass on the events held for merging and to commit the
+		 * batched events. Stop requests are only handled while
+		 * waiting here.
+		 */
+		timeout = ras->use_instance ? RING_CHECK_TIME * 1000 : -1;
+		merge_timeout = ras_merge_flush(ras);
+		if (merge_timeout >= 0 && (timeout < 0 || merge_timeout < timeout))
+			timeout = merge_timeout;
+		db_timeout = ras_db_flush(ras);
+		if (db_timeout >= 0 && (timeout < 0 || db_timeout < timeout))
+			timeout = db_timeout;
+		ts.tv_sec = timeout / 1000;
+		ts.tv_nsec = (timeout % 1000) * 1000000;
+
+		ready = ppoll(fds, n_streams, timeout < 0 ? NULL : &ts,
+			      &ras_sigmask);
 		if (ready < 0) {
-			log(TERM, LOG_WARNING, "poll\n");
+			if (errno != EINTR)
+				log(TERM, LOG_WARNING, "poll\n");
+			continue;
+		} else if (!ready) {
+			adjust_ring_buffer(ras);
+			continue;
 		}
 		count_nready = 0;
-		for (i = 0; i < n_cpus; i++) {
+		for (i = 0; i < n_streams; i++) {
 			if (fds[i].revents & POLLERR) {
 				if (!warnonce[i]) {
 					log(TERM, LOG_INFO,
-					    "Error on CPU %i\n", i);
+					    "Error on CPU %i\n", pdata[i].cpu);
 					warnonce[i]++;
 #if 0
 					need_sleep = 1;
@@ -372,24 +862,21 @@ static int read_ras_event_all_cpus(struct pthread_data *pdata,
 				count_nready++;
 				continue;
 			}
-			size = read(fds[i].fd, page, pdata[i].ras->page_size);
+
+			/* Lower priority streams never delay critical events */
+			if (i >= n_prio)
+				drain_priority_streams(pdata, fds, n_prio,
+						       kbuf, page);
+
+			size = read_ras_page(&pdata[i], fds[i].fd, kbuf, page);
 			if (size < 0) {
 				log(TERM, LOG_WARNING, "read\n");
 				return -1;
-			} else if (size > 0) {
-				kbuffer_load_subbuffer(kbuf, page);
-
-				while ((data = kbuffer_read_event(kbuf, &time_stamp))) {
-					parse_ras_data(&pdata[i],
-						       kbuf, data, time_stamp);
-
-					/* increment to read next event */
-					kbuffer_next_event(kbuf, NULL);
-				}
-			} else {
+			} else if (!size) {
 				count_nready++;
 			}
 		}
+		adjust_ring_buffer(ras);
 #if 0
 		if (need_sleep)
 			sleep(POLLING_TIME);
@@ -398,22 +885,24 @@ static int read_ras_event_all_cpus(struct pthread_data *pdata,
 		 * If we enable fallback mode, it will always be used, as
 		 * poll is still not working fine, IMHO
 		 */
-		if (count_nready == n_cpus) {
+		if (count_nready == n_streams) {
 			/* Should only happen with legacy kernels */
+			rc = -255;
 			break;
 		}
 #endif
-	} while (1);
+	}
 
 	/* poll() is not supported. We need to fallback to the old way */
-	log(TERM, LOG_INFO,
-	    "Old kernel detected. Stop listening and fall back to pthread way.\n");
+	if (rc == -255)
+		log(TERM, LOG_INFO,
+		    "Old kernel detected. Stop listening and fall back to pthread way.\n");
 	kbuffer_free(kbuf);
 	free(page);
-	for (i = 0; i < n_cpus; i++)
+	for (i = 0; i < n_streams; i++)
 		close(fds[i].fd);
 
-	return -255;
+	return rc;
 }
 
 static int read_ras_event(int fd,
@@ -421,33 +910,29 @@ static int read_ras_event(int fd,
 			  struct kbuffer *kbuf,
 			  void *page)
 {
-	unsigned size;
-	unsigned long long time_stamp;
-	void *data;
+	int size;
 
 	/*
 	 * read() never blocks. We can't call poll() here, as it is
 	 * not supported on kernels below 3.10. So, the better is to just
 	 * sleep for a while, to avoid eating too much CPU here.
 	 */
-	do {
-		size = read(fd, page, pdata->ras->page_size);
+	while (!ras_exiting) {
+		size = read_ras_page(pdata, fd, kbuf, page);
 		if (size < 0) {
 			log(TERM, LOG_WARNING, "read\n");
 			return -1;
-		} else if (size > 0) {
-			kbuffer_load_subbuffer(kbuf, page);
-
-			while ((data = kbuffer_read_event(kbuf, &time_stamp))) {
-				parse_ras_data(pdata, kbuf, data, time_stamp);
-
-				/* increment to read next event */
-				kbuffer_next_event(kbuf, NULL);
-			}
-		} else {
+		} else if (!size) {
 			sleep(POLLING_TIME);
 		}
-	} while (1);
+
+		if (!pdata->cpu) {
+			adjust_ring_buffer(pdata->ras);
+			ras_db_flush(pdata->ras);
+		}
+	}
+
+	return 0;
 }
 
 static void *handle_ras_events_cpu(void *priv)
@@ -476,7 +961,7 @@ static void *handle_ras_events_cpu(void *priv)
 		 "per_cpu/cpu%d/trace_pipe_raw",
 		 pdata->cpu);
 
-	fd = open_trace(pdata->ras, pipe_raw, O_RDONLY);
+	fd = open_trace(pdata->inst->tracing, pipe_raw, O_RDONLY);
 	if (fd < 0) {
 		log(TERM, LOG_ERR, "Can't open trace_pipe_raw\n");
 		kbuffer_free(kbuf);
@@ -484,7 +969,8 @@ static void *handle_ras_events_cpu(void *priv)
 		return NULL;
 	}
 
-	log(TERM, LOG_INFO, "Listening to events on cpu %d\n", pdata->cpu);
+	log(TERM, LOG_INFO, "Listening to %s events on cpu %d\n",
+	    pdata->inst->name, pdata->cpu);
 	if (pdata->ras->record_events)
 		ras_mc_event_opendb(pdata->cpu, pdata->ras);
 
@@ -502,14 +988,14 @@ static void *handle_ras_events_cpu(void *priv)
 static int select_tracing_timestamp(struct ras_events *ras)
 {
 	FILE *fp;
-	int fd, rc;
+	int fd, rc, i;
 	time_t uptime, now;
 	size_t size;
 	unsigned j1;
 	char buf[4096];
 
 	/* Check if uptime is supported (kernel 3.10-rc1 or upper) */
-	fd = open_trace(ras, "trace_clock", O_RDONLY);
+	fd = open_trace(ras->inst[0].tracing, "trace_clock", O_RDONLY);
 	if (fd < 0) {
 		log(TERM, LOG_ERR, "Can't open trace_clock\n");
 		return -1;
@@ -526,20 +1012,22 @@ static int select_tracing_timestamp(struct ras_events *ras)
 		return 0;
 	}
 
-	/* Select uptime tracing */
-	fd = open_trace(ras, "trace_clock", O_WRONLY);
-	if (!fd) {
-		log(TERM, LOG_ERR,
-		    "Kernel didn't allow writing to trace_clock\n");
-		return 0;
-	}
-	rc = write(fd, UPTIME, sizeof(UPTIME));
-	close(fd);
+	/* Select uptime tracing, as each instance has its own clock */
+	for (i = 0; i < ras->ninstances; i++) {
+		fd = open_trace(ras->inst[i].tracing, "trace_clock", O_WRONLY);
+		if (fd < 0) {
+			log(TERM, LOG_ERR,
+			    "Kernel didn't allow writing to trace_clock\n");
+			return 0;
+		}
+		rc = write(fd, UPTIME, sizeof(UPTIME));
+		close(fd);
 
-	if (rc < 0) {
-		log(TERM, LOG_ERR,
-		    "Kernel didn't allow selecting uptime on trace_clock\n");
-		return 0;
+		if (rc < 0) {
+			log(TERM, LOG_ERR,
+			    "Kernel didn't allow selecting uptime on trace_clock\n");
+			return 0;
+		}
 	}
 
 	/* Reference uptime with localtime */
@@ -564,15 +1052,17 @@ static int select_tracing_timestamp(struct ras_events *ras)
 }
 
 static int add_event_handler(struct ras_events *ras, struct pevent *pevent,
-			     unsigned page_size, char *group, char *event,
+			     unsigned page_size, enum ras_instance_id id,
+			     char *group, char *event,
 			     pevent_event_handler_func func)
 {
+	struct ras_instance *inst = get_instance(ras, id);
 	int fd, size, rc;
 	char *page, fname[MAX_PATH + 1];
 
 	snprintf(fname, sizeof(fname), "events/%s/%s/format", group, event);
 
-	fd = open_trace(ras, fname, O_RDONLY);
+	fd = open_trace(ras->tracing, fname, O_RDONLY);
 	if (fd < 0) {
 		log(TERM, LOG_ERR,
 		    "Can't get %s:%s traces. Perhaps this feature is not supported on your system.\n",
@@ -613,14 +1103,17 @@ static int add_event_handler(struct ras_events *ras, struct pevent *pevent,
 		return EINVAL;
 	}
 
+	ras_filter_apply(ras, inst->tracing, group, event);
+
 	/* Enable RAS events */
-	rc = __toggle_ras_mc_event(ras, group, event, 1);
+	rc = __toggle_ras_mc_event(inst, group, event, 1);
 	if (rc < 0) {
 		log(TERM, LOG_ERR, "Can't enable %s:%s tracing\n",
 		    group, event);
 
 		return EINVAL;
 	}
+	inst->num_events++;
 
 	log(ALL, LOG_INFO, "Enabled event %s:%s\n", group, event);
 
@@ -630,12 +1123,14 @@ static int add_event_handler(struct ras_events *ras, struct pevent *pevent,
 
 int handle_ras_events(int record_events)
 {
-	int rc, page_size, i;
+	int rc, page_size, i, j;
 	int num_events = 0;
-	unsigned cpus;
+	unsigned cpus, n_streams;
 	struct pevent *pevent = NULL;
 	struct pthread_data *data = NULL;
 	struct ras_events *ras = NULL;
+	struct sigaction sa;
+	sigset_t mask;
 
 	ras = calloc(1, sizeof(*ras));
 	if (!ras) {
@@ -668,7 +1163,17 @@ int handle_ras_events(int record_events)
 	ras->page_size = page_size;
 	ras->record_events = record_events;
 
-	rc = add_event_handler(ras, pevent, page_size, "ras", "mc_event",
+	ras_filter_load(ras);
+	ras_rules_load(ras);
+	ras->dimms = ras_dimm_init();
+	ras->hitters = ras_hitters_init();
+	ras->incidents = ras_incident_init();
+	ras->metrics = ras_metrics_init();
+	ras->pages = ras_page_init();
+	ras->cpus = ras_cpu_init();
+
+	rc = add_event_handler(ras, pevent, page_size, RAS_INST_BULK,
+			       "ras", "mc_event",
 			       ras_mc_event_handler);
 	if (!rc)
 		num_events++;
@@ -677,7 +1182,8 @@ int handle_ras_events(int record_events)
 		    "ras", "mc_event");
 
 #ifdef HAVE_AER
-	rc = add_event_handler(ras, pevent, page_size, "ras", "aer_event",
+	rc = add_event_handler(ras, pevent, page_size, RAS_INST_CRITICAL,
+			       "ras", "aer_event",
 			       ras_aer_event_handler);
 	if (!rc)
 		num_events++;
@@ -687,7 +1193,8 @@ int handle_ras_events(int record_events)
 #endif
 
 #ifdef HAVE_NON_STANDARD
-        rc = add_event_handler(ras, pevent, page_size, "ras", "non_standard_event",
+        rc = add_event_handler(ras, pevent, page_size, RAS_INST_CRITICAL,
+			       "ras", "non_standard_event",
                                ras_non_standard_event_handler);
         if (!rc)
                 num_events++;
@@ -697,7 +1204,8 @@ int handle_ras_events(int record_events)
 #endif
 
 #ifdef HAVE_ARM
-        rc = add_event_handler(ras, pevent, page_size, "ras", "arm_event",
+        rc = add_event_handler(ras, pevent, page_size, RAS_INST_CRITICAL,
+			       "ras", "arm_event",
                                ras_arm_event_handler);
         if (!rc)
                 num_events++;
@@ -707,13 +1215,18 @@ int handle_ras_events(int record_events)
 #endif
 
 	cpus = get_num_cpus(ras);
+	setup_ring_buffer(ras, cpus);
 
 #ifdef HAVE_MCE
 	rc = register_mce_handler(ras, cpus);
 	if (rc)
 		log(ALL, LOG_INFO, "Can't register mce handler\n");
 	if (ras->mce_priv) {
-		rc = add_event_handler(ras, pevent, page_size,
+		struct mce_priv *mce = ras->mce_priv;
+
+		ras_metrics_mce_cache(ras->metrics, &mce->cache_hits,
+				      &mce->cache_misses);
+		rc = add_event_handler(ras, pevent, page_size, RAS_INST_BULK,
 				       "mce", "mce_record",
 			               ras_mce_event_handler);
 		if (!rc)
@@ -725,7 +1238,8 @@ int handle_ras_events(int record_events)
 #endif
 
 #ifdef HAVE_EXTLOG
-	rc = add_event_handler(ras, pevent, page_size, "ras", "extlog_mem_event",
+	rc = add_event_handler(ras, pevent, page_size, RAS_INST_CRITICAL,
+			       "ras", "extlog_mem_event",
 			       ras_extlog_mem_event_handler);
 	if (!rc) {
 		/* tell kernel we are listening, so don't printk to console */
@@ -742,22 +1256,59 @@ int handle_ras_events(int record_events)
 		return EINVAL;
 	}
 
-	data = calloc(sizeof(*data), cpus);
+	/* One stream per CPU at each instance with events, by priority */
+	data = calloc(sizeof(*data), cpus * ras->ninstances);
 	if (!data)
 		goto err;
 
-
-	for (i = 0; i < cpus; i++) {
-		data[i].ras = ras;
-		data[i].cpu = i;
+	n_streams = 0;
+	for (j = 0; j < ras->ninstances; j++) {
+		if (!ras->inst[j].num_events)
+			continue;
+		for (i = 0; i < cpus; i++) {
+			data[n_streams].ras = ras;
+			data[n_streams].inst = &ras->inst[j];
+			data[n_streams].cpu = i;
+			n_streams++;
+		}
 	}
-	rc = read_ras_event_all_cpus(data, cpus);
+	ras->merge = ras_merge_init();
+	if (ras_decode_start(ras) < 0)
+		log(ALL, LOG_WARNING, "Decoding events at the readers\n");
+	ras->subs = ras_subs_init();
+	ras->ctl = ras_ctl_start(ras);
+
+	/*
+	 * Stop requests are blocked, except while waiting for events, so
+	 * that no event gets half-stored.
+	 */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = ras_stop;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGTERM, &sa, NULL);
+	sigaction(SIGINT, &sa, NULL);
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGTERM);
+	sigaddset(&mask, SIGINT);
+	pthread_sigmask(SIG_BLOCK, &mask, &ras_sigmask);
+
+	rc = read_ras_event_all_cpus(data, n_streams);
+
+	pthread_sigmask(SIG_SETMASK, &ras_sigmask, NULL);
+
+	/* The events still held for merging */
+	ras_merge_drain(ras);
 
 	/* Poll doesn't work on this kernel. Fallback to pthread way */
 	if (rc == -255) {
+		/* Each thread reads a single stream, so there's no merging */
+		ras_merge_free(ras->merge);
+		ras->merge = NULL;
+
 		log(SYSLOG, LOG_INFO,
-		"Opening one thread per cpu (%d threads)\n", cpus);
-		for (i = 0; i < cpus; i++) {
+		"Opening one thread per cpu (%d threads)\n", n_streams);
+		for (i = 0; i < n_streams; i++) {
 			rc = pthread_create(&data[i].thread, NULL,
 					handle_ras_events_cpu,
 					(void *)&data[i]);
@@ -772,11 +1323,28 @@ int handle_ras_events(int record_events)
 		}
 
 		/* Wait for all threads to complete */
-		for (i = 0; i < cpus; i++)
+		for (i = 0; i < n_streams; i++)
 			pthread_join(data[i].thread, NULL);
 	}
 
-	log(SYSLOG, LOG_INFO, "Huh! something got wrong. Aborting.\n");
+	/* Decode what the readers queued before exiting */
+	ras_decode_stop(ras);
+	ras_ctl_stop(ras->ctl);
+	ras->ctl = NULL;
+	ras_subs_free(ras->subs);
+	ras->subs = NULL;
+
+	if (ras_exiting) {
+		log(SYSLOG, LOG_INFO, "Exiting.\n");
+#ifdef HAVE_NON_STANDARD
+		ras_ns_log_counters();
+#endif
+		rc = 0;
+	} else {
+		log(SYSLOG, LOG_INFO, "Huh! something got wrong. Aborting.\n");
+	}
+
+	ras_mc_event_closedb(ras);
 
 err:
 	if (data)
@@ -785,8 +1353,23 @@ err:
 	if (pevent)
 		pevent_free(pevent);
 
-	if (ras)
+	if (ras) {
+		ras_decode_stop(ras);
+		ras_merge_free(ras->merge);
+		ras_filter_free(ras);
+		ras_rules_free(ras);
+		ras_ctl_stop(ras->ctl);
+		ras_subs_free(ras->subs);
+		ras_dimm_free(ras->dimms);
+		ras_hitters_free(ras->hitters);
+		ras_incident_free(ras->incidents);
+		ras_metrics_free(ras->metrics);
+		ras_page_free(ras->pages);
+		ras_cpu_free(ras->cpus);
+		for (i = 0; i < ras->ninstances; i++)
+			free(ras->inst[i].ring_cpu);
 		free(ras);
+	}
 
 	return rc;
 }
@@ -20,6 +20,7 @@
 #define __RAS_EVENTS_H
 
 #include "ras-record.h"
+#include "ras-rules.h"
 
 #include <pthread.h>
 #include <time.h>
@@ -28,6 +29,47 @@
 #define STR(x) #x
 
 struct mce_priv;
+struct ras_page_tracker;
+struct ras_cpu_tracker;
+struct ras_filter;
+struct ras_rules;
+struct ras_dimm_index;
+struct event_filter;
+struct ras_decode_pool;
+struct ras_merge;
+struct ras_incidents;
+struct ras_subs;
+struct ras_metrics;
+struct pevent_record;
+
+/* Per-CPU ring buffer loss accounting */
+struct ras_ring_cpu {
+	unsigned long long	missed;		/* seen via kbuffer_missed_events() */
+	unsigned long long	overrun;	/* last per_cpu/cpuN/stats values */
+	unsigned long long	dropped;
+};
+
+/*
+ * Events are split between tracing instances per severity class, so a
+ * storm of corrected errors can't evict a fatal one. The critical
+ * instance is always drained first.
+ */
+enum ras_instance_id {
+	RAS_INST_CRITICAL,	/* AER, extlog, ARM and non-standard events */
+	RAS_INST_BULK,		/* mc_event and MCE records */
+	RAS_NUM_INSTANCES
+};
+
+struct ras_instance {
+	const char	*name;
+	char		tracing[MAX_PATH + 1];
+	unsigned	num_events;
+
+	/* For the trace ring buffer sizing */
+	unsigned	buffer_kb, buffer_base_kb, buffer_max_kb;
+	time_t		ring_checked, ring_busy;
+	struct ras_ring_cpu *ring_cpu;
+};
 
 struct ras_events {
 	char debugfs[MAX_PATH + 1];
@@ -38,6 +80,7 @@ struct ras_events {
 	/* Booleans */
 	unsigned	use_uptime: 1;
 	unsigned        record_events: 1;
+	unsigned	use_instance: 1;
 
 	/* For timestamp */
 	time_t		uptime_diff;
@@ -48,15 +91,60 @@ struct ras_events {
 	/* For the mce handler */
 	struct mce_priv	*mce_priv;
 
+	/* Corrected memory errors per page */
+	struct ras_page_tracker	*pages;
+
+	/* Corrected MCEs per CPU and bank */
+	struct ras_cpu_tracker	*cpus;
+
 	/* For ABRT socket*/
 	int socketfd;
+
+	/* Event filters, and the ones evaluated at userspace */
+	struct ras_filter	*filters;
+	struct event_filter	*filter;
+
+	/* Event rules */
+	struct ras_rules	*rules;
+
+	/* DIMM labels */
+	struct ras_dimm_index	*dimms;
+
+	/* Memory locations with most errors */
+	struct ras_hitters	*hitters;
+
+	/* Recent memory errors, to correlate their reports */
+	struct ras_incidents	*incidents;
+
+	/* Error counters */
+	struct ras_metrics	*metrics;
+
+	/* Control socket, and its live event subscribers */
+	struct ras_ctl		*ctl;
+	struct ras_subs		*subs;
+
+	/* Decode workers. NULL when events are decoded by the readers */
+	struct ras_decode_pool	*decode;
+
+	/* Events held to be merged by time. NULL when not merging */
+	struct ras_merge	*merge;
+
+	/* Tracing instances, in the order they should be read */
+	unsigned	ncpus;
+	unsigned	ninstances;
+	struct ras_instance inst[RAS_NUM_INSTANCES];
 };
 
 struct pthread_data {
 	pthread_t		thread;
 	struct pevent		*pevent;
 	struct ras_events	*ras;
+	struct ras_instance	*inst;
 	int			cpu;
+
+	/* Per stream order of the events given to the decode workers */
+	unsigned long long	dec_seq;	/* next one to be queued */
+	unsigned long long	dec_done;	/* next one to be output */
 };
 
 
@@ -79,5 +167,15 @@ enum ghes_severity {
 /* Function prototypes */
 int toggle_ras_mc_event(int enable);
 int handle_ras_events(int record_events);
+void ras_print_record(struct pthread_data *pdata, struct pevent_record *record);
+void ras_dispatch_record(struct pthread_data *pdata,
+			 struct pevent_record *record);
+
+/*
+ * Hands a decoded event, like a struct ras_mc_event, to its consumers:
+ * the error counters, the live subscribers and the rules.
+ */
+void ras_notify_event(struct ras_events *ras, enum ras_rule_event type,
+		      const void *ev);
 
 #endif
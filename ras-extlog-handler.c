@@ -27,160 +27,30 @@
 #include "ras-record.h"
 #include "ras-logger.h"
 #include "ras-report.h"
-
-static char *err_type(int etype)
-{
-	switch (etype) {
-	case 0: return "unknown";
-	case 1: return "no error";
-	case 2: return "single-bit ECC";
-	case 3: return "multi-bit ECC";
-	case 4: return "single-symbol chipkill ECC";
-	case 5: return "multi-symbol chipkill ECC";
-	case 6: return "master abort";
-	case 7: return "target abort";
-	case 8: return "parity error";
-	case 9: return "watchdog timeout";
-	case 10: return "invalid address";
-	case 11: return "mirror Broken";
-	case 12: return "memory sparing";
-	case 13: return "scrub corrected error";
-	case 14: return "scrub uncorrected error";
-	case 15: return "physical memory map-out event";
-	}
-	return "unknown-type";
-}
-
-static char *err_severity(int severity)
-{
-	switch (severity) {
-	case 0: return "recoverable";
-	case 1: return "fatal";
-	case 2: return "corrected";
-	case 3: return "informational";
-	}
-	return "unknown-severity";
-}
-
-static unsigned long long err_mask(int lsb)
-{
-	if (lsb == 0xff)
-		return ~0ull;
-	return ~((1ull << lsb) - 1);
-}
-
-#define CPER_MEM_VALID_NODE			0x0008
-#define CPER_MEM_VALID_CARD			0x0010
-#define CPER_MEM_VALID_MODULE			0x0020
-#define CPER_MEM_VALID_BANK			0x0040
-#define CPER_MEM_VALID_DEVICE			0x0080
-#define CPER_MEM_VALID_ROW			0x0100
-#define CPER_MEM_VALID_COLUMN			0x0200
-#define CPER_MEM_VALID_BIT_POSITION		0x0400
-#define CPER_MEM_VALID_REQUESTOR_ID		0x0800
-#define CPER_MEM_VALID_RESPONDER_ID		0x1000
-#define CPER_MEM_VALID_TARGET_ID		0x2000
-#define CPER_MEM_VALID_RANK_NUMBER		0x8000
-#define CPER_MEM_VALID_CARD_HANDLE		0x10000
-#define CPER_MEM_VALID_MODULE_HANDLE		0x20000
-
-struct cper_mem_err_compact {
-	unsigned long long	validation_bits;
-	unsigned short		node;
-	unsigned short		card;
-	unsigned short		module;
-	unsigned short		bank;
-	unsigned short		device;
-	unsigned short		row;
-	unsigned short		column;
-	unsigned short		bit_pos;
-	unsigned long long	requestor_id;
-	unsigned long long	responder_id;
-	unsigned long long	target_id;
-	unsigned short		rank;
-	unsigned short		mem_array_handle;
-	unsigned short		mem_dev_handle;
-};
-
-static char *err_cper_data(const char *c)
-{
-	const struct cper_mem_err_compact *cpd = (struct cper_mem_err_compact *)c;
-	static char buf[256];
-	char *p = buf;
-
-	if (cpd->validation_bits == 0)
-		return "";
-	p += sprintf(p, " (");
-	if (cpd->validation_bits & CPER_MEM_VALID_NODE)
-		p += sprintf(p, "node: %d ", cpd->node);
-	if (cpd->validation_bits & CPER_MEM_VALID_CARD)
-		p += sprintf(p, "card: %d ", cpd->card);
-	if (cpd->validation_bits & CPER_MEM_VALID_MODULE)
-		p += sprintf(p, "module: %d ", cpd->module);
-	if (cpd->validation_bits & CPER_MEM_VALID_BANK)
-		p += sprintf(p, "bank: %d ", cpd->bank);
-	if (cpd->validation_bits & CPER_MEM_VALID_DEVICE)
-		p += sprintf(p, "device: %d ", cpd->device);
-	if (cpd->validation_bits & CPER_MEM_VALID_ROW)
-		p += sprintf(p, "row: %d ", cpd->row);
-	if (cpd->validation_bits & CPER_MEM_VALID_COLUMN)
-		p += sprintf(p, "column: %d ", cpd->column);
-	if (cpd->validation_bits & CPER_MEM_VALID_BIT_POSITION)
-		p += sprintf(p, "bit_pos: %d ", cpd->bit_pos);
-	if (cpd->validation_bits & CPER_MEM_VALID_REQUESTOR_ID)
-		p += sprintf(p, "req_id: 0x%llx ", cpd->requestor_id);
-	if (cpd->validation_bits & CPER_MEM_VALID_RESPONDER_ID)
-		p += sprintf(p, "resp_id: 0x%llx ", cpd->responder_id);
-	if (cpd->validation_bits & CPER_MEM_VALID_TARGET_ID)
-		p += sprintf(p, "tgt_id: 0x%llx ", cpd->target_id);
-	if (cpd->validation_bits & CPER_MEM_VALID_RANK_NUMBER)
-		p += sprintf(p, "rank: %d ", cpd->rank);
-	if (cpd->validation_bits & CPER_MEM_VALID_CARD_HANDLE)
-		p += sprintf(p, "card_handle: %d ", cpd->mem_array_handle);
-	if (cpd->validation_bits & CPER_MEM_VALID_MODULE_HANDLE)
-		p += sprintf(p, "module_handle: %d ", cpd->mem_dev_handle);
-	p += sprintf(p-1, ")");
-
-	return buf;
-}
-
-static char *uuid_le(const char *uu)
-{
-	static char uuid[sizeof("xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx")];
-	char *p = uuid;
-	int i;
-	static const unsigned char le[16] = {3,2,1,0,5,4,7,6,8,9,10,11,12,13,14,15};
-
-	for (i = 0; i < 16; i++) {
-		p += sprintf(p, "%.2x", uu[le[i]]);
-		switch (i) {
-		case 3:
-		case 5:
-		case 7:
-		case 9:
-			*p++ = '-';
-			break;
-		}
-	}
-
-	*p = 0;
-
-	return uuid;
-}
-
+#include "ras-cper.h"
+#include "ras-page-isolation.h"
+#include "ras-rules.h"
+#include "ras-dimm.h"
+#include "ras-hitters.h"
+#include "ras-incident.h"
+#include "ras-decode.h"
 
 static void report_extlog_mem_event(struct ras_events *ras,
 				    struct pevent_record *record,
 				    struct trace_seq *s,
 				    struct ras_extlog_event *ev)
 {
-	trace_seq_printf(s, "%d %s error: %s physical addr: 0x%llx mask: 0x%llx%s %s %s",
-		ev->error_seq, err_severity(ev->severity),
-		err_type(ev->etype), ev->address,
-		err_mask(ev->pa_mask_lsb),
-		err_cper_data(ev->cper_data),
-		ev->fru_text,
-		uuid_le(ev->fru_id));
+	char buf[1024];
+	struct strbuf msg;
+
+	STRBUF_INIT(&msg, buf);
+	ras_cper_mem_msg(&msg, ev);
+	trace_seq_puts(s, msg.buf);
+
+	if (ev->label) {
+		trace_seq_puts(s, " on ");
+		trace_seq_puts(s, ev->label);
+	}
 }
 
 int ras_extlog_mem_event_handler(struct trace_seq *s,
@@ -191,8 +61,10 @@ int ras_extlog_mem_event_handler(struct trace_seq *s,
 	unsigned long long val;
 	struct ras_events *ras = context;
 	time_t now;
-	struct tm *tm;
+	struct tm tm_buf, *tm;
 	struct ras_extlog_event ev;
+	char label[128];
+	int handle;
 
 	/*
 	 * Newer kernels (3.10-rc1 or upper) provide an uptime clock.
@@ -208,7 +80,7 @@ int ras_extlog_mem_event_handler(struct trace_seq *s,
 	else
 		now = time(NULL);
 
-	tm = localtime(&now);
+	tm = localtime_r(&now, &tm_buf);
 	if (tm)
 		strftime(ev.timestamp, sizeof(ev.timestamp),
 			 "%Y-%m-%d %H:%M:%S %z", tm);
@@ -238,8 +110,24 @@ int ras_extlog_mem_event_handler(struct trace_seq *s,
 	ev.fru_id = pevent_get_field_raw(s, event, "fru_id",
 					   record, &len, 1);
 
+	ev.label = NULL;
+	handle = ras_cper_mem_handle(&ev);
+	if (handle >= 0 &&
+	    !ras_dimm_handle_label(ras, handle, label, sizeof(label)))
+		ev.label = label;
+
 	report_extlog_mem_event(ras, record, s, &ev);
 
+	/* Decode workers account each stream events in order */
+	ras_decode_ordered();
+	if (ev.severity == CPER_SEV_CORRECTED)
+		ras_record_page_error(ras, ev.address, ev.pa_mask_lsb, 1);
+	ras_record_mem_error(ras, ev.address, ev.pa_mask_lsb, ev.label, 1);
+	ev.incident = ras_incident(ras, RAS_INCIDENT_EXTLOG, record->ts,
+				   ev.address, ev.pa_mask_lsb);
+
+	ras_notify_event(ras, RAS_RULE_EXTLOG, &ev);
+
 	ras_store_extlog_mem_record(ras, &ev);
 
 	return 0;
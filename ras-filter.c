@@ -0,0 +1,236 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "libtrace/event-parse.h"
+#include "ras-events.h"
+#include "ras-filter.h"
+#include "ras-logger.h"
+
+#define FILTER_FILE	SYSCONFDIR "/ras/filters.conf"
+
+static struct ras_filter *find_filter(struct ras_events *ras,
+				      const char *group, const char *event)
+{
+	struct ras_filter *f;
+
+	for (f = ras->filters; f; f = f->next)
+		if (!strcmp(f->group, group) && !strcmp(f->event, event))
+			return f;
+
+	return NULL;
+}
+
+static int add_filter(struct ras_events *ras, int drop,
+		      const char *group, const char *event, const char *expr)
+{
+	struct ras_filter *f;
+	size_t len = 0;
+	char *p;
+
+	f = find_filter(ras, group, event);
+	if (!f) {
+		f = calloc(1, sizeof(*f));
+		if (!f)
+			return ENOMEM;
+		f->group = strdup(group);
+		f->event = strdup(event);
+		if (!f->group || !f->event) {
+			free(f->group);
+			free(f->event);
+			free(f);
+			return ENOMEM;
+		}
+		f->next = ras->filters;
+		ras->filters = f;
+	}
+
+	/* Rules are merged as "(keep) && !(drop)" */
+	if (f->expr)
+		len = strlen(f->expr);
+	p = realloc(f->expr, len + strlen(expr) + 8);
+	if (!p)
+		return ENOMEM;
+	f->expr = p;
+	sprintf(p + len, "%s%s(%s)", len ? " && " : "", drop ? "!" : "", expr);
+
+	return 0;
+}
+
+int ras_filter_load(struct ras_events *ras)
+{
+	const char *fname = getenv("RAS_EVENT_FILTERS");
+	char line[1024], *p, *verb, *group, *event, *expr;
+	int drop, n = 0, rc = 0;
+	FILE *fp;
+
+	if (!fname || !*fname)
+		fname = FILTER_FILE;
+
+	fp = fopen(fname, "r");
+	if (!fp) {
+		if (errno == ENOENT)
+			return 0;
+		log(ALL, LOG_WARNING, "Can't open event filters at %s\n",
+		    fname);
+		return errno;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		n++;
+
+		p = strchr(line, '#');
+		if (p)
+			*p = '\0';
+		for (p = line + strlen(line); p > line && isspace((unsigned char)p[-1]); p--)
+			p[-1] = '\0';
+
+		verb = strtok(line, " \t");
+		if (!verb)
+			continue;
+		group = strtok(NULL, ":");
+		event = strtok(NULL, " \t");
+		expr = strtok(NULL, "");
+		while (expr && isspace((unsigned char)*expr))
+			expr++;
+
+		if (!strcmp(verb, "keep"))
+			drop = 0;
+		else if (!strcmp(verb, "drop"))
+			drop = 1;
+		else
+			drop = -1;
+
+		if (drop < 0 || !group || !event || !expr || !*expr) {
+			log(ALL, LOG_WARNING, "%s:%d: invalid filter. Ignoring it\n",
+			    fname, n);
+			continue;
+		}
+
+		rc = add_filter(ras, drop, group, event, expr);
+		if (rc)
+			break;
+	}
+	fclose(fp);
+
+	return rc;
+}
+
+static int write_filter(const char *tracing, const char *group,
+			const char *event, const char *expr)
+{
+	char fname[MAX_PATH + 1];
+	int fd, rc;
+
+	snprintf(fname, sizeof(fname), "%s/events/%s/%s/filter",
+		 tracing, group, event);
+	fd = open(fname, O_WRONLY | O_TRUNC);
+	if (fd < 0)
+		return errno;
+	rc = write(fd, expr, strlen(expr));
+	close(fd);
+	if (rc < 0)
+		return errno;
+
+	return 0;
+}
+
+/*
+ * Should be called after the event format got parsed, as the userspace
+ * filter needs it.
+ */
+int ras_filter_apply(struct ras_events *ras, const char *tracing,
+		     const char *group, const char *event)
+{
+	struct ras_filter *f = find_filter(ras, group, event);
+	char *str, *err = NULL;
+	int rc;
+
+	/*
+	 * Without instances, the top level buffer is shared with other
+	 * tracers, so its filters are left alone.
+	 */
+	if (!ras->use_instance) {
+		if (!f)
+			return 0;
+	} else {
+		/* Clean up any filter left by a previous run */
+		if (!f) {
+			write_filter(tracing, group, event, "0");
+			return 0;
+		}
+
+		rc = write_filter(tracing, group, event, f->expr);
+		if (!rc) {
+			log(ALL, LOG_INFO, "Filtering %s:%s at the Kernel: %s\n",
+			    group, event, f->expr);
+			return 0;
+		}
+		write_filter(tracing, group, event, "0");
+	}
+
+	/* The Kernel can't handle it. Evaluate it here */
+	if (!ras->filter) {
+		ras->filter = pevent_filter_alloc(ras->pevent);
+		if (!ras->filter)
+			return ENOMEM;
+	}
+
+	str = malloc(strlen(group) + strlen(event) + strlen(f->expr) + 3);
+	if (!str)
+		return ENOMEM;
+	sprintf(str, "%s/%s:%s", group, event, f->expr);
+
+	rc = pevent_filter_add_filter_str(ras->filter, str, &err);
+	free(str);
+	if (rc < 0) {
+		log(ALL, LOG_ERR, "Can't parse filter for %s:%s: %s\n",
+		    group, event, err ? err : f->expr);
+		free(err);
+		return EINVAL;
+	}
+
+	log(ALL, LOG_INFO, "Filtering %s:%s at userspace: %s\n",
+	    group, event, f->expr);
+	return 0;
+}
+
+void ras_filter_free(struct ras_events *ras)
+{
+	struct ras_filter *f, *next;
+
+	for (f = ras->filters; f; f = next) {
+		next = f->next;
+		free(f->group);
+		free(f->event);
+		free(f->expr);
+		free(f);
+	}
+	ras->filters = NULL;
+
+	if (ras->filter) {
+		pevent_filter_free(ras->filter);
+		ras->filter = NULL;
+	}
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_FILTER_H
+#define __RAS_FILTER_H
+
+struct ras_events;
+
+/*
+ * Event filters, read from SYSCONFDIR/ras/filters.conf. Each line has
+ * the form:
+ *
+ *	keep|drop <group>:<event> <expression>
+ *
+ * where <expression> uses the ftrace filter syntax, e.g.
+ *
+ *	drop ras:mc_event error_type == 3
+ *	drop mce:mce_record bank == 128
+ *
+ * All rules for an event are merged into a single expression that is
+ * written to the tracing instance, so the Kernel discards the events.
+ * If the Kernel refuses it, or if there are no tracing instances and
+ * the top level buffer is used, the expression is evaluated in userspace,
+ * before calling the event handler.
+ */
+struct ras_filter {
+	char			*group;
+	char			*event;
+	char			*expr;
+	struct ras_filter	*next;
+};
+
+int ras_filter_load(struct ras_events *ras);
+int ras_filter_apply(struct ras_events *ras, const char *tracing,
+		     const char *group, const char *event);
+void ras_filter_free(struct ras_events *ras);
+
+#endif
@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "ras-hex.h"
+
+static const char hex_digits[16] = "0123456789abcdef";
+
+static inline char *hex_byte(char *dst, uint8_t b)
+{
+	*dst++ = hex_digits[b >> 4];
+	*dst++ = hex_digits[b & 0xf];
+	return dst;
+}
+
+#ifdef __SSE2__
+/* Writes the 32 digits of 16 bytes */
+static inline void hex_encode16(char *dst, __m128i v)
+{
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	const __m128i nine = _mm_set1_epi8(9);
+	__m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), nibble);
+	__m128i lo = _mm_and_si128(v, nibble);
+
+	/* '0' + n, plus the gap up to 'a' for n > 9 */
+	hi = _mm_add_epi8(_mm_add_epi8(hi, _mm_set1_epi8('0')),
+			  _mm_and_si128(_mm_cmpgt_epi8(hi, nine),
+					_mm_set1_epi8('a' - '0' - 10)));
+	lo = _mm_add_epi8(_mm_add_epi8(lo, _mm_set1_epi8('0')),
+			  _mm_and_si128(_mm_cmpgt_epi8(lo, nine),
+					_mm_set1_epi8('a' - '0' - 10)));
+
+	_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi8(hi, lo));
+	_mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi8(hi, lo));
+}
+
+/* Reverses the byte order of each 32-bit word */
+static inline __m128i bswap32x4(__m128i v)
+{
+	__m128i swapped;
+
+	/* Swap the bytes of each 16-bit half, then swap the halves */
+	swapped = _mm_or_si128(_mm_srli_epi16(v, 8), _mm_slli_epi16(v, 8));
+	swapped = _mm_shufflelo_epi16(swapped, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_shufflehi_epi16(swapped, _MM_SHUFFLE(2, 3, 0, 1));
+}
+#endif
+
+char *hex_encode(char *dst, const void *src, size_t len)
+{
+	const uint8_t *p = src;
+
+#ifdef __SSE2__
+	for (; len >= 16; len -= 16, p += 16, dst += 32)
+		hex_encode16(dst, _mm_loadu_si128((const __m128i *)p));
+#endif
+	while (len--)
+		dst = hex_byte(dst, *p++);
+
+	return dst;
+}
+
+char *hex_encode_le32(char *dst, const void *src, size_t nwords)
+{
+	const uint8_t *p = src;
+
+#ifdef __SSE2__
+	for (; nwords >= 4; nwords -= 4, p += 16, dst += 32)
+		hex_encode16(dst,
+			     bswap32x4(_mm_loadu_si128((const __m128i *)p)));
+#endif
+	for (; nwords; nwords--, p += 4) {
+		dst = hex_byte(dst, p[3]);
+		dst = hex_byte(dst, p[2]);
+		dst = hex_byte(dst, p[1]);
+		dst = hex_byte(dst, p[0]);
+	}
+
+	return dst;
+}
+
+/* Byte order of the uuid_le fields, as they are printed */
+static const unsigned char uuid_le_order[16] = {
+	3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15
+};
+
+char *uuid_le_str(char *buf, const void *uu)
+{
+	const unsigned char *le = uuid_le_order;
+	const uint8_t *b = uu;
+	char *p = buf;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		p = hex_byte(p, b[le[i]]);
+		switch (i) {
+		case 3:
+		case 5:
+		case 7:
+		case 9:
+			*p++ = '-';
+			break;
+		}
+	}
+	*p = '\0';
+
+	return buf;
+}
+
+int hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+int hex_decode(void *dst, const char *src, size_t size)
+{
+	uint8_t *b = dst;
+	size_t n;
+	int hi, lo;
+
+	for (n = 0; src[0] && src[1]; n++, src += 2) {
+		hi = hex_value(src[0]);
+		lo = hex_value(src[1]);
+		if (hi < 0 || lo < 0 || n == size)
+			return -1;
+		b[n] = hi << 4 | lo;
+	}
+
+	return *src ? -1 : n;
+}
+
+int uuid_le_parse(void *uu, const char *str)
+{
+	uint8_t *b = uu;
+	int i, hi, lo;
+
+	for (i = 0; i < 16; i++) {
+		if (*str == '-' && (i == 4 || i == 6 || i == 8 || i == 10))
+			str++;
+		hi = hex_value(str[0]);
+		if (hi < 0)
+			return -1;
+		lo = hex_value(str[1]);
+		if (lo < 0)
+			return -1;
+		b[uuid_le_order[i]] = hi << 4 | lo;
+		str += 2;
+	}
+
+	return *str ? -1 : 0;
+}
@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_HEX_H
+#define __RAS_HEX_H
+
+#include <stddef.h>
+
+/* "xxxxxxxx-xxxx-xxxx-xxxx-xxxxxxxxxxxx", plus the NUL */
+#define UUID_STR_SIZE	37
+
+/*
+ * Hex encoders for binary event payloads. They write the digits in
+ * lowercase, without a NUL terminator, and return the end of the
+ * output.
+ */
+
+/* 2 * len digits, a byte after the other */
+char *hex_encode(char *dst, const void *src, size_t len);
+
+/* 8 * nwords digits, each 32-bit little endian word read as a number */
+char *hex_encode_le32(char *dst, const void *src, size_t nwords);
+
+/* Formats an UEFI GUID (uuid_le) into buf, with UUID_STR_SIZE bytes */
+char *uuid_le_str(char *buf, const void *uu);
+
+/* Value of a hex digit, or -1 */
+int hex_value(char c);
+
+/* Decodes up to size bytes. Returns their number, or -1 on bad input */
+int hex_decode(void *dst, const char *src, size_t size);
+
+/* Parses an uuid_le, with or without the dashes. Returns 0 or -1 */
+int uuid_le_parse(void *uu, const char *str);
+
+#endif
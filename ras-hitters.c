@@ -0,0 +1,492 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ras-events.h"
+#include "ras-hitters.h"
+#include "ras-record.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+
+#define HH_TOP_K	16
+#define HH_MAX_TOP_K	1024
+#define HH_WIDTH	4096
+#define HH_DEPTH	4
+#define HH_ROW_SHIFT	13
+#define HH_DECAY	(24 * 60 * 60)
+#define HH_SNAPSHOT	(60 * 60)
+#define HH_NAME_LEN	64
+
+enum hh_kind {
+	HH_ADDRESS,
+	HH_ROW,
+	HH_DIMM,
+	NUM_HH_KINDS
+};
+
+static const char *hh_kinds[] = {
+	[HH_ADDRESS]	= "address",
+	[HH_ROW]	= "row",
+	[HH_DIMM]	= "dimm",
+};
+
+struct hh_entry {
+	uint64_t	key;
+	uint64_t	count;
+	char		name[HH_NAME_LEN];	/* DIMM label */
+};
+
+/*
+ * A count-min sketch, with HH_DEPTH rows of width counters. The count of
+ * a location is the smallest of its counters, one per row, so it's never
+ * less than the real count. The locations with the highest counts are
+ * kept at a min-heap.
+ */
+struct hh_table {
+	pthread_mutex_t	lock;
+	uint32_t	*cells;
+	struct hh_entry	*top;
+	unsigned	ntop;
+	uint64_t	total;
+	time_t		decayed;
+};
+
+struct ras_hitters {
+	unsigned	width_bits, top_k, row_shift;
+	unsigned long	decay, snapshot;
+	time_t		snapshotted;
+	struct hh_table	tab[NUM_HH_KINDS];
+};
+
+static const uint64_t hh_seeds[HH_DEPTH] = {
+	0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL,
+	0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL,
+};
+
+static time_t now_secs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+static uint64_t name_hash(const char *name)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+
+	while (*name) {
+		h ^= (unsigned char)*name++;
+		h *= 0x100000001b3ULL;
+	}
+
+	return h;
+}
+
+static uint32_t *hh_cell(struct ras_hitters *hh, struct hh_table *t,
+			 unsigned row, uint64_t key)
+{
+	uint64_t h = (key ^ (key >> 29)) * hh_seeds[row];
+
+	return &t->cells[(row << hh->width_bits) + (h >> (64 - hh->width_bits))];
+}
+
+/*
+ * Adds count to the location, raising only the counters below its new
+ * count, so the collisions inflate the other counts less.
+ */
+static uint64_t sketch_add(struct ras_hitters *hh, struct hh_table *t,
+			   uint64_t key, unsigned count)
+{
+	uint32_t *cell[HH_DEPTH], min = UINT32_MAX, val;
+	unsigned i;
+
+	for (i = 0; i < HH_DEPTH; i++) {
+		cell[i] = hh_cell(hh, t, i, key);
+		if (*cell[i] < min)
+			min = *cell[i];
+	}
+
+	val = count > UINT32_MAX - min ? UINT32_MAX : min + count;
+	for (i = 0; i < HH_DEPTH; i++)
+		if (*cell[i] < val)
+			*cell[i] = val;
+
+	return val;
+}
+
+static void heap_swap(struct hh_entry *a, struct hh_entry *b)
+{
+	struct hh_entry tmp = *a;
+
+	*a = *b;
+	*b = tmp;
+}
+
+static void heap_up(struct hh_entry *h, unsigned i)
+{
+	while (i && h[(i - 1) / 2].count > h[i].count) {
+		heap_swap(&h[(i - 1) / 2], &h[i]);
+		i = (i - 1) / 2;
+	}
+}
+
+static void heap_down(struct hh_entry *h, unsigned n, unsigned i)
+{
+	unsigned min, c;
+
+	for (;;) {
+		min = i;
+		for (c = 2 * i + 1; c <= 2 * i + 2 && c < n; c++)
+			if (h[c].count < h[min].count)
+				min = c;
+		if (min == i)
+			break;
+		heap_swap(&h[min], &h[i]);
+		i = min;
+	}
+}
+
+static void top_update(struct ras_hitters *hh, struct hh_table *t,
+		       uint64_t key, const char *name, uint64_t count)
+{
+	struct hh_entry *e;
+	unsigned i;
+
+	for (i = 0; i < t->ntop; i++) {
+		if (t->top[i].key == key) {
+			t->top[i].count = count;
+			heap_down(t->top, t->ntop, i);
+			return;
+		}
+	}
+
+	if (t->ntop < hh->top_k) {
+		i = t->ntop++;
+	} else {
+		/* Replaces the smallest one */
+		if (count <= t->top[0].count)
+			return;
+		i = 0;
+	}
+
+	e = &t->top[i];
+	e->key = key;
+	e->count = count;
+	e->name[0] = '\0';
+	if (name) {
+		strncpy(e->name, name, sizeof(e->name) - 1);
+		e->name[sizeof(e->name) - 1] = '\0';
+	}
+
+	if (i)
+		heap_up(t->top, i);
+	else
+		heap_down(t->top, t->ntop, 0);
+}
+
+/* Halves the counts every decay seconds, so old errors fade away */
+static void hh_decay(struct ras_hitters *hh, struct hh_table *t, time_t now)
+{
+	unsigned long shift;
+	unsigned i;
+
+	if (!hh->decay || now - t->decayed < hh->decay)
+		return;
+
+	shift = (now - t->decayed) / hh->decay;
+	t->decayed += shift * hh->decay;
+	if (shift > 32)
+		shift = 32;
+
+	for (i = 0; i < HH_DEPTH << hh->width_bits; i++)
+		t->cells[i] = (uint64_t)t->cells[i] >> shift;
+	for (i = 0; i < t->ntop; i++)
+		t->top[i].count >>= shift;
+	t->total >>= shift;
+}
+
+static void hh_add(struct ras_hitters *hh, enum hh_kind kind, uint64_t key,
+		   const char *name, unsigned count, time_t now)
+{
+	struct hh_table *t = &hh->tab[kind];
+	uint64_t est;
+
+	pthread_mutex_lock(&t->lock);
+	hh_decay(hh, t, now);
+	t->total += count;
+	est = sketch_add(hh, t, key, count);
+	top_update(hh, t, key, name, est);
+	pthread_mutex_unlock(&t->lock);
+}
+
+static int entry_cmp(const void *a, const void *b)
+{
+	const struct hh_entry *ea = a, *eb = b;
+
+	if (ea->count != eb->count)
+		return ea->count < eb->count ? 1 : -1;
+	return ea->key < eb->key ? -1 : ea->key > eb->key;
+}
+
+/* Copies the top locations, sorted by count. Returns how many there are */
+static unsigned hh_get_top(struct ras_hitters *hh, enum hh_kind kind,
+			   struct hh_entry *top, uint64_t *total)
+{
+	struct hh_table *t = &hh->tab[kind];
+	unsigned i, n = 0;
+
+	pthread_mutex_lock(&t->lock);
+	hh_decay(hh, t, now_secs());
+	for (i = 0; i < t->ntop; i++)
+		if (t->top[i].count)
+			top[n++] = t->top[i];
+	*total = t->total;
+	pthread_mutex_unlock(&t->lock);
+
+	qsort(top, n, sizeof(*top), entry_cmp);
+
+	return n;
+}
+
+static void hh_location(struct ras_hitters *hh, enum hh_kind kind,
+			const struct hh_entry *e, char *buf, size_t size)
+{
+	switch (kind) {
+	case HH_ADDRESS:
+		snprintf(buf, size, "0x%08llx", (unsigned long long)e->key);
+		break;
+	case HH_ROW:
+		snprintf(buf, size, "0x%08llx",
+			 (unsigned long long)e->key << hh->row_shift);
+		break;
+	default:
+		snprintf(buf, size, "%s", e->name);
+	}
+}
+
+/* Stores the top locations every snapshot seconds */
+static void hh_snapshot(struct ras_events *ras, struct ras_hitters *hh,
+			time_t now)
+{
+	time_t last = __atomic_load_n(&hh->snapshotted, __ATOMIC_RELAXED);
+	struct ras_hot_spot hs;
+	struct hh_entry *top;
+	char location[HH_NAME_LEN];
+	uint64_t total;
+	time_t t = time(NULL);
+	struct tm tm;
+	unsigned i, n;
+	int kind;
+
+	if (!hh->snapshot || now - last < hh->snapshot)
+		return;
+	if (!__atomic_compare_exchange_n(&hh->snapshotted, &last, now, 0,
+					 __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		return;
+
+	top = calloc(hh->top_k, sizeof(*top));
+	if (!top)
+		return;
+
+	memset(&hs, 0, sizeof(hs));
+	if (localtime_r(&t, &tm))
+		strftime(hs.timestamp, sizeof(hs.timestamp),
+			 "%Y-%m-%d %H:%M:%S %z", &tm);
+	hs.location = location;
+
+	for (kind = 0; kind < NUM_HH_KINDS; kind++) {
+		n = hh_get_top(hh, kind, top, &total);
+		if (!n)
+			continue;
+
+		hs.kind = hh_kinds[kind];
+		for (i = n; i-- > 0; ) {
+			hh_location(hh, kind, &top[i], location,
+				    sizeof(location));
+			hs.rank = i + 1;
+			hs.errors = top[i].count;
+			ras_store_hot_spot(ras, &hs);
+		}
+
+		log(SYSLOG, LOG_INFO,
+		    "Memory errors by %s: %llu, most of them at %s (%llu)\n",
+		    hh_kinds[kind], (unsigned long long)total, location,
+		    (unsigned long long)top[0].count);
+	}
+
+	free(top);
+}
+
+void ras_record_mem_error(struct ras_events *ras, unsigned long long addr,
+			  unsigned grain_bits, const char *dimm,
+			  unsigned count)
+{
+	struct ras_hitters *hh = ras->hitters;
+	time_t now;
+
+	if (!hh || !count)
+		return;
+
+	now = now_secs();
+	if (addr) {
+		if (grain_bits > 63)
+			grain_bits = 63;
+		hh_add(hh, HH_ADDRESS, addr & ~((1ULL << grain_bits) - 1),
+		       NULL, count, now);
+		hh_add(hh, HH_ROW, addr >> hh->row_shift, NULL, count, now);
+	}
+	if (dimm && *dimm)
+		hh_add(hh, HH_DIMM, name_hash(dimm), dimm, count, now);
+
+	hh_snapshot(ras, hh, now);
+}
+
+int ras_hitters_cmd(struct ras_events *ras, int argc, char *argv[],
+		    FILE *out)
+{
+	struct ras_hitters *hh = ras->hitters;
+	unsigned kinds = 0, max = 0, i, n;
+	struct hh_entry *top;
+	char location[HH_NAME_LEN];
+	unsigned long long bound;
+	uint64_t total;
+	char *end;
+	int kind;
+
+	if (!hh)
+		return -EOPNOTSUPP;
+
+	for (i = 1; i < argc; i++) {
+		for (kind = 0; kind < NUM_HH_KINDS; kind++)
+			if (!strcmp(argv[i], hh_kinds[kind]))
+				break;
+		if (kind < NUM_HH_KINDS) {
+			kinds |= 1 << kind;
+			continue;
+		}
+		max = strtoul(argv[i], &end, 0);
+		if (*end)
+			return -EINVAL;
+	}
+	if (!kinds)
+		kinds = (1 << NUM_HH_KINDS) - 1;
+
+	top = calloc(hh->top_k, sizeof(*top));
+	if (!top)
+		return -ENOMEM;
+
+	for (kind = 0; kind < NUM_HH_KINDS; kind++) {
+		if (!(kinds & (1 << kind)))
+			continue;
+
+		n = hh_get_top(hh, kind, top, &total);
+		if (max && n > max)
+			n = max;
+
+		/* Counts are likely (98%) no more than e / width too high */
+		bound = (total * 2.718281828 / (1 << hh->width_bits)) + 0.5;
+		fprintf(out, "# %s: %llu errors, counts may be up to %llu too high\n",
+			hh_kinds[kind], (unsigned long long)total, bound);
+		for (i = 0; i < n; i++) {
+			hh_location(hh, kind, &top[i], location,
+				    sizeof(location));
+			fprintf(out, "%s %llu\n", location,
+				(unsigned long long)top[i].count);
+		}
+	}
+
+	free(top);
+	return 0;
+}
+
+struct ras_hitters *ras_hitters_init(void)
+{
+	struct ras_hitters *hh;
+	unsigned long width;
+	time_t now = now_secs();
+	int i;
+
+	hh = calloc(1, sizeof(*hh));
+	if (!hh)
+		return NULL;
+
+	hh->top_k = ras_env_ulong("RAS_HH_TOP_K", HH_TOP_K);
+	if (!hh->top_k) {
+		free(hh);
+		return NULL;
+	}
+	if (hh->top_k > HH_MAX_TOP_K)
+		hh->top_k = HH_MAX_TOP_K;
+
+	width = ras_env_ulong("RAS_HH_WIDTH", HH_WIDTH);
+	for (hh->width_bits = 6; hh->width_bits < 24; hh->width_bits++)
+		if ((1UL << hh->width_bits) >= width)
+			break;
+
+	hh->row_shift = ras_env_ulong("RAS_HH_ROW_SHIFT", HH_ROW_SHIFT);
+	if (hh->row_shift > 63)
+		hh->row_shift = HH_ROW_SHIFT;
+	hh->decay = ras_env_ulong("RAS_HH_DECAY", HH_DECAY);
+	hh->snapshot = ras_env_ulong("RAS_HH_SNAPSHOT", HH_SNAPSHOT);
+	hh->snapshotted = now;
+
+	for (i = 0; i < NUM_HH_KINDS; i++) {
+		struct hh_table *t = &hh->tab[i];
+
+		pthread_mutex_init(&t->lock, NULL);
+		t->decayed = now;
+		t->cells = calloc(HH_DEPTH << hh->width_bits,
+				  sizeof(*t->cells));
+		t->top = calloc(hh->top_k, sizeof(*t->top));
+		if (!t->cells || !t->top) {
+			log(ALL, LOG_ERR,
+			    "Can't allocate the memory error hot spots\n");
+			ras_hitters_free(hh);
+			return NULL;
+		}
+	}
+
+	log(ALL, LOG_INFO,
+	    "Keeping the %u memory locations with most errors, using %zu KiB\n",
+	    hh->top_k,
+	    NUM_HH_KINDS * ((HH_DEPTH * sizeof(uint32_t) << hh->width_bits) +
+			    hh->top_k * sizeof(struct hh_entry)) / 1024);
+
+	return hh;
+}
+
+void ras_hitters_free(struct ras_hitters *hh)
+{
+	int i;
+
+	if (!hh)
+		return;
+
+	for (i = 0; i < NUM_HH_KINDS; i++) {
+		free(hh->tab[i].cells);
+		free(hh->tab[i].top);
+		pthread_mutex_destroy(&hh->tab[i].lock);
+	}
+	free(hh);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_HITTERS_H
+#define __RAS_HITTERS_H
+
+#include <stdio.h>
+
+struct ras_events;
+
+/*
+ * Memory error hot spots. The errors are counted per address, per DRAM
+ * row and per DIMM by count-min sketches of fixed size, which keep the
+ * RAS_HH_TOP_K locations with the most errors.
+ */
+struct ras_hitters;
+
+struct ras_hitters *ras_hitters_init(void);
+void ras_hitters_free(struct ras_hitters *hh);
+
+/*
+ * Accounts count memory errors. grain_bits is the number of address bits
+ * that aren't known. addr is 0 if it's unknown, and dimm is NULL.
+ */
+void ras_record_mem_error(struct ras_events *ras, unsigned long long addr,
+			  unsigned grain_bits, const char *dimm,
+			  unsigned count);
+
+/* The "top" control command */
+int ras_hitters_cmd(struct ras_events *ras, int argc, char *argv[],
+		    FILE *out);
+
+#endif
@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "ras-events.h"
+#include "ras-incident.h"
+#include "ras-record.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+
+#define INC_WINDOW_MS	2000
+#define INC_BUCKET_BITS	10
+#define INC_WAYS	4
+#define INC_PAGE_SHIFT	12
+
+/* The first report of a recent incident */
+struct inc_slot {
+	uint64_t	id;
+	uint64_t	addr;
+	unsigned	grain;
+	unsigned	sources;
+	uint64_t	seen;
+};
+
+/*
+ * Recent incidents, hashed by page, with INC_WAYS per bucket. Reports
+ * with a grain above the page size only match the ones at its first page.
+ */
+struct ras_incidents {
+	pthread_mutex_t	lock;
+	uint64_t	window_ns;
+	uint64_t	next_id;
+	uint64_t	reports, joined;
+	struct inc_slot	slots[1 << INC_BUCKET_BITS][INC_WAYS];
+};
+
+/* The trace timestamp in ns: it's in clock ticks when using uptime */
+static uint64_t event_ns(struct ras_events *ras, unsigned long long ts)
+{
+	if (ras->use_uptime && user_hz > 0)
+		return ts * (1000000000ULL / user_hz);
+	return ts;
+}
+
+/* Events may come out of order, mostly when from different instances */
+static int inc_expired(struct ras_incidents *inc, struct inc_slot *s,
+		       uint64_t now)
+{
+	uint64_t delta = now > s->seen ? now - s->seen : s->seen - now;
+
+	return delta > inc->window_ns;
+}
+
+static unsigned inc_bucket(uint64_t addr)
+{
+	return ((addr >> INC_PAGE_SHIFT) * 0x9e3779b97f4a7c15ULL) >>
+	       (64 - INC_BUCKET_BITS);
+}
+
+/* Both addresses are the same, within the coarser grain */
+static int same_addr(uint64_t a, unsigned ga, uint64_t b, unsigned gb)
+{
+	unsigned grain = ga > gb ? ga : gb;
+
+	return grain >= 64 || !((a ^ b) >> grain);
+}
+
+unsigned long long ras_incident(struct ras_events *ras,
+				enum ras_incident_source src,
+				unsigned long long ts,
+				unsigned long long addr, unsigned grain_bits)
+{
+	struct ras_incidents *inc = ras->incidents;
+	struct inc_slot *bucket, *s, *slot = NULL;
+	unsigned source = 1 << src, i;
+	uint64_t now, id = 0;
+
+	if (!inc)
+		return 0;
+
+	if (grain_bits > 63)
+		grain_bits = 63;
+	addr &= ~((1ULL << grain_bits) - 1);
+	if (!addr)
+		return 0;
+
+	pthread_mutex_lock(&inc->lock);
+	inc->reports++;
+
+	now = event_ns(ras, ts);
+	bucket = inc->slots[inc_bucket(addr)];
+	for (i = 0; i < INC_WAYS; i++) {
+		s = &bucket[i];
+		if (!s->id || inc_expired(inc, s, now) ||
+		    !same_addr(s->addr, s->grain, addr, grain_bits))
+			continue;
+
+		/* Another error, if this source already reported it */
+		if (s->sources & source) {
+			slot = s;
+			break;
+		}
+
+		s->sources |= source;
+		inc->joined++;
+		id = s->id;
+		goto out;
+	}
+
+	/* Else an empty or expired slot, or the oldest one */
+	if (!slot) {
+		slot = &bucket[0];
+		for (i = 0; i < INC_WAYS; i++) {
+			s = &bucket[i];
+			if (!s->id || inc_expired(inc, s, now)) {
+				slot = s;
+				break;
+			}
+			if (s->seen < slot->seen)
+				slot = s;
+		}
+	}
+
+	id = inc->next_id++;
+	slot->id = id;
+	slot->addr = addr;
+	slot->grain = grain_bits;
+	slot->sources = source;
+	slot->seen = now;
+
+out:
+	pthread_mutex_unlock(&inc->lock);
+
+	return id;
+}
+
+struct ras_incidents *ras_incident_init(void)
+{
+	struct ras_incidents *inc;
+	unsigned long window_ms;
+	struct timeval tv;
+
+	window_ms = ras_env_ulong("RAS_INCIDENT_WINDOW_MS", INC_WINDOW_MS);
+	if (!window_ms)
+		return NULL;
+
+	inc = calloc(1, sizeof(*inc));
+	if (!inc)
+		return NULL;
+
+	pthread_mutex_init(&inc->lock, NULL);
+	inc->window_ns = window_ms * 1000000ULL;
+
+	/*
+	 * Ids are stored, so they must not repeat after a restart. They
+	 * start at the current time, in us.
+	 */
+	gettimeofday(&tv, NULL);
+	inc->next_id = tv.tv_sec * 1000000ULL + tv.tv_usec;
+
+	return inc;
+}
+
+void ras_incident_free(struct ras_incidents *inc)
+{
+	if (!inc)
+		return;
+
+	if (inc->reports)
+		log(SYSLOG, LOG_INFO,
+		    "memory error reports: %llu, in %llu incidents\n",
+		    (unsigned long long)inc->reports,
+		    (unsigned long long)(inc->reports - inc->joined));
+
+	pthread_mutex_destroy(&inc->lock);
+	free(inc);
+}
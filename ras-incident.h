@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_INCIDENT_H
+#define __RAS_INCIDENT_H
+
+struct ras_events;
+
+/*
+ * Memory error incidents. The same error may be reported by an MCE, by
+ * the EDAC driver at mc_event and by the firmware at extlog. Reports
+ * from different sources, at the same address within the grain of both,
+ * and with trace timestamps at most RAS_INCIDENT_WINDOW_MS apart, get the
+ * same incident id.
+ */
+enum ras_incident_source {
+	RAS_INCIDENT_MC,
+	RAS_INCIDENT_MCE,
+	RAS_INCIDENT_EXTLOG,
+};
+
+struct ras_incidents;
+
+struct ras_incidents *ras_incident_init(void);
+void ras_incident_free(struct ras_incidents *inc);
+
+/*
+ * Returns the incident id of a memory error report, or 0 when not
+ * correlating or if addr is 0, meaning it's unknown. grain_bits is the
+ * number of address bits that aren't known and ts is the trace timestamp
+ * of the event, as at struct pevent_record. The first report of an
+ * error gets a new id, even if no other source reports it later.
+ */
+unsigned long long ras_incident(struct ras_events *ras,
+				enum ras_incident_source src,
+				unsigned long long ts,
+				unsigned long long addr, unsigned grain_bits);
+
+#endif
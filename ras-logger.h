@@ -33,6 +33,14 @@
 #define ALL	(SYSLOG | TERM)
 /* TODO: global logging limit mask */
 
+#ifdef LIBRASDECODE
+/* The library doesn't write anywhere, but to the caller log callback */
+void librasdecode_log(int level, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+#define log(where, level, fmt, args...) \
+	librasdecode_log(level, fmt, ##args)
+#else
 #define log(where, level, fmt, args...) do {\
 	if (where & SYSLOG)\
 		syslog(level, fmt, ##args);\
@@ -42,6 +50,7 @@
 		fflush(stderr);\
 	}\
 } while (0)
+#endif
 
 #define __RAS_LOGGER_H
 #endif
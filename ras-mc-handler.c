@@ -24,6 +24,12 @@
 #include "ras-record.h"
 #include "ras-logger.h"
 #include "ras-report.h"
+#include "ras-page-isolation.h"
+#include "ras-rules.h"
+#include "ras-dimm.h"
+#include "ras-hitters.h"
+#include "ras-incident.h"
+#include "ras-decode.h"
 
 int ras_mc_event_handler(struct trace_seq *s,
 			 struct pevent_record *record,
@@ -33,9 +39,12 @@ int ras_mc_event_handler(struct trace_seq *s,
 	unsigned long long val;
 	struct ras_events *ras = context;
 	time_t now;
-	struct tm *tm;
+	struct tm tm_buf, *tm;
 	struct ras_mc_event ev;
 	int parsed_fields = 0;
+	int corrected;
+	char label[128], location[32];
+	const char *dimm;
 
 	/*
 	 * Newer kernels (3.10-rc1 or upper) provide an uptime clock.
@@ -51,7 +60,7 @@ int ras_mc_event_handler(struct trace_seq *s,
 	else
 		now = time(NULL);
 
-	tm = localtime(&now);
+	tm = localtime_r(&now, &tm_buf);
 	if (tm)
 		strftime(ev.timestamp, sizeof(ev.timestamp),
 			 "%Y-%m-%d %H:%M:%S %z", tm);
@@ -68,6 +77,7 @@ int ras_mc_event_handler(struct trace_seq *s,
 		goto parse_error;
 	parsed_fields++;
 
+	corrected = val == HW_EVENT_ERR_CORRECTED;
 	switch (val) {
 	case HW_EVENT_ERR_CORRECTED:
 		ev.error_type = "Corrected";
@@ -104,18 +114,10 @@ int ras_mc_event_handler(struct trace_seq *s,
 		goto parse_error;
 	parsed_fields++;
 
-	if (*ev.label) {
-		trace_seq_puts(s, " on ");
-		trace_seq_puts(s, ev.label);
-	}
-
-	trace_seq_puts(s, " (");
 	if (pevent_get_field_val(s,  event, "mc_index", record, &val, 1) < 0)
 		goto parse_error;
 	parsed_fields++;
-
 	ev.mc_index = val;
-	trace_seq_printf(s, "mc: %d", ev.mc_index);
 
 	if (pevent_get_field_val(s,  event, "top_layer", record, &val, 1) < 0)
 		goto parse_error;
@@ -132,6 +134,18 @@ int ras_mc_event_handler(struct trace_seq *s,
 	parsed_fields++;
 	ev.lower_layer = (signed char) val;
 
+	/* The labels the Kernel doesn't know, from the label database */
+	if (!ras_dimm_label(ras, ev.mc_index, ev.top_layer, ev.middle_layer,
+			    ev.lower_layer, label, sizeof(label)))
+		ev.label = label;
+
+	if (*ev.label) {
+		trace_seq_puts(s, " on ");
+		trace_seq_puts(s, ev.label);
+	}
+
+	trace_seq_printf(s, " (mc: %d", ev.mc_index);
+
 	if (ev.top_layer >= 0 || ev.middle_layer >= 0 || ev.lower_layer >= 0) {
 		if (ev.lower_layer >= 0)
 			trace_seq_printf(s, " location: %d:%d:%d",
@@ -179,6 +193,28 @@ int ras_mc_event_handler(struct trace_seq *s,
 	}
 	trace_seq_puts(s, ")");
 
+	/* Decode workers account each stream events in order */
+	ras_decode_ordered();
+
+	/* Account the corrected errors per page */
+	if (ev.address && corrected)
+		ras_record_page_error(ras, ev.address, ev.grain,
+				      ev.error_count);
+
+	/* DIMMs without a label are known by their location */
+	dimm = ev.label;
+	if (!*dimm && ev.top_layer >= 0) {
+		snprintf(location, sizeof(location), "mc%d:%d:%d:%d",
+			 ev.mc_index, ev.top_layer, ev.middle_layer,
+			 ev.lower_layer);
+		dimm = location;
+	}
+	ras_record_mem_error(ras, ev.address, ev.grain, dimm, ev.error_count);
+	ev.incident = ras_incident(ras, RAS_INCIDENT_MC, record->ts,
+				   ev.address, ev.grain);
+
+	ras_notify_event(ras, RAS_RULE_MC, &ev);
+
 	/* Insert data into the SGBD */
 
 	ras_store_mc_event(ras, &ev);
@@ -27,103 +27,19 @@
 #include "ras-record.h"
 #include "ras-logger.h"
 #include "ras-report.h"
+#include "ras-page-isolation.h"
+#include "ras-cpu-isolation.h"
+#include "ras-rules.h"
+#include "ras-dimm.h"
+#include "ras-hitters.h"
+#include "ras-incident.h"
+#include "ras-decode.h"
 
 /*
  * The code below were adapted from Andi Kleen/Intel/SuSe mcelog code,
  * released under GNU Public General License, v.2
  */
-static char *cputype_name[] = {
-	[CPU_GENERIC] = "generic CPU",
-	[CPU_P6OLD] = "Intel PPro/P2/P3/old Xeon",
-	[CPU_CORE2] = "Intel Core", /* 65nm and 45nm */
-	[CPU_K8] = "AMD K8 and derivates",
-	[CPU_P4] = "Intel P4",
-	[CPU_NEHALEM] = "Intel Xeon 5500 series / Core i3/5/7 (\"Nehalem/Westmere\")",
-	[CPU_DUNNINGTON] = "Intel Xeon 7400 series",
-	[CPU_TULSA] = "Intel Xeon 7100 series",
-	[CPU_INTEL] = "Intel generic architectural MCA",
-	[CPU_XEON75XX] = "Intel Xeon 7500 series",
-	[CPU_SANDY_BRIDGE] = "Sandy Bridge",		/* Fill in better name */
-	[CPU_SANDY_BRIDGE_EP] = "Sandy Bridge EP",	/* Fill in better name */
-	[CPU_IVY_BRIDGE] = "Ivy Bridge",		/* Fill in better name */
-	[CPU_IVY_BRIDGE_EPEX] = "Ivy Bridge EP/EX",	/* Fill in better name */
-	[CPU_HASWELL] = "Haswell",
-	[CPU_HASWELL_EPEX] = "Intel Xeon v3 (Haswell) EP/EX",
-	[CPU_BROADWELL] = "Broadwell",
-	[CPU_BROADWELL_DE] = "Broadwell DE",
-	[CPU_BROADWELL_EPEX] = "Broadwell EP/EX",
-	[CPU_KNIGHTS_LANDING] = "Knights Landing",
-	[CPU_KNIGHTS_MILL] = "Knights Mill",
-};
-
-static enum cputype select_intel_cputype(struct ras_events *ras)
-{
-	struct mce_priv *mce = ras->mce_priv;
-
-	if (mce->family == 15) {
-		if (mce->model == 6)
-			return CPU_TULSA;
-		return CPU_P4;
-	}
-	if (mce->family == 6) {
-		if (mce->model >= 0x1a && mce->model != 28)
-			mce->mc_error_support = 1;
-
-		if (mce->model < 0xf)
-			return CPU_P6OLD;
-		else if (mce->model == 0xf || mce->model == 0x17) /* Merom/Penryn */
-			return CPU_CORE2;
-		else if (mce->model == 0x1d)
-			return CPU_DUNNINGTON;
-		else if (mce->model == 0x1a || mce->model == 0x2c ||
-			 mce->model == 0x1e || mce->model == 0x25)
-			return CPU_NEHALEM;
-		else if (mce->model == 0x2e || mce->model == 0x2f)
-			return CPU_XEON75XX;
-		else if (mce->model == 0x2a)
-			return CPU_SANDY_BRIDGE;
-		else if (mce->model == 0x2d)
-			return CPU_SANDY_BRIDGE_EP;
-		else if (mce->model == 0x3a)
-			return CPU_IVY_BRIDGE;
-		else if (mce->model == 0x3e)
-			return CPU_IVY_BRIDGE_EPEX;
-		else if (mce->model == 0x3c || mce->model == 0x45 ||
-			 mce->model == 0x46)
-			return CPU_HASWELL;
-		else if (mce->model == 0x3f)
-			return CPU_HASWELL_EPEX;
-		else if (mce->model == 0x56)
-			return CPU_BROADWELL_DE;
-		else if (mce->model == 0x4f)
-			return CPU_BROADWELL_EPEX;
-		else if (mce->model == 0x3d)
-			return CPU_BROADWELL;
-		else if (mce->model == 0x57)
-			return CPU_KNIGHTS_LANDING;
-		else if (mce->model == 0x85)
-			return CPU_KNIGHTS_MILL;
-
-		if (mce->model > 0x1a) {
-			log(ALL, LOG_INFO,
-			    "Family 6 Model %x CPU: only decoding architectural errors\n",
-			    mce->model);
-			return CPU_INTEL;
-		}
-	}
-	if (mce->family > 6) {
-		log(ALL, LOG_INFO,
-		    "Family %u Model %x CPU: only decoding architectural errors\n",
-		    mce->family, mce->model);
-		return CPU_INTEL;
-	}
-	log(ALL, LOG_INFO,
-	    "Unknown Intel CPU type Family %x Model %x\n",
-	    mce->family, mce->model);
-	return mce->family == 6 ? CPU_P6OLD : CPU_GENERIC;
-}
-
-static int detect_cpu(struct ras_events *ras)
+static int detect_cpu(struct ras_events *ras, int (**setup)(unsigned ncpus))
 {
 	struct mce_priv *mce = ras->mce_priv;
 	FILE *f;
@@ -181,23 +97,7 @@ static int detect_cpu(struct ras_events *ras)
 		goto ret;
 	}
 
-	/* Handle only Intel and AMD CPUs */
-	ret = 0;
-
-	if (!strcmp(mce->vendor, "AuthenticAMD")) {
-		if (mce->family == 15)
-			mce->cputype = CPU_K8;
-		if (mce->family > 15) {
-			log(ALL, LOG_INFO,
-			    "Can't parse MCE for this AMD CPU yet\n");
-			ret = EINVAL;
-		}
-		goto ret;
-	} else if (!strcmp(mce->vendor,"GenuineIntel")) {
-		mce->cputype = select_intel_cputype(ras);
-	} else {
-		ret = EINVAL;
-	}
+	ret = mce_select_cpu(mce, setup);
 
 ret:
 	fclose(f);
@@ -210,6 +110,7 @@ int register_mce_handler(struct ras_events *ras, unsigned ncpus)
 {
 	int rc;
 	struct mce_priv *mce;
+	int (*setup)(unsigned ncpus) = NULL;
 
 	ras->mce_priv = calloc(1, sizeof(struct mce_priv));
 	if (!ras->mce_priv) {
@@ -219,7 +120,7 @@ int register_mce_handler(struct ras_events *ras, unsigned ncpus)
 
 	mce = ras->mce_priv;
 
-	rc = detect_cpu(ras);
+	rc = detect_cpu(ras, &setup);
 	if (rc) {
 		if (mce->processor_flags)
 			free (mce->processor_flags);
@@ -227,16 +128,8 @@ int register_mce_handler(struct ras_events *ras, unsigned ncpus)
 		ras->mce_priv = NULL;
 		return (rc);
 	}
-	switch (mce->cputype) {
-	case CPU_SANDY_BRIDGE_EP:
-	case CPU_IVY_BRIDGE_EPEX:
-	case CPU_HASWELL_EPEX:
-	case CPU_KNIGHTS_LANDING:
-	case CPU_KNIGHTS_MILL:
-		set_intel_imc_log(mce->cputype, ncpus);
-	default:
-		break;
-	}
+	if (setup)
+		setup(ncpus);
 
 	return rc;
 }
@@ -250,7 +143,7 @@ static void report_mce_event(struct ras_events *ras,
 			     struct trace_seq *s, struct mce_event *e)
 {
 	time_t now;
-	struct tm *tm;
+	struct tm tm_buf, *tm;
 	struct mce_priv *mce = ras->mce_priv;
 
 	/*
@@ -267,30 +160,37 @@ static void report_mce_event(struct ras_events *ras,
 	else
 		now = time(NULL);
 
-	tm = localtime(&now);
-	if (tm)
-		strftime(e->timestamp, sizeof(e->timestamp),
-			 "%Y-%m-%d %H:%M:%S %z", tm);
-	trace_seq_printf(s, "%s ", e->timestamp);
+	tm = localtime_r(&now, &tm_buf);
+	if (tm) {
+		struct strbuf sb;
 
-	if (*e->bank_name)
-		trace_seq_printf(s, "%s", e->bank_name);
+		mce_text_begin(&e->timestamp, &sb);
+		sb.len = strftime(sb.buf, sb.size, "%Y-%m-%d %H:%M:%S %z", tm);
+		mce_text_end(&e->timestamp, &sb);
+	}
+	trace_seq_printf(s, "%s ", MCE_TEXT(e, timestamp));
+
+	if (e->bank_name.len)
+		trace_seq_printf(s, "%s", MCE_TEXT(e, bank_name));
 	else
 		trace_seq_printf(s, "bank=%x", e->bank);
 
 	trace_seq_printf(s, ", status= %llx", (long long)e->status);
-	if (*e->error_msg)
-		trace_seq_printf(s, ", %s", e->error_msg);
-	if (*e->mcistatus_msg)
-		trace_seq_printf(s, ", mci=%s", e->mcistatus_msg);
-	if (*e->mcastatus_msg)
-		trace_seq_printf(s, ", mca=%s", e->mcastatus_msg);
+	if (e->error_msg.len)
+		trace_seq_printf(s, ", %s", MCE_TEXT(e, error_msg));
+	if (e->mcistatus_msg.len)
+		trace_seq_printf(s, ", mci=%s", MCE_TEXT(e, mcistatus_msg));
+	if (e->mcastatus_msg.len)
+		trace_seq_printf(s, ", mca=%s", MCE_TEXT(e, mcastatus_msg));
 
-	if (*e->user_action)
-		trace_seq_printf(s, " %s", e->user_action);
+	if (e->user_action.len)
+		trace_seq_printf(s, " %s", MCE_TEXT(e, user_action));
 
-	if (*e->mc_location)
-		trace_seq_printf(s, ", %s", e->mc_location);
+	if (e->mc_location.len)
+		trace_seq_printf(s, ", %s", MCE_TEXT(e, mc_location));
+
+	if (e->label)
+		trace_seq_printf(s, ", label= %s", e->label);
 
 #if 0
 	/*
@@ -302,7 +202,7 @@ static void report_mce_event(struct ras_events *ras,
 	trace_seq_printf(s, ", walltime= %d", e->walltime);
 #endif
 
-	trace_seq_printf(s, ", cpu_type= %s", cputype_name[mce->cputype]);
+	trace_seq_printf(s, ", cpu_type= %s", mce->cpu_name);
 	trace_seq_printf(s, ", cpu= %d", e->cpu);
 	trace_seq_printf(s, ", socketid= %d", e->socketid);
 
@@ -328,8 +228,8 @@ static void report_mce_event(struct ras_events *ras,
 	if (e->status & MCI_STATUS_ADDRV)
 		trace_seq_printf(s, ", addr= %llx", (long long)e->addr);
 
-	if (e->mcgstatus_msg)
-		trace_seq_printf(s, ", %s", e->mcgstatus_msg);
+	if (e->mcgstatus_msg.len)
+		trace_seq_printf(s, ", %s", MCE_TEXT(e, mcgstatus_msg));
 	else
 		trace_seq_printf(s, ", mcgstatus= %llx",
 				 (long long)e->mcgstatus);
@@ -350,91 +250,152 @@ static void report_mce_event(struct ras_events *ras,
 	 */
 }
 
-int ras_mce_event_handler(struct trace_seq *s,
-			  struct pevent_record *record,
-			  struct event_format *event, void *context)
+/* Position after "name=" at the decoded location, or -1 */
+static int mc_location_val(const char *loc, const char *name)
+{
+	const char *p = strstr(loc, name);
+
+	if (!p || !isdigit(p[strlen(name)]))
+		return -1;
+
+	return atoi(p + strlen(name));
+}
+
+/*
+ * The DIMM of memory controller errors, from the channel and DIMM found
+ * by the decoders. Only done when the socket has a single EDAC memory
+ * controller, as the MCE doesn't tell which one it is.
+ */
+static void mce_dimm_label(struct ras_events *ras, struct mce_event *e,
+			   char *buf, size_t size)
+{
+	const char *loc = MCE_TEXT(e, mc_location);
+	int mc, chan, dimm;
+
+	if ((e->status & 0xff80) != 0x0080 || !e->mc_location.len)
+		return;
+
+	mc = ras_dimm_socket_mc(ras, e->socketid);
+	if (mc < 0)
+		return;
+
+	chan = mc_location_val(loc, "channel=");
+	dimm = mc_location_val(loc, "dimm=");
+	if (dimm >= 0 ?
+	    !ras_dimm_label(ras, mc, chan, dimm, -1, buf, size) :
+	    !ras_dimm_channel_label(ras, mc, chan, buf, size))
+		e->label = buf;
+}
+
+static int mce_handle_event(struct ras_events *ras, struct trace_seq *s,
+			    struct pevent_record *record,
+			    struct event_format *event, struct mce_event *e)
 {
 	unsigned long long val;
-	struct ras_events *ras = context;
-	struct mce_priv *mce = ras->mce_priv;
-	struct mce_event e;
+	char label[128];
+	unsigned long long addr;
+	unsigned grain;
 	int rc = 0;
 
-	memset(&e, 0, sizeof(e));
-
 	/* Parse the MCE error data */
 	if (pevent_get_field_val(s, event, "mcgcap", record, &val, 1) < 0)
 		return -1;
-	e.mcgcap = val;
+	e->mcgcap = val;
 	if (pevent_get_field_val(s, event, "mcgstatus", record, &val, 1) < 0)
 		return -1;
-	e.mcgstatus = val;
+	e->mcgstatus = val;
 	if (pevent_get_field_val(s, event, "status", record, &val, 1) < 0)
 		return -1;
-	e.status = val;
+	e->status = val;
 	if (pevent_get_field_val(s, event, "addr", record, &val, 1) < 0)
 		return -1;
-	e.addr = val;
+	e->addr = val;
 	if (pevent_get_field_val(s, event, "misc", record, &val, 1) < 0)
 		return -1;
-	e.misc = val;
+	e->misc = val;
 	if (pevent_get_field_val(s, event, "ip", record, &val, 1) < 0)
 		return -1;
-	e.ip = val;
+	e->ip = val;
 	if (pevent_get_field_val(s, event, "tsc", record, &val, 1) < 0)
 		return -1;
-	e.tsc = val;
+	e->tsc = val;
 	if (pevent_get_field_val(s, event, "walltime", record, &val, 1) < 0)
 		return -1;
-	e.walltime = val;
+	e->walltime = val;
 	if (pevent_get_field_val(s, event, "cpu", record, &val, 1) < 0)
 		return -1;
-	e.cpu = val;
+	e->cpu = val;
 	if (pevent_get_field_val(s, event, "cpuid", record, &val, 1) < 0)
 		return -1;
-	e.cpuid = val;
+	e->cpuid = val;
 	if (pevent_get_field_val(s, event, "apicid", record, &val, 1) < 0)
 		return -1;
-	e.apicid = val;
+	e->apicid = val;
 	if (pevent_get_field_val(s, event, "socketid", record, &val, 1) < 0)
 		return -1;
-	e.socketid = val;
+	e->socketid = val;
 	if (pevent_get_field_val(s, event, "cs", record, &val, 1) < 0)
 		return -1;
-	e.cs = val;
+	e->cs = val;
 	if (pevent_get_field_val(s, event, "bank", record, &val, 1) < 0)
 		return -1;
-	e.bank = val;
+	e->bank = val;
 	if (pevent_get_field_val(s, event, "cpuvendor", record, &val, 1) < 0)
 		return -1;
-	e.cpuvendor = val;
-
-	switch (mce->cputype) {
-	case CPU_GENERIC:
-		break;
-	case CPU_K8:
-		rc = parse_amd_k8_event(ras, &e);
-		break;
-	default:			/* All other CPU types are Intel */
-		rc = parse_intel_event(ras, &e);
-	}
+	e->cpuvendor = val;
 
+	rc = mce_decode_event(ras, e);
 	if (rc)
 		return rc;
 
-	if (!*e.error_msg && *e.mcastatus_msg)
-		mce_snprintf(e.error_msg, "%s", e.mcastatus_msg);
+	mce_dimm_label(ras, e, label, sizeof(label));
+
+	report_mce_event(ras, record, s, e);
 
-	report_mce_event(ras, record, s, &e);
+	/* Decode workers account each stream events in order */
+	ras_decode_ordered();
+
+	/* Memory controller errors: 0000 0000 1MMM CCCC */
+	if ((e->status & 0xff80) == 0x0080) {
+		grain = e->status & MCI_STATUS_MISCV ? e->misc & 0x3f : 0;
+		addr = e->status & MCI_STATUS_ADDRV ? e->addr : 0;
+
+		if (addr && !(e->status & MCI_STATUS_UC))
+			ras_record_page_error(ras, addr, grain, 1);
+		ras_record_mem_error(ras, addr, grain, e->label, 1);
+		e->incident = ras_incident(ras, RAS_INCIDENT_MCE,
+					   record->ts, addr, grain);
+	}
+
+	ras_record_cpu_error(ras, e);
+	ras_notify_event(ras, RAS_RULE_MCE, e);
 
 #ifdef HAVE_SQLITE3
-	ras_store_mce_record(ras, &e);
+	ras_store_mce_record(ras, e);
 #endif
 
 #ifdef HAVE_ABRT_REPORT
 	/* Report event to ABRT */
-	ras_report_mce_event(ras, &e);
+	ras_report_mce_event(ras, e);
 #endif
 
 	return 0;
 }
+
+int ras_mce_event_handler(struct trace_seq *s,
+			  struct pevent_record *record,
+			  struct event_format *event, void *context)
+{
+	struct ras_events *ras = context;
+	struct mce_event e;
+	int rc;
+
+	memset(&e, 0, sizeof(e));
+	if (mce_event_init(&e) < 0)
+		return -1;
+
+	rc = mce_handle_event(ras, s, record, event, &e);
+	mce_event_release(&e);
+
+	return rc;
+}
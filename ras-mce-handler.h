@@ -22,6 +22,7 @@
 #include <stdint.h>
 
 #include "ras-events.h"
+#include "strbuf.h"
 #include "libtrace/event-parse.h"
 
 
@@ -49,6 +50,14 @@ enum cputype {
 	CPU_BROADWELL_EPEX,
 	CPU_KNIGHTS_LANDING,
 	CPU_KNIGHTS_MILL,
+	CPU_SKYLAKE_XEON,
+	CPU_ICELAKE_XEON,
+	CPU_SAPPHIRERAPIDS,
+};
+
+/* A string at the MCE event text arena */
+struct mce_text {
+	uint16_t	off, len, size;
 };
 
 struct mce_event {
@@ -69,17 +78,44 @@ struct mce_event {
 	uint8_t		bank;
 	uint8_t		cpuvendor;
 
-	/* Parsed data */
-	char		timestamp[64];
-	char		bank_name[64];
-	char		error_msg[4096];
-	char		mcgstatus_msg[256];
-	char		mcistatus_msg[1024];
-	char		mcastatus_msg[1024];
-	char		user_action[4096];
-	char		mc_location[256];
+	/* Parsed data, stored at the text arena */
+	struct mce_text	timestamp;
+	struct mce_text	bank_name;
+	struct mce_text	error_msg;
+	struct mce_text	mcgstatus_msg;
+	struct mce_text	mcistatus_msg;
+	struct mce_text	mcastatus_msg;
+	struct mce_text	user_action;
+	struct mce_text	mc_location;
+	const char	*text;		/* The event arena, owning the strings */
+
+	const char	*label;		/* DIMM label, or NULL */
+	uint64_t	incident;	/* Memory error incident, or 0 */
 };
 
+/* Reads a parsed data string */
+#define MCE_TEXT(e, field)	((e)->text + (e)->field.off)
+
+/*
+ * The parsed data strings belong to the event, from mce_event_init() until
+ * mce_event_release(), so an event may be kept or queued meanwhile. Copies
+ * of the struct share them: only one of them is released, and none is used
+ * after that. They're written while decoding, by the thread that
+ * initialized the event, before it initializes another one.
+ */
+int mce_event_init(struct mce_event *e);
+void mce_event_release(struct mce_event *e);
+void mce_text_free(void);
+void mce_text_reset(struct mce_text *t);
+void mce_text_add(struct mce_text *t, const char *str, unsigned len);
+void mce_text_puts(struct mce_text *t, const char *str);
+void mce_text_catf(struct mce_text *t, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+void mce_text_begin(struct mce_text *t, struct strbuf *sb);
+void mce_text_end(struct mce_text *t, struct strbuf *sb);
+
+typedef void (*mce_decode_func)(struct ras_events *ras, struct mce_event *e);
+
 struct mce_priv {
 	/* CPU Info */
 	char vendor[64];
@@ -88,20 +124,22 @@ struct mce_priv {
 	enum cputype cputype;
 	unsigned mc_error_support:1;
 	char *processor_flags;
+
+	/* Decoders for this CPU, from the CPU models table */
+	const char *cpu_name;
+	int (*parse_event)(struct ras_events *ras, struct mce_event *e);
+	mce_decode_func bus_decode;	/* Bus and interconnect errors */
+	mce_decode_func model_decode;
+
+	/* Decoded messages cache statistics */
+	unsigned long long cache_hits, cache_misses;
 };
 
-#define mce_snprintf(buf, fmt, arg...) do {			\
-	unsigned __n = strlen(buf);				\
-	unsigned __len = sizeof(buf) - __n;			\
-	if (!__len)						\
-		break;						\
-	if (__n) {						\
-		snprintf(buf + __n, __len, " ");		\
-		__len--;					\
-		__n++;						\
-	}							\
-	snprintf(buf + __n, __len, fmt,  ##arg);		\
-} while (0)
+#define mce_snprintf(t, fmt, arg...)	mce_text_catf(&(t), fmt, ##arg)
+
+/* CPU models registry, and the decoding entry point */
+int mce_select_cpu(struct mce_priv *mce, int (**setup)(unsigned ncpus));
+int mce_decode_event(struct ras_events *ras, struct mce_event *e);
 
 /* register and handling routines */
 int register_mce_handler(struct ras_events *ras, unsigned ncpus);
@@ -109,21 +147,28 @@ int ras_mce_event_handler(struct trace_seq *s,
 			  struct pevent_record *record,
 			  struct event_format *event, void *context);
 
+/* decoded messages cache */
+int mce_cache_lookup(struct mce_priv *mce, struct mce_event *e,
+		     uint64_t status);
+void mce_cache_store(struct mce_priv *mce, struct mce_event *e,
+		     uint64_t status);
+void mce_cache_free(void);
+
 /* enables intel iMC logs */
-int set_intel_imc_log(enum cputype cputype, unsigned ncpus);
+int set_intel_imc_log(unsigned ncpus);
 
 /* Per-CPU-type decoders for Intel CPUs */
-void p4_decode_model(struct mce_event *e);
-void core2_decode_model(struct mce_event *e);
-void p6old_decode_model(struct mce_event *e);
-void nehalem_decode_model(struct mce_event *e);
-void xeon75xx_decode_model(struct mce_event *e);
-void dunnington_decode_model(struct mce_event *e);
+void p4_decode_model(struct ras_events *ras, struct mce_event *e);
+void core2_decode_model(struct ras_events *ras, struct mce_event *e);
+void p6old_decode_model(struct ras_events *ras, struct mce_event *e);
+void nehalem_decode_model(struct ras_events *ras, struct mce_event *e);
+void xeon75xx_decode_model(struct ras_events *ras, struct mce_event *e);
+void dunnington_decode_model(struct ras_events *ras, struct mce_event *e);
 void snb_decode_model(struct ras_events *ras, struct mce_event *e);
 void ivb_decode_model(struct ras_events *ras, struct mce_event *e);
 void hsw_decode_model(struct ras_events *ras, struct mce_event *e);
 void knl_decode_model(struct ras_events *ras, struct mce_event *e);
-void tulsa_decode_model(struct mce_event *e);
+void tulsa_decode_model(struct ras_events *ras, struct mce_event *e);
 void broadwell_de_decode_model(struct ras_events *ras, struct mce_event *e);
 void broadwell_epex_decode_model(struct ras_events *ras, struct mce_event *e);
 
@@ -131,6 +176,7 @@ void broadwell_epex_decode_model(struct ras_events *ras, struct mce_event *e);
 #define MCE_EXTENDED_BANK	128
 
 #define MCI_THRESHOLD_OVER  (1ULL<<48)  /* threshold error count overflow */
+#define MCI_STATUS_CEC_MASK (0x7fffULL<<38) /* corrected error count */
 
 #define MCI_STATUS_VAL   (1ULL<<63)  /* valid error */
 #define MCI_STATUS_OVER  (1ULL<<62)  /* previous errors lost */
@@ -147,6 +193,8 @@ void broadwell_epex_decode_model(struct ras_events *ras, struct mce_event *e);
 #define MCG_STATUS_MCIP  (1ULL<<2)   /* machine check in progress */
 #define MCG_STATUS_LMCE  (1ULL<<3)   /* local machine check signaled */
 
+#define MCG_TES_P        (1ULL<<11)  /* Yellow bit cache threshold supported */
+
 /* Those functions are defined on per-cpu vendor C files */
 int parse_intel_event(struct ras_events *ras, struct mce_event *e);
 
@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "libtrace/event-parse.h"
+#include "ras-merge.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+
+#define MERGE_WINDOW_MS		100
+#define MERGE_MAX_EVENTS	1024
+#define MERGE_STATS_TIME	3600
+
+struct merge_item {
+	struct pthread_data	*pdata;
+	unsigned long long	seq;		/* read order, for ties */
+	unsigned long long	arrival;	/* when it was read, in ns */
+	struct pevent_record	record;
+	char			data[];
+};
+
+struct ras_merge {
+	/* Min-heap by timestamp, then read order */
+	struct merge_item	**heap;
+	unsigned		count, max;
+	unsigned long long	window_ns;
+	unsigned long long	seq;
+
+	/* Statistics */
+	unsigned long long	last_ts, max_ts;
+	unsigned long long	events, reordered, late;
+	unsigned long long	unmerged;	/* Passed on without memory */
+	unsigned long long	held_ns, max_held_ns;
+	time_t			stats_logged;
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int item_before(struct merge_item *a, struct merge_item *b)
+{
+	if (a->record.ts != b->record.ts)
+		return a->record.ts < b->record.ts;
+	return a->seq < b->seq;
+}
+
+static void heap_up(struct merge_item **h, unsigned i)
+{
+	struct merge_item *tmp;
+
+	while (i && item_before(h[i], h[(i - 1) / 2])) {
+		tmp = h[i];
+		h[i] = h[(i - 1) / 2];
+		h[(i - 1) / 2] = tmp;
+		i = (i - 1) / 2;
+	}
+}
+
+static void heap_down(struct merge_item **h, unsigned n, unsigned i)
+{
+	struct merge_item *tmp;
+	unsigned min, c;
+
+	for (;;) {
+		min = i;
+		for (c = 2 * i + 1; c <= 2 * i + 2 && c < n; c++)
+			if (item_before(h[c], h[min]))
+				min = c;
+		if (min == i)
+			break;
+		tmp = h[i];
+		h[i] = h[min];
+		h[min] = tmp;
+		i = min;
+	}
+}
+
+static void merge_log_stats(struct ras_merge *m)
+{
+	if (!m->events)
+		return;
+
+	log(SYSLOG, LOG_INFO,
+	    "merged events: %llu, %llu reordered, %llu late, %llu unmerged, held avg %llu us, max %llu us\n",
+	    m->events, m->reordered, m->late, m->unmerged,
+	    m->held_ns / m->events / 1000, m->max_held_ns / 1000);
+}
+
+static void merge_pass(struct ras_merge *m, struct pthread_data *pdata,
+		       struct pevent_record *record, unsigned long long held)
+{
+	m->events++;
+	m->held_ns += held;
+	if (held > m->max_held_ns)
+		m->max_held_ns = held;
+	/* Read too late to be put in order */
+	if (record->ts < m->last_ts)
+		m->late++;
+	else
+		m->last_ts = record->ts;
+
+	ras_dispatch_record(pdata, record);
+}
+
+/* Passes on the first event */
+static void merge_pop(struct ras_merge *m, unsigned long long now)
+{
+	struct merge_item *item = m->heap[0];
+
+	m->heap[0] = m->heap[--m->count];
+	heap_down(m->heap, m->count, 0);
+
+	merge_pass(m, item->pdata, &item->record, now - item->arrival);
+	free(item);
+}
+
+int ras_merge_push(struct pthread_data *pdata, struct pevent_record *record)
+{
+	struct ras_merge *m = pdata->ras->merge;
+	struct merge_item *item;
+
+	/*
+	 * Without memory, the event is passed on right away, after the held
+	 * ones, so it's not lost, and they're still in order.
+	 */
+	item = malloc(sizeof(*item) + record->size);
+	if (!item) {
+		if (!m->unmerged++)
+			log(ALL, LOG_ERR,
+			    "Can't merge events: out of memory. Passing them on as read\n");
+		ras_merge_drain(pdata->ras);
+		merge_pass(m, pdata, record, 0);
+		return -ENOMEM;
+	}
+
+	item->pdata = pdata;
+	item->seq = m->seq++;
+	item->arrival = now_ns();
+	memset(&item->record, 0, sizeof(item->record));
+	item->record.ts = record->ts;
+	item->record.offset = record->offset;
+	item->record.missed_events = record->missed_events;
+	item->record.record_size = record->record_size;
+	item->record.size = record->size;
+	item->record.cpu = record->cpu;
+	item->record.data = item->data;
+	memcpy(item->data, record->data, record->size);
+
+	/* Read after an event that happened later */
+	if (record->ts < m->max_ts)
+		m->reordered++;
+	else
+		m->max_ts = record->ts;
+
+	m->heap[m->count] = item;
+	heap_up(m->heap, m->count++);
+
+	if (m->count > m->max)
+		merge_pop(m, item->arrival);
+
+	return 0;
+}
+
+int ras_merge_flush(struct ras_events *ras)
+{
+	struct ras_merge *m = ras->merge;
+	unsigned long long now, expired_ts = 0, oldest;
+	time_t t = time(NULL);
+	int expired = 0;
+	unsigned i;
+
+	if (!m)
+		return -1;
+
+	if (t - m->stats_logged >= MERGE_STATS_TIME) {
+		merge_log_stats(m);
+		m->stats_logged = t;
+	}
+
+	if (!m->count)
+		return -1;
+
+	/*
+	 * Events held for the whole window are passed on, and so are the
+	 * ones that happened before them.
+	 */
+	now = now_ns();
+	for (i = 0; i < m->count; i++) {
+		if (m->heap[i]->arrival + m->window_ns > now)
+			continue;
+		if (!expired || m->heap[i]->record.ts > expired_ts)
+			expired_ts = m->heap[i]->record.ts;
+		expired = 1;
+	}
+	while (expired && m->count && m->heap[0]->record.ts <= expired_ts)
+		merge_pop(m, now);
+
+	if (!m->count)
+		return -1;
+
+	oldest = m->heap[0]->arrival;
+	for (i = 1; i < m->count; i++)
+		if (m->heap[i]->arrival < oldest)
+			oldest = m->heap[i]->arrival;
+
+	return (oldest + m->window_ns - now + 999999) / 1000000;
+}
+
+void ras_merge_drain(struct ras_events *ras)
+{
+	struct ras_merge *m = ras->merge;
+	unsigned long long now = now_ns();
+
+	if (!m)
+		return;
+
+	while (m->count)
+		merge_pop(m, now);
+}
+
+struct ras_merge *ras_merge_init(void)
+{
+	struct ras_merge *m;
+	unsigned long window_ms;
+
+	window_ms = ras_env_ulong("RAS_MERGE_WINDOW_MS", MERGE_WINDOW_MS);
+	if (!window_ms)
+		return NULL;
+
+	m = calloc(1, sizeof(*m));
+	if (!m)
+		return NULL;
+
+	m->window_ns = window_ms * 1000000ULL;
+	m->max = ras_env_ulong("RAS_MERGE_MAX_EVENTS", MERGE_MAX_EVENTS);
+	if (!m->max)
+		m->max = 1;
+
+	/* One more, as an event is pushed before the first one is popped */
+	m->heap = calloc(m->max + 1, sizeof(*m->heap));
+	if (!m->heap) {
+		free(m);
+		return NULL;
+	}
+	m->stats_logged = time(NULL);
+
+	log(ALL, LOG_INFO,
+	    "Merging events by time, holding them up to %lu ms or %u events\n",
+	    window_ms, m->max);
+
+	return m;
+}
+
+void ras_merge_free(struct ras_merge *m)
+{
+	unsigned i;
+
+	if (!m)
+		return;
+
+	merge_log_stats(m);
+	for (i = 0; i < m->count; i++)
+		free(m->heap[i]);
+	free(m->heap);
+	free(m);
+}
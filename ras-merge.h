@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_MERGE_H
+#define __RAS_MERGE_H
+
+#include "ras-events.h"
+
+/*
+ * Merges the events of all streams by their trace timestamp. Events are
+ * held for up to RAS_MERGE_WINDOW_MS, or until RAS_MERGE_MAX_EVENTS are
+ * waiting, so the ones read later from other CPUs can be put before
+ * them. Only used by the poll() reader, which is single threaded, and
+ * not for the critical instance streams, whose events are passed on
+ * right away.
+ *
+ * The uptime trace clock counts jiffies, so events within the same tick
+ * have equal timestamps, and are kept in the order they were read.
+ */
+struct ras_merge;
+
+struct ras_merge *ras_merge_init(void);
+void ras_merge_free(struct ras_merge *m);
+
+/*
+ * Copies the event, as the trace ring buffer page will be reused. Without
+ * memory for it, it passes on the held events and this one, returning
+ * -ENOMEM.
+ */
+int ras_merge_push(struct pthread_data *pdata, struct pevent_record *record);
+
+/*
+ * Passes on the events held for too long, and the ones before them.
+ * Returns the time, in ms, for the next call, or -1 if nothing is held.
+ */
+int ras_merge_flush(struct ras_events *ras);
+
+/* Passes on all the held events */
+void ras_merge_drain(struct ras_events *ras);
+
+#endif
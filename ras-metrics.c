@@ -0,0 +1,488 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ras-events.h"
+#include "ras-metrics.h"
+#include "ras-record.h"
+#include "ras-mce-handler.h"
+#include "ras-cper.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+#include "strbuf.h"
+
+#define METRICS_MAX_SERIES	4096
+#define METRICS_INTERVAL	60
+#define METRICS_LABELS_LEN	512
+
+enum metric_family {
+	MF_EVENTS,
+	MF_MC,
+	MF_AER,
+	MF_MCE,
+	MF_EXTLOG,
+	MF_DROPPED,
+	MF_MCE_CACHE,
+	NUM_MFS
+};
+
+static const struct {
+	const char	*name;
+	const char	*help;
+} metric_families[] = {
+	[MF_EVENTS]	= { "rasdaemon_events",
+			    "Hardware error events, by type and severity" },
+	[MF_MC]		= { "rasdaemon_mc_errors",
+			    "Memory controller errors, by DIMM" },
+	[MF_AER]	= { "rasdaemon_aer_errors",
+			    "PCIe AER errors, by device" },
+	[MF_MCE]	= { "rasdaemon_mce_errors",
+			    "Machine check errors, by CPU and bank" },
+	[MF_EXTLOG]	= { "rasdaemon_extlog_errors",
+			    "Firmware reported memory errors, by module" },
+	[MF_DROPPED]	= { "rasdaemon_metrics_dropped_series",
+			    "Counts not kept, as there were too many label sets" },
+	[MF_MCE_CACHE]	= { "rasdaemon_mce_decode_cache_lookups",
+			    "Lookups of the decoded MCE messages cache, by result" },
+};
+
+/* A counter, with its labels as written out */
+struct metric_series {
+	struct metric_series	*next;		/* In the same family */
+	unsigned long long	value;
+	unsigned		hash;
+	enum metric_family	family;
+	char			labels[];
+};
+
+/*
+ * Series are hashed by family and labels, with linear probing. They're
+ * never removed, so a slot, once set by a compare and swap, doesn't
+ * change. The table has twice the slots as the maximum series.
+ */
+struct ras_metrics {
+	struct metric_series	**slots;
+	unsigned		mask;
+	unsigned		nseries, max;
+	struct metric_series	*families[NUM_MFS];
+	struct metric_series	dropped;
+
+	/* Kept by the MCE handler, or NULL */
+	const unsigned long long *mce_cache_hits, *mce_cache_misses;
+
+	/* Text file, updated by its own thread */
+	char			*path;
+	unsigned long		interval;
+	unsigned long long	updates;
+	pthread_t		thread;
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	int			stop;
+};
+
+static unsigned metric_hash(enum metric_family family, const char *labels)
+{
+	unsigned h = 2166136261u ^ family;
+
+	for (; *labels; labels++)
+		h = (h ^ (unsigned char)*labels) * 16777619u;
+
+	return h;
+}
+
+static struct metric_series *metric_find(struct ras_metrics *m,
+					 enum metric_family family,
+					 const char *labels)
+{
+	struct metric_series *s, *new = NULL;
+	unsigned hash = metric_hash(family, labels), i, probe;
+	int counted = 0;
+
+	for (probe = 0; probe <= m->mask; probe++) {
+		i = (hash + probe) & m->mask;
+		s = __atomic_load_n(&m->slots[i], __ATOMIC_ACQUIRE);
+		if (!s) {
+			if (!new) {
+				counted = 1;
+				if (__atomic_fetch_add(&m->nseries, 1,
+						       __ATOMIC_RELAXED) >= m->max)
+					break;
+				new = calloc(1, sizeof(*new) + strlen(labels) + 1);
+				if (!new)
+					break;
+				new->hash = hash;
+				new->family = family;
+				strcpy(new->labels, labels);
+			}
+			if (__atomic_compare_exchange_n(&m->slots[i], &s, new, 0,
+							__ATOMIC_ACQ_REL,
+							__ATOMIC_ACQUIRE)) {
+				/* Readers walk the families, without the table */
+				new->next = __atomic_load_n(&m->families[family],
+							    __ATOMIC_RELAXED);
+				while (!__atomic_compare_exchange_n(&m->families[family],
+								    &new->next, new, 1,
+								    __ATOMIC_RELEASE,
+								    __ATOMIC_RELAXED))
+					;
+				return new;
+			}
+			/* Another thread took the slot first: s is its series */
+		}
+		if (s->hash == hash && s->family == family &&
+		    !strcmp(s->labels, labels))
+			break;
+		s = NULL;
+	}
+
+	free(new);
+	if (counted)
+		__atomic_fetch_sub(&m->nseries, 1, __ATOMIC_RELAXED);
+
+	return s;
+}
+
+static void metric_add(struct ras_metrics *m, enum metric_family family,
+		       const struct strbuf *labels, unsigned long long n)
+{
+	struct metric_series *s = NULL;
+
+	/* Truncated labels would be cut at the middle of a value */
+	if (labels->len + 1 < labels->size)
+		s = metric_find(m, family, labels->buf);
+	if (!s)
+		s = &m->dropped;
+
+	__atomic_fetch_add(&s->value, n, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&m->updates, 1, __ATOMIC_RELAXED);
+}
+
+static void label_str(struct strbuf *sb, const char *name, const char *val)
+{
+	strbuf_printf(sb, "%s%s=\"", sb->len ? "," : "", name);
+	for (; val && *val; val++) {
+		switch (*val) {
+		case '\\':
+			strbuf_add(sb, "\\\\", 2);
+			break;
+		case '"':
+			strbuf_add(sb, "\\\"", 2);
+			break;
+		case '\n':
+			strbuf_add(sb, "\\n", 2);
+			break;
+		default:
+			strbuf_add(sb, val, 1);
+		}
+	}
+	strbuf_add(sb, "\"", 1);
+}
+
+/* Unknown numbers, as -1, have an empty value */
+static void label_int(struct strbuf *sb, const char *name, long long val)
+{
+	if (val < 0)
+		strbuf_printf(sb, "%s%s=\"\"", sb->len ? "," : "", name);
+	else
+		strbuf_printf(sb, "%s%s=\"%lld\"", sb->len ? "," : "", name,
+			      val);
+}
+
+void ras_metrics_count(struct ras_events *ras, enum ras_rule_event type,
+		       const void *ev)
+{
+	struct ras_metrics *m = ras->metrics;
+	const char *sev;
+	char buf[METRICS_LABELS_LEN];
+	struct strbuf sb;
+	enum metric_family family;
+	unsigned long long n = 1;
+	int node, card, module;
+
+	if (!m)
+		return;
+
+	sev = ras_rule_severity(type, ev);
+	STRBUF_INIT(&sb, buf);
+	label_str(&sb, "event", ras_rule_event_name(type));
+	if (sev)
+		label_str(&sb, "severity", sev);
+	metric_add(m, MF_EVENTS, &sb, 1);
+
+	strbuf_reset(&sb);
+	switch (type) {
+	case RAS_RULE_MC: {
+		const struct ras_mc_event *e = ev;
+
+		family = MF_MC;
+		label_int(&sb, "mc", e->mc_index);
+		label_int(&sb, "top_layer", e->top_layer);
+		label_int(&sb, "middle_layer", e->middle_layer);
+		label_int(&sb, "lower_layer", e->lower_layer);
+		label_str(&sb, "label", e->label);
+		if (e->error_count > 0)
+			n = e->error_count;
+		break;
+	}
+	case RAS_RULE_AER: {
+		const struct ras_aer_event *e = ev;
+
+		family = MF_AER;
+		label_str(&sb, "device", e->dev_name);
+		break;
+	}
+	case RAS_RULE_MCE: {
+		const struct mce_event *e = ev;
+
+		family = MF_MCE;
+		label_int(&sb, "socket", e->socketid);
+		label_int(&sb, "cpu", e->cpu);
+		label_int(&sb, "bank", e->bank);
+		break;
+	}
+	case RAS_RULE_EXTLOG: {
+		const struct ras_extlog_event *e = ev;
+
+		family = MF_EXTLOG;
+		ras_cper_mem_location(e, &node, &card, &module);
+		label_int(&sb, "node", node);
+		label_int(&sb, "card", card);
+		label_int(&sb, "module", module);
+		label_str(&sb, "label", e->label);
+		break;
+	}
+	default:
+		return;
+	}
+	if (sev)
+		label_str(&sb, "severity", sev);
+	metric_add(m, family, &sb, n);
+}
+
+/*
+ * Writes the counters as OpenMetrics, or in the older Prometheus text
+ * format, where the counter type is given to the sample name.
+ */
+static void metrics_write(struct ras_metrics *m, FILE *out, int openmetrics)
+{
+	struct metric_series *s;
+	const char *name;
+	int f;
+
+	for (f = 0; f < NUM_MFS; f++) {
+		if (f == MF_MCE_CACHE && !m->mce_cache_hits)
+			continue;
+
+		name = metric_families[f].name;
+		fprintf(out, "# HELP %s%s %s\n# TYPE %s%s counter\n",
+			name, openmetrics ? "" : "_total",
+			metric_families[f].help,
+			name, openmetrics ? "" : "_total");
+
+		if (f == MF_DROPPED) {
+			fprintf(out, "%s_total %llu\n", name,
+				__atomic_load_n(&m->dropped.value,
+						__ATOMIC_RELAXED));
+			continue;
+		}
+		if (f == MF_MCE_CACHE) {
+			fprintf(out, "%s_total{result=\"hit\"} %llu\n", name,
+				__atomic_load_n(m->mce_cache_hits,
+						__ATOMIC_RELAXED));
+			fprintf(out, "%s_total{result=\"miss\"} %llu\n", name,
+				__atomic_load_n(m->mce_cache_misses,
+						__ATOMIC_RELAXED));
+			continue;
+		}
+
+		for (s = __atomic_load_n(&m->families[f], __ATOMIC_ACQUIRE);
+		     s; s = s->next)
+			fprintf(out, "%s_total{%s} %llu\n", name, s->labels,
+				__atomic_load_n(&s->value, __ATOMIC_RELAXED));
+	}
+	if (openmetrics)
+		fputs("# EOF\n", out);
+}
+
+void ras_metrics_mce_cache(struct ras_metrics *m,
+			   const unsigned long long *hits,
+			   const unsigned long long *misses)
+{
+	if (!m)
+		return;
+
+	m->mce_cache_misses = misses;
+	m->mce_cache_hits = hits;
+}
+
+int ras_metrics_cmd(struct ras_events *ras, int argc, char *argv[],
+		    FILE *out)
+{
+	int openmetrics = 1;
+
+	if (!ras->metrics)
+		return -EOPNOTSUPP;
+
+	if (argc > 2)
+		return -EINVAL;
+	if (argc == 2) {
+		if (!strcmp(argv[1], "prometheus"))
+			openmetrics = 0;
+		else if (strcmp(argv[1], "openmetrics"))
+			return -EINVAL;
+	}
+
+	metrics_write(ras->metrics, out, openmetrics);
+
+	return 0;
+}
+
+/* Replaces the text file, so the collector never reads it half written */
+static void metrics_write_file(struct ras_metrics *m)
+{
+	char tmp[PATH_MAX];
+	FILE *f;
+
+	snprintf(tmp, sizeof(tmp), "%s.tmp", m->path);
+	f = fopen(tmp, "we");
+	if (!f) {
+		log(SYSLOG, LOG_WARNING, "Can't write metrics to %s: %s\n",
+		    tmp, strerror(errno));
+		return;
+	}
+
+	metrics_write(m, f, 0);
+	if (fclose(f) || rename(tmp, m->path) < 0) {
+		log(SYSLOG, LOG_WARNING, "Can't write metrics to %s: %s\n",
+		    m->path, strerror(errno));
+		unlink(tmp);
+	}
+}
+
+/* Updates the text file every interval seconds, when the counts change */
+static void *metrics_thread(void *priv)
+{
+	struct ras_metrics *m = priv;
+	unsigned long long updates, written = 0;
+	struct timespec ts;
+	int first = 1;
+
+	pthread_mutex_lock(&m->lock);
+	for (;;) {
+		updates = __atomic_load_n(&m->updates, __ATOMIC_RELAXED);
+		if (first || updates != written) {
+			pthread_mutex_unlock(&m->lock);
+			metrics_write_file(m);
+			pthread_mutex_lock(&m->lock);
+			written = updates;
+			first = 0;
+		}
+		if (m->stop)
+			break;
+
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += m->interval;
+		pthread_cond_timedwait(&m->cond, &m->lock, &ts);
+	}
+	pthread_mutex_unlock(&m->lock);
+
+	return NULL;
+}
+
+struct ras_metrics *ras_metrics_init(void)
+{
+	const char *path = getenv("RAS_METRICS_FILE");
+	struct ras_metrics *m;
+	unsigned long max;
+	unsigned size;
+
+	max = ras_env_ulong("RAS_METRICS_MAX_SERIES", METRICS_MAX_SERIES);
+	if (!max)
+		return NULL;
+	if (max > 1 << 20)
+		max = 1 << 20;
+
+	m = calloc(1, sizeof(*m));
+	if (!m)
+		return NULL;
+
+	m->max = max;
+	for (size = 2; size < 2 * max; size <<= 1)
+		;
+	m->mask = size - 1;
+	m->slots = calloc(size, sizeof(*m->slots));
+	if (!m->slots) {
+		free(m);
+		return NULL;
+	}
+
+	pthread_mutex_init(&m->lock, NULL);
+	pthread_cond_init(&m->cond, NULL);
+
+	if (path && *path) {
+		m->interval = ras_env_ulong("RAS_METRICS_INTERVAL",
+					    METRICS_INTERVAL);
+		if (!m->interval)
+			m->interval = 1;
+		m->path = strdup(path);
+		if (!m->path ||
+		    pthread_create(&m->thread, NULL, metrics_thread, m)) {
+			log(ALL, LOG_ERR, "Can't write metrics to %s\n", path);
+			free(m->path);
+			m->path = NULL;
+		} else {
+			log(ALL, LOG_INFO,
+			    "Writing metrics to %s every %lu seconds\n",
+			    path, m->interval);
+		}
+	}
+
+	return m;
+}
+
+void ras_metrics_free(struct ras_metrics *m)
+{
+	unsigned i;
+
+	if (!m)
+		return;
+
+	/* The thread writes the last counts before exiting */
+	if (m->path) {
+		pthread_mutex_lock(&m->lock);
+		m->stop = 1;
+		pthread_cond_signal(&m->cond);
+		pthread_mutex_unlock(&m->lock);
+		pthread_join(m->thread, NULL);
+		free(m->path);
+	}
+
+	for (i = 0; i <= m->mask; i++)
+		free(m->slots[i]);
+	free(m->slots);
+	pthread_cond_destroy(&m->cond);
+	pthread_mutex_destroy(&m->lock);
+	free(m);
+}
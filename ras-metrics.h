@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_METRICS_H
+#define __RAS_METRICS_H
+
+#include <stdio.h>
+#include "ras-rules.h"
+
+/*
+ * Error counters, by DIMM, PCIe device, CPU and bank, and severity, as
+ * OpenMetrics. They're read with the "metrics" control socket command,
+ * or from the RAS_METRICS_FILE text file, for the node exporter textfile
+ * collector. Counters are updated without locks, and each one keeps its
+ * labels already formatted, so reading them doesn't touch the database.
+ * Up to RAS_METRICS_MAX_SERIES label sets are counted.
+ */
+struct ras_metrics;
+
+struct ras_metrics *ras_metrics_init(void);
+void ras_metrics_free(struct ras_metrics *m);
+
+/* Counts a decoded event, like a struct ras_mc_event */
+void ras_metrics_count(struct ras_events *ras, enum ras_rule_event type,
+		       const void *ev);
+
+/*
+ * Adds the decoded MCE messages cache statistics. The counters are kept
+ * by the MCE handler, and must outlive m.
+ */
+void ras_metrics_mce_cache(struct ras_metrics *m,
+			   const unsigned long long *hits,
+			   const unsigned long long *misses);
+
+int ras_metrics_cmd(struct ras_events *ras, int argc, char *argv[],
+		    FILE *out);
+
+#endif
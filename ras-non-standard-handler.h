@@ -31,9 +31,20 @@ int ras_non_standard_event_handler(struct trace_seq *s,
 			 struct event_format *event, void *context);
 
 void print_le_hex(struct trace_seq *s, const uint8_t *buf, int index);
+void print_le_words(struct trace_seq *s, const uint8_t *buf, int len);
+
+/* Runs the decoder registered for sec_type, or returns -ENOENT */
+int ras_ns_decode(struct trace_seq *s, const void *sec_type,
+		  const void *error);
 
 int register_ns_dec_tab(const p_ns_dec_tab tab);
 
 void unregister_ns_dec_tab(void);
 
+/* Per section type event counters. sec_type is NULL for unknown types */
+void ras_ns_dec_counters(void (*func)(void *priv, const char *sec_type,
+				      unsigned long long count),
+			 void *priv);
+void ras_ns_log_counters(void);
+
 #endif
@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2016, The Linux Foundation. All rights reserved.
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 and
+ * only version 2 as published by the Free Software Foundation.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "ras-non-standard-handler.h"
+#include "ras-logger.h"
+#include "ras-hex.h"
+
+/*
+ * Decoders are kept on an open addressing hash table, keyed by the
+ * section type GUID, with the bytes in the same order as the event.
+ */
+struct ns_dec_entry {
+	uint64_t	guid[2];
+	p_ns_dec_tab	dec;		/* NULL for an empty slot */
+	unsigned long long count;	/* Events seen for this section type */
+};
+
+#define NS_DEC_MIN_SIZE	16
+
+static struct ns_dec_entry *ns_dec_hash;
+static unsigned ns_dec_size, ns_dec_used;
+static unsigned long long ns_dec_unknown;
+
+/* Converts a sec_type string, as printed by uuid_le(), without dashes */
+static int guid_from_str(uint64_t *guid, const char *str)
+{
+	if (strlen(str) != 32 || uuid_le_parse(guid, str) < 0)
+		return -EINVAL;
+
+	return 0;
+}
+
+static unsigned guid_hash(const uint64_t *guid)
+{
+	uint64_t h = (guid[0] ^ (guid[1] * 0x9e3779b97f4a7c15ULL)) *
+		     0xff51afd7ed558ccdULL;
+
+	return h ^ (h >> 32);
+}
+
+static struct ns_dec_entry *ns_dec_slot(struct ns_dec_entry *hash,
+					unsigned size, const uint64_t *guid)
+{
+	unsigned i = guid_hash(guid) & (size - 1);
+
+	while (hash[i].dec &&
+	       (hash[i].guid[0] != guid[0] || hash[i].guid[1] != guid[1]))
+		i = (i + 1) & (size - 1);
+
+	return &hash[i];
+}
+
+static int ns_dec_grow(void)
+{
+	unsigned size = ns_dec_size ? ns_dec_size * 2 : NS_DEC_MIN_SIZE;
+	struct ns_dec_entry *hash;
+	unsigned i;
+
+	hash = calloc(size, sizeof(*hash));
+	if (!hash)
+		return -ENOMEM;
+
+	for (i = 0; i < ns_dec_size; i++)
+		if (ns_dec_hash[i].dec)
+			*ns_dec_slot(hash, size, ns_dec_hash[i].guid) =
+				ns_dec_hash[i];
+
+	free(ns_dec_hash);
+	ns_dec_hash = hash;
+	ns_dec_size = size;
+
+	return 0;
+}
+
+int register_ns_dec_tab(const p_ns_dec_tab tab)
+{
+	struct ns_dec_entry *e;
+	uint64_t guid[2];
+	size_t i;
+
+	for (i = 0; i < tab[0].len; i++) {
+		if (guid_from_str(guid, tab[i].sec_type) < 0) {
+			log(ALL, LOG_ERR, "Invalid section type %s\n",
+			    tab[i].sec_type);
+			continue;
+		}
+
+		/* Keep the load factor at 50% at most */
+		if (2 * (ns_dec_used + 1) > ns_dec_size && ns_dec_grow() < 0) {
+			log(ALL, LOG_ERR, "%s: can't allocate decoders table\n",
+			    __func__);
+			return -1;
+		}
+
+		/* The first decoder registered for a section type wins */
+		e = ns_dec_slot(ns_dec_hash, ns_dec_size, guid);
+		if (e->dec)
+			continue;
+		memcpy(e->guid, guid, sizeof(guid));
+		e->dec = &tab[i];
+		ns_dec_used++;
+	}
+
+	return 0;
+}
+
+void unregister_ns_dec_tab(void)
+{
+	free(ns_dec_hash);
+	ns_dec_hash = NULL;
+	ns_dec_size = 0;
+	ns_dec_used = 0;
+}
+
+void ras_ns_dec_counters(void (*func)(void *priv, const char *sec_type,
+				      unsigned long long count),
+			 void *priv)
+{
+	unsigned i;
+
+	for (i = 0; i < ns_dec_size; i++)
+		if (ns_dec_hash[i].dec)
+			func(priv, ns_dec_hash[i].dec->sec_type,
+			     __atomic_load_n(&ns_dec_hash[i].count,
+					     __ATOMIC_RELAXED));
+
+	func(priv, NULL, __atomic_load_n(&ns_dec_unknown, __ATOMIC_RELAXED));
+}
+
+static void log_counter(void *priv, const char *sec_type,
+			unsigned long long count)
+{
+	if (count)
+		log(SYSLOG, LOG_INFO, "non-standard section %s: %llu events\n",
+		    sec_type ? sec_type : "without decoder", count);
+}
+
+void ras_ns_log_counters(void)
+{
+	ras_ns_dec_counters(log_counter, NULL);
+}
+
+int ras_ns_decode(struct trace_seq *s, const void *sec_type,
+		  const void *error)
+{
+	struct ns_dec_entry *dec;
+	uint64_t guid[2];
+
+	if (ns_dec_size) {
+		memcpy(guid, sec_type, sizeof(guid));
+		dec = ns_dec_slot(ns_dec_hash, ns_dec_size, guid);
+		if (dec->dec) {
+			__atomic_add_fetch(&dec->count, 1, __ATOMIC_RELAXED);
+			dec->dec->decode(s, error);
+			return 0;
+		}
+	}
+
+	__atomic_add_fetch(&ns_dec_unknown, 1, __ATOMIC_RELAXED);
+	return -ENOENT;
+}
+
+void print_le_hex(struct trace_seq *s, const uint8_t *buf, int index)
+{
+	char word[9];
+
+	*hex_encode_le32(word, buf + index, 1) = '\0';
+	trace_seq_puts(s, word);
+}
+
+/*
+ * Dumps the payload as 32-bit little endian words, 4 words per line,
+ * each line built at once.
+ */
+void print_le_words(struct trace_seq *s, const uint8_t *buf, int len)
+{
+	char line[sizeof("xxxxxxxx xxxxxxxx xxxxxxxx xxxxxxxx\n  00000000: ")];
+	char digits[32];
+	uint8_t off[4];
+	char *p;
+	int i, j;
+
+	trace_seq_puts(s, " error:\n  00000000: ");
+	for (i = 0; len >= 16; i += 16, len -= 16) {
+		hex_encode_le32(digits, buf + i, 4);
+		for (j = 0, p = line; j < 4; j++) {
+			memcpy(p, digits + 8 * j, 8);
+			p += 8;
+			*p++ = ' ';
+		}
+		p[-1] = '\n';
+		*p++ = ' ';
+		*p++ = ' ';
+
+		off[0] = i + 16;
+		off[1] = (i + 16) >> 8;
+		off[2] = (i + 16) >> 16;
+		off[3] = (i + 16) >> 24;
+		p = hex_encode_le32(p, off, 1);
+		*p++ = ':';
+		*p++ = ' ';
+		*p = '\0';
+		trace_seq_puts(s, line);
+	}
+
+	for (p = line; len >= 4; i += 4, len -= 4) {
+		p = hex_encode_le32(p, buf + i, 1);
+		*p++ = ' ';
+	}
+	*p = '\0';
+	trace_seq_puts(s, line);
+}
+
+__attribute__((destructor))
+static void ns_exit(void)
+{
+	unregister_ns_dec_tab();
+}
@@ -0,0 +1,490 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ras-page-isolation.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+
+#define PAGE_OFFLINE_FILE	RASSTATEDIR "/offlined-pages"
+#define SOFT_OFFLINE_PAGE	"/sys/devices/system/memory/soft_offline_page"
+#define HARD_OFFLINE_PAGE	"/sys/devices/system/memory/hard_offline_page"
+
+#define PAGE_CE_THRESHOLD	50
+#define PAGE_CE_WINDOW		(24 * 60 * 60)
+#define PAGE_CE_MAX_PAGES	65536
+
+enum page_action {
+	PAGE_ACTION_OFF,
+	PAGE_ACTION_ACCOUNT,
+	PAGE_ACTION_SOFT,
+	PAGE_ACTION_HARD,
+	PAGE_ACTION_SOFT_THEN_HARD,
+	NUM_PAGE_ACTIONS
+};
+
+static const char *page_actions[] = {
+	[PAGE_ACTION_OFF]		= "off",
+	[PAGE_ACTION_ACCOUNT]		= "account",
+	[PAGE_ACTION_SOFT]		= "soft",
+	[PAGE_ACTION_HARD]		= "hard",
+	[PAGE_ACTION_SOFT_THEN_HARD]	= "soft-then-hard",
+};
+
+/*
+ * Each page has a leaky bucket: errors fill it, and it drains at
+ * threshold / window errors per second. A page is taken offline when
+ * its bucket gets full.
+ */
+struct page_entry {
+	uint64_t	pfn;
+	double		level;		/* Errors in the bucket */
+	double		last;		/* When the level was updated */
+	uint32_t	prev, next;	/* LRU list, most recent first */
+};
+
+#define NIL	UINT32_MAX
+
+/*
+ * The pages are kept at a fixed size array, indexed by an open addressing
+ * hash table of array index + 1. Once the array is full, the least
+ * recently hit page is dropped.
+ */
+struct ras_page_tracker {
+	pthread_mutex_t		lock;
+	enum page_action	action;
+	unsigned		threshold;
+	unsigned long		window;
+	double			rate;
+	unsigned		page_shift;
+
+	struct page_entry	*pages;
+	uint32_t		npages, max_pages;
+	uint32_t		*slots;
+	uint32_t		nslots;
+	uint32_t		lru_head, lru_tail;
+	unsigned long long	evicted;
+
+	/* Pages already offline, sorted */
+	uint64_t		*offline;
+	size_t			noffline, offline_size;
+};
+
+static double now_secs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static uint32_t pfn_hash(uint64_t pfn)
+{
+	pfn *= 0x9e3779b97f4a7c15ULL;
+	return pfn >> 32;
+}
+
+/* Slot with the page, or the empty slot where it should go */
+static uint32_t slot_find(struct ras_page_tracker *pt, uint64_t pfn)
+{
+	uint32_t mask = pt->nslots - 1;
+	uint32_t i = pfn_hash(pfn) & mask;
+
+	while (pt->slots[i] && pt->pages[pt->slots[i] - 1].pfn != pfn)
+		i = (i + 1) & mask;
+
+	return i;
+}
+
+/* Removes a slot, moving back the entries that probed past it */
+static void slot_delete(struct ras_page_tracker *pt, uint32_t i)
+{
+	uint32_t mask = pt->nslots - 1;
+	uint32_t j = i, home;
+
+	for (;;) {
+		j = (j + 1) & mask;
+		if (!pt->slots[j])
+			break;
+		home = pfn_hash(pt->pages[pt->slots[j] - 1].pfn) & mask;
+		/* Keep it if its home is cyclically within (i, j] */
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+		pt->slots[i] = pt->slots[j];
+		i = j;
+	}
+	pt->slots[i] = 0;
+}
+
+static void lru_unlink(struct ras_page_tracker *pt, uint32_t idx)
+{
+	struct page_entry *e = &pt->pages[idx];
+
+	if (e->prev != NIL)
+		pt->pages[e->prev].next = e->next;
+	else
+		pt->lru_head = e->next;
+	if (e->next != NIL)
+		pt->pages[e->next].prev = e->prev;
+	else
+		pt->lru_tail = e->prev;
+}
+
+static void lru_push(struct ras_page_tracker *pt, uint32_t idx)
+{
+	struct page_entry *e = &pt->pages[idx];
+
+	e->prev = NIL;
+	e->next = pt->lru_head;
+	if (pt->lru_head != NIL)
+		pt->pages[pt->lru_head].prev = idx;
+	else
+		pt->lru_tail = idx;
+	pt->lru_head = idx;
+}
+
+/* Drops a page, moving the last one of the array into its place */
+static void page_remove(struct ras_page_tracker *pt, uint32_t idx)
+{
+	uint32_t last = pt->npages - 1;
+	struct page_entry *e;
+
+	slot_delete(pt, slot_find(pt, pt->pages[idx].pfn));
+	lru_unlink(pt, idx);
+
+	if (idx != last) {
+		e = &pt->pages[idx];
+		*e = pt->pages[last];
+		pt->slots[slot_find(pt, e->pfn)] = idx + 1;
+		if (e->prev != NIL)
+			pt->pages[e->prev].next = idx;
+		else
+			pt->lru_head = idx;
+		if (e->next != NIL)
+			pt->pages[e->next].prev = idx;
+		else
+			pt->lru_tail = idx;
+	}
+	pt->npages--;
+}
+
+static struct page_entry *page_get(struct ras_page_tracker *pt, uint64_t pfn,
+				   double now)
+{
+	struct page_entry *e;
+	uint32_t i, idx;
+
+	i = slot_find(pt, pfn);
+	if (pt->slots[i]) {
+		idx = pt->slots[i] - 1;
+		if (pt->lru_head != idx) {
+			lru_unlink(pt, idx);
+			lru_push(pt, idx);
+		}
+		return &pt->pages[idx];
+	}
+
+	if (pt->npages == pt->max_pages) {
+		page_remove(pt, pt->lru_tail);
+		pt->evicted++;
+		i = slot_find(pt, pfn);
+	}
+
+	idx = pt->npages++;
+	e = &pt->pages[idx];
+	e->pfn = pfn;
+	e->level = 0;
+	e->last = now;
+	pt->slots[i] = idx + 1;
+	lru_push(pt, idx);
+
+	return e;
+}
+
+static int cmp_pfn(const void *a, const void *b)
+{
+	const uint64_t *x = a, *y = b;
+
+	return *x < *y ? -1 : *x > *y;
+}
+
+static int is_offline(struct ras_page_tracker *pt, uint64_t pfn)
+{
+	return pt->noffline &&
+	       bsearch(&pfn, pt->offline, pt->noffline, sizeof(pfn),
+		       cmp_pfn) != NULL;
+}
+
+static void add_offline(struct ras_page_tracker *pt, uint64_t pfn)
+{
+	uint64_t *p;
+	size_t i;
+
+	if (pt->noffline == pt->offline_size) {
+		p = realloc(pt->offline, (pt->offline_size * 2 + 16) *
+					 sizeof(*p));
+		if (!p)
+			return;
+		pt->offline = p;
+		pt->offline_size = pt->offline_size * 2 + 16;
+	}
+
+	for (i = pt->noffline; i && pt->offline[i - 1] > pfn; i--)
+		pt->offline[i] = pt->offline[i - 1];
+	pt->offline[i] = pfn;
+	pt->noffline++;
+}
+
+static int write_sysfs(const char *file, unsigned long long addr)
+{
+	char buf[32];
+	int fd, n, rc = 0;
+
+	fd = open(file, O_WRONLY);
+	if (fd < 0)
+		return -errno;
+
+	n = snprintf(buf, sizeof(buf), "%#llx", addr);
+	if (write(fd, buf, n) < 0)
+		rc = -errno;
+	close(fd);
+
+	return rc;
+}
+
+/* Returns the method used, or NULL */
+static const char *page_offline(enum page_action action,
+				unsigned long long addr, int *err)
+{
+	*err = 0;
+
+	if (action == PAGE_ACTION_SOFT || action == PAGE_ACTION_SOFT_THEN_HARD) {
+		*err = write_sysfs(SOFT_OFFLINE_PAGE, addr);
+		if (!*err)
+			return "soft";
+		if (action == PAGE_ACTION_SOFT)
+			return NULL;
+	}
+
+	*err = write_sysfs(HARD_OFFLINE_PAGE, addr);
+	return *err ? NULL : "hard";
+}
+
+static void page_persist(unsigned long long addr, const char *method)
+{
+	char buf[64];
+	int fd, n;
+
+	fd = open(PAGE_OFFLINE_FILE, O_WRONLY | O_APPEND | O_CREAT, 0600);
+	if (fd < 0) {
+		log(ALL, LOG_WARNING, "Can't open %s: %s\n",
+		    PAGE_OFFLINE_FILE, strerror(errno));
+		return;
+	}
+
+	n = snprintf(buf, sizeof(buf), "%#llx %s\n", addr, method);
+	if (write(fd, buf, n) != n || fdatasync(fd) < 0)
+		log(ALL, LOG_WARNING, "Can't write %s: %s\n",
+		    PAGE_OFFLINE_FILE, strerror(errno));
+	close(fd);
+}
+
+/* Takes again offline the pages offlined before the last boot */
+static void page_reapply(struct ras_page_tracker *pt)
+{
+	unsigned long long addr;
+	char method[16];
+	unsigned n = 0, failed = 0;
+	FILE *fp;
+	int err;
+
+	fp = fopen(PAGE_OFFLINE_FILE, "r");
+	if (!fp)
+		return;
+
+	while (fscanf(fp, "%llx %15s", &addr, method) == 2) {
+		if (is_offline(pt, addr >> pt->page_shift))
+			continue;
+		n++;
+
+		/*
+		 * Only pages that are really offline now are skipped by the
+		 * tracker. The others keep being counted, and get another
+		 * chance once they exceed the threshold again.
+		 */
+		if (pt->action == PAGE_ACTION_ACCOUNT)
+			continue;
+		if (!page_offline(strcmp(method, "hard") ? PAGE_ACTION_SOFT :
+							   PAGE_ACTION_HARD,
+				  addr, &err)) {
+			log(SYSLOG, LOG_WARNING,
+			    "Can't take page 0x%llx offline again: %s\n",
+			    addr, strerror(-err));
+			failed++;
+			continue;
+		}
+		add_offline(pt, addr >> pt->page_shift);
+	}
+	fclose(fp);
+
+	if (n)
+		log(SYSLOG, LOG_INFO, "%u pages were offlined before, %u of them failed now\n",
+		    n, failed);
+}
+
+struct ras_page_tracker *ras_page_init(void)
+{
+	struct ras_page_tracker *pt;
+	const char *action = getenv("RAS_PAGE_CE_ACTION");
+	unsigned i;
+	long page_size;
+
+	pt = calloc(1, sizeof(*pt));
+	if (!pt)
+		return NULL;
+
+	pt->action = PAGE_ACTION_SOFT;
+	if (action && *action) {
+		for (i = 0; i < NUM_PAGE_ACTIONS; i++)
+			if (!strcmp(action, page_actions[i]))
+				break;
+		if (i < NUM_PAGE_ACTIONS)
+			pt->action = i;
+		else
+			log(ALL, LOG_WARNING,
+			    "Invalid value '%s' for RAS_PAGE_CE_ACTION. Using %s\n",
+			    action, page_actions[pt->action]);
+	}
+
+	pt->threshold = ras_env_ulong("RAS_PAGE_CE_THRESHOLD",
+				      PAGE_CE_THRESHOLD);
+	pt->window = ras_env_ulong("RAS_PAGE_CE_WINDOW", PAGE_CE_WINDOW);
+	pt->max_pages = ras_env_ulong("RAS_PAGE_CE_MAX_PAGES",
+				      PAGE_CE_MAX_PAGES);
+	if (pt->action == PAGE_ACTION_OFF || !pt->threshold ||
+	    !pt->window || !pt->max_pages || pt->max_pages > (1U << 30)) {
+		free(pt);
+		return NULL;
+	}
+	pt->rate = (double)pt->threshold / pt->window;
+
+	page_size = sysconf(_SC_PAGESIZE);
+	pt->page_shift = __builtin_ctzl(page_size > 0 ? page_size : 4096);
+
+	/* Keep the hash table at most half full */
+	for (pt->nslots = 2; pt->nslots < 2 * pt->max_pages; pt->nslots *= 2)
+		;
+	pt->pages = calloc(pt->max_pages, sizeof(*pt->pages));
+	pt->slots = calloc(pt->nslots, sizeof(*pt->slots));
+	if (!pt->pages || !pt->slots) {
+		log(ALL, LOG_ERR, "Can't allocate the page error tracker\n");
+		ras_page_free(pt);
+		return NULL;
+	}
+	pt->lru_head = pt->lru_tail = NIL;
+	pthread_mutex_init(&pt->lock, NULL);
+
+	page_reapply(pt);
+
+	log(ALL, LOG_INFO,
+	    "Page isolation: %s at %u corrected errors in %lu seconds, tracking up to %u pages\n",
+	    page_actions[pt->action], pt->threshold, pt->window,
+	    pt->max_pages);
+
+	return pt;
+}
+
+void ras_page_free(struct ras_page_tracker *pt)
+{
+	if (!pt)
+		return;
+
+	if (pt->evicted)
+		log(SYSLOG, LOG_INFO, "Page isolation: %llu pages dropped from the tracker\n",
+		    pt->evicted);
+	free(pt->pages);
+	free(pt->slots);
+	free(pt->offline);
+	free(pt);
+}
+
+void ras_record_page_error(struct ras_events *ras, unsigned long long addr,
+			   unsigned grain_bits, unsigned count)
+{
+	struct ras_page_tracker *pt = ras->pages;
+	unsigned long long page;
+	struct page_entry *e;
+	const char *method;
+	double now, level;
+	uint64_t pfn;
+	int err;
+
+	/* Errors that can't be pinned to a single page aren't counted */
+	if (!pt || !count || grain_bits > pt->page_shift)
+		return;
+
+	pfn = addr >> pt->page_shift;
+	page = (unsigned long long)pfn << pt->page_shift;
+	now = now_secs();
+
+	pthread_mutex_lock(&pt->lock);
+
+	if (is_offline(pt, pfn))
+		goto out;
+
+	e = page_get(pt, pfn, now);
+	level = e->level - (now - e->last) * pt->rate;
+	e->level = (level > 0 ? level : 0) + count;
+	e->last = now;
+	if (e->level < pt->threshold)
+		goto out;
+
+	log(SYSLOG, LOG_WARNING,
+	    "Page 0x%llx exceeded %u corrected errors in %lu seconds\n",
+	    page, pt->threshold, pt->window);
+
+	if (pt->action == PAGE_ACTION_ACCOUNT) {
+		e->level = 0;
+		goto out;
+	}
+
+	method = page_offline(pt->action, page, &err);
+	if (!method) {
+		log(SYSLOG, LOG_ERR, "Can't take page 0x%llx offline: %s\n",
+		    page, strerror(-err));
+		e->level = 0;
+		goto out;
+	}
+
+	log(SYSLOG, LOG_WARNING, "Page 0x%llx taken offline (%s)\n",
+	    page, method);
+	page_remove(pt, e - pt->pages);
+	add_offline(pt, pfn);
+	page_persist(page, method);
+
+out:
+	pthread_mutex_unlock(&pt->lock);
+}
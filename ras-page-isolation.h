@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_PAGE_ISOLATION_H
+#define __RAS_PAGE_ISOLATION_H
+
+#include "ras-events.h"
+
+/*
+ * Predictive page isolation: corrected memory errors are counted per
+ * page frame, and pages getting too many of them are taken offline
+ * before an uncorrected error hits them.
+ */
+
+struct ras_page_tracker;
+
+#ifdef HAVE_MEMORY_CE_PFA
+
+struct ras_page_tracker *ras_page_init(void);
+void ras_page_free(struct ras_page_tracker *pt);
+
+/*
+ * Accounts count corrected errors at a physical address. grain_bits is
+ * the number of address bits that aren't known.
+ */
+void ras_record_page_error(struct ras_events *ras, unsigned long long addr,
+			   unsigned grain_bits, unsigned count);
+
+#else
+
+static inline struct ras_page_tracker *ras_page_init(void) { return NULL; }
+static inline void ras_page_free(struct ras_page_tracker *pt) { }
+static inline void ras_record_page_error(struct ras_events *ras,
+					 unsigned long long addr,
+					 unsigned grain_bits,
+					 unsigned count) { }
+
+#endif
+
+#endif
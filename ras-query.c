@@ -0,0 +1,785 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sqlite3.h>
+#include "ras-events.h"
+#include "ras-query.h"
+#include "ras-mce-handler.h"
+#include "ras-cper.h"
+#include "ras-hex.h"
+#include "ras-logger.h"
+#include "strbuf.h"
+
+#define SUM_BUCKETS	256
+#define SUM_RECENT	64	/* Incidents recently seen */
+#define QUERY_PAGE	256	/* Errors read at once */
+
+enum sum_table {
+	SUM_MC,
+	SUM_AER,
+	SUM_EXTLOG,
+	SUM_MCE,
+	NUM_SUM_TABLES
+};
+
+/* A summary line: the number of events with the same values */
+struct sum_group {
+	struct sum_group	*next;
+	enum sum_table		table;
+	char			*str[2];	/* NULL, as at the database */
+	long long		num[4];
+	unsigned long long	count;
+};
+
+struct ras_summary {
+	struct sum_group	*groups[SUM_BUCKETS];
+	unsigned		ngroups[NUM_SUM_TABLES];
+
+	/*
+	 * Memory errors, counting once the reports of an incident, the
+	 * incidents reported by more than one source, with their reports,
+	 * and the last incidents with their report count
+	 */
+	unsigned long long	errors, incidents, reports;
+	struct {
+		uint64_t	id;
+		unsigned	n;
+	}			recent[SUM_RECENT];
+	unsigned		nrecent, head;
+};
+
+/*
+ * Columns are the two strings, the four numbers and the count. The
+ * order is the one ras-mc-ctl used.
+ */
+static const char *sum_queries[NUM_SUM_TABLES] = {
+	[SUM_MC] = "SELECT err_type, label, mc, top_layer, middle_layer, lower_layer, COUNT(*) FROM mc_event GROUP BY err_type, label, mc, top_layer, middle_layer, lower_layer",
+	[SUM_AER] = "SELECT err_type, err_msg, 0, 0, 0, 0, COUNT(*) FROM aer_event GROUP BY err_type, err_msg",
+	[SUM_EXTLOG] = "SELECT NULL, NULL, etype, severity, 0, 0, COUNT(*) FROM extlog_event GROUP BY etype, severity",
+	[SUM_MCE] = "SELECT error_msg, NULL, 0, 0, 0, 0, COUNT(*) FROM mce_record GROUP BY error_msg",
+};
+
+/* The tables with memory errors, and which of their rows are */
+static const struct {
+	const char	*name, *mem;
+} incident_tables[] = {
+	{ "mc_event",		"1" },
+	/* Memory controller errors: 0000 0000 1MMM CCCC */
+	{ "mce_record",		"(status & 65408) = 128" },
+	{ "extlog_event",	"1" },
+};
+
+static uint32_t fnv(uint32_t h, const void *data, size_t len)
+{
+	const unsigned char *p = data;
+
+	while (len--)
+		h = (h ^ *p++) * 16777619;
+
+	return h;
+}
+
+static unsigned group_hash(enum sum_table table, const char *s0,
+			   const char *s1, const long long *num)
+{
+	uint32_t h = 2166136261u;
+
+	h = fnv(h, &table, sizeof(table));
+	if (s0)
+		h = fnv(h, s0, strlen(s0) + 1);
+	if (s1)
+		h = fnv(h, s1, strlen(s1) + 1);
+	h = fnv(h, num, 4 * sizeof(*num));
+
+	return h % SUM_BUCKETS;
+}
+
+static int str_eq(const char *a, const char *b)
+{
+	return a == b || (a && b && !strcmp(a, b));
+}
+
+static int sum_add(struct ras_summary *sum, enum sum_table table,
+		   const char *s0, const char *s1, const long long *num,
+		   unsigned long long count)
+{
+	unsigned h = group_hash(table, s0, s1, num);
+	struct sum_group *g;
+
+	for (g = sum->groups[h]; g; g = g->next) {
+		if (g->table == table && str_eq(g->str[0], s0) &&
+		    str_eq(g->str[1], s1) &&
+		    !memcmp(g->num, num, sizeof(g->num))) {
+			g->count += count;
+			return 0;
+		}
+	}
+
+	g = calloc(1, sizeof(*g));
+	if (!g)
+		return -ENOMEM;
+	if ((s0 && !(g->str[0] = strdup(s0))) ||
+	    (s1 && !(g->str[1] = strdup(s1)))) {
+		free(g->str[0]);
+		free(g);
+		return -ENOMEM;
+	}
+	g->table = table;
+	memcpy(g->num, num, sizeof(g->num));
+	g->count = count;
+
+	g->next = sum->groups[h];
+	sum->groups[h] = g;
+	sum->ngroups[table]++;
+
+	return 0;
+}
+
+static void sum_recent(struct ras_summary *sum, uint64_t id, unsigned n)
+{
+	sum->recent[sum->head].id = id;
+	sum->recent[sum->head].n = n;
+	sum->head = (sum->head + 1) % SUM_RECENT;
+	if (sum->nrecent < SUM_RECENT)
+		sum->nrecent++;
+}
+
+/*
+ * Counts a memory error report. The reports of an incident come close in
+ * time, so the last ones suffice. Without an incident, the address isn't
+ * known, so it can't be told whether other reports are the same error.
+ */
+static void sum_incident(struct ras_summary *sum, uint64_t id)
+{
+	unsigned i;
+
+	if (!id) {
+		sum->errors++;
+		return;
+	}
+
+	for (i = 0; i < sum->nrecent; i++) {
+		if (sum->recent[i].id != id)
+			continue;
+		/* The second report makes it a correlated incident */
+		if (sum->recent[i].n++ == 1) {
+			sum->incidents++;
+			sum->reports++;
+		}
+		sum->reports++;
+		return;
+	}
+
+	sum->errors++;
+	sum_recent(sum, id, 1);
+}
+
+void ras_summary_free(struct ras_summary *sum)
+{
+	struct sum_group *g, *next;
+	unsigned i;
+
+	if (!sum)
+		return;
+
+	for (i = 0; i < SUM_BUCKETS; i++) {
+		for (g = sum->groups[i]; g; g = next) {
+			next = g->next;
+			free(g->str[0]);
+			free(g->str[1]);
+			free(g);
+		}
+	}
+	free(sum);
+}
+
+/*
+ * Counts a stored event, and its incident if it's a memory error. Without
+ * memory, it stops counting, and the next summary reads the database again.
+ */
+static void sum_count(struct sqlite3_priv *priv, enum sum_table table,
+		      const char *s0, const char *s1, const long long *num,
+		      int mem, uint64_t incident)
+{
+	if (!priv->summary)
+		return;
+
+	if (sum_add(priv->summary, table, s0, s1, num, 1)) {
+		ras_summary_free(priv->summary);
+		priv->summary = NULL;
+		return;
+	}
+	if (mem)
+		sum_incident(priv->summary, incident);
+}
+
+void ras_summary_mc(struct sqlite3_priv *priv, const struct ras_mc_event *ev)
+{
+	long long num[4] = { ev->mc_index, ev->top_layer, ev->middle_layer,
+			     ev->lower_layer };
+
+	sum_count(priv, SUM_MC, ev->error_type, ev->label, num, 1,
+		  ev->incident);
+}
+
+void ras_summary_aer(struct sqlite3_priv *priv,
+		     const struct ras_aer_event *ev)
+{
+	long long num[4] = { 0 };
+
+	sum_count(priv, SUM_AER, ev->error_type, ev->msg, num, 0, 0);
+}
+
+void ras_summary_extlog(struct sqlite3_priv *priv,
+			const struct ras_extlog_event *ev)
+{
+	long long num[4] = { ev->etype, ev->severity };
+
+	sum_count(priv, SUM_EXTLOG, NULL, NULL, num, 1, ev->incident);
+}
+
+void ras_summary_mce(struct sqlite3_priv *priv, const struct mce_event *ev)
+{
+	long long num[4] = { 0 };
+
+	sum_count(priv, SUM_MCE, MCE_TEXT(ev, error_msg), NULL, num,
+		  (ev->status & 0xff80) == 0x0080, ev->incident);
+}
+
+static int sum_load_incidents(sqlite3 *db, struct ras_summary *sum)
+{
+	char query[1024], loose[512], probe[64], *tables;
+	struct strbuf sb, lb;
+	sqlite3_stmt *stmt;
+	unsigned i;
+	int rc;
+
+	/*
+	 * Only the tables at this database, with incidents, and the count
+	 * of their memory errors without one
+	 */
+	STRBUF_INIT(&sb, query);
+	STRBUF_INIT(&lb, loose);
+	for (i = 0; i < ARRAY_SIZE(incident_tables); i++) {
+		snprintf(probe, sizeof(probe), "SELECT incident FROM %s",
+			 incident_tables[i].name);
+		if (sqlite3_prepare_v2(db, probe, -1, &stmt, NULL) != SQLITE_OK)
+			continue;
+		sqlite3_finalize(stmt);
+		strbuf_printf(&sb, "%sSELECT incident FROM %s WHERE incident",
+			      sb.len ? " UNION ALL " : "",
+			      incident_tables[i].name);
+		strbuf_printf(&lb, " + (SELECT COUNT(*) FROM %s WHERE NOT IFNULL(incident, 0) AND %s)",
+			      incident_tables[i].name, incident_tables[i].mem);
+	}
+	if (!sb.len)
+		return 0;
+	tables = strdup(query);
+	if (!tables)
+		return -ENOMEM;
+
+	snprintf(query, sizeof(query),
+		 "SELECT (SELECT COUNT(DISTINCT incident) FROM (%s))%s",
+		 tables, loose);
+	rc = sqlite3_prepare_v2(db, query, -1, &stmt, NULL);
+	if (rc == SQLITE_OK) {
+		if (sqlite3_step(stmt) == SQLITE_ROW)
+			sum->errors = sqlite3_column_int64(stmt, 0);
+		sqlite3_finalize(stmt);
+	}
+
+	snprintf(query, sizeof(query),
+		 "SELECT COUNT(*), SUM(n) FROM (SELECT COUNT(*) AS n FROM (%s) GROUP BY incident HAVING n > 1)",
+		 tables);
+	rc = sqlite3_prepare_v2(db, query, -1, &stmt, NULL);
+	if (rc == SQLITE_OK) {
+		if (sqlite3_step(stmt) == SQLITE_ROW) {
+			sum->incidents = sqlite3_column_int64(stmt, 0);
+			sum->reports = sqlite3_column_int64(stmt, 1);
+		}
+		sqlite3_finalize(stmt);
+	}
+
+	/* Ids grow with time, so these are the last ones */
+	snprintf(query, sizeof(query),
+		 "SELECT incident, COUNT(*) FROM (%s) GROUP BY incident ORDER BY incident DESC LIMIT %d",
+		 tables, SUM_RECENT);
+	rc = sqlite3_prepare_v2(db, query, -1, &stmt, NULL);
+	if (rc == SQLITE_OK) {
+		while (sqlite3_step(stmt) == SQLITE_ROW)
+			sum_recent(sum, sqlite3_column_int64(stmt, 0),
+				   sqlite3_column_int(stmt, 1));
+		sqlite3_finalize(stmt);
+	}
+	free(tables);
+
+	return 0;
+}
+
+struct ras_summary *ras_summary_load(sqlite3 *db)
+{
+	struct ras_summary *sum;
+	sqlite3_stmt *stmt;
+	long long num[4];
+	unsigned t, i;
+	int rc;
+
+	sum = calloc(1, sizeof(*sum));
+	if (!sum)
+		return NULL;
+
+	for (t = 0; t < NUM_SUM_TABLES; t++) {
+		/* Not at this database */
+		if (sqlite3_prepare_v2(db, sum_queries[t], -1, &stmt, NULL) !=
+		    SQLITE_OK)
+			continue;
+
+		while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+			for (i = 0; i < 4; i++)
+				num[i] = sqlite3_column_int64(stmt, 2 + i);
+			if (sum_add(sum, t,
+				    (const char *)sqlite3_column_text(stmt, 0),
+				    (const char *)sqlite3_column_text(stmt, 1),
+				    num, sqlite3_column_int64(stmt, 6))) {
+				rc = SQLITE_NOMEM;
+				break;
+			}
+		}
+		sqlite3_finalize(stmt);
+		if (rc != SQLITE_DONE)
+			goto err;
+	}
+
+	if (sum_load_incidents(db, sum))
+		goto err;
+
+	return sum;
+
+err:
+	log(ALL, LOG_ERR, "Can't read the errors summary: error = %d\n", rc);
+	ras_summary_free(sum);
+	return NULL;
+}
+
+/* NULLs first, like the database */
+static int str_cmp(const char *a, const char *b)
+{
+	if (!a || !b)
+		return !!a - !!b;
+	return strcmp(a, b);
+}
+
+static int group_cmp(const void *pa, const void *pb)
+{
+	const struct sum_group *a = *(const struct sum_group **)pa;
+	const struct sum_group *b = *(const struct sum_group **)pb;
+	int i, rc;
+
+	for (i = 0; i < 2; i++) {
+		rc = str_cmp(a->str[i], b->str[i]);
+		if (rc)
+			return rc;
+	}
+	for (i = 0; i < 4; i++)
+		if (a->num[i] != b->num[i])
+			return a->num[i] < b->num[i] ? -1 : 1;
+
+	return 0;
+}
+
+#define S(s)	((s) ? (s) : "")
+
+static void sum_print_group(FILE *f, const struct sum_group *g)
+{
+	switch (g->table) {
+	case SUM_MC:
+		fprintf(f, "\t%s on DIMM Label(s): '%s' location: %lld:%lld:%lld:%lld errors: %llu\n",
+			S(g->str[0]), S(g->str[1]), g->num[0], g->num[1],
+			g->num[2], g->num[3], g->count);
+		break;
+	case SUM_AER:
+		fprintf(f, "\t%llu %s errors: %s\n", g->count, S(g->str[0]),
+			S(g->str[1]));
+		break;
+	case SUM_EXTLOG:
+		fprintf(f, "\t%llu %s %s errors\n", g->count,
+			err_type(g->num[0]), err_severity(g->num[1]));
+		break;
+	case SUM_MCE:
+		fprintf(f, "\t%llu %s errors\n", g->count, S(g->str[0]));
+		break;
+	default:
+		break;
+	}
+}
+
+static const struct {
+	const char	*title, *none, *end;
+} sum_titles[NUM_SUM_TABLES] = {
+	[SUM_MC]	= { "Memory controller events summary",
+			    "No Memory errors.\n\n", "\n" },
+	[SUM_AER]	= { "PCIe AER events summary",
+			    "No PCIe AER errors.\n\n", "\n" },
+	[SUM_EXTLOG]	= { "Extlog records summary",
+			    "No Extlog errors.\n", "" },
+	[SUM_MCE]	= { "MCE records summary",
+			    "No MCE errors.\n", "" },
+};
+
+static int sum_print(struct ras_summary *sum, FILE *f)
+{
+	struct sum_group **groups, *g;
+	unsigned t, i, n;
+
+	for (t = 0; t < NUM_SUM_TABLES; t++) {
+		if (!sum->ngroups[t]) {
+			fputs(sum_titles[t].none, f);
+			continue;
+		}
+
+		groups = calloc(sum->ngroups[t], sizeof(*groups));
+		if (!groups)
+			return -ENOMEM;
+		for (i = n = 0; i < SUM_BUCKETS; i++)
+			for (g = sum->groups[i]; g; g = g->next)
+				if (g->table == t)
+					groups[n++] = g;
+		qsort(groups, n, sizeof(*groups), group_cmp);
+
+		fprintf(f, "%s:\n", sum_titles[t].title);
+		for (i = 0; i < n; i++)
+			sum_print_group(f, groups[i]);
+		fputs(sum_titles[t].end, f);
+		free(groups);
+	}
+
+	if (sum->errors)
+		fprintf(f, "\nDistinct memory errors: %llu\n",
+			sum->errors);
+	if (sum->incidents)
+		fprintf(f, "Memory errors reported by more than one source: %llu, from %llu reports\n",
+			sum->incidents, sum->reports);
+
+	return 0;
+}
+
+int ras_query_summary(struct ras_events *ras, int argc, char *argv[],
+		      FILE *out)
+{
+	struct sqlite3_priv *priv = ras->db_priv;
+	struct ras_summary *sum;
+	const char *path;
+	char *buf = NULL;
+	sqlite3 *db = NULL;
+	size_t size;
+	FILE *f;
+	int rc = -EAGAIN;
+
+	if (!priv)
+		return -EOPNOTSUPP;
+
+	f = open_memstream(&buf, &size);
+	if (!f)
+		return -ENOMEM;
+
+	pthread_mutex_lock(&priv->lock);
+	if (priv->summary)
+		rc = sum_print(priv->summary, f);
+	path = sqlite3_db_filename(priv->db, "main");
+	pthread_mutex_unlock(&priv->lock);
+
+	/*
+	 * Without the counts, lost when out of memory, the database is
+	 * read by its own connection, so the events are still stored
+	 * meanwhile. It doesn't see the batched events not committed yet.
+	 */
+	if (rc == -EAGAIN) {
+		rc = -EIO;
+		if (path && *path &&
+		    sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) ==
+		    SQLITE_OK) {
+			sqlite3_busy_timeout(db, 1000);
+			sum = ras_summary_load(db);
+			if (sum)
+				rc = sum_print(sum, f);
+			ras_summary_free(sum);
+		}
+		sqlite3_close(db);
+	}
+
+	fclose(f);
+	if (!rc)
+		fwrite(buf, 1, size, out);
+	free(buf);
+
+	return rc;
+}
+
+/*
+ * Error listings
+ */
+static const char *col_str(sqlite3_stmt *stmt, int col)
+{
+	return S((const char *)sqlite3_column_text(stmt, col));
+}
+
+static void print_mc(FILE *f, sqlite3_stmt *stmt)
+{
+	fprintf(f, "%lld %s %d %s error(s): %s at %s location: %d:%d:%d:%d, addr %lld, grain %lld, syndrome %lld %s\n",
+		sqlite3_column_int64(stmt, 0), col_str(stmt, 1),
+		sqlite3_column_int(stmt, 2), col_str(stmt, 3),
+		col_str(stmt, 4), col_str(stmt, 5),
+		sqlite3_column_int(stmt, 6), sqlite3_column_int(stmt, 7),
+		sqlite3_column_int(stmt, 8), sqlite3_column_int(stmt, 9),
+		sqlite3_column_int64(stmt, 10), sqlite3_column_int64(stmt, 11),
+		sqlite3_column_int64(stmt, 12), col_str(stmt, 13));
+}
+
+static void print_aer(FILE *f, sqlite3_stmt *stmt)
+{
+	fprintf(f, "%lld %s %s error: %s\n", sqlite3_column_int64(stmt, 0),
+		col_str(stmt, 1), col_str(stmt, 2), col_str(stmt, 3));
+}
+
+static void print_extlog(FILE *f, sqlite3_stmt *stmt)
+{
+	unsigned char fru_id[16] = { 0 };
+	char uuid[UUID_STR_SIZE], buf[512];
+	struct strbuf cper;
+	int len;
+
+	len = sqlite3_column_bytes(stmt, 5);
+	if (len > sizeof(fru_id))
+		len = sizeof(fru_id);
+	if (len > 0)
+		memcpy(fru_id, sqlite3_column_blob(stmt, 5), len);
+
+	STRBUF_INIT(&cper, buf);
+	len = sqlite3_column_bytes(stmt, 7);
+	if (len > 0)
+		ras_cper_mem_fields(&cper, sqlite3_column_blob(stmt, 7), len);
+
+	fprintf(f, "%lld %s error: type=%s, severity=%s, address=0x%08llx, fru_id=%s, fru_text='%s', %s\n",
+		sqlite3_column_int64(stmt, 0), col_str(stmt, 1),
+		err_type(sqlite3_column_int(stmt, 2)),
+		err_severity(sqlite3_column_int(stmt, 3)),
+		(unsigned long long)sqlite3_column_int64(stmt, 4),
+		uuid_le_str(uuid, fru_id), col_str(stmt, 6), buf);
+}
+
+static void print_mce(FILE *f, sqlite3_stmt *stmt)
+{
+	static const struct {
+		const char	*name;
+		int		col;
+	} hex[] = {
+		{ "mcgcap", 2 }, { "mcgstatus", 3 }, { "status", 4 },
+		{ "addr", 5 }, { "misc", 6 }, { "ip", 7 }, { "tsc", 8 },
+		{ "walltime", 9 }, { "cpu", 10 }, { "cpuid", 11 },
+		{ "apicid", 12 }, { "socketid", 13 }, { "cs", 14 },
+		{ "bank", 15 },
+	};
+	unsigned long long val;
+	unsigned i;
+
+	fprintf(f, "%lld %s error: %s", sqlite3_column_int64(stmt, 0),
+		col_str(stmt, 1), col_str(stmt, 18));
+	if (sqlite3_column_int(stmt, 16))
+		fprintf(f, ", CPU %d", sqlite3_column_int(stmt, 16));
+	if (*col_str(stmt, 17))
+		fprintf(f, ", bank %s", col_str(stmt, 17));
+	if (*col_str(stmt, 19))
+		fprintf(f, ", mcg %s", col_str(stmt, 19));
+	if (*col_str(stmt, 20))
+		fprintf(f, ", mci %s", col_str(stmt, 20));
+	if (*col_str(stmt, 22))
+		fprintf(f, ", %s", col_str(stmt, 22));
+	if (*col_str(stmt, 21))
+		fprintf(f, ", %s", col_str(stmt, 21));
+	for (i = 0; i < ARRAY_SIZE(hex); i++) {
+		val = sqlite3_column_int64(stmt, hex[i].col);
+		if (val)
+			fprintf(f, ", %s=0x%08llx", hex[i].name, val);
+	}
+	fputc('\n', f);
+}
+
+static const struct err_table {
+	const char	*name;
+	const char	*title, *none;
+	const char	*query;
+	void		(*print)(FILE *f, sqlite3_stmt *stmt);
+} err_tables[] = {
+	{ "mc", "Memory controller events", "No Memory errors.",
+	  "SELECT id, timestamp, err_count, err_type, err_msg, label, mc, top_layer, middle_layer, lower_layer, address, grain, syndrome, driver_detail FROM mc_event",
+	  print_mc },
+	{ "aer", "PCIe AER events", "No PCIe AER errors.",
+	  "SELECT id, timestamp, err_type, err_msg FROM aer_event",
+	  print_aer },
+	{ "extlog", "Extlog events", "No Extlog errors.",
+	  "SELECT id, timestamp, etype, severity, address, fru_id, fru_text, cper_data FROM extlog_event",
+	  print_extlog },
+	{ "mce", "MCE events", "No MCE errors.",
+	  "SELECT id, timestamp, mcgcap, mcgstatus, status, addr, misc, ip, tsc, walltime, cpu, cpuid, apicid, socketid, cs, bank, cpuvendor, bank_name, error_msg, mcgstatus_msg, mcistatus_msg, user_action, mc_location FROM mce_record",
+	  print_mce },
+};
+
+/*
+ * Reads up to n errors after the id into f, setting more if there are
+ * others after them. Returns how many were read, or a negative errno.
+ */
+static int read_page(struct sqlite3_priv *priv, const struct err_table *t,
+		     long long *after, unsigned n, int *more, FILE *f)
+{
+	char query[512];
+	sqlite3_stmt *stmt;
+	int rc, rows = 0;
+
+	snprintf(query, sizeof(query), "%s WHERE id > ?1 ORDER BY id LIMIT ?2",
+		 t->query);
+
+	pthread_mutex_lock(&priv->lock);
+	rc = sqlite3_prepare_v2(priv->db, query, -1, &stmt, NULL);
+	if (rc != SQLITE_OK) {
+		/* Not at this database */
+		pthread_mutex_unlock(&priv->lock);
+		return 0;
+	}
+
+	sqlite3_bind_int64(stmt, 1, *after);
+	sqlite3_bind_int(stmt, 2, n + 1);
+	while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+		if (rows == n) {
+			*more = 1;
+			break;
+		}
+		*after = sqlite3_column_int64(stmt, 0);
+		t->print(f, stmt);
+		rows++;
+	}
+	if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+		log(ALL, LOG_ERR, "Can't read %s errors: error = %d\n",
+		    t->name, rc);
+		rows = -EIO;
+	}
+	sqlite3_finalize(stmt);
+	pthread_mutex_unlock(&priv->lock);
+
+	return rows;
+}
+
+/*
+ * Sends the errors, a page at a time, so the database is only locked
+ * while reading them.
+ */
+static int list_errors(struct sqlite3_priv *priv, const struct err_table *t,
+		       long long after, unsigned long limit, int titles,
+		       FILE *out)
+{
+	unsigned long total = 0;
+	int rows, more = 1;
+	char *buf = NULL;
+	size_t size;
+	unsigned n;
+	FILE *f;
+
+	while (more && (!limit || total < limit)) {
+		n = QUERY_PAGE;
+		if (limit && limit - total < n)
+			n = limit - total;
+
+		f = open_memstream(&buf, &size);
+		if (!f)
+			return -ENOMEM;
+		more = 0;
+		rows = read_page(priv, t, &after, n, &more, f);
+		fclose(f);
+		if (rows < 0) {
+			free(buf);
+			return rows;
+		}
+
+		if (titles && rows && !total)
+			fprintf(out, "%s:\n", t->title);
+		fwrite(buf, 1, size, out);
+		free(buf);
+		total += rows;
+
+		/* The client went away */
+		if (ferror(out))
+			return -EPIPE;
+	}
+
+	if (titles && total)
+		fprintf(out, "\n");
+	else if (titles)
+		fprintf(out, "%s\n\n", t->none);
+	else if (more)
+		fprintf(out, "next %lld\n", after);
+
+	return 0;
+}
+
+int ras_query_errors(struct ras_events *ras, int argc, char *argv[],
+		     FILE *out)
+{
+	struct sqlite3_priv *priv = ras->db_priv;
+	const struct err_table *t = NULL;
+	unsigned long limit = 0;
+	long long after = 0;
+	char *end;
+	int i, rc;
+
+	if (!priv)
+		return -EOPNOTSUPP;
+
+	/* All the errors */
+	if (argc < 2) {
+		for (i = 0; i < ARRAY_SIZE(err_tables); i++) {
+			rc = list_errors(priv, &err_tables[i], 0, 0, 1, out);
+			if (rc < 0)
+				return rc;
+		}
+		return 0;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(err_tables); i++)
+		if (!strcmp(argv[1], err_tables[i].name))
+			t = &err_tables[i];
+	if (!t)
+		return -EINVAL;
+
+	for (i = 2; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "after"))
+			after = strtoll(argv[i + 1], &end, 0);
+		else if (!strcmp(argv[i], "limit"))
+			limit = strtoul(argv[i + 1], &end, 0);
+		else
+			return -EINVAL;
+		if (*end)
+			return -EINVAL;
+	}
+	if (i < argc)
+		return -EINVAL;
+
+	return list_errors(priv, t, after, limit, 0, out);
+}
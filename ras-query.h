@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_QUERY_H
+#define __RAS_QUERY_H
+
+#include <errno.h>
+#include <stdio.h>
+#include "config.h"
+#include "ras-record.h"
+
+/*
+ * Queries of the recorded events, answered by the daemon through the
+ * control socket, with the same output as ras-mc-ctl:
+ *
+ *	summary
+ *	errors [mc|aer|extlog|mce [after <id>] [limit <n>]]
+ *
+ * The summary comes from counts kept in memory, read from the database
+ * when it's opened and updated as events are stored. Errors are read
+ * in pages, by id, so the database isn't locked while sending them. A
+ * listing of a single table with a limit ends with "next <id>", when
+ * there are more errors after it.
+ */
+struct ras_summary;
+
+#ifdef HAVE_SQLITE3
+
+/* Reads the counts of the events at the database */
+struct ras_summary *ras_summary_load(sqlite3 *db);
+void ras_summary_free(struct ras_summary *sum);
+
+/* Count a stored event. Called with the database lock held */
+void ras_summary_mc(struct sqlite3_priv *priv, const struct ras_mc_event *ev);
+void ras_summary_aer(struct sqlite3_priv *priv,
+		     const struct ras_aer_event *ev);
+void ras_summary_extlog(struct sqlite3_priv *priv,
+			const struct ras_extlog_event *ev);
+void ras_summary_mce(struct sqlite3_priv *priv, const struct mce_event *ev);
+
+int ras_query_summary(struct ras_events *ras, int argc, char *argv[],
+		      FILE *out);
+int ras_query_errors(struct ras_events *ras, int argc, char *argv[],
+		     FILE *out);
+
+#else
+
+static inline int ras_query_summary(struct ras_events *ras, int argc,
+				    char *argv[], FILE *out)
+{
+	return -EOPNOTSUPP;
+}
+
+static inline int ras_query_errors(struct ras_events *ras, int argc,
+				   char *argv[], FILE *out)
+{
+	return -EOPNOTSUPP;
+}
+
+#endif
+
+#endif
@@ -30,11 +30,20 @@
 #include "ras-aer-handler.h"
 #include "ras-mce-handler.h"
 #include "ras-logger.h"
+#include "ras-config.h"
+#include "ras-spool.h"
+#include "ras-decode.h"
+#include "ras-query.h"
 
 /* #define DEBUG_SQL 1 */
 
 #define SQLITE_RAS_DB RASSTATEDIR "/" RAS_DB_FNAME
 
+/* Defaults for the batched lane, and how often to log lane statistics */
+#define DB_BATCH_SIZE	64
+#define DB_BATCH_MS	1000
+#define DB_STATS_TIME	3600
+
 
 #define ARRAY_SIZE(x) (sizeof(x)/sizeof(*(x)))
 
@@ -49,6 +58,186 @@ struct db_table_descriptor {
 	size_t			num_fields;
 };
 
+/*
+ * Storage lanes. Callers hold priv->lock from ras_db_begin() up to
+ * ras_db_end().
+ */
+
+static unsigned long long db_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void db_account(struct sqlite3_priv *priv, enum ras_db_lane lane,
+		       unsigned long long events,
+		       unsigned long long total_ns, unsigned long long max_ns)
+{
+	struct ras_db_lane_stats *st = &priv->lane[lane];
+
+	st->events += events;
+	st->total_ns += total_ns;
+	if (max_ns > st->max_ns)
+		st->max_ns = max_ns;
+}
+
+static void db_log_stats(struct sqlite3_priv *priv)
+{
+	static const char *lane_name[] = {
+		[RAS_DB_EXPRESS] = "express",
+		[RAS_DB_BATCH] = "batched",
+	};
+	struct ras_db_lane_stats *st;
+	int i;
+
+	for (i = 0; i < RAS_DB_NUM_LANES; i++) {
+		st = &priv->lane[i];
+		if (!st->events)
+			continue;
+		log(SYSLOG, LOG_INFO,
+		    "%s events: %llu stored, commit latency avg %llu us, max %llu us\n",
+		    lane_name[i], st->events,
+		    st->total_ns / st->events / 1000, st->max_ns / 1000);
+	}
+}
+
+static void db_commit(struct sqlite3_priv *priv)
+{
+	unsigned long long now;
+	int rc;
+
+	if (!priv->batch_pending)
+		return;
+
+	rc = sqlite3_exec(priv->db, "COMMIT", NULL, NULL, NULL);
+	if (rc != SQLITE_OK)
+		log(TERM, LOG_ERR,
+		    "Failed to commit events on sqlite: error = %d\n", rc);
+
+	now = db_now();
+	db_account(priv, RAS_DB_BATCH, priv->batch_pending,
+		   priv->batch_pending * now - priv->batch_sum,
+		   now - priv->batch_start);
+	priv->batch_pending = 0;
+	priv->batch_sum = 0;
+}
+
+static unsigned long long ras_db_begin(struct sqlite3_priv *priv,
+				       enum ras_db_lane lane)
+{
+	unsigned long long start;
+	int rc;
+
+	/* Decode workers store each stream events in order */
+	ras_decode_ordered();
+
+	pthread_mutex_lock(&priv->lock);
+	start = db_now();
+
+	if (lane != RAS_DB_BATCH || priv->batch_size <= 1 ||
+	    priv->batch_pending)
+		return start;
+
+	rc = sqlite3_exec(priv->db, "BEGIN", NULL, NULL, NULL);
+	if (rc != SQLITE_OK) {
+		log(TERM, LOG_ERR,
+		    "Failed to start a transaction on sqlite: error = %d\n", rc);
+		return start;
+	}
+	priv->batch_start = start;
+
+	return start;
+}
+
+static void ras_db_end(struct sqlite3_priv *priv, enum ras_db_lane lane,
+		       unsigned long long start)
+{
+	unsigned long long now;
+
+	if (lane == RAS_DB_BATCH && sqlite3_get_autocommit(priv->db) == 0) {
+		priv->batch_pending++;
+		priv->batch_sum += start;
+
+		if (priv->batch_pending >= priv->batch_size ||
+		    db_now() - priv->batch_start >= priv->batch_ms * 1000000ULL)
+			db_commit(priv);
+
+		pthread_mutex_unlock(&priv->lock);
+		return;
+	}
+
+	/* Flush any batched events too, as they come before this one */
+	if (sqlite3_get_autocommit(priv->db) == 0)
+		db_commit(priv);
+
+	now = db_now();
+	db_account(priv, lane, 1, now - start, now - start);
+
+	if (priv->spool_seq) {
+		ras_spool_ack(priv->spool, priv->spool_seq);
+		priv->spool_seq = 0;
+	}
+
+	pthread_mutex_unlock(&priv->lock);
+}
+
+/* MC, AER and non-standard events have their severity as a string */
+static enum ras_db_lane severity_lane(const char *severity)
+{
+	if (!severity || !strcmp(severity, "Corrected") ||
+	    !strcmp(severity, "Info") || !strcmp(severity, "Informational"))
+		return RAS_DB_BATCH;
+
+	return RAS_DB_EXPRESS;
+}
+
+/*
+ * Commits the batched events, if they're waiting for too long. Returns
+ * the time, in ms, for the next call, or -1 if there's nothing to wait.
+ */
+int ras_db_flush(struct ras_events *ras)
+{
+	struct sqlite3_priv *priv = ras->db_priv;
+	unsigned long long elapsed;
+	time_t now = time(NULL);
+	int timeout = -1;
+
+	if (!priv)
+		return -1;
+
+	pthread_mutex_lock(&priv->lock);
+	if (priv->batch_pending) {
+		elapsed = (db_now() - priv->batch_start) / 1000000;
+		if (elapsed >= priv->batch_ms)
+			db_commit(priv);
+		else
+			timeout = priv->batch_ms - elapsed;
+	}
+
+	if (now - priv->stats_logged >= DB_STATS_TIME) {
+		db_log_stats(priv);
+		priv->stats_logged = now;
+	}
+	pthread_mutex_unlock(&priv->lock);
+
+	return timeout;
+}
+
+/*
+ * Every memory error report with an address has an incident, even if no
+ * other source reports it. Reports without one can't be correlated.
+ */
+static void bind_incident(sqlite3_stmt *stmt, int col,
+			  unsigned long long incident)
+{
+	if (incident)
+		sqlite3_bind_int64(stmt, col, incident);
+	else
+		sqlite3_bind_null(stmt, col);
+}
+
 /*
  * Table and functions to handle ras:mc_event
  */
@@ -68,6 +257,7 @@ static const struct db_fields mc_event_fields[] = {
 		{ .name="grain",		.type="INTEGER" },
 		{ .name="syndrome",		.type="INTEGER" },
 		{ .name="driver_detail",	.type="TEXT" },
+		{ .name="incident",		.type="INTEGER" },
 };
 
 static const struct db_table_descriptor mc_event_tab = {
@@ -80,11 +270,18 @@ int ras_store_mc_event(struct ras_events *ras, struct ras_mc_event *ev)
 {
 	int rc;
 	struct sqlite3_priv *priv = ras->db_priv;
+	enum ras_db_lane lane;
+	unsigned long long start;
 
 	if (!priv || !priv->stmt_mc_event)
 		return 0;
 	log(TERM, LOG_INFO, "mc_event store: %p\n", priv->stmt_mc_event);
 
+	lane = severity_lane(ev->error_type);
+	start = ras_db_begin(priv, lane);
+	if (lane == RAS_DB_EXPRESS)
+		priv->spool_seq = ras_spool_write(priv->spool, RAS_SPOOL_MC_EVENT, ev);
+
 	sqlite3_bind_text(priv->stmt_mc_event,  1, ev->timestamp, -1, NULL);
 	sqlite3_bind_int (priv->stmt_mc_event,  2, ev->error_count);
 	sqlite3_bind_text(priv->stmt_mc_event,  3, ev->error_type, -1, NULL);
@@ -98,10 +295,13 @@ int ras_store_mc_event(struct ras_events *ras, struct ras_mc_event *ev)
 	sqlite3_bind_int (priv->stmt_mc_event, 11, ev->grain);
 	sqlite3_bind_int (priv->stmt_mc_event, 12, ev->syndrome);
 	sqlite3_bind_text(priv->stmt_mc_event, 13, ev->driver_detail, -1, NULL);
+	bind_incident(priv->stmt_mc_event, 14, ev->incident);
 	rc = sqlite3_step(priv->stmt_mc_event);
 	if (rc != SQLITE_OK && rc != SQLITE_DONE)
 		log(TERM, LOG_ERR,
 		    "Failed to do mc_event step on sqlite: error = %d\n", rc);
+	else
+		ras_summary_mc(priv, ev);
 	rc = sqlite3_reset(priv->stmt_mc_event);
 	if (rc != SQLITE_OK && rc != SQLITE_DONE)
 		log(TERM, LOG_ERR,
@@ -109,6 +309,8 @@ int ras_store_mc_event(struct ras_events *ras, struct ras_mc_event *ev)
 		    rc);
 	log(TERM, LOG_INFO, "register inserted at db\n");
 
+	ras_db_end(priv, lane, start);
+
 	return rc;
 }
 
@@ -122,6 +324,7 @@ static const struct db_fields aer_event_fields[] = {
 		{ .name="timestamp",		.type="TEXT" },
 		{ .name="err_type",		.type="TEXT" },
 		{ .name="err_msg",		.type="TEXT" },
+		{ .name="dev_name",		.type="TEXT" },
 };
 
 static const struct db_table_descriptor aer_event_tab = {
@@ -134,19 +337,29 @@ int ras_store_aer_event(struct ras_events *ras, struct ras_aer_event *ev)
 {
 	int rc;
 	struct sqlite3_priv *priv = ras->db_priv;
+	enum ras_db_lane lane;
+	unsigned long long start;
 
 	if (!priv || !priv->stmt_aer_event)
 		return 0;
 	log(TERM, LOG_INFO, "aer_event store: %p\n", priv->stmt_aer_event);
 
+	lane = severity_lane(ev->error_type);
+	start = ras_db_begin(priv, lane);
+	if (lane == RAS_DB_EXPRESS)
+		priv->spool_seq = ras_spool_write(priv->spool, RAS_SPOOL_AER_EVENT, ev);
+
 	sqlite3_bind_text(priv->stmt_aer_event,  1, ev->timestamp, -1, NULL);
 	sqlite3_bind_text(priv->stmt_aer_event,  2, ev->error_type, -1, NULL);
 	sqlite3_bind_text(priv->stmt_aer_event,  3, ev->msg, -1, NULL);
+	sqlite3_bind_text(priv->stmt_aer_event,  4, ev->dev_name, -1, NULL);
 
 	rc = sqlite3_step(priv->stmt_aer_event);
 	if (rc != SQLITE_OK && rc != SQLITE_DONE)
 		log(TERM, LOG_ERR,
 		    "Failed to do aer_event step on sqlite: error = %d\n", rc);
+	else
+		ras_summary_aer(priv, ev);
 	rc = sqlite3_reset(priv->stmt_aer_event);
 	if (rc != SQLITE_OK && rc != SQLITE_DONE)
 		log(TERM, LOG_ERR,
@@ -154,6 +367,8 @@ int ras_store_aer_event(struct ras_events *ras, struct ras_aer_event *ev)
 		    rc);
 	log(TERM, LOG_INFO, "register inserted at db\n");
 
+	ras_db_end(priv, lane, start);
+
 	return rc;
 }
 #endif
@@ -183,11 +398,18 @@ int ras_store_non_standard_record(struct ras_events *ras, struct ras_non_standar
 {
 	int rc;
 	struct sqlite3_priv *priv = ras->db_priv;
+	enum ras_db_lane lane;
+	unsigned long long start;
 
 	if (!priv || !priv->stmt_non_standard_record)
 		return 0;
 	log(TERM, LOG_INFO, "non_standard_event store: %p\n", priv->stmt_non_standard_record);
 
+	lane = severity_lane(ev->severity);
+	start = ras_db_begin(priv, lane);
+	if (lane == RAS_DB_EXPRESS)
+		priv->spool_seq = ras_spool_write(priv->spool, RAS_SPOOL_NON_STANDARD_RECORD, ev);
+
 	sqlite3_bind_text (priv->stmt_non_standard_record,  1, ev->timestamp, -1, NULL);
 	sqlite3_bind_blob (priv->stmt_non_standard_record,  2, ev->sec_type, -1, NULL);
 	sqlite3_bind_blob (priv->stmt_non_standard_record,  3, ev->fru_id, 16, NULL);
@@ -205,6 +427,8 @@ int ras_store_non_standard_record(struct ras_events *ras, struct ras_non_standar
 		    "Failed reset non_standard_event on sqlite: error = %d\n", rc);
 	log(TERM, LOG_INFO, "register inserted at db\n");
 
+	ras_db_end(priv, lane, start);
+
 	return rc;
 }
 #endif
@@ -234,11 +458,19 @@ int ras_store_arm_record(struct ras_events *ras, struct ras_arm_event *ev)
 {
 	int rc;
 	struct sqlite3_priv *priv = ras->db_priv;
+	enum ras_db_lane lane;
+	unsigned long long start;
 
 	if (!priv || !priv->stmt_arm_record)
 		return 0;
 	log(TERM, LOG_INFO, "arm_event store: %p\n", priv->stmt_arm_record);
 
+	/* There's no severity on ARM processor events */
+	lane = RAS_DB_EXPRESS;
+	start = ras_db_begin(priv, lane);
+	if (lane == RAS_DB_EXPRESS)
+		priv->spool_seq = ras_spool_write(priv->spool, RAS_SPOOL_ARM_RECORD, ev);
+
 	sqlite3_bind_text (priv->stmt_arm_record,  1,  ev->timestamp, -1, NULL);
 	sqlite3_bind_int  (priv->stmt_arm_record,  2,  ev->error_count);
 	sqlite3_bind_int  (priv->stmt_arm_record,  3,  ev->affinity);
@@ -257,6 +489,8 @@ int ras_store_arm_record(struct ras_events *ras, struct ras_arm_event *ev)
 		    rc);
 	log(TERM, LOG_INFO, "register inserted at db\n");
 
+	ras_db_end(priv, lane, start);
+
 	return rc;
 }
 #endif
@@ -272,6 +506,8 @@ static const struct db_fields extlog_event_fields[] = {
 		{ .name="fru_id",		.type="BLOB" },
 		{ .name="fru_text",		.type="TEXT" },
 		{ .name="cper_data",		.type="BLOB" },
+		{ .name="label",		.type="TEXT" },
+		{ .name="incident",		.type="INTEGER" },
 };
 
 static const struct db_table_descriptor extlog_event_tab = {
@@ -284,11 +520,20 @@ int ras_store_extlog_mem_record(struct ras_events *ras, struct ras_extlog_event
 {
 	int rc;
 	struct sqlite3_priv *priv = ras->db_priv;
+	enum ras_db_lane lane;
+	unsigned long long start;
 
 	if (!priv || !priv->stmt_extlog_record)
 		return 0;
 	log(TERM, LOG_INFO, "extlog_record store: %p\n", priv->stmt_extlog_record);
 
+	/* CPER severity: 2 is corrected, 3 informational */
+	lane = (ev->severity == 2 || ev->severity == 3) ?
+	       RAS_DB_BATCH : RAS_DB_EXPRESS;
+	start = ras_db_begin(priv, lane);
+	if (lane == RAS_DB_EXPRESS)
+		priv->spool_seq = ras_spool_write(priv->spool, RAS_SPOOL_EXTLOG_RECORD, ev);
+
 	sqlite3_bind_text  (priv->stmt_extlog_record,  1, ev->timestamp, -1, NULL);
 	sqlite3_bind_int   (priv->stmt_extlog_record,  2, ev->etype);
 	sqlite3_bind_int   (priv->stmt_extlog_record,  3, ev->error_seq);
@@ -297,11 +542,15 @@ int ras_store_extlog_mem_record(struct ras_events *ras, struct ras_extlog_event
 	sqlite3_bind_blob  (priv->stmt_extlog_record,  6, ev->fru_id, 16, NULL);
 	sqlite3_bind_text  (priv->stmt_extlog_record,  7, ev->fru_text, -1, NULL);
 	sqlite3_bind_blob  (priv->stmt_extlog_record,  8, ev->cper_data, ev->cper_data_length, NULL);
+	sqlite3_bind_text  (priv->stmt_extlog_record,  9, ev->label, -1, NULL);
+	bind_incident(priv->stmt_extlog_record, 10, ev->incident);
 
 	rc = sqlite3_step(priv->stmt_extlog_record);
 	if (rc != SQLITE_OK && rc != SQLITE_DONE)
 		log(TERM, LOG_ERR,
 		    "Failed to do extlog_mem_record step on sqlite: error = %d\n", rc);
+	else
+		ras_summary_extlog(priv, ev);
 	rc = sqlite3_reset(priv->stmt_extlog_record);
 	if (rc != SQLITE_OK && rc != SQLITE_DONE)
 		log(TERM, LOG_ERR,
@@ -309,6 +558,8 @@ int ras_store_extlog_mem_record(struct ras_events *ras, struct ras_extlog_event
 		    rc);
 	log(TERM, LOG_INFO, "register inserted at db\n");
 
+	ras_db_end(priv, lane, start);
+
 	return rc;
 }
 #endif
@@ -347,6 +598,8 @@ static const struct db_fields mce_record_fields[] = {
 		{ .name="mcastatus_msg",	.type="TEXT" },
 		{ .name="user_action",		.type="TEXT" },
 		{ .name="mc_location",		.type="TEXT" },
+		{ .name="label",		.type="TEXT" },
+		{ .name="incident",		.type="INTEGER" },
 };
 
 static const struct db_table_descriptor mce_record_tab = {
@@ -359,12 +612,20 @@ int ras_store_mce_record(struct ras_events *ras, struct mce_event *ev)
 {
 	int rc;
 	struct sqlite3_priv *priv = ras->db_priv;
+	enum ras_db_lane lane;
+	unsigned long long start;
 
 	if (!priv || !priv->stmt_mce_record)
 		return 0;
 	log(TERM, LOG_INFO, "mce_record store: %p\n", priv->stmt_mce_record);
 
-	sqlite3_bind_text  (priv->stmt_mce_record,  1, ev->timestamp, -1, NULL);
+	lane = (ev->status & (MCI_STATUS_UC | MCI_STATUS_PCC)) ?
+	       RAS_DB_EXPRESS : RAS_DB_BATCH;
+	start = ras_db_begin(priv, lane);
+	if (lane == RAS_DB_EXPRESS)
+		priv->spool_seq = ras_spool_write(priv->spool, RAS_SPOOL_MCE_RECORD, ev);
+
+	sqlite3_bind_text  (priv->stmt_mce_record,  1, MCE_TEXT(ev, timestamp), ev->timestamp.len, NULL);
 	sqlite3_bind_int   (priv->stmt_mce_record,  2, ev->mcgcap);
 	sqlite3_bind_int   (priv->stmt_mce_record,  3, ev->mcgstatus);
 	sqlite3_bind_int64 (priv->stmt_mce_record,  4, ev->status);
@@ -381,18 +642,22 @@ int ras_store_mce_record(struct ras_events *ras, struct mce_event *ev)
 	sqlite3_bind_int   (priv->stmt_mce_record, 15, ev->bank);
 	sqlite3_bind_int   (priv->stmt_mce_record, 16, ev->cpuvendor);
 
-	sqlite3_bind_text(priv->stmt_mce_record, 17, ev->bank_name, -1, NULL);
-	sqlite3_bind_text(priv->stmt_mce_record, 18, ev->error_msg, -1, NULL);
-	sqlite3_bind_text(priv->stmt_mce_record, 19, ev->mcgstatus_msg, -1, NULL);
-	sqlite3_bind_text(priv->stmt_mce_record, 20, ev->mcistatus_msg, -1, NULL);
-	sqlite3_bind_text(priv->stmt_mce_record, 21, ev->mcastatus_msg, -1, NULL);
-	sqlite3_bind_text(priv->stmt_mce_record, 22, ev->user_action, -1, NULL);
-	sqlite3_bind_text(priv->stmt_mce_record, 23, ev->mc_location, -1, NULL);
+	sqlite3_bind_text(priv->stmt_mce_record, 17, MCE_TEXT(ev, bank_name), ev->bank_name.len, NULL);
+	sqlite3_bind_text(priv->stmt_mce_record, 18, MCE_TEXT(ev, error_msg), ev->error_msg.len, NULL);
+	sqlite3_bind_text(priv->stmt_mce_record, 19, MCE_TEXT(ev, mcgstatus_msg), ev->mcgstatus_msg.len, NULL);
+	sqlite3_bind_text(priv->stmt_mce_record, 20, MCE_TEXT(ev, mcistatus_msg), ev->mcistatus_msg.len, NULL);
+	sqlite3_bind_text(priv->stmt_mce_record, 21, MCE_TEXT(ev, mcastatus_msg), ev->mcastatus_msg.len, NULL);
+	sqlite3_bind_text(priv->stmt_mce_record, 22, MCE_TEXT(ev, user_action), ev->user_action.len, NULL);
+	sqlite3_bind_text(priv->stmt_mce_record, 23, MCE_TEXT(ev, mc_location), ev->mc_location.len, NULL);
+	sqlite3_bind_text(priv->stmt_mce_record, 24, ev->label, -1, NULL);
+	bind_incident(priv->stmt_mce_record, 25, ev->incident);
 
 	rc = sqlite3_step(priv->stmt_mce_record);
 	if (rc != SQLITE_OK && rc != SQLITE_DONE)
 		log(TERM, LOG_ERR,
 		    "Failed to do mce_record step on sqlite: error = %d\n", rc);
+	else
+		ras_summary_mce(priv, ev);
 	rc = sqlite3_reset(priv->stmt_mce_record);
 	if (rc != SQLITE_OK && rc != SQLITE_DONE)
 		log(TERM, LOG_ERR,
@@ -400,10 +665,63 @@ int ras_store_mce_record(struct ras_events *ras, struct mce_event *ev)
 		    rc);
 	log(TERM, LOG_INFO, "register inserted at db\n");
 
+	ras_db_end(priv, lane, start);
+
 	return rc;
 }
 #endif
 
+/*
+ * Table and functions to handle the memory error hot spots snapshots
+ */
+
+static const struct db_fields hot_spot_fields[] = {
+		{ .name="id",			.type="INTEGER PRIMARY KEY" },
+		{ .name="timestamp",		.type="TEXT" },
+		{ .name="kind",			.type="TEXT" },
+		{ .name="rank",			.type="INTEGER" },
+		{ .name="location",		.type="TEXT" },
+		{ .name="errors",		.type="INTEGER" },
+};
+
+static const struct db_table_descriptor hot_spot_tab = {
+	.name = "hot_spot",
+	.fields = hot_spot_fields,
+	.num_fields = ARRAY_SIZE(hot_spot_fields),
+};
+
+int ras_store_hot_spot(struct ras_events *ras, struct ras_hot_spot *hs)
+{
+	int rc;
+	struct sqlite3_priv *priv = ras->db_priv;
+	unsigned long long start;
+
+	if (!priv || !priv->stmt_hot_spot)
+		return 0;
+
+	start = ras_db_begin(priv, RAS_DB_BATCH);
+
+	sqlite3_bind_text (priv->stmt_hot_spot,  1, hs->timestamp, -1, NULL);
+	sqlite3_bind_text (priv->stmt_hot_spot,  2, hs->kind, -1, NULL);
+	sqlite3_bind_int  (priv->stmt_hot_spot,  3, hs->rank);
+	sqlite3_bind_text (priv->stmt_hot_spot,  4, hs->location, -1, NULL);
+	sqlite3_bind_int64(priv->stmt_hot_spot,  5, hs->errors);
+
+	rc = sqlite3_step(priv->stmt_hot_spot);
+	if (rc != SQLITE_OK && rc != SQLITE_DONE)
+		log(TERM, LOG_ERR,
+		    "Failed to do hot_spot step on sqlite: error = %d\n", rc);
+	rc = sqlite3_reset(priv->stmt_hot_spot);
+	if (rc != SQLITE_OK && rc != SQLITE_DONE)
+		log(TERM, LOG_ERR,
+		    "Failed reset hot_spot on sqlite: error = %d\n",
+		    rc);
+
+	ras_db_end(priv, RAS_DB_BATCH, start);
+
+	return rc;
+}
+
 
 /*
  * Generic code
@@ -455,6 +773,49 @@ static int ras_mc_prepare_stmt(struct sqlite3_priv *priv,
 	return rc;
 }
 
+/* Adds the columns missing at tables created by older versions */
+static int ras_mc_upgrade_table(struct sqlite3_priv *priv,
+				const struct db_table_descriptor *db_tab)
+{
+	const struct db_fields *field;
+	unsigned long long found = 0;
+	char sql[256];
+	sqlite3_stmt *stmt;
+	const char *name;
+	int i, rc;
+
+	snprintf(sql, sizeof(sql), "PRAGMA table_info(%s)", db_tab->name);
+	rc = sqlite3_prepare_v2(priv->db, sql, -1, &stmt, NULL);
+	if (rc != SQLITE_OK)
+		return rc;
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		name = (const char *)sqlite3_column_text(stmt, 1);
+		for (i = 0; name && i < db_tab->num_fields && i < 64; i++)
+			if (!strcmp(name, db_tab->fields[i].name))
+				found |= 1ULL << i;
+	}
+	sqlite3_finalize(stmt);
+
+	for (i = 0; i < db_tab->num_fields && i < 64; i++) {
+		if (found & (1ULL << i))
+			continue;
+		field = &db_tab->fields[i];
+		snprintf(sql, sizeof(sql), "ALTER TABLE %s ADD COLUMN %s %s",
+			 db_tab->name, field->name, field->type);
+		rc = sqlite3_exec(priv->db, sql, NULL, NULL, NULL);
+		if (rc != SQLITE_OK) {
+			log(TERM, LOG_ERR,
+			    "Failed to add column %s to table %s on %s: error = %d\n",
+			    field->name, db_tab->name, SQLITE_RAS_DB, rc);
+			return rc;
+		}
+		log(TERM, LOG_INFO, "Added column %s to table %s\n",
+		    field->name, db_tab->name);
+	}
+
+	return SQLITE_OK;
+}
+
 static int ras_mc_create_table(struct sqlite3_priv *priv,
 			       const struct db_table_descriptor *db_tab)
 {
@@ -483,10 +844,14 @@ static int ras_mc_create_table(struct sqlite3_priv *priv,
 		log(TERM, LOG_ERR,
 		    "Failed to create table %s on %s: error = %d\n",
 		    db_tab->name, SQLITE_RAS_DB, rc);
+		return rc;
 	}
-	return rc;
+
+	return ras_mc_upgrade_table(priv, db_tab);
 }
 
+static pthread_mutex_t db_lock = PTHREAD_MUTEX_INITIALIZER;
+
 int ras_mc_event_opendb(unsigned cpu, struct ras_events *ras)
 {
 	int rc;
@@ -495,11 +860,18 @@ int ras_mc_event_opendb(unsigned cpu, struct ras_events *ras)
 
 	printf("Calling %s()\n", __FUNCTION__);
 
-	ras->db_priv = NULL;
+	/* On the pthread way, all threads share the same database */
+	pthread_mutex_lock(&db_lock);
+	if (ras->db_priv) {
+		pthread_mutex_unlock(&db_lock);
+		return 0;
+	}
 
 	priv = calloc(1, sizeof(*priv));
-	if (!priv)
+	if (!priv) {
+		pthread_mutex_unlock(&db_lock);
 		return -1;
+	}
 
 	rc = sqlite3_initialize();
 	if (rc != SQLITE_OK) {
@@ -507,6 +879,7 @@ int ras_mc_event_opendb(unsigned cpu, struct ras_events *ras)
 		    "cpu %u: Failed to initialize sqlite: error = %d\n",
 		    cpu, rc);
 		free(priv);
+		pthread_mutex_unlock(&db_lock);
 		return -1;
 	}
 
@@ -524,9 +897,21 @@ int ras_mc_event_opendb(unsigned cpu, struct ras_events *ras)
 		    "cpu %u: Failed to connect to %s: error = %d\n",
 		    cpu, SQLITE_RAS_DB, rc);
 		free(priv);
+		pthread_mutex_unlock(&db_lock);
 		return -1;
 	}
 	priv->db = db;
+	pthread_mutex_init(&priv->lock, NULL);
+
+	/* Make sure each commit reaches the disk */
+	rc = sqlite3_exec(db, "PRAGMA synchronous = FULL", NULL, NULL, NULL);
+	if (rc != SQLITE_OK)
+		log(TERM, LOG_ERR,
+		    "cpu %u: Failed to set synchronous mode: error = %d\n",
+		    cpu, rc);
+
+	priv->batch_size = ras_env_ulong("RAS_DB_BATCH_SIZE", DB_BATCH_SIZE);
+	priv->batch_ms = ras_env_ulong("RAS_DB_BATCH_MS", DB_BATCH_MS);
 
 	rc = ras_mc_create_table(priv, &mc_event_tab);
 	if (rc == SQLITE_OK)
@@ -568,6 +953,71 @@ int ras_mc_event_opendb(unsigned cpu, struct ras_events *ras)
 					&arm_event_tab);
 #endif
 
-		ras->db_priv = priv;
+	rc = ras_mc_create_table(priv, &hot_spot_tab);
+	if (rc == SQLITE_OK)
+		rc = ras_mc_prepare_stmt(priv, &priv->stmt_hot_spot,
+					 &hot_spot_tab);
+
+	/* Before any event is stored, so the summary doesn't wait for it */
+	priv->summary = ras_summary_load(db);
+
+	ras->db_priv = priv;
+
+	/* Store whatever was left at the spool by a crash */
+	priv->spool = ras_spool_open();
+	if (priv->spool) {
+		struct ras_spool *spool = priv->spool;
+
+		priv->spool = NULL;
+		ras_spool_replay(spool, ras);
+		priv->spool = spool;
+	}
+
+	pthread_mutex_unlock(&db_lock);
 	return 0;
 }
+
+int ras_mc_event_closedb(struct ras_events *ras)
+{
+	struct sqlite3_priv *priv = ras->db_priv;
+	int rc;
+
+	if (!priv)
+		return 0;
+
+	pthread_mutex_lock(&priv->lock);
+	db_commit(priv);
+	db_log_stats(priv);
+
+	sqlite3_finalize(priv->stmt_mc_event);
+#ifdef HAVE_AER
+	sqlite3_finalize(priv->stmt_aer_event);
+#endif
+#ifdef HAVE_MCE
+	sqlite3_finalize(priv->stmt_mce_record);
+#endif
+#ifdef HAVE_EXTLOG
+	sqlite3_finalize(priv->stmt_extlog_record);
+#endif
+#ifdef HAVE_NON_STANDARD
+	sqlite3_finalize(priv->stmt_non_standard_record);
+#endif
+#ifdef HAVE_ARM
+	sqlite3_finalize(priv->stmt_arm_record);
+#endif
+	sqlite3_finalize(priv->stmt_hot_spot);
+	ras_summary_free(priv->summary);
+
+	rc = sqlite3_close_v2(priv->db);
+	if (rc != SQLITE_OK)
+		log(TERM, LOG_ERR,
+		    "Failed to close %s: error = %d\n", SQLITE_RAS_DB, rc);
+	pthread_mutex_unlock(&priv->lock);
+
+	pthread_mutex_destroy(&priv->lock);
+	ras_spool_close(priv->spool);
+	ras->db_priv = NULL;
+	free(priv);
+
+	return rc;
+}
@@ -25,7 +25,7 @@
 
 extern long user_hz;
 
-struct ras_events *ras;
+struct ras_events;
 
 struct ras_mc_event {
 	char timestamp[64];
@@ -35,6 +35,7 @@ struct ras_mc_event {
 	signed char top_layer, middle_layer, lower_layer;
 	unsigned long long address, grain, syndrome;
 	const char *driver_detail;
+	unsigned long long incident;
 };
 
 struct ras_aer_event {
@@ -55,6 +56,8 @@ struct ras_extlog_event {
 	const char *fru_text;
 	const char *cper_data;
 	unsigned short cper_data_length;
+	const char *label;
+	unsigned long long incident;
 };
 
 struct ras_non_standard_event {
@@ -75,6 +78,15 @@ struct ras_arm_event {
 	int32_t psci_state;
 };
 
+/* A memory location with many errors, see ras-hitters.c */
+struct ras_hot_spot {
+	char timestamp[64];
+	const char *kind;
+	int rank;
+	const char *location;
+	unsigned long long errors;
+};
+
 struct ras_mc_event;
 struct ras_aer_event;
 struct ras_extlog_event;
@@ -84,10 +96,45 @@ struct mce_event;
 
 #ifdef HAVE_SQLITE3
 
+#include <pthread.h>
+#include <time.h>
 #include <sqlite3.h>
 
+struct ras_spool;
+
+/*
+ * Uncorrected and fatal errors may precede a crash, so they're committed
+ * to disk as soon as they're stored. Everything else is grouped into
+ * transactions of up to RAS_DB_BATCH_SIZE events or RAS_DB_BATCH_MS.
+ */
+enum ras_db_lane {
+	RAS_DB_EXPRESS,
+	RAS_DB_BATCH,
+	RAS_DB_NUM_LANES
+};
+
+/* Time from storing an event up to its commit */
+struct ras_db_lane_stats {
+	unsigned long long	events;
+	unsigned long long	total_ns, max_ns;
+};
+
 struct sqlite3_priv {
 	sqlite3		*db;
+	pthread_mutex_t	lock;
+
+	/* Batched transaction */
+	unsigned	batch_size, batch_ms;
+	unsigned	batch_pending;
+	unsigned long long batch_start, batch_sum;
+
+	time_t		stats_logged;
+	struct ras_db_lane_stats lane[RAS_DB_NUM_LANES];
+
+	/* Emergency spool for the express lane */
+	struct ras_spool *spool;
+	uint64_t	spool_seq;
+
 	sqlite3_stmt	*stmt_mc_event;
 #ifdef HAVE_AER
 	sqlite3_stmt	*stmt_aer_event;
@@ -104,24 +151,34 @@ struct sqlite3_priv {
 #ifdef HAVE_ARM
 	sqlite3_stmt	*stmt_arm_record;
 #endif
+	sqlite3_stmt	*stmt_hot_spot;
+
+	/* Errors summary, once queried */
+	struct ras_summary *summary;
 };
 
 int ras_mc_event_opendb(unsigned cpu, struct ras_events *ras);
+int ras_mc_event_closedb(struct ras_events *ras);
+int ras_db_flush(struct ras_events *ras);
 int ras_store_mc_event(struct ras_events *ras, struct ras_mc_event *ev);
 int ras_store_aer_event(struct ras_events *ras, struct ras_aer_event *ev);
 int ras_store_mce_record(struct ras_events *ras, struct mce_event *ev);
 int ras_store_extlog_mem_record(struct ras_events *ras, struct ras_extlog_event *ev);
 int ras_store_non_standard_record(struct ras_events *ras, struct ras_non_standard_event *ev);
 int ras_store_arm_record(struct ras_events *ras, struct ras_arm_event *ev);
+int ras_store_hot_spot(struct ras_events *ras, struct ras_hot_spot *hs);
 
 #else
 static inline int ras_mc_event_opendb(unsigned cpu, struct ras_events *ras) { return 0; };
+static inline int ras_mc_event_closedb(struct ras_events *ras) { return 0; };
+static inline int ras_db_flush(struct ras_events *ras) { return -1; };
 static inline int ras_store_mc_event(struct ras_events *ras, struct ras_mc_event *ev) { return 0; };
 static inline int ras_store_aer_event(struct ras_events *ras, struct ras_aer_event *ev) { return 0; };
 static inline int ras_store_mce_record(struct ras_events *ras, struct mce_event *ev) { return 0; };
 static inline int ras_store_extlog_mem_record(struct ras_events *ras, struct ras_extlog_event *ev) { return 0; };
 static inline int ras_store_non_standard_record(struct ras_events *ras, struct ras_non_standard_event *ev) { return 0; };
 static inline int ras_store_arm_record(struct ras_events *ras, struct ras_arm_event *ev) { return 0; };
+static inline int ras_store_hot_spot(struct ras_events *ras, struct ras_hot_spot *hs) { return 0; };
 
 #endif
 
@@ -20,12 +20,16 @@
 #include <sys/un.h>
 
 #include "ras-report.h"
+#include "ras-decode.h"
 
 static int setup_report_socket(void){
 	int sockfd = -1;
 	int rc = -1;
 	struct sockaddr_un addr;
 
+	/* Decode workers report each stream events in order */
+	ras_decode_ordered();
+
 	sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
 	if (sockfd < 0){
 		return -1;
@@ -159,14 +163,14 @@ static int set_mce_event_backtrace(char *buf, struct mce_event *ev){
 						"cs=%d\n"	\
 						"bank=%d\n"	\
 						"cpuvendor=%d\n",	\
-						ev->timestamp,	\
-						ev->bank_name,	\
-						ev->error_msg,	\
-						ev->mcgstatus_msg,	\
-						ev->mcistatus_msg,	\
-						ev->mcastatus_msg,	\
-						ev->user_action,	\
-						ev->mc_location,	\
+						MCE_TEXT(ev, timestamp),	\
+						MCE_TEXT(ev, bank_name),	\
+						MCE_TEXT(ev, error_msg),	\
+						MCE_TEXT(ev, mcgstatus_msg),	\
+						MCE_TEXT(ev, mcistatus_msg),	\
+						MCE_TEXT(ev, mcastatus_msg),	\
+						MCE_TEXT(ev, user_action),	\
+						MCE_TEXT(ev, mc_location),	\
 						ev->mcgcap,	\
 						ev->mcgstatus,	\
 						ev->status,	\
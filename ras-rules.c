@@ -0,0 +1,1419 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "ras-events.h"
+#include "ras-rules.h"
+#include "ras-record.h"
+#include "ras-mce-handler.h"
+#include "ras-cper.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+#include "strbuf.h"
+
+#define RULES_FILE	SYSCONFDIR "/ras/rules.conf"
+#define TAGS_FILE	RASSTATEDIR "/host-tags"
+
+#define RULE_MAX_TOKENS	64
+#define RULE_MAX_CONDS	8
+#define RULE_MAX_COUNT	4096
+#define RULE_MAX_KEYS	1024
+#define RULE_KEY_SLOTS	(2 * RULE_MAX_KEYS)
+#define RULE_KEY_LEN	64
+#define RULE_QUEUE_SIZE	64
+#define RULE_JOBS	4
+#define RULE_TIMEOUT	30
+#define RULE_CPU_RANGES	8
+
+enum field_type {
+	FT_STR,		/* const char * */
+	FT_ARRAY,	/* char [] */
+	FT_MCE_TEXT,	/* struct mce_text, at the mce_event arena */
+	FT_S8,
+	FT_S32,
+	FT_S64,
+	FT_U8,
+	FT_U32,
+	FT_U64,
+};
+
+struct rule_field {
+	const char	*name;
+	enum field_type	type;
+	size_t		off;
+};
+
+#define FIELD(s, f, t)	{ #f, t, offsetof(struct s, f) }
+
+static const struct rule_field mc_fields[] = {
+	FIELD(ras_mc_event, timestamp, FT_ARRAY),
+	FIELD(ras_mc_event, error_count, FT_S32),
+	FIELD(ras_mc_event, error_type, FT_STR),
+	FIELD(ras_mc_event, msg, FT_STR),
+	FIELD(ras_mc_event, label, FT_STR),
+	FIELD(ras_mc_event, mc_index, FT_U8),
+	FIELD(ras_mc_event, top_layer, FT_S8),
+	FIELD(ras_mc_event, middle_layer, FT_S8),
+	FIELD(ras_mc_event, lower_layer, FT_S8),
+	FIELD(ras_mc_event, address, FT_U64),
+	FIELD(ras_mc_event, grain, FT_U64),
+	FIELD(ras_mc_event, syndrome, FT_U64),
+	FIELD(ras_mc_event, driver_detail, FT_STR),
+	FIELD(ras_mc_event, incident, FT_U64),
+	{ NULL }
+};
+
+static const struct rule_field aer_fields[] = {
+	FIELD(ras_aer_event, timestamp, FT_ARRAY),
+	FIELD(ras_aer_event, error_type, FT_STR),
+	FIELD(ras_aer_event, dev_name, FT_STR),
+	FIELD(ras_aer_event, msg, FT_STR),
+	{ NULL }
+};
+
+static const struct rule_field mce_fields[] = {
+	FIELD(mce_event, mcgcap, FT_U64),
+	FIELD(mce_event, mcgstatus, FT_U64),
+	FIELD(mce_event, status, FT_U64),
+	FIELD(mce_event, addr, FT_U64),
+	FIELD(mce_event, misc, FT_U64),
+	FIELD(mce_event, ip, FT_U64),
+	FIELD(mce_event, tsc, FT_U64),
+	FIELD(mce_event, walltime, FT_U64),
+	FIELD(mce_event, cpu, FT_U32),
+	FIELD(mce_event, cpuid, FT_U32),
+	FIELD(mce_event, apicid, FT_U32),
+	FIELD(mce_event, socketid, FT_U32),
+	FIELD(mce_event, cs, FT_U8),
+	FIELD(mce_event, bank, FT_U8),
+	FIELD(mce_event, cpuvendor, FT_U8),
+	FIELD(mce_event, timestamp, FT_MCE_TEXT),
+	FIELD(mce_event, bank_name, FT_MCE_TEXT),
+	FIELD(mce_event, error_msg, FT_MCE_TEXT),
+	FIELD(mce_event, mcgstatus_msg, FT_MCE_TEXT),
+	FIELD(mce_event, mcistatus_msg, FT_MCE_TEXT),
+	FIELD(mce_event, mcastatus_msg, FT_MCE_TEXT),
+	FIELD(mce_event, user_action, FT_MCE_TEXT),
+	FIELD(mce_event, mc_location, FT_MCE_TEXT),
+	FIELD(mce_event, label, FT_STR),
+	FIELD(mce_event, incident, FT_U64),
+	{ NULL }
+};
+
+static const struct rule_field extlog_fields[] = {
+	FIELD(ras_extlog_event, timestamp, FT_ARRAY),
+	FIELD(ras_extlog_event, error_seq, FT_S32),
+	FIELD(ras_extlog_event, etype, FT_S8),
+	FIELD(ras_extlog_event, severity, FT_S8),
+	FIELD(ras_extlog_event, address, FT_U64),
+	FIELD(ras_extlog_event, pa_mask_lsb, FT_S8),
+	FIELD(ras_extlog_event, fru_text, FT_STR),
+	FIELD(ras_extlog_event, label, FT_STR),
+	FIELD(ras_extlog_event, incident, FT_U64),
+	{ NULL }
+};
+
+static const struct rule_field non_standard_fields[] = {
+	FIELD(ras_non_standard_event, timestamp, FT_ARRAY),
+	FIELD(ras_non_standard_event, severity, FT_STR),
+	FIELD(ras_non_standard_event, length, FT_U32),
+	{ NULL }
+};
+
+static const struct rule_field arm_fields[] = {
+	FIELD(ras_arm_event, timestamp, FT_ARRAY),
+	FIELD(ras_arm_event, error_count, FT_S32),
+	FIELD(ras_arm_event, affinity, FT_S8),
+	FIELD(ras_arm_event, mpidr, FT_S64),
+	FIELD(ras_arm_event, midr, FT_S64),
+	FIELD(ras_arm_event, running_state, FT_S32),
+	FIELD(ras_arm_event, psci_state, FT_S32),
+	{ NULL }
+};
+
+static const struct {
+	const char		*name;
+	const struct rule_field	*fields;
+} rule_events[] = {
+	[RAS_RULE_MC]		= { "ras:mc_event", mc_fields },
+	[RAS_RULE_AER]		= { "ras:aer_event", aer_fields },
+	[RAS_RULE_MCE]		= { "mce:mce_record", mce_fields },
+	[RAS_RULE_EXTLOG]	= { "ras:extlog_mem_event", extlog_fields },
+	[RAS_RULE_NON_STANDARD]	= { "ras:non_standard_event",
+				    non_standard_fields },
+	[RAS_RULE_ARM]		= { "ras:arm_event", arm_fields },
+};
+
+enum rule_op {
+	OP_EQ,
+	OP_NE,
+	OP_LT,
+	OP_LE,
+	OP_GT,
+	OP_GE,
+	OP_AND,		/* Numbers: any of the bits set */
+	OP_MATCH,	/* Strings: contains */
+	NUM_OPS
+};
+
+static const char *rule_ops[] = {
+	[OP_EQ]		= "==",
+	[OP_NE]		= "!=",
+	[OP_LT]		= "<",
+	[OP_LE]		= "<=",
+	[OP_GT]		= ">",
+	[OP_GE]		= ">=",
+	[OP_AND]	= "&",
+	[OP_MATCH]	= "~",
+};
+
+struct rule_value {
+	const char		*str;		/* NULL for numbers */
+	int			is_signed;
+	long long		s;
+	unsigned long long	u;
+};
+
+struct rule_cond {
+	const struct rule_field	*field;
+	enum rule_op		op;
+	struct rule_value	val;
+};
+
+/* Time of the last count errors of a key, as a ring */
+struct rule_key {
+	char		key[RULE_KEY_LEN];
+	time_t		*times;		/* NULL for an empty slot */
+	unsigned	head, n;
+};
+
+struct ras_rule {
+	char			*name;
+	enum ras_rule_event	type;
+	struct rule_cond	conds[RULE_MAX_CONDS];
+	unsigned		nconds;
+
+	/* count events within seconds, per field value */
+	unsigned		count;
+	time_t			within;
+	const struct rule_field	*per;
+	pthread_mutex_t		lock;
+	struct rule_key		*keys;
+	unsigned		nkeys;
+	int			full_warned;
+
+	char			*run;
+	char			*tag;
+	struct ras_rule		*next;
+};
+
+struct rule_job {
+	char		*prog;
+	char		*who;		/* Log prefix, like "Rule <name>" */
+	char		**argv;
+	char		**env;
+};
+
+struct ras_rules {
+	struct ras_rule		*rules[RAS_RULE_NUM_EVENTS];
+
+	/* Tags already set */
+	pthread_mutex_t		tag_lock;
+	char			**tags;
+	unsigned		ntags;
+
+	/* Programs to run, and the threads running them */
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	struct rule_job		*queue[RULE_QUEUE_SIZE];
+	unsigned		qhead, qlen;
+	int			stop;
+	pthread_t		*workers;
+	unsigned		nworkers;
+	unsigned long		timeout;
+	unsigned long long	dropped;
+};
+
+static void field_get(const struct rule_field *f, const void *ev,
+		      struct rule_value *v)
+{
+	const char *p = (const char *)ev + f->off;
+
+	v->str = NULL;
+	v->is_signed = 1;
+	switch (f->type) {
+	case FT_STR:
+		v->str = *(const char * const *)p;
+		if (!v->str)
+			v->str = "";
+		break;
+	case FT_ARRAY:
+		v->str = p;
+		break;
+	case FT_MCE_TEXT:
+		v->str = ((const struct mce_event *)ev)->text +
+			 ((const struct mce_text *)p)->off;
+		break;
+	case FT_S8:
+		v->s = *(const int8_t *)p;
+		break;
+	case FT_S32:
+		v->s = *(const int32_t *)p;
+		break;
+	case FT_S64:
+		v->s = *(const int64_t *)p;
+		break;
+	case FT_U8:
+		v->is_signed = 0;
+		v->u = *(const uint8_t *)p;
+		break;
+	case FT_U32:
+		v->is_signed = 0;
+		v->u = *(const uint32_t *)p;
+		break;
+	case FT_U64:
+		v->is_signed = 0;
+		v->u = *(const uint64_t *)p;
+		break;
+	}
+}
+
+static int field_is_str(const struct rule_field *f)
+{
+	return f->type == FT_STR || f->type == FT_ARRAY ||
+	       f->type == FT_MCE_TEXT;
+}
+
+static void field_str(const struct rule_field *f, const void *ev,
+		      char *buf, size_t size)
+{
+	struct rule_value v;
+
+	field_get(f, ev, &v);
+	if (v.str)
+		snprintf(buf, size, "%s", v.str);
+	else if (v.is_signed)
+		snprintf(buf, size, "%lld", v.s);
+	else
+		snprintf(buf, size, "%llu", v.u);
+}
+
+static int cond_match(const struct rule_cond *c, const void *ev)
+{
+	struct rule_value v;
+	int cmp;
+
+	field_get(c->field, ev, &v);
+	if (v.str) {
+		if (c->op == OP_MATCH)
+			return strstr(v.str, c->val.str) != NULL;
+		cmp = strcmp(v.str, c->val.str);
+	} else if (c->op == OP_AND) {
+		return (v.u & c->val.u) != 0;
+	} else if (v.is_signed) {
+		cmp = (v.s > c->val.s) - (v.s < c->val.s);
+	} else {
+		cmp = (v.u > c->val.u) - (v.u < c->val.u);
+	}
+
+	switch (c->op) {
+	case OP_EQ:
+		return cmp == 0;
+	case OP_NE:
+		return cmp != 0;
+	case OP_LT:
+		return cmp < 0;
+	case OP_LE:
+		return cmp <= 0;
+	case OP_GT:
+		return cmp > 0;
+	case OP_GE:
+		return cmp >= 0;
+	default:
+		return 0;
+	}
+}
+
+static time_t now_secs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec;
+}
+
+static uint32_t key_hash(const char *key)
+{
+	uint32_t h = 2166136261U;
+
+	while (*key)
+		h = (h ^ (unsigned char)*key++) * 16777619U;
+	return h;
+}
+
+static struct rule_key *key_slot(struct ras_rule *r, const char *key)
+{
+	uint32_t i = key_hash(key) & (RULE_KEY_SLOTS - 1);
+
+	while (r->keys[i].times && strcmp(r->keys[i].key, key))
+		i = (i + 1) & (RULE_KEY_SLOTS - 1);
+
+	return &r->keys[i];
+}
+
+static int key_expired(struct ras_rule *r, struct rule_key *k, time_t now)
+{
+	return !k->n ||
+	       now - k->times[(k->head + k->n - 1) % r->count] >= r->within;
+}
+
+/* Drops the keys without errors in the window */
+static void key_purge(struct ras_rule *r, time_t now)
+{
+	struct rule_key *old = r->keys, *k;
+	unsigned i;
+
+	r->keys = calloc(RULE_KEY_SLOTS, sizeof(*r->keys));
+	if (!r->keys) {
+		r->keys = old;
+		return;
+	}
+
+	r->nkeys = 0;
+	for (i = 0; i < RULE_KEY_SLOTS; i++) {
+		if (!old[i].times)
+			continue;
+		if (key_expired(r, &old[i], now)) {
+			free(old[i].times);
+			continue;
+		}
+		k = key_slot(r, old[i].key);
+		*k = old[i];
+		r->nkeys++;
+	}
+	free(old);
+}
+
+static struct rule_key *key_get(struct ras_rule *r, const char *key,
+				time_t now)
+{
+	struct rule_key *k = key_slot(r, key);
+
+	if (k->times)
+		return k;
+
+	if (r->nkeys >= RULE_MAX_KEYS) {
+		key_purge(r, now);
+		if (r->nkeys >= RULE_MAX_KEYS) {
+			if (!r->full_warned)
+				log(SYSLOG, LOG_WARNING,
+				    "Rule %s: too many %s values. Not counting new ones\n",
+				    r->name, r->per->name);
+			r->full_warned = 1;
+			return NULL;
+		}
+		k = key_slot(r, key);
+	}
+
+	k->times = calloc(r->count, sizeof(*k->times));
+	if (!k->times)
+		return NULL;
+	snprintf(k->key, sizeof(k->key), "%s", key);
+	k->head = k->n = 0;
+	r->nkeys++;
+
+	return k;
+}
+
+/* Accounts a match, returning if the rule triggers */
+static int rule_count(struct ras_rule *r, const char *key)
+{
+	time_t now = now_secs();
+	struct rule_key *k;
+	int fire = 0;
+
+	pthread_mutex_lock(&r->lock);
+
+	k = key_get(r, key, now);
+	if (!k)
+		goto out;
+
+	if (k->n < r->count) {
+		k->times[(k->head + k->n) % r->count] = now;
+		k->n++;
+	} else {
+		k->times[k->head] = now;
+		k->head = (k->head + 1) % r->count;
+	}
+
+	if (k->n == r->count && now - k->times[k->head] < r->within) {
+		fire = 1;
+		k->head = k->n = 0;
+	}
+out:
+	pthread_mutex_unlock(&r->lock);
+
+	return fire;
+}
+
+static void rule_tag(struct ras_rules *rr, const char *tag)
+{
+	char **tags;
+	unsigned i;
+	int fd;
+
+	pthread_mutex_lock(&rr->tag_lock);
+
+	for (i = 0; i < rr->ntags; i++)
+		if (!strcmp(rr->tags[i], tag))
+			goto out;
+
+	tags = realloc(rr->tags, (rr->ntags + 1) * sizeof(*tags));
+	if (!tags)
+		goto out;
+	rr->tags = tags;
+	rr->tags[rr->ntags] = strdup(tag);
+	if (!rr->tags[rr->ntags])
+		goto out;
+	rr->ntags++;
+
+	log(SYSLOG, LOG_NOTICE, "Host tagged as %s\n", tag);
+
+	fd = open(TAGS_FILE, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+	if (fd < 0) {
+		log(SYSLOG, LOG_ERR, "Can't open %s: %s\n", TAGS_FILE,
+		    strerror(errno));
+		goto out;
+	}
+	if (write(fd, tag, strlen(tag)) < 0 || write(fd, "\n", 1) < 0)
+		log(SYSLOG, LOG_ERR, "Can't write to %s: %s\n", TAGS_FILE,
+		    strerror(errno));
+	close(fd);
+out:
+	pthread_mutex_unlock(&rr->tag_lock);
+}
+
+static void tags_load(struct ras_rules *rr)
+{
+	char line[256], **tags, *p;
+	FILE *fp;
+
+	fp = fopen(TAGS_FILE, "r");
+	if (!fp)
+		return;
+
+	while (fgets(line, sizeof(line), fp)) {
+		p = strchr(line, '\n');
+		if (p)
+			*p = '\0';
+		if (!*line)
+			continue;
+		tags = realloc(rr->tags, (rr->ntags + 1) * sizeof(*tags));
+		if (!tags)
+			break;
+		rr->tags = tags;
+		rr->tags[rr->ntags] = strdup(line);
+		if (!rr->tags[rr->ntags])
+			break;
+		rr->ntags++;
+	}
+	fclose(fp);
+}
+
+static void strv_free(char **v)
+{
+	char **p;
+
+	for (p = v; p && *p; p++)
+		free(*p);
+	free(v);
+}
+
+static void job_free(struct rule_job *job)
+{
+	if (!job)
+		return;
+
+	strv_free(job->argv);
+	strv_free(job->env);
+	free(job->prog);
+	free(job->who);
+	free(job);
+}
+
+static struct rule_job *job_alloc(const char *prefix, const char *name,
+				  const char *prog, unsigned nargs,
+				  unsigned nenv)
+{
+	struct rule_job *job;
+
+	job = calloc(1, sizeof(*job));
+	if (!job)
+		return NULL;
+	job->prog = strdup(prog);
+	job->who = malloc(strlen(prefix) + strlen(name) + 1);
+	job->argv = calloc(nargs + 1, sizeof(*job->argv));
+	job->env = calloc(nenv + 1, sizeof(*job->env));
+	if (!job->prog || !job->who || !job->argv || !job->env) {
+		job_free(job);
+		return NULL;
+	}
+	sprintf(job->who, "%s%s", prefix, name);
+
+	return job;
+}
+
+static int env_add(char **env, unsigned *n, const char *prefix,
+		   const char *name, const char *val)
+{
+	size_t len = strlen(prefix) + strlen(name) + strlen(val) + 2;
+	char *p;
+
+	env[*n] = malloc(len);
+	if (!env[*n])
+		return -ENOMEM;
+	p = env[*n] + sprintf(env[*n], "%s", prefix);
+	while (*name)
+		*p++ = toupper((unsigned char)*name++);
+	sprintf(p, "=%s", val);
+	(*n)++;
+
+	return 0;
+}
+
+/*
+ * The program gets the event as environment variables, as the event
+ * memory is only valid during the handler.
+ */
+static struct rule_job *job_new(struct ras_rule *r, const void *ev,
+				const char *key)
+{
+	const struct rule_field *f, *fields = rule_events[r->type].fields;
+	struct rule_job *job;
+	char buf[4096];
+	unsigned n = 0, nfields = 0;
+	int rc = 0;
+
+	for (f = fields; f->name; f++)
+		nfields++;
+
+	job = job_alloc("Rule ", r->name, r->run, 1, nfields + 4);
+	if (!job)
+		return NULL;
+	job->argv[0] = strdup(r->run);
+	if (!job->argv[0]) {
+		job_free(job);
+		return NULL;
+	}
+
+	rc |= env_add(job->env, &n, "", "PATH", "/usr/sbin:/usr/bin:/sbin:/bin");
+	rc |= env_add(job->env, &n, "", "RAS_RULE", r->name);
+	rc |= env_add(job->env, &n, "", "RAS_EVENT", rule_events[r->type].name);
+	rc |= env_add(job->env, &n, "", "RAS_KEY", key);
+	for (f = fields; f->name && !rc; f++) {
+		field_str(f, ev, buf, sizeof(buf));
+		rc |= env_add(job->env, &n, "RAS_FIELD_", f->name, buf);
+	}
+	if (rc) {
+		job_free(job);
+		return NULL;
+	}
+
+	return job;
+}
+
+static void job_run(struct ras_rules *rr, struct rule_job *job)
+{
+	struct timespec delay = { 0, 10 * 1000 * 1000 };
+	time_t start = now_secs();
+	int rc, status;
+	pid_t pid;
+
+	rc = posix_spawn(&pid, job->prog, NULL, NULL, job->argv, job->env);
+	if (rc) {
+		log(SYSLOG, LOG_ERR, "%s: can't run %s: %s\n",
+		    job->who, job->prog, strerror(rc));
+		return;
+	}
+
+	while ((rc = waitpid(pid, &status, WNOHANG)) == 0) {
+		if ((unsigned long)(now_secs() - start) >= rr->timeout) {
+			log(SYSLOG, LOG_WARNING,
+			    "%s: %s took more than %lu seconds. Killing it\n",
+			    job->who, job->prog, rr->timeout);
+			kill(pid, SIGKILL);
+			while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+				;
+			return;
+		}
+		nanosleep(&delay, NULL);
+	}
+
+	if (rc > 0 && !(WIFEXITED(status) && !WEXITSTATUS(status)))
+		log(SYSLOG, LOG_WARNING, "%s: %s failed, status %d\n",
+		    job->who, job->prog, status);
+}
+
+static void *job_worker(void *arg)
+{
+	struct ras_rules *rr = arg;
+	struct rule_job *job;
+
+	pthread_mutex_lock(&rr->lock);
+	while (1) {
+		while (!rr->stop && !rr->qlen)
+			pthread_cond_wait(&rr->cond, &rr->lock);
+		if (rr->stop)
+			break;
+
+		job = rr->queue[rr->qhead];
+		rr->qhead = (rr->qhead + 1) % RULE_QUEUE_SIZE;
+		rr->qlen--;
+		pthread_mutex_unlock(&rr->lock);
+
+		job_run(rr, job);
+		job_free(job);
+
+		pthread_mutex_lock(&rr->lock);
+	}
+	pthread_mutex_unlock(&rr->lock);
+
+	return NULL;
+}
+
+/* Called with rr->lock held, or before the rules are in use */
+static int rules_start(struct ras_rules *rr)
+{
+	unsigned long njobs = ras_env_ulong("RAS_RULES_MAX_JOBS", RULE_JOBS);
+	int rc;
+
+	rr->timeout = ras_env_ulong("RAS_RULES_TIMEOUT", RULE_TIMEOUT);
+	if (!njobs)
+		njobs = 1;
+
+	rr->workers = calloc(njobs, sizeof(*rr->workers));
+	if (!rr->workers)
+		return ENOMEM;
+
+	for (; rr->nworkers < njobs; rr->nworkers++) {
+		rc = pthread_create(&rr->workers[rr->nworkers], NULL,
+				    job_worker, rr);
+		if (rc)
+			return rc;
+	}
+
+	return 0;
+}
+
+/* Takes the job, and starts the workers on the first one */
+static int job_queue(struct ras_rules *rr, struct rule_job *job)
+{
+	int rc;
+
+	pthread_mutex_lock(&rr->lock);
+	if (!rr->workers) {
+		rc = rules_start(rr);
+		if (rc) {
+			pthread_mutex_unlock(&rr->lock);
+			log(SYSLOG, LOG_ERR, "%s: can't start the workers: %s\n",
+			    job->who, strerror(rc));
+			job_free(job);
+			return -rc;
+		}
+	}
+	if (rr->qlen == RULE_QUEUE_SIZE) {
+		if (!rr->dropped++)
+			log(SYSLOG, LOG_WARNING,
+			    "%s: too many programs waiting to run. Dropping it\n",
+			    job->who);
+		pthread_mutex_unlock(&rr->lock);
+		job_free(job);
+		return -EBUSY;
+	}
+	rr->queue[(rr->qhead + rr->qlen++) % RULE_QUEUE_SIZE] = job;
+	pthread_cond_signal(&rr->cond);
+	pthread_mutex_unlock(&rr->lock);
+
+	return 0;
+}
+
+int ras_rules_spawn(struct ras_events *ras, const char *name,
+		    char *const argv[])
+{
+	struct ras_rules *rr = ras->rules;
+	struct rule_job *job;
+	unsigned i, n = 0, nargs = 0;
+
+	if (!rr)
+		return -ENOENT;
+
+	while (argv[nargs])
+		nargs++;
+	job = job_alloc("", name, argv[0], nargs, 1);
+	if (!job)
+		goto nomem;
+	for (i = 0; i < nargs; i++) {
+		job->argv[i] = strdup(argv[i]);
+		if (!job->argv[i])
+			goto nomem;
+	}
+	if (env_add(job->env, &n, "", "PATH", "/usr/sbin:/usr/bin:/sbin:/bin"))
+		goto nomem;
+
+	return job_queue(rr, job);
+
+nomem:
+	log(SYSLOG, LOG_ERR, "%s: can't allocate the job\n", name);
+	job_free(job);
+	return -ENOMEM;
+}
+
+void ras_rules_eval(struct ras_events *ras, enum ras_rule_event type,
+		    const void *ev)
+{
+	struct ras_rules *rr = ras->rules;
+	char key[RULE_KEY_LEN];
+	struct rule_job *job;
+	struct ras_rule *r;
+	unsigned i;
+
+	if (!rr)
+		return;
+
+	for (r = rr->rules[type]; r; r = r->next) {
+		for (i = 0; i < r->nconds; i++)
+			if (!cond_match(&r->conds[i], ev))
+				break;
+		if (i < r->nconds)
+			continue;
+
+		*key = '\0';
+		if (r->per)
+			field_str(r->per, ev, key, sizeof(key));
+		if (r->count && !rule_count(r, key))
+			continue;
+
+		log(SYSLOG, LOG_NOTICE, "Rule %s matched%s%s\n", r->name,
+		    *key ? " for " : "", key);
+		if (r->tag)
+			rule_tag(rr, r->tag);
+		if (!r->run)
+			continue;
+		job = job_new(r, ev, key);
+		if (job)
+			job_queue(rr, job);
+		else
+			log(SYSLOG, LOG_ERR, "Rule %s: can't allocate the job\n",
+			    r->name);
+	}
+}
+
+/* Splits a line into words. Double quotes group words with spaces. */
+static int tokenize(char *line, char **tok)
+{
+	char *p = line;
+	int n = 0;
+
+	while (n < RULE_MAX_TOKENS) {
+		while (isspace((unsigned char)*p))
+			p++;
+		if (!*p)
+			break;
+		if (*p == '"') {
+			tok[n++] = ++p;
+			p = strchr(p, '"');
+			if (!p)
+				return -1;
+		} else {
+			tok[n++] = p;
+			while (*p && !isspace((unsigned char)*p))
+				p++;
+			if (!*p)
+				break;
+		}
+		*p++ = '\0';
+	}
+
+	return *p ? -1 : n;
+}
+
+static const struct rule_field *find_field(enum ras_rule_event type,
+					   const char *name)
+{
+	const struct rule_field *f;
+
+	for (f = rule_events[type].fields; f->name; f++)
+		if (!strcmp(f->name, name))
+			return f;
+
+	return NULL;
+}
+
+static const char *parse_cond(enum ras_rule_event type, char **tok,
+			      struct rule_cond *c)
+{
+	char *end;
+	int i;
+
+	c->field = find_field(type, tok[0]);
+	if (!c->field)
+		return "unknown field";
+
+	for (i = 0; i < NUM_OPS; i++)
+		if (!strcmp(tok[1], rule_ops[i]))
+			break;
+	if (i == NUM_OPS)
+		return "unknown operator";
+	c->op = i;
+
+	if (field_is_str(c->field)) {
+		if (c->op == OP_AND)
+			return "& needs a numeric field";
+		c->val.str = strdup(tok[2]);
+		return c->val.str ? NULL : "out of memory";
+	}
+
+	if (c->op == OP_MATCH)
+		return "~ needs a string field";
+	errno = 0;
+	if (c->op == OP_AND || c->field->type == FT_U8 ||
+	    c->field->type == FT_U32 || c->field->type == FT_U64)
+		c->val.u = strtoull(tok[2], &end, 0);
+	else
+		c->val.s = strtoll(tok[2], &end, 0);
+	if (errno || end == tok[2] || *end)
+		return "invalid number";
+
+	return NULL;
+}
+
+static void rule_free(struct ras_rule *r)
+{
+	unsigned i;
+
+	for (i = 0; i < r->nconds; i++)
+		free((char *)r->conds[i].val.str);
+	if (r->keys) {
+		for (i = 0; i < RULE_KEY_SLOTS; i++)
+			free(r->keys[i].times);
+		free(r->keys);
+		pthread_mutex_destroy(&r->lock);
+	}
+	free(r->name);
+	free(r->run);
+	free(r->tag);
+	free(r);
+}
+
+static const char *parse_rule(struct ras_rule *r, char **tok, int ntok)
+{
+	const char *err;
+	unsigned long val;
+	char *end;
+	int i, type;
+
+	if (ntok < 4 || strcmp(tok[0], "rule") || strcmp(tok[2], "on"))
+		return "expected \"rule <name> on <group>:<event>\"";
+
+	for (type = 0; type < RAS_RULE_NUM_EVENTS; type++)
+		if (!strcmp(tok[3], rule_events[type].name))
+			break;
+	if (type == RAS_RULE_NUM_EVENTS)
+		return "unknown event";
+	r->type = type;
+	r->name = strdup(tok[1]);
+	if (!r->name)
+		return "out of memory";
+
+	for (i = 4; i < ntok; i++) {
+		if (!strcmp(tok[i], "if") || !strcmp(tok[i], "and")) {
+			/* "if" starts the conditions, "and" adds more */
+			if (!strcmp(tok[i], "if") == !!r->nconds)
+				return "syntax error";
+			if (i + 3 >= ntok)
+				return "incomplete condition";
+			if (r->nconds == RULE_MAX_CONDS)
+				return "too many conditions";
+			err = parse_cond(r->type, &tok[i + 1],
+					 &r->conds[r->nconds]);
+			if (err)
+				return err;
+			r->nconds++;
+			i += 3;
+		} else if (!strcmp(tok[i], "count")) {
+			if (i + 3 >= ntok || strcmp(tok[i + 2], "within"))
+				return "expected \"count <n> within <seconds>\"";
+			val = strtoul(tok[i + 1], &end, 0);
+			if (*end || !val || val > RULE_MAX_COUNT)
+				return "invalid count";
+			r->count = val;
+			val = strtoul(tok[i + 3], &end, 0);
+			if (*end || !val)
+				return "invalid time";
+			r->within = val;
+			i += 3;
+			if (i + 2 < ntok && !strcmp(tok[i + 1], "per")) {
+				r->per = find_field(r->type, tok[i + 2]);
+				if (!r->per)
+					return "unknown field";
+				i += 2;
+			}
+		} else if (!strcmp(tok[i], "run") && i + 1 < ntok && !r->run) {
+			r->run = strdup(tok[++i]);
+			if (!r->run)
+				return "out of memory";
+		} else if (!strcmp(tok[i], "tag") && i + 1 < ntok && !r->tag) {
+			r->tag = strdup(tok[++i]);
+			if (!r->tag)
+				return "out of memory";
+		} else {
+			return "syntax error";
+		}
+	}
+
+	if (r->count) {
+		r->keys = calloc(RULE_KEY_SLOTS, sizeof(*r->keys));
+		if (!r->keys)
+			return "out of memory";
+		pthread_mutex_init(&r->lock, NULL);
+	}
+
+	return NULL;
+}
+
+int ras_rules_load(struct ras_events *ras)
+{
+	const char *fname = getenv("RAS_RULES");
+	char line[1024], *tok[RULE_MAX_TOKENS], *p;
+	struct ras_rule *r, **tail[RAS_RULE_NUM_EVENTS];
+	struct ras_rules *rr;
+	const char *err;
+	int i, ntok, n = 0, nrules = 0, run = 0, rc = 0;
+	FILE *fp;
+
+	if (!fname || !*fname)
+		fname = RULES_FILE;
+
+	/* Without rules, it still runs the programs of ras_rules_spawn() */
+	rr = calloc(1, sizeof(*rr));
+	if (!rr)
+		return ENOMEM;
+	pthread_mutex_init(&rr->tag_lock, NULL);
+	pthread_mutex_init(&rr->lock, NULL);
+	pthread_cond_init(&rr->cond, NULL);
+	for (i = 0; i < RAS_RULE_NUM_EVENTS; i++)
+		tail[i] = &rr->rules[i];
+
+	fp = fopen(fname, "r");
+	if (!fp) {
+		rc = errno;
+		ras->rules = rr;
+		if (rc == ENOENT)
+			return 0;
+		log(ALL, LOG_WARNING, "Can't open event rules at %s\n", fname);
+		return rc;
+	}
+
+	while (fgets(line, sizeof(line), fp)) {
+		n++;
+
+		p = strchr(line, '#');
+		if (p)
+			*p = '\0';
+		ntok = tokenize(line, tok);
+		if (!ntok)
+			continue;
+
+		r = calloc(1, sizeof(*r));
+		if (!r) {
+			rc = ENOMEM;
+			break;
+		}
+		err = ntok < 0 ? "unbalanced quotes or too many words" :
+				 parse_rule(r, tok, ntok);
+		if (err) {
+			log(ALL, LOG_WARNING, "%s:%d: %s. Ignoring the rule\n",
+			    fname, n, err);
+			rule_free(r);
+			continue;
+		}
+
+		*tail[r->type] = r;
+		tail[r->type] = &r->next;
+		nrules++;
+		if (r->run)
+			run = 1;
+	}
+	fclose(fp);
+
+	tags_load(rr);
+	if (!rc && run)
+		rc = rules_start(rr);
+
+	ras->rules = rr;
+	if (rc) {
+		ras_rules_free(ras);
+		return rc;
+	}
+
+	log(ALL, LOG_INFO, "Loaded %d event rules from %s\n", nrules, fname);
+
+	return 0;
+}
+
+void ras_rules_free(struct ras_events *ras)
+{
+	struct ras_rules *rr = ras->rules;
+	struct ras_rule *r, *next;
+	unsigned i;
+
+	if (!rr)
+		return;
+	ras->rules = NULL;
+
+	if (rr->workers) {
+		pthread_mutex_lock(&rr->lock);
+		rr->stop = 1;
+		pthread_cond_broadcast(&rr->cond);
+		pthread_mutex_unlock(&rr->lock);
+		for (i = 0; i < rr->nworkers; i++)
+			pthread_join(rr->workers[i], NULL);
+		free(rr->workers);
+		for (i = 0; i < rr->qlen; i++)
+			job_free(rr->queue[(rr->qhead + i) % RULE_QUEUE_SIZE]);
+	}
+
+	for (i = 0; i < RAS_RULE_NUM_EVENTS; i++) {
+		for (r = rr->rules[i]; r; r = next) {
+			next = r->next;
+			rule_free(r);
+		}
+	}
+	for (i = 0; i < rr->ntags; i++)
+		free(rr->tags[i]);
+	free(rr->tags);
+	free(rr);
+}
+
+/*
+ * Filters of the live subscribers, using the same fields and conditions
+ */
+enum rule_severity {
+	SEV_INFO,
+	SEV_CORRECTED,
+	SEV_UNCORRECTED,
+	SEV_FATAL,
+	NUM_SEVS
+};
+
+static const char *rule_sevs[] = {
+	[SEV_INFO]		= "info",
+	[SEV_CORRECTED]		= "corrected",
+	[SEV_UNCORRECTED]	= "uncorrected",
+	[SEV_FATAL]		= "fatal",
+};
+
+struct ras_rule_filter {
+	unsigned		events;		/* Mask of event types */
+	int			severity;	/* Minimum severity */
+
+	/* CPU ranges, matched against the cpu field */
+	unsigned		cpu_lo[RULE_CPU_RANGES];
+	unsigned		cpu_hi[RULE_CPU_RANGES];
+	unsigned		ncpus;
+
+	char			*dimm;		/* fnmatch() pattern of the label */
+
+	/* Conditions, when there's a single event type */
+	enum ras_rule_event	type;
+	struct rule_cond	conds[RULE_MAX_CONDS];
+	unsigned		nconds;
+};
+
+/* Returns the severity of an event, or -1 for the ARM ones, without it */
+static int rule_severity(enum ras_rule_event type, const void *ev)
+{
+	const struct mce_event *e = ev;
+	const char *str;
+
+	switch (type) {
+	case RAS_RULE_MC:
+		str = ((const struct ras_mc_event *)ev)->error_type;
+		break;
+	case RAS_RULE_AER:
+		str = ((const struct ras_aer_event *)ev)->error_type;
+		break;
+	case RAS_RULE_NON_STANDARD:
+		str = ((const struct ras_non_standard_event *)ev)->severity;
+		break;
+	case RAS_RULE_MCE:
+		if (!(e->status & MCI_STATUS_UC))
+			return SEV_CORRECTED;
+		return e->status & MCI_STATUS_PCC ? SEV_FATAL : SEV_UNCORRECTED;
+	case RAS_RULE_EXTLOG:
+		switch (((const struct ras_extlog_event *)ev)->severity) {
+		case CPER_SEV_CORRECTED:
+			return SEV_CORRECTED;
+		case CPER_SEV_RECOVERABLE:
+			return SEV_UNCORRECTED;
+		case CPER_SEV_FATAL:
+			return SEV_FATAL;
+		default:
+			return SEV_INFO;
+		}
+	default:
+		return -1;
+	}
+
+	/* As set by the event handlers */
+	if (!str)
+		return SEV_INFO;
+	if (!strcmp(str, "Corrected"))
+		return SEV_CORRECTED;
+	if (!strcmp(str, "Uncorrected") || !strcmp(str, "Recoverable"))
+		return SEV_UNCORRECTED;
+	if (!strcmp(str, "Fatal"))
+		return SEV_FATAL;
+	return SEV_INFO;
+}
+
+static const char *parse_cpus(struct ras_rule_filter *f, char *list)
+{
+	char *p, *save, *end;
+
+	for (p = strtok_r(list, ",", &save); p; p = strtok_r(NULL, ",", &save)) {
+		if (f->ncpus == RULE_CPU_RANGES)
+			return "too many CPU ranges";
+		f->cpu_lo[f->ncpus] = strtoul(p, &end, 0);
+		f->cpu_hi[f->ncpus] = f->cpu_lo[f->ncpus];
+		if (*end == '-' && end[1])
+			f->cpu_hi[f->ncpus] = strtoul(end + 1, &end, 0);
+		if (end == p || *end || f->cpu_hi[f->ncpus] < f->cpu_lo[f->ncpus])
+			return "invalid CPU range";
+		f->ncpus++;
+	}
+
+	return f->ncpus ? NULL : "invalid CPU range";
+}
+
+static const char *parse_filter(struct ras_rule_filter *f, int ntok,
+				char **tok)
+{
+	const char *err;
+	int i, type;
+
+	for (i = 0; i < ntok; i++) {
+		for (type = 0; type < RAS_RULE_NUM_EVENTS; type++)
+			if (!strcmp(tok[i], rule_events[type].name))
+				break;
+		if (type < RAS_RULE_NUM_EVENTS) {
+			f->events |= 1 << type;
+			f->type = type;
+		} else if (!strcmp(tok[i], "severity") && i + 1 < ntok) {
+			for (f->severity = 0; f->severity < NUM_SEVS;
+			     f->severity++)
+				if (!strcmp(tok[i + 1], rule_sevs[f->severity]))
+					break;
+			if (f->severity == NUM_SEVS)
+				return "unknown severity";
+			i++;
+		} else if (!strcmp(tok[i], "cpu") && i + 1 < ntok) {
+			err = parse_cpus(f, tok[++i]);
+			if (err)
+				return err;
+		} else if (!strcmp(tok[i], "dimm") && i + 1 < ntok && !f->dimm) {
+			f->dimm = strdup(tok[++i]);
+			if (!f->dimm)
+				return "out of memory";
+		} else if (!strcmp(tok[i], "if") || !strcmp(tok[i], "and")) {
+			/* Fields are resolved for a single event type */
+			if (f->events & (f->events - 1) || !f->events)
+				return "conditions need a single event";
+			if (!strcmp(tok[i], "if") == !!f->nconds)
+				return "syntax error";
+			if (i + 3 >= ntok)
+				return "incomplete condition";
+			if (f->nconds == RULE_MAX_CONDS)
+				return "too many conditions";
+			err = parse_cond(f->type, &tok[i + 1],
+					 &f->conds[f->nconds]);
+			if (err)
+				return err;
+			f->nconds++;
+			i += 3;
+		} else {
+			return "syntax error";
+		}
+	}
+	if (!f->events)
+		f->events = (1 << RAS_RULE_NUM_EVENTS) - 1;
+
+	return NULL;
+}
+
+struct ras_rule_filter *ras_rule_filter_parse(int argc, char *argv[],
+					      const char **err)
+{
+	struct ras_rule_filter *f;
+
+	f = calloc(1, sizeof(*f));
+	if (!f) {
+		*err = "out of memory";
+		return NULL;
+	}
+
+	*err = parse_filter(f, argc, argv);
+	if (*err) {
+		ras_rule_filter_free(f);
+		return NULL;
+	}
+
+	return f;
+}
+
+void ras_rule_filter_free(struct ras_rule_filter *f)
+{
+	unsigned i;
+
+	if (!f)
+		return;
+
+	for (i = 0; i < f->nconds; i++)
+		free((char *)f->conds[i].val.str);
+	free(f->dimm);
+	free(f);
+}
+
+int ras_rule_filter_match(const struct ras_rule_filter *f,
+			  enum ras_rule_event type, const void *ev)
+{
+	const struct rule_field *field;
+	struct rule_value v;
+	int sev;
+	unsigned i;
+
+	if (!(f->events & (1 << type)))
+		return 0;
+
+	sev = rule_severity(type, ev);
+	if (sev >= 0 && sev < f->severity)
+		return 0;
+
+	/* Events without a cpu or a label field don't match */
+	if (f->ncpus) {
+		field = find_field(type, "cpu");
+		if (!field)
+			return 0;
+		field_get(field, ev, &v);
+		for (i = 0; i < f->ncpus; i++)
+			if (v.u >= f->cpu_lo[i] && v.u <= f->cpu_hi[i])
+				break;
+		if (i == f->ncpus)
+			return 0;
+	}
+
+	if (f->dimm) {
+		field = find_field(type, "label");
+		if (!field)
+			return 0;
+		field_get(field, ev, &v);
+		if (fnmatch(f->dimm, v.str, 0))
+			return 0;
+	}
+
+	for (i = 0; i < f->nconds; i++)
+		if (!cond_match(&f->conds[i], ev))
+			return 0;
+
+	return 1;
+}
+
+/* Adds a JSON string, escaping it */
+static void json_str(struct strbuf *sb, const char *str)
+{
+	char esc[8];
+
+	strbuf_add(sb, "\"", 1);
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\') {
+			esc[0] = '\\';
+			esc[1] = *str;
+			strbuf_add(sb, esc, 2);
+		} else if ((unsigned char)*str < 0x20) {
+			snprintf(esc, sizeof(esc), "\\u%04x",
+				 (unsigned char)*str);
+			strbuf_puts(sb, esc);
+		} else {
+			strbuf_add(sb, str, 1);
+		}
+	}
+	strbuf_add(sb, "\"", 1);
+}
+
+int ras_rule_event_json(enum ras_rule_event type, const void *ev,
+			struct strbuf *sb)
+{
+	const struct rule_field *f;
+	struct rule_value v;
+	int sev = rule_severity(type, ev);
+
+	strbuf_printf(sb, "{\"event\":\"%s\"", rule_events[type].name);
+	if (sev >= 0)
+		strbuf_printf(sb, ",\"severity\":\"%s\"", rule_sevs[sev]);
+
+	for (f = rule_events[type].fields; f->name; f++) {
+		field_get(f, ev, &v);
+		strbuf_printf(sb, ",\"%s\":", f->name);
+		if (v.str)
+			json_str(sb, v.str);
+		else if (v.is_signed)
+			strbuf_printf(sb, "%lld", v.s);
+		else
+			strbuf_printf(sb, "%llu", v.u);
+	}
+	strbuf_add(sb, "}", 1);
+
+	/* Truncated */
+	return sb->len + 1 >= sb->size ? -ENOSPC : 0;
+}
+
+const char *ras_rule_event_name(enum ras_rule_event type)
+{
+	return rule_events[type].name;
+}
+
+const char *ras_rule_severity(enum ras_rule_event type, const void *ev)
+{
+	int sev = rule_severity(type, ev);
+
+	return sev >= 0 ? rule_sevs[sev] : NULL;
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_RULES_H
+#define __RAS_RULES_H
+
+struct ras_events;
+
+/*
+ * Event rules, read from SYSCONFDIR/ras/rules.conf. Each line has the
+ * form:
+ *
+ *	rule <name> on <group>:<event> [if <cond> [and <cond>]...]
+ *		[count <n> within <seconds> [per <field>]]
+ *		[run <program>] [tag <tag>]
+ *
+ * where <cond> is "<field> <op> <value>", e.g.
+ *
+ *	rule dimm-ce on ras:mc_event if error_type == Corrected
+ *		count 5 within 600 per label run /usr/sbin/dimm-alert
+ *
+ * Rules are compiled into per-event lists, with the fields resolved to
+ * offsets at the decoded event, and evaluated after decoding. Programs
+ * are run asynchronously, by a bounded set of worker threads.
+ */
+enum ras_rule_event {
+	RAS_RULE_MC,
+	RAS_RULE_AER,
+	RAS_RULE_MCE,
+	RAS_RULE_EXTLOG,
+	RAS_RULE_NON_STANDARD,
+	RAS_RULE_ARM,
+	RAS_RULE_NUM_EVENTS
+};
+
+struct ras_rules;
+
+int ras_rules_load(struct ras_events *ras);
+void ras_rules_free(struct ras_events *ras);
+
+/* Evaluates the rules for a decoded event, like a struct ras_mc_event */
+void ras_rules_eval(struct ras_events *ras, enum ras_rule_event type,
+		    const void *ev);
+
+/*
+ * Runs a program, argv[0], by the rule workers, so it's killed after
+ * RAS_RULES_TIMEOUT seconds as well. The name prefixes its log messages.
+ * Returns 0 once queued, or a negative errno.
+ */
+int ras_rules_spawn(struct ras_events *ras, const char *name,
+		    char *const argv[]);
+
+/*
+ * Event filters of the live subscribers. They're parsed from words like
+ *
+ *	[<group>:<event>...] [severity info|corrected|uncorrected|fatal]
+ *		[cpu <n>[-<m>][,...]] [dimm <pattern>]
+ *		[if <cond> [and <cond>]...]
+ *
+ * using the same conditions as the rules, for a single event. The
+ * severity is the minimum one, and cpu and dimm only match the events
+ * with a cpu or a label field.
+ */
+struct ras_rule_filter;
+struct strbuf;
+
+struct ras_rule_filter *ras_rule_filter_parse(int argc, char *argv[],
+					      const char **err);
+void ras_rule_filter_free(struct ras_rule_filter *f);
+int ras_rule_filter_match(const struct ras_rule_filter *f,
+			  enum ras_rule_event type, const void *ev);
+
+/*
+ * Writes a decoded event as a JSON object, with its fields and severity.
+ * Returns -ENOSPC if it didn't fit.
+ */
+int ras_rule_event_json(enum ras_rule_event type, const void *ev,
+			struct strbuf *sb);
+
+/* The name of an event type, like "ras:mc_event" */
+const char *ras_rule_event_name(enum ras_rule_event type);
+
+/* The severity of an event, as for the filters, or NULL if unknown */
+const char *ras_rule_severity(enum ras_rule_event type, const void *ev);
+
+#endif
@@ -0,0 +1,658 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "ras-events.h"
+#include "ras-mce-handler.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+#include "ras-spool.h"
+
+#define SPOOL_FILE	RASSTATEDIR "/ras-spool.bin"
+#define SPOOL_RECORDS	128
+#define SPOOL_SECTOR	512
+#define SPOOL_MAGIC	0x4c4f4f50534152ULL	/* "RASPOOL" */
+/* Bumped whenever a record payload changes */
+#define SPOOL_VERSION	2
+
+/* Sector 0 */
+struct spool_header {
+	uint64_t	magic;
+	uint32_t	version;
+	uint32_t	nrecords;
+	uint64_t	acked;		/* Records up to it are at the database */
+};
+
+/* Sectors 1 to nrecords */
+struct spool_record {
+	uint64_t	magic;
+	uint32_t	crc;		/* From type up to the end of data */
+	uint16_t	type;
+	uint16_t	len;
+	uint64_t	seq;
+	uint8_t		data[SPOOL_SECTOR - 24];
+};
+
+struct ras_spool {
+	int		fd;
+	unsigned	nrecords;
+	uint64_t	seq, acked;
+
+	/* O_DIRECT needs an aligned buffer */
+	void		*sector;
+};
+
+/*
+ * CRC-32 (IEEE 802.3)
+ */
+
+static uint32_t crc_table[256];
+
+static void crc32_init(void)
+{
+	uint32_t c;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		crc_table[i] = c;
+	}
+}
+
+static uint32_t crc32(const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+	uint32_t crc = 0xffffffff;
+
+	while (len--)
+		crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return crc ^ 0xffffffff;
+}
+
+static uint32_t record_crc(struct spool_record *rec)
+{
+	return crc32(&rec->type, offsetof(struct spool_record, data) -
+			       offsetof(struct spool_record, type) + rec->len);
+}
+
+/*
+ * Record payload. Numbers are stored first, then strings and blobs,
+ * truncated if they don't fit.
+ */
+
+struct spool_buf {
+	uint8_t	*p, *end;
+};
+
+static void put(struct spool_buf *b, const void *val, size_t len)
+{
+	if (len > b->end - b->p)
+		len = b->end - b->p;
+	memcpy(b->p, val, len);
+	b->p += len;
+}
+
+static void put_str(struct spool_buf *b, const char *str)
+{
+	size_t len = str ? strlen(str) : 0;
+
+	if (b->p == b->end)
+		return;
+	if (len >= b->end - b->p)
+		len = b->end - b->p - 1;
+	if (len)
+		memcpy(b->p, str, len);
+	b->p[len] = '\0';
+	b->p += len + 1;
+}
+
+static void put_blob(struct spool_buf *b, const void *blob, uint16_t len)
+{
+	if (!blob)
+		len = 0;
+	if (b->end - b->p < sizeof(len))
+		return;
+	if (len > b->end - b->p - sizeof(len))
+		len = b->end - b->p - sizeof(len);
+	put(b, &len, sizeof(len));
+	put(b, blob, len);
+}
+
+static void get(struct spool_buf *b, void *val, size_t len)
+{
+	size_t n = len;
+
+	if (n > b->end - b->p)
+		n = b->end - b->p;
+	memcpy(val, b->p, n);
+	memset((char *)val + n, 0, len - n);
+	b->p += n;
+}
+
+static const char *get_str(struct spool_buf *b)
+{
+	const char *str = (const char *)b->p;
+	size_t len = strnlen(str, b->end - b->p);
+
+	if (len == b->end - b->p)
+		return "";
+	b->p += len + 1;
+
+	return str;
+}
+
+static const void *get_blob(struct spool_buf *b, uint16_t *len)
+{
+	const void *blob;
+
+	get(b, len, sizeof(*len));
+	if (*len > b->end - b->p)
+		*len = b->end - b->p;
+	blob = b->p;
+	b->p += *len;
+
+	return *len ? blob : NULL;
+}
+
+static void pack_event(struct spool_buf *b, enum ras_spool_type type,
+		       const void *ev)
+{
+	switch (type) {
+	case RAS_SPOOL_MC_EVENT: {
+		const struct ras_mc_event *mc = ev;
+
+		put(b, &mc->error_count, sizeof(mc->error_count));
+		put(b, &mc->mc_index, sizeof(mc->mc_index));
+		put(b, &mc->top_layer, sizeof(mc->top_layer));
+		put(b, &mc->middle_layer, sizeof(mc->middle_layer));
+		put(b, &mc->lower_layer, sizeof(mc->lower_layer));
+		put(b, &mc->address, sizeof(mc->address));
+		put(b, &mc->grain, sizeof(mc->grain));
+		put(b, &mc->syndrome, sizeof(mc->syndrome));
+		put_str(b, mc->timestamp);
+		put_str(b, mc->error_type);
+		put_str(b, mc->label);
+		put_str(b, mc->msg);
+		put_str(b, mc->driver_detail);
+		put(b, &mc->incident, sizeof(mc->incident));
+		break;
+	}
+	case RAS_SPOOL_AER_EVENT: {
+		const struct ras_aer_event *aer = ev;
+
+		put_str(b, aer->timestamp);
+		put_str(b, aer->error_type);
+		put_str(b, aer->dev_name);
+		put_str(b, aer->msg);
+		break;
+	}
+#ifdef HAVE_MCE
+	case RAS_SPOOL_MCE_RECORD: {
+		const struct mce_event *e = ev;
+
+		/* All MCE registers are kept, the text may be truncated */
+		put(b, &e->mcgcap, sizeof(e->mcgcap));
+		put(b, &e->mcgstatus, sizeof(e->mcgstatus));
+		put(b, &e->status, sizeof(e->status));
+		put(b, &e->addr, sizeof(e->addr));
+		put(b, &e->misc, sizeof(e->misc));
+		put(b, &e->ip, sizeof(e->ip));
+		put(b, &e->tsc, sizeof(e->tsc));
+		put(b, &e->walltime, sizeof(e->walltime));
+		put(b, &e->cpu, sizeof(e->cpu));
+		put(b, &e->cpuid, sizeof(e->cpuid));
+		put(b, &e->apicid, sizeof(e->apicid));
+		put(b, &e->socketid, sizeof(e->socketid));
+		put(b, &e->cs, sizeof(e->cs));
+		put(b, &e->bank, sizeof(e->bank));
+		put(b, &e->cpuvendor, sizeof(e->cpuvendor));
+		put_str(b, MCE_TEXT(e, timestamp));
+		put_str(b, MCE_TEXT(e, bank_name));
+		put_str(b, MCE_TEXT(e, mc_location));
+		put_str(b, MCE_TEXT(e, error_msg));
+		put_str(b, MCE_TEXT(e, mcgstatus_msg));
+		put_str(b, MCE_TEXT(e, mcistatus_msg));
+		put_str(b, MCE_TEXT(e, mcastatus_msg));
+		put_str(b, MCE_TEXT(e, user_action));
+		put_str(b, e->label);
+		put(b, &e->incident, sizeof(e->incident));
+		break;
+	}
+#endif
+	case RAS_SPOOL_EXTLOG_RECORD: {
+		const struct ras_extlog_event *ext = ev;
+
+		put(b, &ext->error_seq, sizeof(ext->error_seq));
+		put(b, &ext->etype, sizeof(ext->etype));
+		put(b, &ext->severity, sizeof(ext->severity));
+		put(b, &ext->address, sizeof(ext->address));
+		put(b, &ext->pa_mask_lsb, sizeof(ext->pa_mask_lsb));
+		put_str(b, ext->timestamp);
+		put_blob(b, ext->fru_id, 16);
+		put_str(b, ext->fru_text);
+		put_blob(b, ext->cper_data, ext->cper_data_length);
+		put_str(b, ext->label);
+		put(b, &ext->incident, sizeof(ext->incident));
+		break;
+	}
+	case RAS_SPOOL_NON_STANDARD_RECORD: {
+		const struct ras_non_standard_event *ns = ev;
+
+		put_str(b, ns->timestamp);
+		put_str(b, ns->severity);
+		put_blob(b, ns->sec_type, 16);
+		put_blob(b, ns->fru_id, 16);
+		put_str(b, ns->fru_text);
+		put_blob(b, ns->error, ns->length);
+		break;
+	}
+	case RAS_SPOOL_ARM_RECORD: {
+		const struct ras_arm_event *arm = ev;
+
+		put(b, &arm->error_count, sizeof(arm->error_count));
+		put(b, &arm->affinity, sizeof(arm->affinity));
+		put(b, &arm->mpidr, sizeof(arm->mpidr));
+		put(b, &arm->midr, sizeof(arm->midr));
+		put(b, &arm->running_state, sizeof(arm->running_state));
+		put(b, &arm->psci_state, sizeof(arm->psci_state));
+		put_str(b, arm->timestamp);
+		break;
+	}
+	}
+}
+
+static void replay_event(struct ras_events *ras, struct spool_record *rec)
+{
+	struct spool_buf b = { rec->data, rec->data + rec->len };
+	uint16_t len;
+
+	switch (rec->type) {
+	case RAS_SPOOL_MC_EVENT: {
+		struct ras_mc_event mc;
+
+		memset(&mc, 0, sizeof(mc));
+		get(&b, &mc.error_count, sizeof(mc.error_count));
+		get(&b, &mc.mc_index, sizeof(mc.mc_index));
+		get(&b, &mc.top_layer, sizeof(mc.top_layer));
+		get(&b, &mc.middle_layer, sizeof(mc.middle_layer));
+		get(&b, &mc.lower_layer, sizeof(mc.lower_layer));
+		get(&b, &mc.address, sizeof(mc.address));
+		get(&b, &mc.grain, sizeof(mc.grain));
+		get(&b, &mc.syndrome, sizeof(mc.syndrome));
+		snprintf(mc.timestamp, sizeof(mc.timestamp), "%s", get_str(&b));
+		mc.error_type = get_str(&b);
+		mc.label = get_str(&b);
+		mc.msg = get_str(&b);
+		mc.driver_detail = get_str(&b);
+		get(&b, &mc.incident, sizeof(mc.incident));
+		ras_store_mc_event(ras, &mc);
+		break;
+	}
+#ifdef HAVE_AER
+	case RAS_SPOOL_AER_EVENT: {
+		struct ras_aer_event aer;
+
+		memset(&aer, 0, sizeof(aer));
+		snprintf(aer.timestamp, sizeof(aer.timestamp), "%s", get_str(&b));
+		aer.error_type = get_str(&b);
+		aer.dev_name = get_str(&b);
+		aer.msg = get_str(&b);
+		ras_store_aer_event(ras, &aer);
+		break;
+	}
+#endif
+#ifdef HAVE_MCE
+	case RAS_SPOOL_MCE_RECORD: {
+		struct mce_event e;
+
+		memset(&e, 0, sizeof(e));
+		if (mce_event_init(&e) < 0)
+			break;
+		get(&b, &e.mcgcap, sizeof(e.mcgcap));
+		get(&b, &e.mcgstatus, sizeof(e.mcgstatus));
+		get(&b, &e.status, sizeof(e.status));
+		get(&b, &e.addr, sizeof(e.addr));
+		get(&b, &e.misc, sizeof(e.misc));
+		get(&b, &e.ip, sizeof(e.ip));
+		get(&b, &e.tsc, sizeof(e.tsc));
+		get(&b, &e.walltime, sizeof(e.walltime));
+		get(&b, &e.cpu, sizeof(e.cpu));
+		get(&b, &e.cpuid, sizeof(e.cpuid));
+		get(&b, &e.apicid, sizeof(e.apicid));
+		get(&b, &e.socketid, sizeof(e.socketid));
+		get(&b, &e.cs, sizeof(e.cs));
+		get(&b, &e.bank, sizeof(e.bank));
+		get(&b, &e.cpuvendor, sizeof(e.cpuvendor));
+		mce_text_puts(&e.timestamp, get_str(&b));
+		mce_text_puts(&e.bank_name, get_str(&b));
+		mce_text_puts(&e.mc_location, get_str(&b));
+		mce_text_puts(&e.error_msg, get_str(&b));
+		mce_text_puts(&e.mcgstatus_msg, get_str(&b));
+		mce_text_puts(&e.mcistatus_msg, get_str(&b));
+		mce_text_puts(&e.mcastatus_msg, get_str(&b));
+		mce_text_puts(&e.user_action, get_str(&b));
+		e.label = get_str(&b);
+		get(&b, &e.incident, sizeof(e.incident));
+		ras_store_mce_record(ras, &e);
+		mce_event_release(&e);
+		break;
+	}
+#endif
+#ifdef HAVE_EXTLOG
+	case RAS_SPOOL_EXTLOG_RECORD: {
+		struct ras_extlog_event ext;
+
+		memset(&ext, 0, sizeof(ext));
+		get(&b, &ext.error_seq, sizeof(ext.error_seq));
+		get(&b, &ext.etype, sizeof(ext.etype));
+		get(&b, &ext.severity, sizeof(ext.severity));
+		get(&b, &ext.address, sizeof(ext.address));
+		get(&b, &ext.pa_mask_lsb, sizeof(ext.pa_mask_lsb));
+		snprintf(ext.timestamp, sizeof(ext.timestamp), "%s", get_str(&b));
+		ext.fru_id = get_blob(&b, &len);
+		ext.fru_text = get_str(&b);
+		ext.cper_data = get_blob(&b, &len);
+		ext.cper_data_length = len;
+		ext.label = get_str(&b);
+		get(&b, &ext.incident, sizeof(ext.incident));
+		ras_store_extlog_mem_record(ras, &ext);
+		break;
+	}
+#endif
+#ifdef HAVE_NON_STANDARD
+	case RAS_SPOOL_NON_STANDARD_RECORD: {
+		struct ras_non_standard_event ns;
+
+		memset(&ns, 0, sizeof(ns));
+		snprintf(ns.timestamp, sizeof(ns.timestamp), "%s", get_str(&b));
+		ns.severity = get_str(&b);
+		ns.sec_type = get_blob(&b, &len);
+		ns.fru_id = get_blob(&b, &len);
+		ns.fru_text = get_str(&b);
+		ns.error = get_blob(&b, &len);
+		ns.length = len;
+		ras_store_non_standard_record(ras, &ns);
+		break;
+	}
+#endif
+#ifdef HAVE_ARM
+	case RAS_SPOOL_ARM_RECORD: {
+		struct ras_arm_event arm;
+
+		memset(&arm, 0, sizeof(arm));
+		get(&b, &arm.error_count, sizeof(arm.error_count));
+		get(&b, &arm.affinity, sizeof(arm.affinity));
+		get(&b, &arm.mpidr, sizeof(arm.mpidr));
+		get(&b, &arm.midr, sizeof(arm.midr));
+		get(&b, &arm.running_state, sizeof(arm.running_state));
+		get(&b, &arm.psci_state, sizeof(arm.psci_state));
+		snprintf(arm.timestamp, sizeof(arm.timestamp), "%s", get_str(&b));
+		ras_store_arm_record(ras, &arm);
+		break;
+	}
+#endif
+	default:
+		log(ALL, LOG_WARNING, "Unknown record type %d at the spool\n",
+		    rec->type);
+	}
+}
+
+/*
+ * Spool file handling
+ */
+
+static int write_sector(struct ras_spool *spool, unsigned sector)
+{
+	ssize_t rc;
+
+	rc = pwrite(spool->fd, spool->sector, SPOOL_SECTOR,
+		    (off_t)sector * SPOOL_SECTOR);
+
+	/* Not all filesystems support O_DIRECT. O_DSYNC is still there */
+	if (rc < 0 && errno == EINVAL) {
+		fcntl(spool->fd, F_SETFL,
+		      fcntl(spool->fd, F_GETFL) & ~O_DIRECT);
+		rc = pwrite(spool->fd, spool->sector, SPOOL_SECTOR,
+			    (off_t)sector * SPOOL_SECTOR);
+	}
+	if (rc != SPOOL_SECTOR)
+		return rc < 0 ? errno : EIO;
+
+	return 0;
+}
+
+static int write_header(struct ras_spool *spool)
+{
+	struct spool_header *hdr = spool->sector;
+
+	memset(spool->sector, 0, SPOOL_SECTOR);
+	hdr->magic = SPOOL_MAGIC;
+	hdr->version = SPOOL_VERSION;
+	hdr->nrecords = spool->nrecords;
+	hdr->acked = spool->acked;
+
+	return write_sector(spool, 0);
+}
+
+static int read_sector(struct ras_spool *spool, unsigned sector)
+{
+	ssize_t rc;
+
+	rc = pread(spool->fd, spool->sector, SPOOL_SECTOR,
+		   (off_t)sector * SPOOL_SECTOR);
+	if (rc < 0 && errno == EINVAL) {
+		fcntl(spool->fd, F_SETFL,
+		      fcntl(spool->fd, F_GETFL) & ~O_DIRECT);
+		rc = pread(spool->fd, spool->sector, SPOOL_SECTOR,
+			   (off_t)sector * SPOOL_SECTOR);
+	}
+
+	return rc == SPOOL_SECTOR ? 0 : -1;
+}
+
+struct ras_spool *ras_spool_open(void)
+{
+	struct ras_spool *spool;
+	int rc;
+
+	spool = calloc(1, sizeof(*spool));
+	if (!spool)
+		return NULL;
+	spool->fd = -1;
+
+	if (posix_memalign(&spool->sector, 4096, SPOOL_SECTOR)) {
+		free(spool);
+		return NULL;
+	}
+
+	spool->nrecords = ras_env_ulong("RAS_SPOOL_RECORDS", SPOOL_RECORDS);
+	if (!spool->nrecords) {
+		/* Disabled */
+		ras_spool_close(spool);
+		return NULL;
+	}
+
+	spool->fd = open(SPOOL_FILE, O_RDWR | O_CREAT | O_DIRECT | O_DSYNC,
+			 0600);
+	if (spool->fd < 0 && errno == EINVAL)
+		spool->fd = open(SPOOL_FILE, O_RDWR | O_CREAT | O_DSYNC, 0600);
+	if (spool->fd < 0) {
+		log(ALL, LOG_WARNING, "Can't open spool file %s: %s\n",
+		    SPOOL_FILE, strerror(errno));
+		ras_spool_close(spool);
+		return NULL;
+	}
+
+	/* Allocate all blocks now, so writing a record never needs to */
+	rc = posix_fallocate(spool->fd, 0,
+			     (off_t)(spool->nrecords + 1) * SPOOL_SECTOR);
+	if (rc) {
+		log(ALL, LOG_WARNING, "Can't allocate spool file %s: %s\n",
+		    SPOOL_FILE, strerror(rc));
+		ras_spool_close(spool);
+		return NULL;
+	}
+
+	crc32_init();
+
+	return spool;
+}
+
+static int cmp_seq(const void *a, const void *b)
+{
+	const struct spool_record *ra = a, *rb = b;
+
+	return ra->seq < rb->seq ? -1 : ra->seq > rb->seq;
+}
+
+/*
+ * Stores the records that didn't reach the database, then starts over
+ * with an empty spool.
+ */
+int ras_spool_replay(struct ras_spool *spool, struct ras_events *ras)
+{
+	struct spool_header *hdr = spool->sector;
+	struct spool_record *rec = spool->sector, *pending = NULL;
+	unsigned i, nrecords = 0, n = 0;
+	uint64_t acked = 0, last = 0;
+	int old = 0;
+
+	if (!read_sector(spool, 0) && hdr->magic == SPOOL_MAGIC) {
+		nrecords = hdr->nrecords;
+		acked = last = hdr->acked;
+
+		/*
+		 * Other versions have other payloads, so their records are
+		 * dropped. They're still read, for the sequence numbers to go
+		 * past them, so they're never taken as new ones.
+		 */
+		if (hdr->version != SPOOL_VERSION) {
+			log(ALL, LOG_WARNING,
+			    "Discarding the events at the spool %s, written with version %u\n",
+			    SPOOL_FILE, hdr->version);
+			old = 1;
+		}
+	}
+
+	/* The spool size may have changed since the records were written */
+	if (nrecords > spool->nrecords)
+		nrecords = spool->nrecords;
+
+	if (nrecords)
+		pending = calloc(nrecords, sizeof(*pending));
+
+	for (i = 0; pending && i < nrecords; i++) {
+		if (read_sector(spool, i + 1))
+			continue;
+		if (rec->magic != SPOOL_MAGIC || rec->seq <= acked ||
+		    rec->len > sizeof(rec->data) ||
+		    rec->crc != record_crc(rec))
+			continue;
+		if (!old)
+			memcpy(&pending[n++], rec, sizeof(*rec));
+		if (rec->seq > last)
+			last = rec->seq;
+	}
+
+	if (n) {
+		log(ALL, LOG_INFO,
+		    "Recovering %u events from the spool at %s\n",
+		    n, SPOOL_FILE);
+		qsort(pending, n, sizeof(*pending), cmp_seq);
+		for (i = 0; i < n; i++)
+			replay_event(ras, &pending[i]);
+	}
+	free(pending);
+
+	spool->seq = last;
+	spool->acked = last;
+
+	return write_header(spool);
+}
+
+/*
+ * Should not allocate memory: this is called when the machine may be
+ * about to die. Returns the record sequence number, or 0 on errors.
+ */
+uint64_t ras_spool_write(struct ras_spool *spool, enum ras_spool_type type,
+			 const void *ev)
+{
+	struct spool_record *rec;
+	struct spool_buf b;
+	uint64_t seq;
+	int rc;
+
+	if (!spool)
+		return 0;
+
+	rec = spool->sector;
+	memset(rec, 0, SPOOL_SECTOR);
+
+	b.p = rec->data;
+	b.end = rec->data + sizeof(rec->data);
+	pack_event(&b, type, ev);
+
+	seq = spool->seq + 1;
+	rec->magic = SPOOL_MAGIC;
+	rec->type = type;
+	rec->len = b.p - rec->data;
+	rec->seq = seq;
+	rec->crc = record_crc(rec);
+
+	rc = write_sector(spool, 1 + (seq - 1) % spool->nrecords);
+	if (rc) {
+		log(ALL, LOG_ERR, "Can't write event to the spool: %s\n",
+		    strerror(rc));
+		return 0;
+	}
+	spool->seq = seq;
+
+	return seq;
+}
+
+/* The record is now at the database */
+void ras_spool_ack(struct ras_spool *spool, uint64_t seq)
+{
+	if (!spool || !seq || seq <= spool->acked)
+		return;
+
+	spool->acked = seq;
+	write_header(spool);
+}
+
+void ras_spool_close(struct ras_spool *spool)
+{
+	if (!spool)
+		return;
+
+	if (spool->fd >= 0)
+		close(spool->fd);
+	free(spool->sector);
+	free(spool);
+}
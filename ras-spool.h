@@ -0,0 +1,51 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_SPOOL_H
+#define __RAS_SPOOL_H
+
+#include <stdint.h>
+
+/*
+ * Emergency spool: fatal events are written to a preallocated ring file,
+ * one sector per record, before being stored at the database, as the
+ * machine may reset before the SQLite transaction finishes. Records are
+ * acknowledged once committed, and the unacknowledged ones are replayed
+ * into the database at the next start.
+ */
+
+struct ras_events;
+struct ras_spool;
+
+enum ras_spool_type {
+	RAS_SPOOL_MC_EVENT = 1,
+	RAS_SPOOL_AER_EVENT,
+	RAS_SPOOL_MCE_RECORD,
+	RAS_SPOOL_EXTLOG_RECORD,
+	RAS_SPOOL_NON_STANDARD_RECORD,
+	RAS_SPOOL_ARM_RECORD,
+};
+
+struct ras_spool *ras_spool_open(void);
+int ras_spool_replay(struct ras_spool *spool, struct ras_events *ras);
+uint64_t ras_spool_write(struct ras_spool *spool, enum ras_spool_type type,
+			 const void *ev);
+void ras_spool_ack(struct ras_spool *spool, uint64_t seq);
+void ras_spool_close(struct ras_spool *spool);
+
+#endif
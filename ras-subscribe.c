@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include "ras-events.h"
+#include "ras-subscribe.h"
+#include "ras-config.h"
+#include "ras-logger.h"
+#include "strbuf.h"
+
+#define SUB_MAX		16
+#define SUB_QUEUE	256
+#define SUB_MAX_QUEUE	4096
+#define SUB_LINE_MAX	8192
+
+/* How often an idle subscriber is checked for a closed connection */
+#define SUB_IDLE_CHECK	5
+
+struct ras_sub {
+	struct ras_subs		*subs;
+	struct ras_rule_filter	*filter;
+	int			fd;
+	int			disconnect;	/* else drop the oldest event */
+	int			stop;
+
+	/* Ring of JSON lines, waiting to be sent */
+	pthread_cond_t		cond;
+	char			**ring;
+	unsigned		size, head, len;
+	unsigned long long	dropped;
+
+	struct ras_sub		*next;
+};
+
+struct ras_subs {
+	/* Protects the list and the rings */
+	pthread_mutex_t		lock;
+	pthread_cond_t		gone;
+	struct ras_sub		*list;
+	unsigned		n, max, queue;
+};
+
+static int sub_send(int fd, const char *buf, size_t len)
+{
+	ssize_t rc;
+
+	while (len) {
+		rc = send(fd, buf, len, MSG_NOSIGNAL);
+		if (rc < 0 && errno == EINTR)
+			continue;
+		if (rc <= 0)
+			return -1;
+		buf += rc;
+		len -= rc;
+	}
+
+	return 0;
+}
+
+/* Whether the client closed the connection. Anything it sends is ignored */
+static int sub_closed(int fd)
+{
+	char buf[256];
+	ssize_t rc;
+
+	do {
+		rc = recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+	} while (rc > 0 || (rc < 0 && errno == EINTR));
+
+	return rc == 0 || errno != EAGAIN;
+}
+
+static void sub_free(struct ras_sub *sub)
+{
+	while (sub->len) {
+		free(sub->ring[sub->head]);
+		sub->head = (sub->head + 1) % sub->size;
+		sub->len--;
+	}
+	free(sub->ring);
+	ras_rule_filter_free(sub->filter);
+	pthread_cond_destroy(&sub->cond);
+	free(sub);
+}
+
+static void *sub_thread(void *priv)
+{
+	struct ras_sub *sub = priv, **p;
+	struct ras_subs *subs = sub->subs;
+	unsigned long long dropped;
+	struct timespec ts;
+	char msg[64], *line;
+	int rc;
+
+	pthread_mutex_lock(&subs->lock);
+	while (!sub->stop) {
+		if (!sub->len && !sub->dropped) {
+			clock_gettime(CLOCK_REALTIME, &ts);
+			ts.tv_sec += SUB_IDLE_CHECK;
+			if (pthread_cond_timedwait(&sub->cond, &subs->lock,
+						   &ts) == ETIMEDOUT &&
+			    sub_closed(sub->fd))
+				break;
+			continue;
+		}
+
+		/* Tell about the dropped events, before the ones after them */
+		dropped = sub->dropped;
+		sub->dropped = 0;
+		line = NULL;
+		if (!dropped) {
+			line = sub->ring[sub->head];
+			sub->head = (sub->head + 1) % sub->size;
+			sub->len--;
+		}
+		pthread_mutex_unlock(&subs->lock);
+
+		if (line) {
+			rc = sub_send(sub->fd, line, strlen(line));
+			free(line);
+		} else {
+			snprintf(msg, sizeof(msg), "{\"dropped\":%llu}\n",
+				 dropped);
+			rc = sub_send(sub->fd, msg, strlen(msg));
+		}
+
+		pthread_mutex_lock(&subs->lock);
+		if (rc < 0)
+			break;
+	}
+
+	for (p = &subs->list; *p != sub; p = &(*p)->next)
+		;
+	*p = sub->next;
+	subs->n--;
+	pthread_cond_signal(&subs->gone);
+	pthread_mutex_unlock(&subs->lock);
+
+	close(sub->fd);
+	sub_free(sub);
+
+	return NULL;
+}
+
+void ras_subs_publish(struct ras_events *ras, enum ras_rule_event type,
+		      const void *ev)
+{
+	struct ras_subs *subs = ras->subs;
+	char buf[SUB_LINE_MAX], *line;
+	struct ras_sub *sub;
+	struct strbuf sb;
+	int rc = 1;
+
+	if (!subs)
+		return;
+
+	pthread_mutex_lock(&subs->lock);
+	for (sub = subs->list; sub; sub = sub->next) {
+		if (sub->stop || !ras_rule_filter_match(sub->filter, type, ev))
+			continue;
+
+		/* Only built when someone wants it */
+		if (rc > 0) {
+			STRBUF_INIT(&sb, buf);
+			rc = ras_rule_event_json(type, ev, &sb);
+			strbuf_add(&sb, "\n", 1);
+		}
+		line = rc ? NULL : strdup(buf);
+		if (!line) {
+			sub->dropped++;
+			pthread_cond_signal(&sub->cond);
+			continue;
+		}
+
+		if (sub->len == sub->size) {
+			if (sub->disconnect) {
+				log(SYSLOG, LOG_WARNING,
+				    "Disconnecting a subscriber too slow to read its events\n");
+				free(line);
+				sub->stop = 1;
+				shutdown(sub->fd, SHUT_RDWR);
+				pthread_cond_signal(&sub->cond);
+				continue;
+			}
+			free(sub->ring[sub->head]);
+			sub->head = (sub->head + 1) % sub->size;
+			sub->len--;
+			sub->dropped++;
+		}
+		sub->ring[(sub->head + sub->len++) % sub->size] = line;
+		pthread_cond_signal(&sub->cond);
+	}
+	pthread_mutex_unlock(&subs->lock);
+}
+
+int ras_subs_cmd(struct ras_events *ras, int argc, char *argv[], int fd,
+		 FILE *out)
+{
+	struct ras_subs *subs = ras->subs;
+	struct timeval tv = { 0 };
+	struct ras_sub *sub;
+	pthread_attr_t attr;
+	pthread_t thread;
+	unsigned long size;
+	const char *err;
+	char *end;
+	int i, rc;
+
+	if (!subs)
+		return -EOPNOTSUPP;
+
+	sub = calloc(1, sizeof(*sub));
+	if (!sub)
+		return -ENOMEM;
+	sub->subs = subs;
+	sub->fd = fd;
+	sub->size = subs->queue;
+	pthread_cond_init(&sub->cond, NULL);
+
+	for (i = 1; i + 1 < argc; i += 2) {
+		if (!strcmp(argv[i], "queue")) {
+			size = strtoul(argv[i + 1], &end, 0);
+			if (*end || !size || size > SUB_MAX_QUEUE) {
+				fprintf(out, "error: the queue size must be from 1 to %d\n",
+					SUB_MAX_QUEUE);
+				sub_free(sub);
+				return 0;
+			}
+			sub->size = size;
+		} else if (!strcmp(argv[i], "overflow") &&
+			   (!strcmp(argv[i + 1], "drop") ||
+			    !strcmp(argv[i + 1], "disconnect"))) {
+			sub->disconnect = !strcmp(argv[i + 1], "disconnect");
+		} else {
+			break;
+		}
+	}
+
+	sub->filter = ras_rule_filter_parse(argc - i, argv + i, &err);
+	if (!sub->filter) {
+		fprintf(out, "error: %s\n", err);
+		sub_free(sub);
+		return 0;
+	}
+
+	sub->ring = calloc(sub->size, sizeof(*sub->ring));
+	if (!sub->ring) {
+		sub_free(sub);
+		return -ENOMEM;
+	}
+
+	/* Sending may block for as long as the client wants */
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	pthread_mutex_lock(&subs->lock);
+	if (subs->n == subs->max) {
+		rc = -EBUSY;
+	} else {
+		rc = -pthread_create(&thread, &attr, sub_thread, sub);
+		if (!rc) {
+			sub->next = subs->list;
+			subs->list = sub;
+			subs->n++;
+		}
+	}
+	pthread_mutex_unlock(&subs->lock);
+	pthread_attr_destroy(&attr);
+
+	if (rc < 0) {
+		sub_free(sub);
+		return rc;
+	}
+
+	return 1;
+}
+
+struct ras_subs *ras_subs_init(void)
+{
+	struct ras_subs *subs;
+	unsigned long max;
+
+	max = ras_env_ulong("RAS_SUB_MAX", SUB_MAX);
+	if (!max)
+		return NULL;
+
+	subs = calloc(1, sizeof(*subs));
+	if (!subs)
+		return NULL;
+
+	pthread_mutex_init(&subs->lock, NULL);
+	pthread_cond_init(&subs->gone, NULL);
+	subs->max = max;
+	subs->queue = ras_env_ulong("RAS_SUB_QUEUE", SUB_QUEUE);
+	if (!subs->queue || subs->queue > SUB_MAX_QUEUE)
+		subs->queue = SUB_QUEUE;
+
+	return subs;
+}
+
+void ras_subs_free(struct ras_subs *subs)
+{
+	struct ras_sub *sub;
+
+	if (!subs)
+		return;
+
+	/* Wakes up the threads, even if blocked sending */
+	pthread_mutex_lock(&subs->lock);
+	for (sub = subs->list; sub; sub = sub->next) {
+		sub->stop = 1;
+		shutdown(sub->fd, SHUT_RDWR);
+		pthread_cond_signal(&sub->cond);
+	}
+	while (subs->n)
+		pthread_cond_wait(&subs->gone, &subs->lock);
+	pthread_mutex_unlock(&subs->lock);
+
+	pthread_cond_destroy(&subs->gone);
+	pthread_mutex_destroy(&subs->lock);
+	free(subs);
+}
@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __RAS_SUBSCRIBE_H
+#define __RAS_SUBSCRIBE_H
+
+#include <stdio.h>
+#include "ras-rules.h"
+
+/*
+ * Live event subscriptions. A control socket client sending
+ *
+ *	subscribe [queue <n>] [overflow drop|disconnect] [<filter>]
+ *
+ * gets the decoded events passing the filter, as described at
+ * ras-rules.h, one JSON object per line, until it closes the connection.
+ * Each subscriber has a queue of up to n events, sent by its own thread,
+ * so a slow one never stalls the event readers. When its queue is full,
+ * the oldest event is dropped and {"dropped":<count>} is sent before
+ * the next one, or the subscriber is disconnected.
+ */
+struct ras_subs;
+
+struct ras_subs *ras_subs_init(void);
+void ras_subs_free(struct ras_subs *subs);
+
+/* Queues a decoded event, like a struct ras_mc_event, to the subscribers */
+void ras_subs_publish(struct ras_events *ras, enum ras_rule_event type,
+		      const void *ev);
+
+int ras_subs_cmd(struct ras_events *ras, int argc, char *argv[], int fd,
+		 FILE *out);
+
+#endif
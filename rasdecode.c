@@ -0,0 +1,1120 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+ * Offline decoder: reads raw error records, as CSV or JSON lines, and
+ * writes them back decoded with the rasdaemon decoders, one JSON object
+ * per line, at the input order.
+ */
+
+#include <argp.h>
+#include <ctype.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "librasdecode.h"
+#include "ras-logger.h"
+#include "ras-hex.h"
+#ifdef HAVE_NON_STANDARD
+#include "ras-non-standard-handler.h"
+#endif
+
+#define TOOL_DESCRIPTION "Decodes raw RAS error records, as CSV or JSON lines, into JSON lines."
+#define ARGS_DOC "[FILE]..."
+
+const char *argp_program_version = TOOL_NAME " " VERSION;
+const char *argp_program_bug_address = "Mauro Carvalho Chehab <mchehab@kernel.org>";
+
+#define MAX_FIELDS	64
+#define BATCH_LINES	1024
+#define NS_MAX_PAYLOAD	4096
+
+/* Kernel's X86_VENDOR_* values, as in the mce trace event */
+#define X86_VENDOR_INTEL	0
+#define X86_VENDOR_AMD		2
+
+struct field {
+	const char	*name;
+	const char	*val;
+};
+
+struct record {
+	struct field	f[MAX_FIELDS];
+	unsigned	nfields;
+};
+
+struct csv_header {
+	char		*buf;
+	const char	*name[MAX_FIELDS];
+	unsigned	n;
+};
+
+/* Growable output buffer */
+struct obuf {
+	char		*buf;
+	size_t		len, size;
+};
+
+struct batch {
+	struct batch		*next;		/* Output order */
+	struct batch		*next_pending;	/* Decoding queue */
+	const struct csv_header	*hdr;
+	const char		*file;
+	unsigned long		first_line;
+	unsigned		nlines;
+	struct obuf		text;	/* Input lines, NUL terminated */
+	struct obuf		out;
+	int			done;
+};
+
+struct decode_pool {
+	pthread_t		*threads;
+	unsigned		nthreads;
+	pthread_mutex_t		lock;
+	pthread_cond_t		work, done;
+	struct batch		*pending, **pending_tail;
+	int			stopping;
+};
+
+/*
+ * Output
+ */
+
+static void ob_grow(struct obuf *o, size_t n)
+{
+	size_t size = o->size ? o->size : 4096;
+
+	if (o->len + n <= o->size)
+		return;
+
+	while (size < o->len + n)
+		size *= 2;
+	o->buf = realloc(o->buf, size);
+	if (!o->buf) {
+		log(TERM, LOG_ERR, "Can't allocate memory\n");
+		exit(EXIT_FAILURE);
+	}
+	o->size = size;
+}
+
+static void ob_add(struct obuf *o, const char *s, size_t n)
+{
+	ob_grow(o, n);
+	memcpy(o->buf + o->len, s, n);
+	o->len += n;
+}
+
+static void ob_printf(struct obuf *o, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+static void ob_printf(struct obuf *o, const char *fmt, ...)
+{
+	va_list ap;
+	int n;
+
+	va_start(ap, fmt);
+	n = vsnprintf(o->buf + o->len, o->size - o->len, fmt, ap);
+	va_end(ap);
+	if (o->len + n < o->size) {
+		o->len += n;
+		return;
+	}
+
+	ob_grow(o, n + 1);
+	va_start(ap, fmt);
+	vsnprintf(o->buf + o->len, o->size - o->len, fmt, ap);
+	va_end(ap);
+	o->len += n;
+}
+
+/* Adds ,"name":"str", escaping str as a JSON string */
+static void ob_json(struct obuf *o, const char *name, const char *str,
+		    size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char *end = str + len;
+	unsigned char c;
+	char *p;
+
+	ob_grow(o, strlen(name) + 6 * len + 6);
+	p = o->buf + o->len;
+	p += sprintf(p, ",\"%s\":\"", name);
+	for (; str < end; str++) {
+		c = *str;
+		if (c == '"' || c == '\\') {
+			*p++ = '\\';
+			*p++ = c;
+		} else if (c == '\n') {
+			*p++ = '\\';
+			*p++ = 'n';
+		} else if (c < 0x20) {
+			p += sprintf(p, "\\u00%c%c", hex[c >> 4], hex[c & 0xf]);
+		} else {
+			*p++ = c;
+		}
+	}
+	*p++ = '"';
+	o->len = p - o->buf;
+}
+
+static void ob_str(struct obuf *o, const char *name, const char *str)
+{
+	ob_json(o, name, str, strlen(str));
+}
+
+/*
+ * Input parsing. Both parsers split the line in place.
+ */
+
+/* Splits a CSV line. Quoted fields may have commas and "" for a quote */
+static int csv_split(char *p, const char **col, unsigned max)
+{
+	unsigned n = 0;
+	char *q;
+
+	for (;;) {
+		if (n == max)
+			return -1;
+		while (*p == ' ' || *p == '\t')
+			p++;
+		if (*p == '"') {
+			col[n++] = q = ++p;
+			for (;;) {
+				if (!*p)
+					return -1;
+				if (*p == '"') {
+					if (p[1] != '"')
+						break;
+					p++;
+				}
+				*q++ = *p++;
+			}
+			*q = '\0';
+			p++;
+			while (*p == ' ' || *p == '\t')
+				p++;
+			if (*p && *p != ',')
+				return -1;
+		} else {
+			col[n++] = p;
+			while (*p && *p != ',')
+				p++;
+			for (q = p; q > col[n - 1] && isspace((unsigned char)q[-1]); q--)
+				;
+			if (!*p) {
+				*q = '\0';
+				return n;
+			}
+			*q = '\0';
+			p++;
+			continue;
+		}
+		if (!*p)
+			return n;
+		p++;
+	}
+}
+
+static int parse_csv(char *line, const struct csv_header *hdr,
+		     struct record *r)
+{
+	const char *col[MAX_FIELDS];
+	int i, n;
+
+	n = csv_split(line, col, MAX_FIELDS);
+	if (n < 0)
+		return -1;
+
+	r->nfields = 0;
+	for (i = 0; i < n && i < hdr->n; i++) {
+		r->f[r->nfields].name = hdr->name[i];
+		r->f[r->nfields++].val = col[i];
+	}
+
+	return 0;
+}
+
+static char *skip_ws(char *p)
+{
+	while (isspace((unsigned char)*p))
+		p++;
+	return p;
+}
+
+/* Parses a JSON string in place. p is after the opening quote */
+static char *json_string(char *p, const char **str)
+{
+	char *q = p;
+	int i, v, c;
+
+	*str = q;
+	while (*p != '"') {
+		if (!*p)
+			return NULL;
+		if (*p != '\\') {
+			*q++ = *p++;
+			continue;
+		}
+		switch (*++p) {
+		case 'b':
+			*q++ = '\b';
+			break;
+		case 'f':
+			*q++ = '\f';
+			break;
+		case 'n':
+			*q++ = '\n';
+			break;
+		case 'r':
+			*q++ = '\r';
+			break;
+		case 't':
+			*q++ = '\t';
+			break;
+		case 'u':
+			for (i = 1, c = 0; i <= 4; i++) {
+				v = hex_value(p[i]);
+				if (v < 0)
+					return NULL;
+				c = c << 4 | v;
+			}
+			*q++ = c < 0x80 ? c : '?';
+			p += 4;
+			break;
+		case '"':
+		case '\\':
+		case '/':
+			*q++ = *p;
+			break;
+		default:
+			return NULL;
+		}
+		p++;
+	}
+	*q = '\0';
+
+	return p + 1;
+}
+
+/* Parses a flat JSON object. Nested values aren't supported */
+static int parse_json(char *p, struct record *r)
+{
+	const char *name, *val;
+	char *end;
+	char c;
+
+	r->nfields = 0;
+	p = skip_ws(p + 1);
+	if (*p == '}')
+		return 0;
+
+	for (;;) {
+		if (*p != '"' || !(p = json_string(p + 1, &name)))
+			return -1;
+		p = skip_ws(p);
+		if (*p != ':')
+			return -1;
+		p = skip_ws(p + 1);
+
+		end = NULL;
+		if (*p == '"') {
+			p = json_string(p + 1, &val);
+			if (!p)
+				return -1;
+		} else {
+			/* A number, true, false or null */
+			val = p;
+			while (*p && !strchr(",} \t\r\n", *p))
+				p++;
+			if (p == val)
+				return -1;
+			end = p;
+		}
+
+		p = skip_ws(p);
+		c = *p;
+		if (c != ',' && c != '}')
+			return -1;
+		if (end)
+			*end = '\0';
+
+		if (strcmp(val, "null")) {
+			if (r->nfields == MAX_FIELDS)
+				return -1;
+			r->f[r->nfields].name = name;
+			r->f[r->nfields++].val = val;
+		}
+		if (c == '}')
+			return 0;
+		p = skip_ws(p + 1);
+	}
+}
+
+static const char *get_str(const struct record *r, const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < r->nfields; i++)
+		if (!strcasecmp(r->f[i].name, name))
+			return *r->f[i].val ? r->f[i].val : NULL;
+
+	return NULL;
+}
+
+/* Returns 1 if found, 0 if missing, -1 if not a number */
+static int get_u64(const struct record *r, const char *name, uint64_t *v)
+{
+	const char *s = get_str(r, name);
+	char *end;
+
+	if (!s)
+		return 0;
+
+	errno = 0;
+	*v = strtoull(s, &end, 0);
+	if (errno || *end)
+		return -1;
+
+	return 1;
+}
+
+#define GET_NUM(r, name, var, err) do {					\
+	uint64_t __v;							\
+	int __rc = get_u64(r, name, &__v);				\
+	if (__rc < 0)							\
+		return err;						\
+	if (__rc)							\
+		var = __v;						\
+} while (0)
+
+/*
+ * Decoders
+ */
+
+static void add_field(void *priv, const char *name, const char *value,
+		      size_t len)
+{
+	ob_json(priv, name, value, len);
+}
+
+/* Decoder contexts already set up by this thread */
+struct cpu_desc {
+	char			vendor[64];
+	unsigned		family, model;
+	struct rasdec_ctx	*ctx;
+};
+
+#define CPU_DESC_CACHE	16
+
+static __thread struct cpu_desc cpu_descs[CPU_DESC_CACHE];
+static __thread unsigned cpu_descs_used, cpu_descs_next;
+
+static struct rasdec_ctx *get_ctx(const char *vendor, unsigned family,
+				  unsigned model)
+{
+	struct rasdec_cpu cpu = {
+		.vendor = vendor,
+		.family = family,
+		.model = model,
+	};
+	struct cpu_desc *d;
+	unsigned i;
+
+	for (i = 0; i < cpu_descs_used; i++) {
+		d = &cpu_descs[i];
+		if (d->family == family && d->model == model &&
+		    !strcmp(d->vendor, vendor))
+			return d->ctx;
+	}
+
+	if (cpu_descs_used < CPU_DESC_CACHE) {
+		d = &cpu_descs[cpu_descs_used++];
+	} else {
+		d = &cpu_descs[cpu_descs_next];
+		cpu_descs_next = (cpu_descs_next + 1) % CPU_DESC_CACHE;
+		rasdec_free(d->ctx);
+	}
+
+	snprintf(d->vendor, sizeof(d->vendor), "%s", vendor);
+	d->family = family;
+	d->model = model;
+	d->ctx = rasdec_new(&cpu);
+
+	return d->ctx;
+}
+
+static void free_ctxs(void)
+{
+	while (cpu_descs_used)
+		rasdec_free(cpu_descs[--cpu_descs_used].ctx);
+	cpu_descs_next = 0;
+	rasdec_thread_exit();
+}
+
+static const char *mce_vendor(const struct record *r)
+{
+	const char *vendor = get_str(r, "vendor");
+	uint64_t v;
+
+	if (!vendor) {
+		if (get_u64(r, "cpuvendor", &v) > 0 && v == X86_VENDOR_AMD)
+			return "AuthenticAMD";
+		return "GenuineIntel";
+	}
+	if (!strcasecmp(vendor, "intel"))
+		return "GenuineIntel";
+	if (!strcasecmp(vendor, "amd"))
+		return "AuthenticAMD";
+
+	return vendor;
+}
+
+static const char *decode_mce(const struct record *r, struct obuf *o)
+{
+	struct rasdec_builder b = { .add = add_field, .priv = o };
+	struct rasdec_mce e;
+	struct rasdec_ctx *ctx;
+	unsigned family = 0, model = 0;
+	uint64_t cpuid = 0;
+	size_t start;
+
+	memset(&e, 0, sizeof(e));
+
+	GET_NUM(r, "cpuid", cpuid, "invalid cpuid");
+	if (cpuid) {
+		/* The CPUID signature, as at the mce trace event */
+		family = (cpuid >> 8) & 0xf;
+		model = (cpuid >> 4) & 0xf;
+		if (family == 0xf)
+			family += (cpuid >> 20) & 0xff;
+		if (family == 6 || family >= 0xf)
+			model += ((cpuid >> 16) & 0xf) << 4;
+	}
+	GET_NUM(r, "family", family, "invalid family");
+	GET_NUM(r, "model", model, "invalid model");
+	if (!family)
+		return "missing the CPU family";
+
+	GET_NUM(r, "mcgcap", e.mcgcap, "invalid mcgcap");
+	GET_NUM(r, "mcgstatus", e.mcgstatus, "invalid mcgstatus");
+	GET_NUM(r, "status", e.status, "invalid status");
+	GET_NUM(r, "addr", e.addr, "invalid addr");
+	GET_NUM(r, "misc", e.misc, "invalid misc");
+	GET_NUM(r, "ip", e.ip, "invalid ip");
+	GET_NUM(r, "tsc", e.tsc, "invalid tsc");
+	GET_NUM(r, "walltime", e.walltime, "invalid walltime");
+	GET_NUM(r, "cpu", e.cpu, "invalid cpu");
+	GET_NUM(r, "apicid", e.apicid, "invalid apicid");
+	GET_NUM(r, "socketid", e.socketid, "invalid socketid");
+	GET_NUM(r, "cs", e.cs, "invalid cs");
+	GET_NUM(r, "bank", e.bank, "invalid bank");
+	e.cpuid = cpuid;
+
+	ctx = get_ctx(mce_vendor(r), family, model);
+	if (!ctx)
+		return "can't decode MCE for this CPU";
+
+	ob_str(o, "type", "mce");
+	ob_str(o, "cpu_type", rasdec_cpu_name(ctx));
+	ob_printf(o, ",\"cpu\":%u,\"socketid\":%u,\"apicid\":%u,\"bank\":%u",
+		  e.cpu, e.socketid, e.apicid, e.bank);
+	ob_printf(o, ",\"mcgcap\":\"0x%llx\",\"mcgstatus\":\"0x%llx\","
+		  "\"status\":\"0x%llx\",\"addr\":\"0x%llx\",\"misc\":\"0x%llx\"",
+		  (unsigned long long)e.mcgcap,
+		  (unsigned long long)e.mcgstatus,
+		  (unsigned long long)e.status,
+		  (unsigned long long)e.addr,
+		  (unsigned long long)e.misc);
+
+	start = o->len;
+	if (rasdec_mce(ctx, &e, &b) < 0) {
+		o->len = start;
+		return "can't decode the MCE";
+	}
+
+	return NULL;
+}
+
+static const char *decode_aer(const struct record *r, struct obuf *o)
+{
+	struct rasdec_builder b = { .add = add_field, .priv = o };
+	struct rasdec_aer aer;
+	const char *dev_name = get_str(r, "dev_name");
+
+	memset(&aer, 0, sizeof(aer));
+	GET_NUM(r, "status", aer.status, "invalid status");
+	GET_NUM(r, "severity", aer.severity, "invalid severity");
+
+	ob_str(o, "type", "aer");
+	if (dev_name)
+		ob_str(o, "dev_name", dev_name);
+	rasdec_aer(&aer, &b);
+
+	return NULL;
+}
+
+static const char *decode_extlog(const struct record *r, struct obuf *o)
+{
+	struct rasdec_builder b = { .add = add_field, .priv = o };
+	uint8_t fru_id[16], cper[256];
+	struct rasdec_extlog ev;
+	const char *s;
+	int len;
+
+	memset(&ev, 0, sizeof(ev));
+	GET_NUM(r, "etype", ev.etype, "invalid etype");
+	GET_NUM(r, "severity", ev.severity, "invalid severity");
+	GET_NUM(r, "sev", ev.severity, "invalid sev");
+	GET_NUM(r, "err_seq", ev.err_seq, "invalid err_seq");
+	GET_NUM(r, "pa_mask_lsb", ev.pa_mask_lsb, "invalid pa_mask_lsb");
+	GET_NUM(r, "pa", ev.address, "invalid pa");
+	GET_NUM(r, "address", ev.address, "invalid address");
+
+	ev.fru_text = get_str(r, "fru_text");
+	s = get_str(r, "fru_id");
+	if (s) {
+		if (uuid_le_parse(fru_id, s) < 0)
+			return "invalid fru_id";
+		ev.fru_id = fru_id;
+	}
+	s = get_str(r, "data");
+	if (s) {
+		len = hex_decode(cper, s, sizeof(cper));
+		if (len < 0)
+			return "invalid data";
+		ev.cper_data = cper;
+		ev.cper_data_len = len;
+	}
+
+	ob_str(o, "type", "extlog");
+	rasdec_extlog(&ev, &b);
+
+	return NULL;
+}
+
+#ifdef HAVE_NON_STANDARD
+static const char *ghes_severity(uint64_t sev)
+{
+	switch (sev) {
+	case GHES_SEV_NO:
+		return "Informational";
+	case GHES_SEV_CORRECTED:
+		return "Corrected";
+	case GHES_SEV_RECOVERABLE:
+		return "Recoverable";
+	default:
+		return "Fatal";
+	}
+}
+
+static const char *decode_non_standard(const struct record *r,
+				       struct obuf *o)
+{
+	static __thread uint8_t payload[NS_MAX_PAYLOAD];
+	uint8_t sec_type[16];
+	char uuid[UUID_STR_SIZE];
+	struct trace_seq s;
+	const char *str;
+	uint64_t sev = GHES_SEV_PANIC;
+	int len, rc;
+
+	GET_NUM(r, "sev", sev, "invalid sev");
+	GET_NUM(r, "severity", sev, "invalid severity");
+
+	str = get_str(r, "sec_type");
+	if (!str || uuid_le_parse(sec_type, str) < 0)
+		return "missing or invalid sec_type";
+
+	str = get_str(r, "data");
+	if (!str)
+		return "missing data";
+	/* The decoders don't know the payload size: zero what's past it */
+	memset(payload, 0, sizeof(payload));
+	len = hex_decode(payload, str, sizeof(payload));
+	if (len < 0)
+		return "invalid data";
+
+	trace_seq_init(&s);
+	rc = ras_ns_decode(&s, sec_type, payload);
+	trace_seq_terminate(&s);
+	if (rc) {
+		trace_seq_destroy(&s);
+		return "no decoder for this section type";
+	}
+
+	ob_str(o, "type", "non-standard");
+	ob_str(o, "severity", ghes_severity(sev));
+	ob_str(o, "sec_type", uuid_le_str(uuid, sec_type));
+	str = s.buffer;
+	while (isspace((unsigned char)*str))
+		str++;
+	for (len = strlen(str); len && isspace((unsigned char)str[len - 1]); len--)
+		;
+	ob_json(o, "decoded", str, len);
+	trace_seq_destroy(&s);
+
+	return NULL;
+}
+#endif
+
+static void decode_line(char *line, unsigned long num, const char *file,
+			const struct csv_header *hdr, struct obuf *o)
+{
+	struct record r;
+	const char *err, *type, *id;
+	size_t start = o->len;
+	int rc;
+
+	line = skip_ws(line);
+	if (!*line || *line == '#')
+		return;
+
+	ob_printf(o, "{\"line\":%lu", num);
+	if (file)
+		ob_str(o, "file", file);
+
+	if (*line == '{')
+		rc = parse_json(line, &r);
+	else if (hdr)
+		rc = parse_csv(line, hdr, &r);
+	else
+		rc = -1;
+	if (rc < 0) {
+		err = hdr || *line == '{' ? "malformed record" :
+					    "missing CSV header";
+		goto error;
+	}
+
+	id = get_str(&r, "id");
+	if (id)
+		ob_str(o, "id", id);
+
+	type = get_str(&r, "type");
+	if (!type || !strcasecmp(type, "mce"))
+		err = decode_mce(&r, o);
+	else if (!strcasecmp(type, "aer"))
+		err = decode_aer(&r, o);
+	else if (!strcasecmp(type, "extlog"))
+		err = decode_extlog(&r, o);
+#ifdef HAVE_NON_STANDARD
+	else if (!strcasecmp(type, "non-standard"))
+		err = decode_non_standard(&r, o);
+#endif
+	else
+		err = "unsupported record type";
+	if (!err) {
+		ob_add(o, "}\n", 2);
+		return;
+	}
+
+	/* Drop the fields added before the error */
+	o->len = start;
+	ob_printf(o, "{\"line\":%lu", num);
+	if (file)
+		ob_str(o, "file", file);
+	if (id)
+		ob_str(o, "id", id);
+error:
+	ob_str(o, "error", err);
+	ob_add(o, "}\n", 2);
+}
+
+static void decode_batch(struct batch *b)
+{
+	char *line = b->text.buf, *next;
+	unsigned i;
+
+	for (i = 0; i < b->nlines; i++, line = next) {
+		/* Parsing writes NULs within the line */
+		next = line + strlen(line) + 1;
+		decode_line(line, b->first_line + i, b->file, b->hdr, &b->out);
+	}
+}
+
+/*
+ * Decoding threads. Batches are written out at the order they were
+ * read, as soon as all the batches before them are done.
+ */
+
+static void *decode_thread(void *priv)
+{
+	struct decode_pool *pool = priv;
+	struct batch *b;
+
+	pthread_mutex_lock(&pool->lock);
+	for (;;) {
+		while (!pool->pending && !pool->stopping)
+			pthread_cond_wait(&pool->work, &pool->lock);
+		b = pool->pending;
+		if (!b)
+			break;
+		pool->pending = b->next_pending;
+		if (!pool->pending)
+			pool->pending_tail = &pool->pending;
+		pthread_mutex_unlock(&pool->lock);
+
+		decode_batch(b);
+
+		pthread_mutex_lock(&pool->lock);
+		b->done = 1;
+		pthread_cond_broadcast(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	free_ctxs();
+
+	return NULL;
+}
+
+static int pool_start(struct decode_pool *pool, unsigned nthreads)
+{
+	unsigned i;
+
+	memset(pool, 0, sizeof(*pool));
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work, NULL);
+	pthread_cond_init(&pool->done, NULL);
+	pool->pending_tail = &pool->pending;
+
+	pool->threads = calloc(nthreads, sizeof(*pool->threads));
+	if (!pool->threads)
+		return -ENOMEM;
+
+	for (i = 0; i < nthreads; i++) {
+		if (pthread_create(&pool->threads[i], NULL, decode_thread,
+				   pool))
+			break;
+	}
+	pool->nthreads = i;
+	if (!i) {
+		free(pool->threads);
+		return -EAGAIN;
+	}
+
+	return 0;
+}
+
+static void pool_stop(struct decode_pool *pool)
+{
+	unsigned i;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = 1;
+	pthread_cond_broadcast(&pool->work);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i = 0; i < pool->nthreads; i++)
+		pthread_join(pool->threads[i], NULL);
+	free(pool->threads);
+}
+
+struct decoder {
+	struct decode_pool	pool;
+	int			threaded;
+	unsigned		max_inflight;
+
+	/* Batches not written yet, at the input order */
+	struct batch		*head, **tail;
+	unsigned		inflight;
+	struct batch		*free;
+	int			write_error;
+};
+
+static void write_batch(struct decoder *dec, struct batch *b)
+{
+	if (b->out.len && fwrite(b->out.buf, 1, b->out.len, stdout) !=
+			  b->out.len)
+		dec->write_error = 1;
+	b->out.len = 0;
+	b->text.len = 0;
+	b->nlines = 0;
+	b->done = 0;
+	b->next = dec->free;
+	dec->free = b;
+}
+
+/* Writes the finished batches. If max is set, waits until less are left */
+static void flush_batches(struct decoder *dec, unsigned max)
+{
+	struct batch *b;
+
+	if (!dec->threaded)
+		return;
+
+	pthread_mutex_lock(&dec->pool.lock);
+	while ((b = dec->head)) {
+		if (!b->done) {
+			if (dec->inflight <= max)
+				break;
+			pthread_cond_wait(&dec->pool.done, &dec->pool.lock);
+			continue;
+		}
+		dec->head = b->next;
+		if (!dec->head)
+			dec->tail = &dec->head;
+		dec->inflight--;
+		pthread_mutex_unlock(&dec->pool.lock);
+
+		write_batch(dec, b);
+
+		pthread_mutex_lock(&dec->pool.lock);
+	}
+	pthread_mutex_unlock(&dec->pool.lock);
+}
+
+static void submit_batch(struct decoder *dec, struct batch *b)
+{
+	if (!b->nlines) {
+		write_batch(dec, b);
+		return;
+	}
+
+	if (!dec->threaded) {
+		decode_batch(b);
+		write_batch(dec, b);
+		return;
+	}
+
+	flush_batches(dec, dec->max_inflight - 1);
+
+	pthread_mutex_lock(&dec->pool.lock);
+	b->next = NULL;
+	b->next_pending = NULL;
+	*dec->tail = b;
+	dec->tail = &b->next;
+	dec->inflight++;
+	*dec->pool.pending_tail = b;
+	dec->pool.pending_tail = &b->next_pending;
+	pthread_cond_signal(&dec->pool.work);
+	pthread_mutex_unlock(&dec->pool.lock);
+}
+
+static struct batch *get_batch(struct decoder *dec)
+{
+	struct batch *b = dec->free;
+
+	if (b) {
+		dec->free = b->next;
+		return b;
+	}
+
+	b = calloc(1, sizeof(*b));
+	if (!b) {
+		log(TERM, LOG_ERR, "Can't allocate memory\n");
+		exit(EXIT_FAILURE);
+	}
+
+	return b;
+}
+
+static struct csv_header *parse_header(const char *line)
+{
+	struct csv_header *hdr;
+	int n;
+
+	hdr = calloc(1, sizeof(*hdr));
+	if (!hdr)
+		return NULL;
+	hdr->buf = strdup(line);
+	if (!hdr->buf) {
+		free(hdr);
+		return NULL;
+	}
+
+	n = csv_split(hdr->buf, hdr->name, MAX_FIELDS);
+	if (n <= 0) {
+		free(hdr->buf);
+		free(hdr);
+		return NULL;
+	}
+	hdr->n = n;
+
+	return hdr;
+}
+
+static int decode_file(struct decoder *dec, const char *name,
+		       const char *label)
+{
+	struct csv_header *hdr = NULL;
+	struct batch *b = NULL;
+	unsigned long num = 0;
+	char *line = NULL, *p;
+	size_t size = 0;
+	ssize_t len;
+	int rc = 0;
+	FILE *fp;
+
+	if (!strcmp(name, "-")) {
+		fp = stdin;
+	} else {
+		fp = fopen(name, "r");
+		if (!fp) {
+			log(TERM, LOG_ERR, "Can't open %s: %s\n", name,
+			    strerror(errno));
+			return -errno;
+		}
+	}
+
+	while ((len = getline(&line, &size, fp)) >= 0) {
+		num++;
+		while (len && (line[len - 1] == '\n' || line[len - 1] == '\r'))
+			line[--len] = '\0';
+
+		/* The first record of a CSV file is the header */
+		p = skip_ws(line);
+		if (!hdr && *p && *p != '{' && *p != '#') {
+			hdr = parse_header(p);
+			if (!hdr) {
+				log(TERM, LOG_ERR,
+				    "%s:%lu: invalid CSV header: %s\n",
+				    fp == stdin ? "<stdin>" : name, num, line);
+				rc = -EINVAL;
+				break;
+			}
+			continue;
+		}
+
+		if (!b) {
+			b = get_batch(dec);
+			b->hdr = hdr;
+			b->file = label;
+			b->first_line = num;
+		}
+		ob_add(&b->text, line, len + 1);
+		if (++b->nlines == BATCH_LINES) {
+			submit_batch(dec, b);
+			b = NULL;
+		}
+	}
+	if (b)
+		submit_batch(dec, b);
+
+	/* The batches point to the header */
+	flush_batches(dec, 0);
+
+	free(line);
+	if (hdr) {
+		free(hdr->buf);
+		free(hdr);
+	}
+	if (fp != stdin)
+		fclose(fp);
+
+	return rc;
+}
+
+struct arguments {
+	unsigned threads;
+};
+
+static error_t parse_opt(int k, char *arg, struct argp_state *state)
+{
+	struct arguments *args = state->input;
+	char *end;
+
+	switch (k) {
+	case 'j':
+		args->threads = strtoul(arg, &end, 0);
+		if (*end || !args->threads)
+			argp_error(state, "invalid number of threads: %s", arg);
+		break;
+	default:
+		return ARGP_ERR_UNKNOWN;
+	}
+	return 0;
+}
+
+/* The library messages, like the decoders chosen for a CPU */
+static void lib_log(void *priv, int level, const char *msg)
+{
+	log(TERM, level, "%s\n", msg);
+}
+
+int main(int argc, char *argv[])
+{
+	struct arguments args;
+	struct decoder dec;
+	struct batch *b;
+	long ncpus;
+	int idx = -1, i, rc = 0;
+	const struct argp_option options[] = {
+		{"threads", 'j', "N", 0, "decode using N threads. Default: the number of CPUs", 0},
+
+		{ 0, 0, 0, 0, 0, 0 }
+	};
+	const struct argp argp = {
+		.options = options,
+		.parser = parse_opt,
+		.doc = TOOL_DESCRIPTION,
+		.args_doc = ARGS_DOC,
+	};
+
+	memset(&args, 0, sizeof(args));
+	argp_parse(&argp, argc, argv, 0, &idx, &args);
+
+	if (!args.threads) {
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		args.threads = ncpus > 0 ? ncpus : 1;
+	}
+
+	/* The non-standard decoders also log to syslog: that's for the daemon */
+	setlogmask(LOG_MASK(LOG_EMERG));
+	rasdec_set_log(lib_log, NULL);
+
+	memset(&dec, 0, sizeof(dec));
+	dec.tail = &dec.head;
+	if (args.threads > 1) {
+		dec.threaded = !pool_start(&dec.pool, args.threads);
+		dec.max_inflight = 4 * dec.pool.nthreads;
+	}
+
+	if (idx >= argc) {
+		if (decode_file(&dec, "-", NULL) < 0)
+			rc = -1;
+	} else {
+		for (i = idx; i < argc; i++)
+			if (decode_file(&dec, argv[i],
+					argc - idx > 1 ? argv[i] : NULL) < 0)
+				rc = -1;
+	}
+
+	if (dec.threaded)
+		pool_stop(&dec.pool);
+	free_ctxs();
+
+	while ((b = dec.free)) {
+		dec.free = b->next;
+		free(b->text.buf);
+		free(b->out.buf);
+		free(b);
+	}
+
+	if (fflush(stdout) || dec.write_error) {
+		log(TERM, LOG_ERR, "Can't write the output: %s\n",
+		    strerror(errno));
+		rc = -1;
+	}
+
+	return rc ? EXIT_FAILURE : EXIT_SUCCESS;
+}
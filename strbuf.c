@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "strbuf.h"
+
+void strbuf_add(struct strbuf *sb, const char *str, unsigned len)
+{
+	if (sb->len + 1 >= sb->size)
+		return;
+
+	if (len > sb->size - sb->len - 1)
+		len = sb->size - sb->len - 1;
+	memcpy(sb->buf + sb->len, str, len);
+	sb->len += len;
+	sb->buf[sb->len] = '\0';
+}
+
+void strbuf_puts(struct strbuf *sb, const char *str)
+{
+	strbuf_add(sb, str, strlen(str));
+}
+
+void strbuf_vprintf(struct strbuf *sb, const char *fmt, va_list ap)
+{
+	unsigned room;
+	int n;
+
+	if (sb->len + 1 >= sb->size)
+		return;
+
+	room = sb->size - sb->len;
+	n = vsnprintf(sb->buf + sb->len, room, fmt, ap);
+	if (n < 0)
+		sb->buf[sb->len] = '\0';
+	else if (n >= room)
+		sb->len = sb->size - 1;
+	else
+		sb->len += n;
+}
+
+void strbuf_printf(struct strbuf *sb, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	strbuf_vprintf(sb, fmt, ap);
+	va_end(ap);
+}
+
+void strbuf_catf(struct strbuf *sb, const char *fmt, ...)
+{
+	va_list ap;
+
+	if (sb->len)
+		strbuf_add(sb, " ", 1);
+
+	va_start(ap, fmt);
+	strbuf_vprintf(sb, fmt, ap);
+	va_end(ap);
+}
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+#ifndef __STRBUF_H
+#define __STRBUF_H
+
+#include <stdarg.h>
+
+/*
+ * String builder over a fixed size buffer. It keeps track of the string
+ * length, so appending doesn't need to scan the string. Text that
+ * doesn't fit is truncated, and the string is always NUL terminated.
+ */
+struct strbuf {
+	char		*buf;
+	unsigned	len, size;
+};
+
+static inline void strbuf_init(struct strbuf *sb, char *buf, unsigned size)
+{
+	sb->buf = buf;
+	sb->size = size;
+	sb->len = 0;
+	if (size)
+		*buf = '\0';
+}
+
+static inline void strbuf_reset(struct strbuf *sb)
+{
+	sb->len = 0;
+	if (sb->size)
+		*sb->buf = '\0';
+}
+
+#define STRBUF_INIT(sb, array)	strbuf_init(sb, array, sizeof(array))
+
+void strbuf_add(struct strbuf *sb, const char *str, unsigned len);
+void strbuf_puts(struct strbuf *sb, const char *str);
+void strbuf_vprintf(struct strbuf *sb, const char *fmt, va_list ap);
+void strbuf_printf(struct strbuf *sb, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+/* Appends, adding a space first if the string isn't empty */
+void strbuf_catf(struct strbuf *sb, const char *fmt, ...)
+	__attribute__((format(printf, 2, 3)));
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+ * Decoding throughput of librasdecode: MCEs served from the cache and
+ * decoded from scratch, from one and several threads, and AER and
+ * extlog events. The rates are printed to the test log.
+ */
+
+#include <pthread.h>
+#include <string.h>
+#include "librasdecode.h"
+#include "tests.h"
+
+#define BENCH_THREADS	4
+
+static const struct rasdec_cpu hsw = { "GenuineIntel", 6, 0x3f };
+
+/* Corrected memory read error, at channel 1 */
+static const struct rasdec_mce mem = {
+	.mcgcap = 0x1c09, .status = 0x8c00004000010091ULL,
+	.addr = 0x1234567000ULL, .misc = 0x140686, .bank = 7, .cpu = 2,
+};
+
+static void add_len(void *priv, const char *name, const char *value,
+		    size_t len)
+{
+	*(size_t *)priv += len;
+}
+
+struct bench_job {
+	struct rasdec_ctx	*ctx;
+	unsigned long		iters;
+	int			cached;
+	int			rc;
+};
+
+static void *bench_mce(void *priv)
+{
+	struct bench_job *job = priv;
+	size_t len = 0;
+	struct rasdec_builder b = { add_len, &len };
+	struct rasdec_mce m = mem;
+	unsigned long i;
+
+	for (i = 0; i < job->iters && !job->rc; i++) {
+		/* A new misc value misses the cache */
+		if (!job->cached)
+			m.misc = i;
+		job->rc = rasdec_mce(job->ctx, &m, &b);
+	}
+	rasdec_thread_exit();
+
+	return NULL;
+}
+
+static void report(const char *name, unsigned long events,
+		   unsigned long long ns)
+{
+	printf("# %-24s %10.0f events/s %8.0f ns/event\n", name,
+	       events * 1e9 / ns, (double)ns / events);
+}
+
+static int run_mce(struct rasdec_ctx *ctx, const char *name, int cached,
+		   unsigned nthreads, unsigned long iters)
+{
+	struct bench_job jobs[BENCH_THREADS];
+	pthread_t threads[BENCH_THREADS];
+	unsigned long long t;
+	unsigned i;
+	int rc = 0;
+
+	t = test_now_ns();
+	for (i = 0; i < nthreads; i++) {
+		jobs[i] = (struct bench_job) { ctx, iters, cached, 0 };
+		if (pthread_create(&threads[i], NULL, bench_mce, &jobs[i]))
+			return -1;
+	}
+	for (i = 0; i < nthreads; i++) {
+		pthread_join(threads[i], NULL);
+		if (jobs[i].rc)
+			rc = jobs[i].rc;
+	}
+	report(name, nthreads * iters, test_now_ns() - t);
+
+	return rc;
+}
+
+int main(void)
+{
+	static const uint8_t cper[80] = {
+		[0] = 0x68, [1] = 0x01,
+		[8] = 1, [12] = 3, [14] = 2, [18] = 0x34, [19] = 0x12,
+	};
+	struct rasdec_extlog ev = {
+		.err_seq = 7, .etype = 2, .severity = 2,
+		.address = 0x1000abc0, .pa_mask_lsb = 6,
+		.fru_text = "DIMM A1",
+		.cper_data = cper, .cper_data_len = sizeof(cper),
+	};
+	struct rasdec_aer aer = { .status = 0x41, .severity = 0 };
+	struct rasdec_ctx *ctx = rasdec_new(&hsw);
+	unsigned long iters = test_iterations(200000), i;
+	size_t len = 0;
+	struct rasdec_builder b = { add_len, &len };
+	unsigned long long t;
+
+	if (!ctx) {
+		perror("rasdec_new");
+		return 1;
+	}
+
+	CHECK(!run_mce(ctx, "mce, cached", 1, 1, iters),
+	      "cached MCE not decoded");
+	CHECK(!run_mce(ctx, "mce, uncached", 0, 1, iters),
+	      "uncached MCE not decoded");
+	CHECK(!run_mce(ctx, "mce, uncached, 4 threads", 0, BENCH_THREADS,
+		       iters), "uncached MCE not decoded");
+
+	t = test_now_ns();
+	for (i = 0; i < iters; i++)
+		CHECK(!rasdec_aer(&aer, &b), "AER not decoded");
+	report("aer", iters, test_now_ns() - t);
+
+	t = test_now_ns();
+	for (i = 0; i < iters; i++)
+		CHECK(!rasdec_extlog(&ev, &b), "extlog not decoded");
+	report("extlog", iters, test_now_ns() - t);
+
+	rasdec_free(ctx);
+	rasdec_thread_exit();
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/*
+ * Checks the hex and UUID encoders against the snprintf() code they
+ * replaced, with random inputs, and compares their speed.
+ */
+
+#include <string.h>
+#include "ras-hex.h"
+#include "tests.h"
+
+#define MAX_LEN		1024
+#define RANDOM_CASES	5000
+
+/* The formatting previously done by the handlers */
+static char *ref_hex(char *dst, const unsigned char *p, size_t len)
+{
+	while (len--)
+		dst += sprintf(dst, "%02x", *p++);
+	return dst;
+}
+
+static char *ref_le32(char *dst, const unsigned char *p, size_t nwords)
+{
+	for (; nwords; nwords--, p += 4)
+		dst += sprintf(dst, "%02x%02x%02x%02x", p[3], p[2], p[1], p[0]);
+	return dst;
+}
+
+static char *ref_uuid(char *buf, const unsigned char *uu)
+{
+	static const unsigned char le[16] = {
+		3, 2, 1, 0, 5, 4, 7, 6, 8, 9, 10, 11, 12, 13, 14, 15
+	};
+	char *p = buf;
+	int i;
+
+	for (i = 0; i < 16; i++) {
+		p += sprintf(p, "%.2x", uu[le[i]]);
+		if (i == 3 || i == 5 || i == 7 || i == 9)
+			*p++ = '-';
+	}
+	*p = '\0';
+	return buf;
+}
+
+static unsigned char src[MAX_LEN + 16];
+static char out[2 * MAX_LEN + 64], ref[2 * MAX_LEN + 64];
+
+static void check_random(void)
+{
+	uint64_t seed = 0x9e3779b97f4a7c15ULL;
+	size_t len, i, soff, doff;
+	char *end;
+	int n;
+
+	for (n = 0; n < RANDOM_CASES; n++) {
+		/* Random sizes and alignments, around the 16 byte steps */
+		len = test_random(&seed) % (n < RANDOM_CASES / 2 ? 80 : MAX_LEN);
+		soff = test_random(&seed) % 16;
+		doff = test_random(&seed) % 16;
+		for (i = 0; i < len + soff; i++)
+			src[i] = test_random(&seed);
+
+		memset(out, '#', sizeof(out));
+		end = hex_encode(out + doff, src + soff, len);
+		ref_hex(ref, src + soff, len);
+		CHECK(end == out + doff + 2 * len,
+		      "hex_encode(%zu): wrong end", len);
+		CHECK(!memcmp(out + doff, ref, 2 * len),
+		      "hex_encode(%zu): %.*s != %.*s", len, (int)(2 * len),
+		      out + doff, (int)(2 * len), ref);
+		CHECK(out[doff + 2 * len] == '#',
+		      "hex_encode(%zu): wrote past the end", len);
+
+		memset(out, '#', sizeof(out));
+		end = hex_encode_le32(out + doff, src + soff, len / 4);
+		ref_le32(ref, src + soff, len / 4);
+		CHECK(end == out + doff + 8 * (len / 4),
+		      "hex_encode_le32(%zu): wrong end", len / 4);
+		CHECK(!memcmp(out + doff, ref, 8 * (len / 4)),
+		      "hex_encode_le32(%zu): %.*s != %.*s", len / 4,
+		      (int)(8 * (len / 4)), out + doff,
+		      (int)(8 * (len / 4)), ref);
+		CHECK(out[doff + 8 * (len / 4)] == '#',
+		      "hex_encode_le32(%zu): wrote past the end", len / 4);
+
+		uuid_le_str(out, src + soff);
+		ref_uuid(ref, src + soff);
+		CHECK(!strcmp(out, ref), "uuid_le_str: %s != %s", out, ref);
+	}
+}
+
+/* Known values, including the bytes that used to be sign extended */
+static void check_known(void)
+{
+	static const unsigned char guid[16] = {
+		0x14, 0x11, 0xbc, 0xa5, 0x64, 0x6f, 0xde, 0x4e,
+		0xb8, 0x63, 0x3e, 0x83, 0xed, 0x7c, 0x83, 0xb1,
+	};
+	char buf[UUID_STR_SIZE];
+	unsigned char uu[16];
+
+	uuid_le_str(buf, guid);
+	CHECK(!strcmp(buf, "a5bc1114-6f64-4ede-b863-3e83ed7c83b1"),
+	      "uuid_le_str: %s", buf);
+	CHECK(!uuid_le_parse(uu, buf) && !memcmp(uu, guid, 16),
+	      "uuid_le_parse: %s", buf);
+
+	*hex_encode(buf, "\xff\x80\x7f\x00", 4) = '\0';
+	CHECK(!strcmp(buf, "ff807f00"), "hex_encode: %s", buf);
+	*hex_encode_le32(buf, "\x78\x56\x34\xf2", 1) = '\0';
+	CHECK(!strcmp(buf, "f2345678"), "hex_encode_le32: %s", buf);
+}
+
+/* Nanoseconds per call of fn, encoding len bytes */
+#define BENCH(iters, call)						\
+	({								\
+		unsigned long long _t = test_now_ns();			\
+		unsigned long _i;					\
+									\
+		for (_i = 0; _i < (iters); _i++) {			\
+			call;						\
+			__asm__ __volatile__("" : : "r"(out) : "memory"); \
+		}							\
+		(double)(test_now_ns() - _t) / (iters);			\
+	})
+
+static void bench(void)
+{
+	static const size_t sizes[] = { 16, 64, 256, 1024 };
+	unsigned long iters;
+	double t, tref;
+	unsigned i;
+
+#ifdef __SSE2__
+	printf("# SSE2 encoders\n");
+#else
+	printf("# scalar encoders, built without SSE2\n");
+#endif
+	printf("# %-22s %10s %12s %8s\n", "encoder", "new ns", "snprintf ns",
+	       "speedup");
+
+	for (i = 0; i < sizeof(sizes) / sizeof(*sizes); i++) {
+		iters = test_iterations(20000000 / sizes[i]);
+
+		t = BENCH(iters, hex_encode(out, src, sizes[i]));
+		tref = BENCH(iters, ref_hex(ref, src, sizes[i]));
+		printf("# hex_encode %-11zu %10.1f %12.1f %7.1fx\n",
+		       sizes[i], t, tref, tref / t);
+
+		t = BENCH(iters, hex_encode_le32(out, src, sizes[i] / 4));
+		tref = BENCH(iters, ref_le32(ref, src, sizes[i] / 4));
+		printf("# hex_encode_le32 %-6zu %10.1f %12.1f %7.1fx\n",
+		       sizes[i], t, tref, tref / t);
+	}
+
+	iters = test_iterations(1000000);
+	t = BENCH(iters, uuid_le_str(out, src));
+	tref = BENCH(iters, ref_uuid(ref, src));
+	printf("# uuid_le_str %-10s %10.1f %12.1f %7.1fx\n", "",
+	       t, tref, tref / t);
+}
+
+int main(void)
+{
+	check_known();
+	check_random();
+	if (failures) {
+		fprintf(stderr, "%u failures\n", failures);
+		return 1;
+	}
+
+	bench();
+	return 0;
+}
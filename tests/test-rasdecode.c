@@ -0,0 +1,253 @@
+/*
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+*/
+
+/* Decodes known register sets through the librasdecode API */
+
+#include <errno.h>
+#include <string.h>
+#include "librasdecode.h"
+#include "tests.h"
+
+#define MAX_FIELDS	16
+
+struct fields {
+	unsigned	n;
+	char		name[MAX_FIELDS][32];
+	char		value[MAX_FIELDS][512];
+};
+
+static void add_field(void *priv, const char *name, const char *value,
+		      size_t len)
+{
+	struct fields *f = priv;
+
+	if (f->n == MAX_FIELDS)
+		return;
+	snprintf(f->name[f->n], sizeof(f->name[0]), "%s", name);
+	snprintf(f->value[f->n], sizeof(f->value[0]), "%.*s", (int)len,
+		 value);
+	f->n++;
+}
+
+static const char *field(const struct fields *f, const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < f->n; i++)
+		if (!strcmp(f->name[i], name))
+			return f->value[i];
+	return NULL;
+}
+
+#define CHECK_FIELD(f, name, expected)					\
+	do {								\
+		const char *_v = field(f, name);			\
+		CHECK(_v && !strcmp(_v, expected),			\
+		      "%s: got \"%s\", expected \"%s\"", name,		\
+		      _v ? _v : "(none)", expected);			\
+	} while (0)
+
+static void count_log(void *priv, int level, const char *msg)
+{
+	(*(unsigned *)priv)++;
+	CHECK(*msg && msg[strlen(msg) - 1] != '\n', "log message: \"%s\"", msg);
+}
+
+static void test_cpus(void)
+{
+	static const struct rasdec_cpu unknown = { "CyrixInstead", 5, 4 };
+	static const struct rasdec_cpu hsw = { "GenuineIntel", 6, 0x3f };
+	static const struct rasdec_cpu future = { "GenuineIntel", 6, 0xff };
+	struct rasdec_ctx *ctx;
+	unsigned logged = 0;
+
+	errno = 0;
+	CHECK(!rasdec_new(&unknown) && errno == EINVAL,
+	      "unknown CPU accepted");
+	CHECK(!rasdec_new(NULL) && errno == EINVAL, "NULL CPU accepted");
+
+	ctx = rasdec_new(&hsw);
+	CHECK(ctx, "rasdec_new(Haswell) failed");
+	if (ctx)
+		CHECK(!strcmp(rasdec_cpu_name(ctx),
+			      "Intel Xeon v3 (Haswell) EP/EX"),
+		      "Haswell name: %s", rasdec_cpu_name(ctx));
+	rasdec_free(ctx);
+
+	/* Unknown models are told to the log callback only */
+	rasdec_set_log(count_log, &logged);
+	ctx = rasdec_new(&hsw);
+	rasdec_free(ctx);
+	CHECK(!logged, "Haswell: %u log messages", logged);
+	ctx = rasdec_new(&future);
+	CHECK(ctx, "rasdec_new(future Intel) failed");
+	rasdec_free(ctx);
+	CHECK(logged == 1, "future Intel: %u log messages", logged);
+	rasdec_set_log(NULL, NULL);
+}
+
+static void test_mce_intel(void)
+{
+	static const struct rasdec_cpu hsw = { "GenuineIntel", 6, 0x3f };
+	/* Corrected memory read error, at channel 1 */
+	static const struct rasdec_mce mem = {
+		.mcgcap = 0x1c09, .status = 0x8c00004000010091ULL,
+		.addr = 0x1234567000ULL, .misc = 0x140686, .bank = 7,
+		.cpu = 2,
+	};
+	/* Fatal internal timer error */
+	static const struct rasdec_mce timer = {
+		.mcgcap = 0x1c09, .mcgstatus = 0x5,
+		.status = 0xbe00000000800400ULL, .bank = 1,
+	};
+	struct rasdec_builder b = { add_field };
+	struct rasdec_ctx *ctx = rasdec_new(&hsw);
+	struct fields f;
+	int i;
+
+	if (!ctx) {
+		CHECK(0, "rasdec_new(Haswell) failed");
+		return;
+	}
+
+	/* The second time, it's served from the cache */
+	for (i = 0; i < 2; i++) {
+		memset(&f, 0, sizeof(f));
+		b.priv = &f;
+		CHECK(!rasdec_mce(ctx, &mem, &b), "memory MCE not decoded");
+		CHECK(f.n == 7, "memory MCE: %u fields", f.n);
+		CHECK_FIELD(&f, "error_msg",
+			    "MEMORY CONTROLLER RD_CHANNEL1_ERR Transaction: Memory read error");
+		CHECK_FIELD(&f, "mcistatus_msg", "Corrected_error");
+		CHECK_FIELD(&f, "mc_location", "n_errors=1");
+	}
+
+	memset(&f, 0, sizeof(f));
+	b.priv = &f;
+	CHECK(!rasdec_mce(ctx, &timer, &b), "timer MCE not decoded");
+	CHECK_FIELD(&f, "error_msg", "Internal Timer error");
+	CHECK_FIELD(&f, "mcgstatus_msg", "mcgstatus=5 RIPV MCIP");
+	CHECK_FIELD(&f, "mcistatus_msg",
+		    "Uncorrected_error Error_enabled Processor_context_corrupt");
+
+	rasdec_free(ctx);
+}
+
+static void test_mce_amd(void)
+{
+	static const struct rasdec_cpu k8 = { "AuthenticAMD", 0xf, 0 };
+	/* Northbridge ECC error, on a data read */
+	static const struct rasdec_mce nb = {
+		.status = 0x9c00000000000135ULL, .bank = 4,
+	};
+	struct rasdec_builder b = { add_field };
+	struct rasdec_ctx *ctx = rasdec_new(&k8);
+	struct fields f;
+
+	if (!ctx) {
+		CHECK(0, "rasdec_new(K8) failed");
+		return;
+	}
+
+	memset(&f, 0, sizeof(f));
+	b.priv = &f;
+	CHECK(!rasdec_mce(ctx, &nb, &b), "K8 MCE not decoded");
+	CHECK_FIELD(&f, "bank_name", "northbridge (bank=4)");
+	CHECK_FIELD(&f, "error_msg",
+		    "Northbridge RAM ECC error ECC syndrome = 0 (misc error valid)  memory/cache error 'data read mem transaction, data transaction, level 1'");
+
+	rasdec_free(ctx);
+}
+
+static void test_aer(void)
+{
+	static const struct rasdec_aer corrected = {
+		.status = 0x41, .severity = 0,
+	};
+	static const struct rasdec_aer fatal = {
+		.status = 0x1010, .severity = 2,
+	};
+	struct rasdec_builder b = { add_field };
+	struct fields f;
+
+	memset(&f, 0, sizeof(f));
+	b.priv = &f;
+	CHECK(!rasdec_aer(&corrected, &b), "corrected AER not decoded");
+	CHECK_FIELD(&f, "error_type", "Corrected");
+	CHECK_FIELD(&f, "msg", "Receiver Error, Bad TLP");
+
+	memset(&f, 0, sizeof(f));
+	b.priv = &f;
+	CHECK(!rasdec_aer(&fatal, &b), "fatal AER not decoded");
+	CHECK_FIELD(&f, "error_type", "Fatal");
+	CHECK_FIELD(&f, "msg", "Data Link Protocol, Poisoned TLP");
+}
+
+static void test_extlog(void)
+{
+	/* CPER memory error section, with node, module, bank and row */
+	static const uint8_t cper[80] = {
+		[0] = 0x68, [1] = 0x01,
+		[8] = 1, [12] = 3, [14] = 2, [18] = 0x34, [19] = 0x12,
+	};
+	struct rasdec_extlog ev = {
+		.err_seq = 7, .etype = 2, .severity = 2,
+		.address = 0x1000abc0, .pa_mask_lsb = 6,
+		.fru_text = "DIMM A1",
+		.cper_data = cper, .cper_data_len = sizeof(cper),
+	};
+	struct rasdec_builder b = { add_field };
+	struct fields f;
+
+	memset(&f, 0, sizeof(f));
+	b.priv = &f;
+	CHECK(!rasdec_extlog(&ev, &b), "extlog not decoded");
+	CHECK_FIELD(&f, "severity", "corrected");
+	CHECK_FIELD(&f, "error_type", "single-bit ECC");
+	CHECK_FIELD(&f, "msg",
+		    "7 corrected error: single-bit ECC physical addr: 0x1000abc0 mask: 0xffffffffffffffc0 (node: 1 module: 3 bank: 2 row: 4660) DIMM A1 ");
+
+	/* Sections shorter than the CPER memory error have no fields */
+	memset(&f, 0, sizeof(f));
+	ev.cper_data_len = 16;
+	ev.fru_text = NULL;
+	CHECK(!rasdec_extlog(&ev, &b), "short extlog not decoded");
+	CHECK_FIELD(&f, "msg",
+		    "7 corrected error: single-bit ECC physical addr: 0x1000abc0 mask: 0xffffffffffffffc0  ");
+
+	memset(&f, 0, sizeof(f));
+	ev.cper_data_len = 0x10000;
+	CHECK(rasdec_extlog(&ev, &b) == -EINVAL && !f.n,
+	      "oversized extlog accepted");
+}
+
+int main(void)
+{
+	test_cpus();
+	test_mce_intel();
+	test_mce_amd();
+	test_aer();
+	test_extlog();
+	rasdec_thread_exit();
+
+	if (failures) {
+		fprintf(stderr, "%u failures\n", failures);
+		return 1;
+	}
+	return 0;
+}